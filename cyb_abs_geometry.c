@@ -0,0 +1,210 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The cached absolute nodes geometry
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_types.h"
+#include "cyb_error.h"
+#include "cyb_structs.h"
+
+/* -----------------------------------------------------------------------------
+ * The cache keeps the absolute rects of the SM nodes (the point nodes have
+ * zero size) computed in one top-down pass over the node tree in the document
+ * node coordinates format. The cache is built on the first access and lives
+ * until it is invalidated explicitly or by the geometry functions. In the local
+ * center coordinates the top-level nodes are relative to the document bounding
+ * rect center (the bounding rect uses the node format, so (x, y) is its center).
+ * ----------------------------------------------------------------------------- */
+
+struct _CyberiadaAbsoluteCache {
+	CyberiadaGeometryCoordFormat format;   /* the node coordinates format used to build the cache */
+	double                       origin_x; /* the top-level nodes origin used to build the cache */
+	double                       origin_y;
+	CyberiadaRect*               rects;
+	size_t                       count;
+	CyberiadaHash                index;    /* node -> rect */
+};
+
+/* the top-level nodes origin in the document node coordinates format */
+static void cyberiada_abs_origin(CyberiadaDocument* doc, double* x, double* y)
+{
+	*x = *y = 0.0;
+	if (doc->node_coord_format == coordLocalCenter && doc->bounding_rect) {
+		*x = doc->bounding_rect->x;
+		*y = doc->bounding_rect->y;
+	}
+}
+
+/* parent is the absolute rect of the nearest ancestor with geometry (NULL for the top level) */
+static int cyberiada_abs_fill(struct _CyberiadaAbsoluteCache* cache, CyberiadaNode* nodes,
+							  const CyberiadaRect* parent)
+{
+	CyberiadaNode* node;
+	CyberiadaRect* r;
+	const CyberiadaRect* next_parent;
+	double ox = cache->origin_x, oy = cache->origin_y;
+	int res;
+
+	if (parent) {
+		if (cache->format == coordLeftTop) {
+			ox = parent->x;
+			oy = parent->y;
+		} else if (cache->format == coordLocalCenter) {
+			ox = parent->x + parent->width / 2.0;
+			oy = parent->y + parent->height / 2.0;
+		}
+	}
+
+	for (node = nodes; node; node = node->next) {
+		next_parent = parent;
+		if (node->geometry_rect || node->geometry_point) {
+			r = cache->rects + cache->count++;
+			if (node->geometry_rect) {
+				r->x = ox + node->geometry_rect->x;
+				r->y = oy + node->geometry_rect->y;
+				r->width = node->geometry_rect->width;
+				r->height = node->geometry_rect->height;
+				if (cache->format == coordLocalCenter) {
+					r->x -= r->width / 2.0;
+					r->y -= r->height / 2.0;
+				}
+			} else {
+				r->x = ox + node->geometry_point->x;
+				r->y = oy + node->geometry_point->y;
+				r->width = r->height = 0.0;
+			}
+			if (cyberiada_hash_put(&(cache->index), node, r) != 0) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			next_parent = r;
+		}
+		if (node->children) {
+			if ((res = cyberiada_abs_fill(cache, node->children, next_parent)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_abs_build(CyberiadaDocument* doc, CyberiadaSM* sm)
+{
+	struct _CyberiadaAbsoluteCache* cache;
+	size_t count = cyberiada_count_nodes(sm->nodes);
+	int res;
+
+	cache = (struct _CyberiadaAbsoluteCache*)malloc(sizeof(struct _CyberiadaAbsoluteCache));
+	if (!cache) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(cache, 0, sizeof(struct _CyberiadaAbsoluteCache));
+	cache->format = doc->node_coord_format;
+	cyberiada_abs_origin(doc, &(cache->origin_x), &(cache->origin_y));
+	if (count) {
+		cache->rects = (CyberiadaRect*)malloc(sizeof(CyberiadaRect) * count);
+		if (!cache->rects) {
+			free(cache);
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	if (cyberiada_hash_init(&(cache->index), 0, count) != 0) {
+		if (cache->rects) free(cache->rects);
+		free(cache);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	
+	res = cyberiada_abs_fill(cache, sm->nodes, NULL);
+	if (res != CYBERIADA_NO_ERROR) {
+		cyberiada_hash_free(&(cache->index));
+		if (cache->rects) free(cache->rects);
+		free(cache);
+		return res;
+	}
+
+	sm->absolute_cache = cache;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_node_absolute_rect(CyberiadaDocument* doc, CyberiadaSM* sm,
+								 const CyberiadaNode* node, CyberiadaRect* rect)
+{
+	CyberiadaRect* r;
+	double ox, oy;
+	int res;
+
+	if (!doc || !sm || !node || !rect) {
+		ERROR("Cannot get node absolute rect: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	if (doc->node_coord_format == coordNone) {
+		return CYBERIADA_NOT_FOUND;
+	}
+	
+	cyberiada_abs_origin(doc, &ox, &oy);
+	if (sm->absolute_cache &&
+		(sm->absolute_cache->format != doc->node_coord_format ||
+		 sm->absolute_cache->origin_x != ox || sm->absolute_cache->origin_y != oy)) {
+		cyberiada_invalidate_sm_absolute_geometry(sm);
+	}
+	if (!sm->absolute_cache) {
+		if ((res = cyberiada_abs_build(doc, sm)) != CYBERIADA_NO_ERROR) {
+			ERROR("Cannot build the absolute geometry cache: %d\n", res);
+			return res;
+		}
+	}
+
+	r = (CyberiadaRect*)cyberiada_hash_get(&(sm->absolute_cache->index), node);
+	if (!r) {
+		return CYBERIADA_NOT_FOUND;
+	}
+	*rect = *r;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_invalidate_sm_absolute_geometry(CyberiadaSM* sm)
+{
+	if (!sm) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (sm->absolute_cache) {
+		cyberiada_hash_free(&(sm->absolute_cache->index));
+		if (sm->absolute_cache->rects) free(sm->absolute_cache->rects);
+		free(sm->absolute_cache);
+		sm->absolute_cache = NULL;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_invalidate_document_absolute_geometry(CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	if (!doc) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		cyberiada_invalidate_sm_absolute_geometry(sm);
+	}
+	return CYBERIADA_NO_ERROR;
+}
@@ -300,6 +300,7 @@ int cyberiada_decode_state_block_action(const char* text, CyberiadaAction** acti
 
 int cyberiada_decode_state_actions(const char* text, CyberiadaAction** actions, CyberiadaRegexps* regexps)
 {
+	CyberiadaAction** tail = actions;
 	int res;
 	size_t buffer_len;
 	char *buffer, *start, *block, *block2, *next;
@@ -355,7 +356,9 @@ int cyberiada_decode_state_actions(const char* text, CyberiadaAction** actions,
 			continue ;
 		}
 
-		if ((res = cyberiada_decode_state_block_action(start, actions, regexps)) != CYBERIADA_NO_ERROR) {
+		/* keep the tail of the list to append the blocks in constant time */
+		while (*tail) tail = &((*tail)->next);
+		if ((res = cyberiada_decode_state_block_action(start, tail, regexps)) != CYBERIADA_NO_ERROR) {
 			ERROR("error while decoding state block %s: %d\n", start, res);
 			return res;
 		}
@@ -368,6 +371,7 @@ int cyberiada_decode_state_actions(const char* text, CyberiadaAction** actions,
 
 int cyberiada_decode_state_actions_yed(const char* text, CyberiadaAction** actions, CyberiadaRegexps* regexps)
 {
+	CyberiadaAction** tail = actions;
 	int res;
 	char *buffer, *next, *start, *block, *buffer2 = NULL;
 	size_t buffer_len;
@@ -475,7 +479,9 @@ int cyberiada_decode_state_actions_yed(const char* text, CyberiadaAction** actio
 	}
 	for (list = sections_list; list; list = list->next) {
 		start = (char*)list->key;
-		if ((res = cyberiada_decode_state_block_action(start, actions, regexps)) != CYBERIADA_NO_ERROR) {
+		/* keep the tail of the list to append the blocks in constant time */
+		while (*tail) tail = &((*tail)->next);
+		if ((res = cyberiada_decode_state_block_action(start, tail, regexps)) != CYBERIADA_NO_ERROR) {
 			ERROR("error while decoding state block %s: %d\n", start, res);
 			break;
 		}
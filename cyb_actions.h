@@ -43,6 +43,38 @@ extern "C" {
 	int cyberiada_join_action_doubles(CyberiadaAction** action);
 	int cyberiada_remove_empty_actions(CyberiadaAction** action);
 	int cyberiada_compare_node_actions(CyberiadaAction* n1action, CyberiadaAction* n2action, int* compare_flags);
+
+	/* the action regexps shared by the raw actions of the document & compiled on the first access */
+	typedef struct _CyberiadaRawRegexps {
+		CyberiadaRegexps      regexps;
+		int                   flattened;       /* the regexps kind */
+		int                   ready;           /* the regexps are compiled */
+		size_t                refs;            /* the raw actions & the decoder references (not atomic) */
+	} CyberiadaRawRegexps;
+
+	/* the raw actions text kept by the lazy actions decoding with the decoder state */
+	typedef struct _CyberiadaRawAction {
+		char*                 text;
+		size_t                text_len;
+		int                   yed;             /* the YED node actions format */
+		int                   berloga_legacy;  /* the regexps state at the moment of the decoding */
+		int                   flags;           /* the import flags (the action entries options) */
+		CyberiadaRawRegexps*  shared;          /* the shared regexps of the document */
+	} CyberiadaRawAction;
+
+	/* the raw action is NULL for the blank text; shared is the decoder reference to the shared */
+	/* regexps of the document (created on the first raw action)                                */
+	int cyberiada_new_raw_action(const char* text, int yed, CyberiadaRegexps* regexps, int flags,
+								 CyberiadaRawRegexps** shared, CyberiadaRawAction** raw);
+	CyberiadaRawAction* cyberiada_copy_raw_action(const CyberiadaRawAction* src);
+	/* drop the decoder reference to the shared regexps at the end of the decoding */
+	void cyberiada_release_raw_regexps(CyberiadaRawRegexps** shared);
+	int cyberiada_destroy_raw_action(CyberiadaRawAction* raw);
+
+	/* decode the lazy actions of the document for the exporters keeping the raw text; the detach */
+	/* frees the decoded actions, so the document is left as it was (the regexps stay compiled)   */
+	int cyberiada_attach_lazy_actions(CyberiadaDocument* doc);
+	void cyberiada_detach_lazy_actions(CyberiadaDocument* doc);
 	
 #ifdef __cplusplus
 }
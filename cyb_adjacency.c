@@ -0,0 +1,211 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The SM adjacency index: incoming & outgoing edges of the nodes
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_error.h"
+
+/* -----------------------------------------------------------------------------
+ * The index is stored in the compressed sparse row form: the nodes are found
+ * by the SM ordinals (the pre-order numbers of the nodes), the outgoing and incoming edges of the node i are the
+ * ranges [offsets[i], offsets[i + 1]) of the out/in edge arrays. The offsets
+ * and the edge arrays share one allocation, the edges keep the SM list order.
+ * The index is built on the first access (or by the decoder) and lives until
+ * it is invalidated explicitly or by the SM editor.
+ * ----------------------------------------------------------------------------- */
+
+struct _CyberiadaAdjacency {
+	size_t                      nodes_count;
+	size_t                      edges_count;
+	size_t*                     out_offsets;     /* nodes_count + 1 items */
+	size_t*                     in_offsets;      /* nodes_count + 1 items */
+	CyberiadaEdge**             out_edges;
+	CyberiadaEdge**             in_edges;
+};
+
+/* the node ordinal + 1 or 0 if the node is not indexed */
+static size_t cyberiada_adj_ordinal(CyberiadaSM* sm, const CyberiadaNode* node)
+{
+	size_t ordinal;
+	if (!node ||
+		cyberiada_node_ordinal(sm, node, &ordinal) != CYBERIADA_NO_ERROR ||
+		ordinal >= sm->adjacency->nodes_count) {
+		return 0;
+	}
+	return ordinal + 1;
+}
+
+static int cyberiada_adj_build(CyberiadaSM* sm)
+{
+	struct _CyberiadaAdjacency* adj;
+	CyberiadaNode* const* nodes;
+	CyberiadaEdge* edge;
+	size_t *out_pos, *in_pos;
+	size_t i, n, e, s, t;
+	char* block;
+	int res;
+
+	/* the ordinals first: building them drops the indexes keyed by the ordinals */
+	if ((res = cyberiada_sm_ordinal_nodes(sm, &nodes, &n)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	adj = (struct _CyberiadaAdjacency*)malloc(sizeof(struct _CyberiadaAdjacency));
+	if (!adj) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(adj, 0, sizeof(struct _CyberiadaAdjacency));
+	sm->adjacency = adj;
+	adj->nodes_count = n;
+	for (edge = sm->edges; edge; edge = edge->next) {
+		adj->edges_count++;
+	}
+
+	n = adj->nodes_count;
+	e = adj->edges_count;
+	/* offsets (with the fill positions) and the edges in one block */
+	block = (char*)malloc(sizeof(size_t) * (n + 1) * 2 + sizeof(CyberiadaEdge*) * (e * 2 + 1));
+	if (!block) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	adj->out_offsets = (size_t*)block;
+	adj->in_offsets = adj->out_offsets + n + 1;
+	adj->out_edges = (CyberiadaEdge**)(adj->in_offsets + n + 1);
+	adj->in_edges = adj->out_edges + e;
+	memset(adj->out_offsets, 0, sizeof(size_t) * (n + 1) * 2);
+
+	/* count the degrees shifted by one and accumulate them to the offsets */
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if ((s = cyberiada_adj_ordinal(sm, edge->source)) != 0) {
+			adj->out_offsets[s]++;
+		}
+		if ((t = cyberiada_adj_ordinal(sm, edge->target)) != 0) {
+			adj->in_offsets[t]++;
+		}
+	}
+	for (i = 1; i <= n; i++) {
+		adj->out_offsets[i] += adj->out_offsets[i - 1];
+		adj->in_offsets[i] += adj->in_offsets[i - 1];
+	}
+
+	out_pos = (size_t*)malloc(sizeof(size_t) * (n + 1) * 2);
+	if (!out_pos) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	in_pos = out_pos + n + 1;
+	memcpy(out_pos, adj->out_offsets, sizeof(size_t) * (n + 1) * 2);
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if ((s = cyberiada_adj_ordinal(sm, edge->source)) != 0) {
+			adj->out_edges[out_pos[s - 1]++] = edge;
+		}
+		if ((t = cyberiada_adj_ordinal(sm, edge->target)) != 0) {
+			adj->in_edges[in_pos[t - 1]++] = edge;
+		}
+	}
+	free(out_pos);
+
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_sm_build_adjacency(CyberiadaSM* sm)
+{
+	int res;
+
+	if (!sm) {
+		ERROR("Cannot build SM adjacency: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	cyberiada_invalidate_sm_adjacency(sm);
+	if ((res = cyberiada_adj_build(sm)) != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot build the SM adjacency index: %d\n", res);
+		cyberiada_invalidate_sm_adjacency(sm);
+	}
+	return res;
+}
+
+static int cyberiada_node_adjacent_edges(CyberiadaSM* sm, const CyberiadaNode* node, int out,
+										 CyberiadaEdge* const** edges, size_t* count)
+{
+	size_t ordinal;
+	int res;
+
+	if (!sm || !node || !edges || !count) {
+		ERROR("Cannot get node edges: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	if (!sm->adjacency && (res = cyberiada_sm_build_adjacency(sm)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	ordinal = cyberiada_adj_ordinal(sm, node);
+	if (!ordinal) {
+		return CYBERIADA_NOT_FOUND;
+	}
+	if (out) {
+		*edges = sm->adjacency->out_edges + sm->adjacency->out_offsets[ordinal - 1];
+		*count = sm->adjacency->out_offsets[ordinal] - sm->adjacency->out_offsets[ordinal - 1];
+	} else {
+		*edges = sm->adjacency->in_edges + sm->adjacency->in_offsets[ordinal - 1];
+		*count = sm->adjacency->in_offsets[ordinal] - sm->adjacency->in_offsets[ordinal - 1];
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_node_out_edges(CyberiadaSM* sm, const CyberiadaNode* node,
+							 CyberiadaEdge* const** edges, size_t* count)
+{
+	return cyberiada_node_adjacent_edges(sm, node, 1, edges, count);
+}
+
+int cyberiada_node_in_edges(CyberiadaSM* sm, const CyberiadaNode* node,
+							CyberiadaEdge* const** edges, size_t* count)
+{
+	return cyberiada_node_adjacent_edges(sm, node, 0, edges, count);
+}
+
+int cyberiada_invalidate_sm_adjacency(CyberiadaSM* sm)
+{
+	if (!sm) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (sm->adjacency) {
+		if (sm->adjacency->out_offsets) free(sm->adjacency->out_offsets);
+		free(sm->adjacency);
+		sm->adjacency = NULL;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_invalidate_document_adjacency(CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	if (!doc) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		cyberiada_invalidate_sm_adjacency(sm);
+	}
+	return CYBERIADA_NO_ERROR;
+}
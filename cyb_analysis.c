@@ -0,0 +1,493 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The SM graph analysis: reachability, dead states & strongly connected components
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_error.h"
+#include "cyb_graph.h"
+
+/* -----------------------------------------------------------------------------
+ * The analysis runs over the compact view of the SM: the nodes are numbered by
+ * the SM ordinals (pre-order), the transitions and the container entries (a composite state or
+ * a region enters its initial pseudostates and its regions) are stored in the
+ * compressed sparse row form. The hierarchy is respected on the traversal: a
+ * state inherits the transitions of its ancestors, so the successors of the
+ * state are its own transition targets, the ancestors transition targets and
+ * its entries. The nearest ancestor with transitions is precomputed top-down
+ * for every node, so the successors iteration skips the ancestors without
+ * transitions. The view takes O(V + E) memory, the traversals are iterative.
+ * ----------------------------------------------------------------------------- */
+
+#define ANALYSIS_NONE ((size_t)-1)
+
+typedef struct {
+	CyberiadaSM*                sm;
+	size_t                      count;
+	CyberiadaNode* const*       nodes;           /* the SM ordinal nodes */
+	size_t*                     parent;          /* parent ordinal or ANALYSIS_NONE */
+	size_t*                     inherit;         /* the nearest ancestor with transitions or ANALYSIS_NONE */
+	size_t*                     out_offsets;     /* count + 1 items */
+	size_t*                     out_targets;
+	size_t*                     enter_offsets;   /* count + 1 items */
+	size_t*                     enter_targets;
+} CyberiadaAnalysisGraph;
+
+typedef struct {
+	size_t                      v;               /* the vertex */
+	size_t                      holder;          /* the vertex or its ancestor that owns the current range */
+	size_t                      pos;
+	int                         enter;           /* iterating the entries */
+} CyberiadaAnalysisIter;
+
+static int cyberiada_analysis_is_comment(const CyberiadaNode* node)
+{
+	return node->type == cybNodeComment || node->type == cybNodeFormalComment;
+}
+
+/* the states inherit the transitions of their ancestors, the pseudostates are transient */
+static int cyberiada_analysis_is_state(const CyberiadaNode* node)
+{
+	return (node->type == cybNodeSimpleState ||
+			node->type == cybNodeCompositeState ||
+			node->type == cybNodeSubmachineState);
+}
+
+static size_t cyberiada_analysis_ordinal(CyberiadaAnalysisGraph* g, const CyberiadaNode* node)
+{
+	size_t ordinal;
+	if (!node || cyberiada_node_ordinal(g->sm, node, &ordinal) != CYBERIADA_NO_ERROR) {
+		return ANALYSIS_NONE;
+	}
+	return ordinal;
+}
+
+/* the parents in the pre-order of the node tree (the order of the SM ordinals) */
+static void cyberiada_analysis_parents(CyberiadaAnalysisGraph* g, CyberiadaNode* node, size_t parent, size_t* counter)
+{
+	size_t i;
+	for (; node; node = node->next) {
+		i = (*counter)++;
+		g->parent[i] = parent;
+		if (node->children) {
+			cyberiada_analysis_parents(g, node->children, i, counter);
+		}
+	}
+}
+
+static void cyberiada_analysis_graph_free(CyberiadaAnalysisGraph* g)
+{
+	if (g->parent) free(g->parent);
+	if (g->out_targets) free(g->out_targets);
+	if (g->enter_targets) free(g->enter_targets);
+}
+
+static int cyberiada_analysis_graph_build(CyberiadaAnalysisGraph* g, CyberiadaSM* sm)
+{
+	CyberiadaEdge* edge;
+	CyberiadaNode* child;
+	size_t n, i, s, t, edges = 0, entries = 0, counter = 0;
+	size_t *out_pos;
+	int res;
+
+	memset(g, 0, sizeof(CyberiadaAnalysisGraph));
+	g->sm = sm;
+	/* rebuild the ordinals since the SM could be changed */
+	if ((res = cyberiada_sm_build_ordinals(sm)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_sm_ordinal_nodes(sm, &(g->nodes), &n)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	g->count = n;
+
+	/* parents, inherited transitions & offsets in one block */
+	g->parent = (size_t*)malloc(sizeof(size_t) * (n * 4 + 2));
+	if (!g->parent) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	g->inherit = g->parent + n;
+	g->out_offsets = g->inherit + n;
+	g->enter_offsets = g->out_offsets + n + 1;
+	memset(g->out_offsets, 0, sizeof(size_t) * (n + 1) * 2);
+	cyberiada_analysis_parents(g, sm->nodes, ANALYSIS_NONE, &counter);
+
+	/* count the transitions (shifted by one) & the entries */
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if (edge->type == cybEdgeComment) continue;
+		s = cyberiada_analysis_ordinal(g, edge->source);
+		t = cyberiada_analysis_ordinal(g, edge->target);
+		if (s != ANALYSIS_NONE && t != ANALYSIS_NONE) {
+			g->out_offsets[s + 1]++;
+			edges++;
+		}
+	}
+	for (i = 0; i < n; i++) {
+		for (child = g->nodes[i]->children; child; child = child->next) {
+			if (child->type == cybNodeInitial || child->type == cybNodeRegion) {
+				g->enter_offsets[i + 1]++;
+				entries++;
+			}
+		}
+	}
+	for (i = 1; i <= n; i++) {
+		g->out_offsets[i] += g->out_offsets[i - 1];
+		g->enter_offsets[i] += g->enter_offsets[i - 1];
+	}
+	/* pre-order: the parents go first */
+	for (i = 0; i < n; i++) {
+		s = g->parent[i];
+		if (s == ANALYSIS_NONE) {
+			g->inherit[i] = ANALYSIS_NONE;
+		} else if (g->out_offsets[s + 1] > g->out_offsets[s]) {
+			g->inherit[i] = s;
+		} else {
+			g->inherit[i] = g->inherit[s];
+		}
+	}
+
+	g->out_targets = (size_t*)malloc(sizeof(size_t) * (edges + 1));
+	g->enter_targets = (size_t*)malloc(sizeof(size_t) * (entries + 1));
+	out_pos = (size_t*)malloc(sizeof(size_t) * (n + 1));
+	if (!g->out_targets || !g->enter_targets || !out_pos) {
+		if (out_pos) free(out_pos);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	memcpy(out_pos, g->out_offsets, sizeof(size_t) * (n + 1));
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if (edge->type == cybEdgeComment) continue;
+		s = cyberiada_analysis_ordinal(g, edge->source);
+		t = cyberiada_analysis_ordinal(g, edge->target);
+		if (s != ANALYSIS_NONE && t != ANALYSIS_NONE) {
+			g->out_targets[out_pos[s]++] = t;
+		}
+	}
+	for (i = 0; i < n; i++) {
+		s = g->enter_offsets[i];
+		for (child = g->nodes[i]->children; child; child = child->next) {
+			if (child->type == cybNodeInitial || child->type == cybNodeRegion) {
+				g->enter_targets[s++] = cyberiada_analysis_ordinal(g, child);
+			}
+		}
+	}
+	free(out_pos);
+
+	return CYBERIADA_NO_ERROR;
+}
+
+static void cyberiada_analysis_iter_init(CyberiadaAnalysisGraph* g, CyberiadaAnalysisIter* it, size_t v)
+{
+	it->v = v;
+	it->holder = v;
+	it->pos = g->out_offsets[v];
+	it->enter = 0;
+}
+
+/* get the next successor of the iterator vertex; returns 0 if there are no more successors */
+static int cyberiada_analysis_iter_next(CyberiadaAnalysisGraph* g, CyberiadaAnalysisIter* it, size_t* w)
+{
+	while (!it->enter) {
+		if (it->pos < g->out_offsets[it->holder + 1]) {
+			*w = g->out_targets[it->pos++];
+			return 1;
+		}
+		if (cyberiada_analysis_is_state(g->nodes[it->v]) && g->inherit[it->holder] != ANALYSIS_NONE) {
+			it->holder = g->inherit[it->holder];
+			it->pos = g->out_offsets[it->holder];
+		} else {
+			it->enter = 1;
+			it->pos = g->enter_offsets[it->v];
+		}
+	}
+	if (it->pos < g->enter_offsets[it->v + 1]) {
+		*w = g->enter_targets[it->pos++];
+		return 1;
+	}
+	return 0;
+}
+
+static int cyberiada_analysis_reachability(CyberiadaAnalysisGraph* g, size_t start, char* reached)
+{
+	CyberiadaAnalysisIter it;
+	size_t *queue, head = 0, tail = 0, v, w;
+
+	queue = (size_t*)malloc(sizeof(size_t) * (g->count + 1));
+	if (!queue) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	reached[start] = 1;
+	queue[tail++] = start;
+	while (head < tail) {
+		v = queue[head++];
+		cyberiada_analysis_iter_init(g, &it, v);
+		while (cyberiada_analysis_iter_next(g, &it, &w)) {
+			if (!reached[w]) {
+				reached[w] = 1;
+				queue[tail++] = w;
+			}
+		}
+	}
+	free(queue);
+
+	/* the ancestors of the reached nodes are active as well (pre-order: parents go first) */
+	for (v = g->count; v-- > 0;) {
+		if (reached[v] && g->parent[v] != ANALYSIS_NONE) {
+			reached[g->parent[v]] = 1;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* iterative Tarjan algorithm; the non-trivial components (more than one node or a self-loop) are collected */
+static int cyberiada_analysis_scc(CyberiadaAnalysisGraph* g, CyberiadaSMAnalysis* a)
+{
+	CyberiadaAnalysisIter* frames;
+	size_t *index, *low, *stack, *offsets;
+	char *on_stack, *self_loop;
+	size_t n = g->count, counter = 0, sp = 0, fp, s, v, w, first, scc_size, pos;
+	size_t offsets_capacity = 16;
+	int res = CYBERIADA_NO_ERROR;
+
+	index = (size_t*)malloc(sizeof(size_t) * (n * 3 + 1));
+	frames = (CyberiadaAnalysisIter*)malloc(sizeof(CyberiadaAnalysisIter) * (n + 1));
+	on_stack = (char*)malloc(n * 2 + 1);
+	a->scc_nodes = (CyberiadaNode**)malloc(sizeof(CyberiadaNode*) * (n + 1));
+	offsets = (size_t*)malloc(sizeof(size_t) * offsets_capacity);
+	if (!index || !frames || !on_stack || !a->scc_nodes || !offsets) {
+		if (index) free(index);
+		if (frames) free(frames);
+		if (on_stack) free(on_stack);
+		if (offsets) free(offsets);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	low = index + n;
+	stack = low + n;
+	self_loop = on_stack + n;
+	memset(on_stack, 0, n * 2);
+	for (v = 0; v < n; v++) index[v] = ANALYSIS_NONE;
+	offsets[0] = 0;
+	a->scc_count = 0;
+
+	for (s = 0; s < n && res == CYBERIADA_NO_ERROR; s++) {
+		if (index[s] != ANALYSIS_NONE || cyberiada_analysis_is_comment(g->nodes[s])) {
+			continue;
+		}
+		fp = 0;
+		index[s] = low[s] = counter++;
+		stack[sp++] = s;
+		on_stack[s] = 1;
+		cyberiada_analysis_iter_init(g, frames + fp++, s);
+
+		while (fp > 0) {
+			v = frames[fp - 1].v;
+			if (cyberiada_analysis_iter_next(g, frames + fp - 1, &w)) {
+				if (w == v) {
+					self_loop[v] = 1;
+				}
+				if (index[w] == ANALYSIS_NONE) {
+					index[w] = low[w] = counter++;
+					stack[sp++] = w;
+					on_stack[w] = 1;
+					cyberiada_analysis_iter_init(g, frames + fp++, w);
+				} else if (on_stack[w] && index[w] < low[v]) {
+					low[v] = index[w];
+				}
+				continue;
+			}
+
+			/* all successors are visited */
+			if (low[v] == index[v]) {
+				first = sp;
+				do {
+					w = stack[--first];
+					on_stack[w] = 0;
+				} while (w != v);
+				scc_size = sp - first;
+				if (scc_size > 1 || self_loop[v]) {
+					if (a->scc_count + 2 > offsets_capacity) {
+						size_t* new_offsets;
+						offsets_capacity *= 2;
+						new_offsets = (size_t*)realloc(offsets, sizeof(size_t) * offsets_capacity);
+						if (!new_offsets) {
+							res = CYBERIADA_MEMORY_ERROR;
+							break;
+						}
+						offsets = new_offsets;
+					}
+					pos = offsets[a->scc_count];
+					for (; first < sp; first++) {
+						a->scc_nodes[pos++] = g->nodes[stack[first]];
+					}
+					offsets[++a->scc_count] = pos;
+				}
+				sp -= scc_size;
+			}
+			fp--;
+			if (fp > 0 && low[v] < low[frames[fp - 1].v]) {
+				low[frames[fp - 1].v] = low[v];
+			}
+		}
+	}
+
+	if (res == CYBERIADA_NO_ERROR) {
+		a->scc_offsets = offsets;
+	} else {
+		free(offsets);
+	}
+
+	free(index);
+	free(frames);
+	free(on_stack);
+	return res;
+}
+
+static int cyberiada_analysis_push(CyberiadaNode*** array, size_t* count, CyberiadaNode* node)
+{
+	CyberiadaNode** new_array;
+	/* grow to the powers of two */
+	if ((*count & (*count - 1)) == 0) {
+		new_array = (CyberiadaNode**)realloc(*array, sizeof(CyberiadaNode*) * (*count ? *count * 2 : 8));
+		if (!new_array) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		*array = new_array;
+	}
+	(*array)[(*count)++] = node;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_analysis_reports(CyberiadaAnalysisGraph* g, const char* reached, CyberiadaSMAnalysis* a)
+{
+	CyberiadaAnalysisIter it;
+	CyberiadaNode *node, *child;
+	size_t v, w, p;
+	int res = CYBERIADA_NO_ERROR, substates;
+
+	for (v = 0; v < g->count && res == CYBERIADA_NO_ERROR; v++) {
+		node = g->nodes[v];
+		if (node->type == cybNodeSM || cyberiada_analysis_is_comment(node)) {
+			continue;
+		}
+
+		if (reached && !reached[v]) {
+			res = cyberiada_analysis_push(&(a->unreachable), &(a->unreachable_count), node);
+			p = g->parent[v];
+			if (res == CYBERIADA_NO_ERROR &&
+				(node->type == cybNodeCompositeState || node->type == cybNodeRegion) &&
+				(p == ANALYSIS_NONE || reached[p])) {
+				res = cyberiada_analysis_push(&(a->unreachable_composites), &(a->unreachable_composites_count), node);
+			}
+		}
+
+		if (res == CYBERIADA_NO_ERROR &&
+			node->type != cybNodeFinal && node->type != cybNodeTerminate && node->type != cybNodeRegion) {
+			substates = 0;
+			for (child = node->children; child; child = child->next) {
+				if (!cyberiada_analysis_is_comment(child)) {
+					substates = 1;
+					break;
+				}
+			}
+			if (!substates) {
+				/* the own & inherited transitions only, the leaf nodes have no entries */
+				cyberiada_analysis_iter_init(g, &it, v);
+				if (!cyberiada_analysis_iter_next(g, &it, &w)) {
+					res = cyberiada_analysis_push(&(a->dead), &(a->dead_count), node);
+				}
+			}
+		}
+	}
+	return res;
+}
+
+int cyberiada_analyze_sm(CyberiadaSM* sm, CyberiadaSMAnalysis** analysis)
+{
+	CyberiadaAnalysisGraph g;
+	CyberiadaSMAnalysis* a;
+	CyberiadaNode* initial = NULL;
+	char* reached = NULL;
+	int res;
+
+	if (!sm || !sm->nodes || !analysis) {
+		ERROR("Cannot analyze SM: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	a = (CyberiadaSMAnalysis*)malloc(sizeof(CyberiadaSMAnalysis));
+	if (!a) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(a, 0, sizeof(CyberiadaSMAnalysis));
+
+	/* the reachability is checked if the SM has the top-level initial pseudostate */
+	if (cyberiada_graph_get_initial_pseudostate(sm, &initial, NULL, 0) == CYBERIADA_NO_ERROR) {
+		a->initial = initial;
+	}
+
+	do {
+		if ((res = cyberiada_analysis_graph_build(&g, sm)) != CYBERIADA_NO_ERROR) {
+			break;
+		}
+		if (initial) {
+			reached = (char*)malloc(g.count + 1);
+			if (!reached) {
+				res = CYBERIADA_MEMORY_ERROR;
+				break;
+			}
+			memset(reached, 0, g.count + 1);
+			res = cyberiada_analysis_reachability(&g, cyberiada_analysis_ordinal(&g, initial), reached);
+			if (res != CYBERIADA_NO_ERROR) {
+				break;
+			}
+		}
+		if ((res = cyberiada_analysis_reports(&g, reached, a)) != CYBERIADA_NO_ERROR) {
+			break;
+		}
+		res = cyberiada_analysis_scc(&g, a);
+	} while (0);
+
+	if (reached) free(reached);
+	cyberiada_analysis_graph_free(&g);
+
+	if (res != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot analyze SM %s: %d\n", sm->nodes->id, res);
+		cyberiada_destroy_sm_analysis(a);
+		return res;
+	}
+
+	*analysis = a;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_destroy_sm_analysis(CyberiadaSMAnalysis* analysis)
+{
+	if (!analysis) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (analysis->unreachable) free(analysis->unreachable);
+	if (analysis->unreachable_composites) free(analysis->unreachable_composites);
+	if (analysis->dead) free(analysis->dead);
+	if (analysis->scc_nodes) free(analysis->scc_nodes);
+	if (analysis->scc_offsets) free(analysis->scc_offsets);
+	free(analysis);
+	return CYBERIADA_NO_ERROR;
+}
@@ -0,0 +1,1005 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The compact binary document format
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "cyberiadaml.h"
+#include "cyb_structs.h"
+#include "cyb_error.h"
+#include "cyb_actions.h"
+
+/* -----------------------------------------------------------------------------
+ * The binary format layout (all integers are unsigned LEB128 varints,
+ * all doubles are 8-byte little-endian IEEE 754 values):
+ *
+ * magic "CYBB", version
+ * string table: count, (length, bytes)*     string ref 0 = NULL, ref i = string i - 1
+ * document:     format ref, geometry formats, bounding rect, metainformation
+ * SMs:          count, (root nodes count, node*, edges count, edge*)*
+ * node:         type, id/title/formal title/color refs, collapsed flag, parts mask,
+ *               geometry, comment data, link, actions, children count, node*
+ * edge:         type, id/source id/target id refs, source/target node index + 1,
+ *               color ref, parts mask, action, comment subject, geometry
+ * ----------------------------------------------------------------------------- */
+
+#define CYBERIADA_BINARY_MAGIC            "CYBB"
+#define CYBERIADA_BINARY_MAGIC_LEN        4
+#define CYBERIADA_BINARY_VERSION          1
+#define CYBERIADA_BINARY_MAX_DEPTH        1024
+#define CYBERIADA_BINARY_INITIAL_SIZE     4096
+
+#define CYBERIADA_BINARY_NODE_POINT       0x1
+#define CYBERIADA_BINARY_NODE_RECT        0x2
+#define CYBERIADA_BINARY_NODE_COMMENT     0x4
+#define CYBERIADA_BINARY_NODE_LINK        0x8
+
+#define CYBERIADA_BINARY_EDGE_COMMENT     0x1
+#define CYBERIADA_BINARY_EDGE_LABEL_POINT 0x2
+#define CYBERIADA_BINARY_EDGE_LABEL_RECT  0x4
+#define CYBERIADA_BINARY_EDGE_POLYLINE    0x8
+#define CYBERIADA_BINARY_EDGE_SOURCE      0x10
+#define CYBERIADA_BINARY_EDGE_TARGET      0x20
+
+/* -----------------------------------------------------------------------------
+ * Binary writer
+ * ----------------------------------------------------------------------------- */
+
+typedef struct {
+	unsigned char*     data;
+	size_t             size;
+	size_t             capacity;
+} CyberiadaBinaryBuffer;
+
+typedef struct {
+	CyberiadaBinaryBuffer body;
+	CyberiadaHash         strings;      /* string -> index + 1 */
+	const char**          string_list;
+	size_t                string_list_size;
+	size_t                string_count;
+	CyberiadaHash         nodes;        /* node -> SM node index + 1 */
+} CyberiadaBinaryWriter;
+
+static int cyberiada_binary_reserve(CyberiadaBinaryBuffer* buf, size_t len)
+{
+	unsigned char* data;
+	size_t capacity;
+	if (buf->size + len <= buf->capacity) {
+		return CYBERIADA_NO_ERROR;
+	}
+	capacity = buf->capacity ? buf->capacity : CYBERIADA_BINARY_INITIAL_SIZE;
+	while (capacity < buf->size + len) capacity <<= 1;
+	data = (unsigned char*)realloc(buf->data, capacity);
+	if (!data) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	buf->data = data;
+	buf->capacity = capacity;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_put_bytes(CyberiadaBinaryBuffer* buf, const void* bytes, size_t len)
+{
+	if (cyberiada_binary_reserve(buf, len) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (len) {
+		memcpy(buf->data + buf->size, bytes, len);
+		buf->size += len;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_put_varint(CyberiadaBinaryBuffer* buf, uint64_t value)
+{
+	unsigned char bytes[10];
+	size_t len = 0;
+	do {
+		bytes[len] = (unsigned char)(value & 0x7F);
+		value >>= 7;
+		if (value) bytes[len] |= 0x80;
+		len++;
+	} while (value);
+	return cyberiada_binary_put_bytes(buf, bytes, len);
+}
+
+static int cyberiada_binary_put_double(CyberiadaBinaryBuffer* buf, double value)
+{
+	unsigned char bytes[8];
+	uint64_t bits;
+	size_t i;
+	memcpy(&bits, &value, sizeof(bits));
+	for (i = 0; i < 8; i++) {
+		bytes[i] = (unsigned char)(bits >> (8 * i));
+	}
+	return cyberiada_binary_put_bytes(buf, bytes, 8);
+}
+
+static int cyberiada_binary_put_string(CyberiadaBinaryWriter* w, const char* s)
+{
+	size_t index;
+	void* found;
+	if (!s) {
+		return cyberiada_binary_put_varint(&(w->body), 0);
+	}
+	found = cyberiada_hash_get(&(w->strings), s);
+	if (found) {
+		index = (size_t)(uintptr_t)found;
+	} else {
+		if (w->string_count == w->string_list_size) {
+			size_t new_size = w->string_list_size ? w->string_list_size * 2 : 64;
+			const char** list = (const char**)realloc((void*)w->string_list, sizeof(const char*) * new_size);
+			if (!list) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			w->string_list = list;
+			w->string_list_size = new_size;
+		}
+		w->string_list[w->string_count++] = s;
+		index = w->string_count;
+		if (cyberiada_hash_put(&(w->strings), s, (void*)(uintptr_t)index) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	return cyberiada_binary_put_varint(&(w->body), index);
+}
+
+static int cyberiada_binary_put_point(CyberiadaBinaryBuffer* buf, const CyberiadaPoint* p)
+{
+	if (cyberiada_binary_put_double(buf, p->x) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_double(buf, p->y) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_put_rect(CyberiadaBinaryBuffer* buf, const CyberiadaRect* r)
+{
+	if (cyberiada_binary_put_double(buf, r->x) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_double(buf, r->y) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_double(buf, r->width) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_double(buf, r->height) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_put_actions(CyberiadaBinaryWriter* w, CyberiadaAction* actions)
+{
+	CyberiadaAction* a;
+	size_t count = 0;
+	for (a = actions; a; a = a->next) count++;
+	if (cyberiada_binary_put_varint(&(w->body), count) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	for (a = actions; a; a = a->next) {
+		if (cyberiada_binary_put_varint(&(w->body), a->type) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, a->trigger) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, a->guard) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, a->behavior) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_index_nodes(CyberiadaBinaryWriter* w, CyberiadaNode* nodes, size_t* index)
+{
+	CyberiadaNode* n;
+	for (n = nodes; n; n = n->next) {
+		(*index)++;
+		if (cyberiada_hash_put(&(w->nodes), n, (void*)(uintptr_t)(*index)) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (n->children) {
+			if (cyberiada_binary_index_nodes(w, n->children, index) != CYBERIADA_NO_ERROR) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_write_nodes(CyberiadaBinaryWriter* w, CyberiadaNode* nodes)
+{
+	CyberiadaNode* n;
+	CyberiadaBinaryBuffer* buf = &(w->body);
+	size_t count = 0, mask;
+	for (n = nodes; n; n = n->next) count++;
+	if (cyberiada_binary_put_varint(buf, count) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	for (n = nodes; n; n = n->next) {
+		mask = 0;
+		if (n->geometry_point) mask |= CYBERIADA_BINARY_NODE_POINT;
+		if (n->geometry_rect) mask |= CYBERIADA_BINARY_NODE_RECT;
+		if (n->comment_data) mask |= CYBERIADA_BINARY_NODE_COMMENT;
+		if (n->link) mask |= CYBERIADA_BINARY_NODE_LINK;
+		if (cyberiada_binary_put_varint(buf, n->type) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, n->id) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, n->title) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, n->formal_title) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, n->color) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_varint(buf, (unsigned char)n->collapsed_flag) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_varint(buf, mask) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (n->geometry_point && cyberiada_binary_put_point(buf, n->geometry_point) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (n->geometry_rect && cyberiada_binary_put_rect(buf, n->geometry_rect) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (n->comment_data) {
+			if (cyberiada_binary_put_string(w, n->comment_data->body) != CYBERIADA_NO_ERROR ||
+				cyberiada_binary_put_string(w, n->comment_data->markup) != CYBERIADA_NO_ERROR) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+		}
+		if (n->link && cyberiada_binary_put_string(w, n->link->ref) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (cyberiada_binary_put_actions(w, n->actions) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_write_nodes(w, n->children) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_write_edges(CyberiadaBinaryWriter* w, CyberiadaEdge* edges)
+{
+	CyberiadaEdge* e;
+	CyberiadaPolyline* pl;
+	CyberiadaBinaryBuffer* buf = &(w->body);
+	size_t count = 0, mask;
+	for (e = edges; e; e = e->next) count++;
+	if (cyberiada_binary_put_varint(buf, count) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	for (e = edges; e; e = e->next) {
+		mask = 0;
+		if (e->comment_subject) mask |= CYBERIADA_BINARY_EDGE_COMMENT;
+		if (e->geometry_label_point) mask |= CYBERIADA_BINARY_EDGE_LABEL_POINT;
+		if (e->geometry_label_rect) mask |= CYBERIADA_BINARY_EDGE_LABEL_RECT;
+		if (e->geometry_polyline) mask |= CYBERIADA_BINARY_EDGE_POLYLINE;
+		if (e->geometry_source_point) mask |= CYBERIADA_BINARY_EDGE_SOURCE;
+		if (e->geometry_target_point) mask |= CYBERIADA_BINARY_EDGE_TARGET;
+		if (cyberiada_binary_put_varint(buf, e->type) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, e->id) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, e->source_id) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, e->target_id) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_varint(buf, (uintptr_t)cyberiada_hash_get(&(w->nodes), e->source)) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_varint(buf, (uintptr_t)cyberiada_hash_get(&(w->nodes), e->target)) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, e->color) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_varint(buf, mask) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_actions(w, e->action) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (e->comment_subject) {
+			if (cyberiada_binary_put_varint(buf, e->comment_subject->type) != CYBERIADA_NO_ERROR ||
+				cyberiada_binary_put_string(w, e->comment_subject->fragment) != CYBERIADA_NO_ERROR) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+		}
+		if (e->geometry_label_point && cyberiada_binary_put_point(buf, e->geometry_label_point) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (e->geometry_label_rect && cyberiada_binary_put_rect(buf, e->geometry_label_rect) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (e->geometry_polyline) {
+			count = 0;
+			for (pl = e->geometry_polyline; pl; pl = pl->next) count++;
+			if (cyberiada_binary_put_varint(buf, count) != CYBERIADA_NO_ERROR) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			for (pl = e->geometry_polyline; pl; pl = pl->next) {
+				if (cyberiada_binary_put_point(buf, &(pl->point)) != CYBERIADA_NO_ERROR) {
+					return CYBERIADA_MEMORY_ERROR;
+				}
+			}
+		}
+		if (e->geometry_source_point && cyberiada_binary_put_point(buf, e->geometry_source_point) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (e->geometry_target_point && cyberiada_binary_put_point(buf, e->geometry_target_point) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_write_meta(CyberiadaBinaryWriter* w, CyberiadaMetainformation* meta)
+{
+	CyberiadaMetaStringList* sl;
+	CyberiadaBinaryBuffer* buf = &(w->body);
+	size_t count = 0;
+	if (!meta) {
+		return cyberiada_binary_put_varint(buf, 0);
+	}
+	for (sl = meta->strings; sl; sl = sl->next) count++;
+	if (cyberiada_binary_put_varint(buf, 1) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_string(w, meta->standard_version) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_varint(buf, (unsigned char)meta->transition_order_flag) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_varint(buf, (unsigned char)meta->event_propagation_flag) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_varint(buf, count) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	for (sl = meta->strings; sl; sl = sl->next) {
+		if (cyberiada_binary_put_string(w, sl->name) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_string(w, sl->value) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_write_document(CyberiadaBinaryWriter* w, CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	CyberiadaBinaryBuffer* buf = &(w->body);
+	size_t count = 0, index;
+	if (cyberiada_binary_put_string(w, doc->format) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_varint(buf, doc->geometry_format) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_varint(buf, doc->node_coord_format) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_varint(buf, doc->edge_coord_format) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_varint(buf, doc->edge_pl_coord_format) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_varint(buf, doc->edge_geom_format) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_put_varint(buf, doc->bounding_rect ? 1 : 0) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (doc->bounding_rect && cyberiada_binary_put_rect(buf, doc->bounding_rect) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (cyberiada_binary_write_meta(w, doc->meta_info) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	for (sm = doc->state_machines; sm; sm = sm->next) count++;
+	if (cyberiada_binary_put_varint(buf, count) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		index = 0;
+		cyberiada_hash_free(&(w->nodes));
+		if (cyberiada_hash_init(&(w->nodes), 0, 0) != 0 ||
+			cyberiada_binary_index_nodes(w, sm->nodes, &index) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_write_nodes(w, sm->nodes) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_write_edges(w, sm->edges) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_encode_sm_document_binary(CyberiadaDocument* doc, char** buffer, size_t* buffer_size)
+{
+	CyberiadaBinaryWriter w;
+	CyberiadaBinaryBuffer out;
+	size_t i, len;
+	int res = CYBERIADA_NO_ERROR;
+
+	if (!doc || !buffer || !buffer_size) {
+		ERROR("Bad parameters to encode the binary document\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	/* the lazy actions are decoded for the encoding only, the document keeps the raw text */
+	if ((res = cyberiada_attach_lazy_actions(doc)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	*buffer = NULL;
+	*buffer_size = 0;
+
+	memset(&w, 0, sizeof(CyberiadaBinaryWriter));
+	memset(&out, 0, sizeof(CyberiadaBinaryBuffer));
+	if (cyberiada_hash_init(&(w.strings), 1, 0) != 0) {
+		cyberiada_detach_lazy_actions(doc);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	do {
+		if (cyberiada_binary_write_document(&w, doc) != CYBERIADA_NO_ERROR) {
+			res = CYBERIADA_MEMORY_ERROR;
+			break;
+		}
+		if (cyberiada_binary_put_bytes(&out, CYBERIADA_BINARY_MAGIC, CYBERIADA_BINARY_MAGIC_LEN) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_varint(&out, CYBERIADA_BINARY_VERSION) != CYBERIADA_NO_ERROR ||
+			cyberiada_binary_put_varint(&out, w.string_count) != CYBERIADA_NO_ERROR) {
+			res = CYBERIADA_MEMORY_ERROR;
+			break;
+		}
+		for (i = 0; i < w.string_count; i++) {
+			len = strlen(w.string_list[i]);
+			if (cyberiada_binary_put_varint(&out, len) != CYBERIADA_NO_ERROR ||
+				cyberiada_binary_put_bytes(&out, w.string_list[i], len) != CYBERIADA_NO_ERROR) {
+				res = CYBERIADA_MEMORY_ERROR;
+				break;
+			}
+		}
+		if (res != CYBERIADA_NO_ERROR) break;
+		if (cyberiada_binary_put_bytes(&out, w.body.data, w.body.size) != CYBERIADA_NO_ERROR) {
+			res = CYBERIADA_MEMORY_ERROR;
+			break;
+		}
+	} while (0);
+
+	cyberiada_detach_lazy_actions(doc);
+	if (w.body.data) free(w.body.data);
+	if (w.string_list) free((void*)w.string_list);
+	cyberiada_hash_free(&(w.strings));
+	cyberiada_hash_free(&(w.nodes));
+
+	if (res != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot encode the binary document: %d\n", res);
+		if (out.data) free(out.data);
+		return res;
+	}
+
+	*buffer = (char*)out.data;
+	*buffer_size = out.size;
+	return CYBERIADA_NO_ERROR;
+}
+
+/* -----------------------------------------------------------------------------
+ * Binary reader
+ * ----------------------------------------------------------------------------- */
+
+typedef struct {
+	const unsigned char*  data;
+	size_t                size;
+	size_t                pos;
+	const unsigned char** strings;      /* string start positions in the buffer */
+	size_t*               string_lens;
+	size_t                string_count;
+	CyberiadaNode**       nodes;        /* the current SM nodes by index */
+	size_t                nodes_count;
+	size_t                nodes_size;
+} CyberiadaBinaryReader;
+
+static int cyberiada_binary_get_varint(CyberiadaBinaryReader* r, uint64_t* value)
+{
+	uint64_t result = 0;
+	unsigned int shift = 0;
+	unsigned char byte;
+	do {
+		if (r->pos >= r->size || shift > 63) {
+			ERROR("Bad binary document varint at %lu\n", (unsigned long)r->pos);
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		byte = r->data[r->pos++];
+		result |= (uint64_t)(byte & 0x7F) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	*value = result;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_get_size(CyberiadaBinaryReader* r, size_t* value)
+{
+	uint64_t v;
+	if (cyberiada_binary_get_varint(r, &v) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	*value = (size_t)v;
+	return CYBERIADA_NO_ERROR;
+}
+
+/* read the number of the following items, each item occupies at least one byte */
+static int cyberiada_binary_get_count(CyberiadaBinaryReader* r, size_t* count)
+{
+	if (cyberiada_binary_get_size(r, count) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	if (*count > r->size - r->pos) {
+		ERROR("Bad binary document item count %lu\n", (unsigned long)*count);
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_get_double(CyberiadaBinaryReader* r, double* value)
+{
+	uint64_t bits = 0;
+	size_t i;
+	if (r->size - r->pos < 8) {
+		ERROR("Unexpected end of the binary document\n");
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	for (i = 0; i < 8; i++) {
+		bits |= (uint64_t)r->data[r->pos + i] << (8 * i);
+	}
+	r->pos += 8;
+	memcpy(value, &bits, sizeof(bits));
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_get_string(CyberiadaBinaryReader* r, char** target, size_t* target_len)
+{
+	size_t index;
+	char* s;
+	*target = NULL;
+	if (target_len) *target_len = 0;
+	if (cyberiada_binary_get_size(r, &index) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	if (index == 0) {
+		return CYBERIADA_NO_ERROR;
+	}
+	if (index > r->string_count) {
+		ERROR("Bad binary document string reference %lu\n", (unsigned long)index);
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	index--;
+	s = (char*)malloc(r->string_lens[index] + 1);
+	if (!s) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memcpy(s, r->strings[index], r->string_lens[index]);
+	s[r->string_lens[index]] = 0;
+	*target = s;
+	if (target_len) *target_len = r->string_lens[index];
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_get_point(CyberiadaBinaryReader* r, CyberiadaPoint** point)
+{
+	CyberiadaPoint* p = htree_new_point();
+	if (!p) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	*point = p;
+	if (cyberiada_binary_get_double(r, &(p->x)) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_get_double(r, &(p->y)) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_get_rect(CyberiadaBinaryReader* r, CyberiadaRect** rect)
+{
+	CyberiadaRect* rc = htree_new_rect();
+	if (!rc) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	*rect = rc;
+	if (cyberiada_binary_get_double(r, &(rc->x)) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_get_double(r, &(rc->y)) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_get_double(r, &(rc->width)) != CYBERIADA_NO_ERROR ||
+		cyberiada_binary_get_double(r, &(rc->height)) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_get_actions(CyberiadaBinaryReader* r, CyberiadaAction** actions)
+{
+	CyberiadaAction *a, *last = NULL;
+	size_t i, count;
+	uint64_t type;
+	int res;
+	if ((res = cyberiada_binary_get_count(r, &count)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (i = 0; i < count; i++) {
+		a = (CyberiadaAction*)malloc(sizeof(CyberiadaAction));
+		if (!a) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		memset(a, 0, sizeof(CyberiadaAction));
+		if (last) {
+			last->next = a;
+		} else {
+			*actions = a;
+		}
+		last = a;
+		if ((res = cyberiada_binary_get_varint(r, &type)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(a->trigger), &(a->trigger_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(a->guard), &(a->guard_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(a->behavior), &(a->behavior_len))) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		a->type = (CyberiadaActionType)type;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_read_nodes(CyberiadaBinaryReader* r, CyberiadaNode* parent,
+									   CyberiadaNode** nodes, size_t depth)
+{
+	CyberiadaNode *n, *last = NULL;
+	size_t i, count, mask;
+	uint64_t value;
+	int res;
+
+	if (depth > CYBERIADA_BINARY_MAX_DEPTH) {
+		ERROR("The binary document node tree is too deep\n");
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	if ((res = cyberiada_binary_get_count(r, &count)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (i = 0; i < count; i++) {
+		n = (CyberiadaNode*)malloc(sizeof(CyberiadaNode));
+		if (!n) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		memset(n, 0, sizeof(CyberiadaNode));
+		n->parent = parent;
+		if (last) {
+			last->next = n;
+		} else {
+			*nodes = n;
+		}
+		last = n;
+
+		if (r->nodes_count == r->nodes_size) {
+			size_t new_size = r->nodes_size ? r->nodes_size * 2 : 64;
+			CyberiadaNode** new_nodes = (CyberiadaNode**)realloc(r->nodes, sizeof(CyberiadaNode*) * new_size);
+			if (!new_nodes) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			r->nodes = new_nodes;
+			r->nodes_size = new_size;
+		}
+		r->nodes[r->nodes_count++] = n;
+
+		if ((res = cyberiada_binary_get_varint(r, &value)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		n->type = (CyberiadaNodeType)value;
+		if ((res = cyberiada_binary_get_string(r, &(n->id), &(n->id_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(n->title), &(n->title_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(n->formal_title), &(n->formal_title_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(n->color), &(n->color_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_varint(r, &value)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		n->collapsed_flag = (char)value;
+		if ((res = cyberiada_binary_get_size(r, &mask)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (mask & CYBERIADA_BINARY_NODE_POINT) {
+			if ((res = cyberiada_binary_get_point(r, &(n->geometry_point))) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if (mask & CYBERIADA_BINARY_NODE_RECT) {
+			if ((res = cyberiada_binary_get_rect(r, &(n->geometry_rect))) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if (mask & CYBERIADA_BINARY_NODE_COMMENT) {
+			n->comment_data = cyberiada_new_comment_data();
+			if (!n->comment_data) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			if ((res = cyberiada_binary_get_string(r, &(n->comment_data->body),
+												   &(n->comment_data->body_len))) != CYBERIADA_NO_ERROR ||
+				(res = cyberiada_binary_get_string(r, &(n->comment_data->markup),
+												   &(n->comment_data->markup_len))) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if (mask & CYBERIADA_BINARY_NODE_LINK) {
+			n->link = cyberiada_new_link(NULL);
+			if (!n->link) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			if ((res = cyberiada_binary_get_string(r, &(n->link->ref), &(n->link->ref_len))) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if ((res = cyberiada_binary_get_actions(r, &(n->actions))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_read_nodes(r, n, &(n->children), depth + 1)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_get_node_ref(CyberiadaBinaryReader* r, CyberiadaNode** node)
+{
+	size_t index;
+	if (cyberiada_binary_get_size(r, &index) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	if (index > r->nodes_count) {
+		ERROR("Bad binary document node reference %lu\n", (unsigned long)index);
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	*node = index ? r->nodes[index - 1] : NULL;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_read_edges(CyberiadaBinaryReader* r, CyberiadaEdge** edges)
+{
+	CyberiadaEdge *e, *last = NULL;
+	CyberiadaPolyline *pl, *last_pl;
+	size_t i, j, count, pl_count, mask;
+	uint64_t value;
+	int res;
+
+	if ((res = cyberiada_binary_get_count(r, &count)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (i = 0; i < count; i++) {
+		e = (CyberiadaEdge*)malloc(sizeof(CyberiadaEdge));
+		if (!e) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		memset(e, 0, sizeof(CyberiadaEdge));
+		if (last) {
+			last->next = e;
+		} else {
+			*edges = e;
+		}
+		last = e;
+
+		if ((res = cyberiada_binary_get_varint(r, &value)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		e->type = (CyberiadaEdgeType)value;
+		if ((res = cyberiada_binary_get_string(r, &(e->id), &(e->id_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(e->source_id), &(e->source_id_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(e->target_id), &(e->target_id_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_node_ref(r, &(e->source))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_node_ref(r, &(e->target))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(e->color), &(e->color_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_size(r, &mask)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_actions(r, &(e->action))) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (mask & CYBERIADA_BINARY_EDGE_COMMENT) {
+			if ((res = cyberiada_binary_get_varint(r, &value)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+			e->comment_subject = cyberiada_new_comment_subject((CyberiadaCommentSubjectType)value);
+			if (!e->comment_subject) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			if ((res = cyberiada_binary_get_string(r, &(e->comment_subject->fragment),
+												   &(e->comment_subject->fragment_len))) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if (mask & CYBERIADA_BINARY_EDGE_LABEL_POINT) {
+			if ((res = cyberiada_binary_get_point(r, &(e->geometry_label_point))) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if (mask & CYBERIADA_BINARY_EDGE_LABEL_RECT) {
+			if ((res = cyberiada_binary_get_rect(r, &(e->geometry_label_rect))) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if (mask & CYBERIADA_BINARY_EDGE_POLYLINE) {
+			if ((res = cyberiada_binary_get_count(r, &pl_count)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+			last_pl = NULL;
+			for (j = 0; j < pl_count; j++) {
+				pl = htree_new_polyline();
+				if (!pl) {
+					return CYBERIADA_MEMORY_ERROR;
+				}
+				if (last_pl) {
+					last_pl->next = pl;
+				} else {
+					e->geometry_polyline = pl;
+				}
+				last_pl = pl;
+				if ((res = cyberiada_binary_get_double(r, &(pl->point.x))) != CYBERIADA_NO_ERROR ||
+					(res = cyberiada_binary_get_double(r, &(pl->point.y))) != CYBERIADA_NO_ERROR) {
+					return res;
+				}
+			}
+		}
+		if (mask & CYBERIADA_BINARY_EDGE_SOURCE) {
+			if ((res = cyberiada_binary_get_point(r, &(e->geometry_source_point))) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if (mask & CYBERIADA_BINARY_EDGE_TARGET) {
+			if ((res = cyberiada_binary_get_point(r, &(e->geometry_target_point))) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_read_meta(CyberiadaBinaryReader* r, CyberiadaDocument* doc)
+{
+	CyberiadaMetaStringList *sl, *last = NULL;
+	CyberiadaMetainformation* meta;
+	size_t i, count;
+	uint64_t value;
+	int res;
+
+	if ((res = cyberiada_binary_get_varint(r, &value)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (!value) {
+		return CYBERIADA_NO_ERROR;
+	}
+	meta = (CyberiadaMetainformation*)malloc(sizeof(CyberiadaMetainformation));
+	if (!meta) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(meta, 0, sizeof(CyberiadaMetainformation));
+	doc->meta_info = meta;
+	if ((res = cyberiada_binary_get_string(r, &(meta->standard_version),
+										   &(meta->standard_version_len))) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_binary_get_varint(r, &value)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	meta->transition_order_flag = (char)value;
+	if ((res = cyberiada_binary_get_varint(r, &value)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	meta->event_propagation_flag = (char)value;
+	if ((res = cyberiada_binary_get_count(r, &count)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (i = 0; i < count; i++) {
+		sl = (CyberiadaMetaStringList*)malloc(sizeof(CyberiadaMetaStringList));
+		if (!sl) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		memset(sl, 0, sizeof(CyberiadaMetaStringList));
+		if (last) {
+			last->next = sl;
+		} else {
+			meta->strings = sl;
+		}
+		last = sl;
+		if ((res = cyberiada_binary_get_string(r, &(sl->name), &(sl->name_len))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_get_string(r, &(sl->value), &(sl->value_len))) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_binary_read_document(CyberiadaBinaryReader* r, CyberiadaDocument* doc)
+{
+	CyberiadaSM *sm, *last = NULL;
+	size_t i, count;
+	uint64_t value[6];
+	int res;
+
+	if (r->size < CYBERIADA_BINARY_MAGIC_LEN ||
+		memcmp(r->data, CYBERIADA_BINARY_MAGIC, CYBERIADA_BINARY_MAGIC_LEN) != 0) {
+		ERROR("Bad binary document magic\n");
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	r->pos = CYBERIADA_BINARY_MAGIC_LEN;
+	if ((res = cyberiada_binary_get_varint(r, value)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (value[0] != CYBERIADA_BINARY_VERSION) {
+		ERROR("Unsupported binary document version %lu\n", (unsigned long)value[0]);
+		return CYBERIADA_FORMAT_ERROR;
+	}
+
+	/* string table: the strings are referenced in place and copied on demand */
+	if ((res = cyberiada_binary_get_count(r, &count)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (count) {
+		r->strings = (const unsigned char**)malloc(sizeof(const unsigned char*) * count);
+		r->string_lens = (size_t*)malloc(sizeof(size_t) * count);
+		if (!r->strings || !r->string_lens) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		if ((res = cyberiada_binary_get_size(r, r->string_lens + i)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (r->string_lens[i] > r->size - r->pos) {
+			ERROR("Bad binary document string length %lu\n", (unsigned long)r->string_lens[i]);
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		r->strings[i] = r->data + r->pos;
+		r->pos += r->string_lens[i];
+	}
+	r->string_count = count;
+
+	if ((res = cyberiada_binary_get_string(r, &(doc->format), &(doc->format_len))) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (i = 0; i < 6; i++) {
+		if ((res = cyberiada_binary_get_varint(r, value + i)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	doc->geometry_format = (CyberiadaGeometryFormat)value[0];
+	doc->node_coord_format = (CyberiadaGeometryCoordFormat)value[1];
+	doc->edge_coord_format = (CyberiadaGeometryCoordFormat)value[2];
+	doc->edge_pl_coord_format = (CyberiadaGeometryCoordFormat)value[3];
+	doc->edge_geom_format = (CyberiadaGeometryEdgeFormat)value[4];
+	if (value[5]) {
+		if ((res = cyberiada_binary_get_rect(r, &(doc->bounding_rect))) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	if ((res = cyberiada_binary_read_meta(r, doc)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	if ((res = cyberiada_binary_get_count(r, &count)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (i = 0; i < count; i++) {
+		sm = cyberiada_new_sm();
+		if (!sm) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (last) {
+			last->next = sm;
+		} else {
+			doc->state_machines = sm;
+		}
+		last = sm;
+		r->nodes_count = 0;
+		if ((res = cyberiada_binary_read_nodes(r, NULL, &(sm->nodes), 0)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_binary_read_edges(r, &(sm->edges))) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+
+	if (r->pos != r->size) {
+		ERROR("Trailing data in the binary document\n");
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_decode_sm_document_binary(CyberiadaDocument* doc, const char* buffer, size_t buffer_size)
+{
+	CyberiadaBinaryReader r;
+	int res;
+
+	if (!doc || !buffer) {
+		ERROR("Bad parameters to decode the binary document\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	cyberiada_init_sm_document(doc);
+	memset(&r, 0, sizeof(CyberiadaBinaryReader));
+	r.data = (const unsigned char*)buffer;
+	r.size = buffer_size;
+
+	res = cyberiada_binary_read_document(&r, doc);
+
+	if (r.strings) free((void*)r.strings);
+	if (r.string_lens) free(r.string_lens);
+	if (r.nodes) free(r.nodes);
+
+	if (res != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot decode the binary document: %d\n", res);
+		cyberiada_cleanup_sm_document(doc);
+	}
+	return res;
+}
@@ -0,0 +1,229 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The SM builder: constant time appending of nodes, edges and actions
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_types.h"
+#include "cyb_error.h"
+#include "cyb_structs.h"
+
+/* -----------------------------------------------------------------------------
+ * The builder keeps the tails of the lists it appends to: the top-level nodes,
+ * the edges, the children of every parent node and every action list. The
+ * tails of the children and action lists are found on the first append to the
+ * list; a tail is moved forward if the list was extended outside the builder,
+ * so the builder stays correct while the appends are amortized O(1).
+ * ----------------------------------------------------------------------------- */
+
+struct _CyberiadaSMBuilder {
+	CyberiadaSM*                sm;
+	CyberiadaNode*              nodes_tail;
+	CyberiadaEdge*              edges_tail;
+	CyberiadaHash               children_tails;  /* parent node -> the last child */
+	CyberiadaHash               action_tails;    /* action list -> the last action */
+	CyberiadaHash               edge_ids;        /* edge id -> edge */
+	size_t                      nodes_count;
+	size_t                      edges_count;
+};
+
+int cyberiada_new_sm_builder(CyberiadaSM* sm, CyberiadaSMBuilder** builder)
+{
+	CyberiadaSMBuilder* b;
+	CyberiadaEdge* edge;
+
+	if (!sm || !builder) {
+		ERROR("Cannot create SM builder: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	b = (CyberiadaSMBuilder*)malloc(sizeof(CyberiadaSMBuilder));
+	if (!b) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(b, 0, sizeof(CyberiadaSMBuilder));
+	b->sm = sm;
+
+	if (cyberiada_hash_init(&(b->children_tails), 0, 0) != 0 ||
+		cyberiada_hash_init(&(b->action_tails), 0, 0) != 0 ||
+		cyberiada_hash_init(&(b->edge_ids), 1, 0) != 0) {
+		cyberiada_destroy_sm_builder(b);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	for (b->nodes_tail = sm->nodes; b->nodes_tail && b->nodes_tail->next; b->nodes_tail = b->nodes_tail->next);
+	b->nodes_count = cyberiada_count_nodes(sm->nodes);
+
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if (edge->id && *(edge->id) && !cyberiada_hash_get(&(b->edge_ids), edge->id) &&
+			cyberiada_hash_put(&(b->edge_ids), edge->id, edge) != 0) {
+			cyberiada_destroy_sm_builder(b);
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		b->edges_tail = edge;
+		b->edges_count++;
+	}
+
+	*builder = b;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_sm_builder_add_node(CyberiadaSMBuilder* builder, CyberiadaNode* parent, CyberiadaNode* node)
+{
+	CyberiadaNode* tail;
+
+	if (!builder || !node || node->next) {
+		ERROR("Cannot add node: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	if (parent) {
+		tail = (CyberiadaNode*)cyberiada_hash_get(&(builder->children_tails), parent);
+		if (!tail) {
+			tail = parent->children;
+		}
+		/* the new tail is registered before linking to leave the SM intact on error */
+		if (cyberiada_hash_put(&(builder->children_tails), parent, node) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		node->parent = parent;
+		if (tail) {
+			while (tail->next) tail = tail->next;
+			tail->next = node;
+		} else {
+			parent->children = node;
+		}
+	} else {
+		node->parent = NULL;
+		tail = builder->nodes_tail;
+		if (tail) {
+			while (tail->next) tail = tail->next;
+			tail->next = node;
+		} else {
+			builder->sm->nodes = node;
+		}
+		builder->nodes_tail = node;
+	}
+
+	builder->nodes_count += 1 + cyberiada_count_nodes(node->children);
+	return CYBERIADA_NO_ERROR;
+}
+
+CyberiadaEdge* cyberiada_sm_builder_find_edge(CyberiadaSMBuilder* builder, const char* id)
+{
+	if (!builder || !id) {
+		return NULL;
+	}
+	return (CyberiadaEdge*)cyberiada_hash_get(&(builder->edge_ids), id);
+}
+
+int cyberiada_sm_builder_add_edge(CyberiadaSMBuilder* builder, CyberiadaEdge* edge)
+{
+	CyberiadaEdge* tail;
+
+	if (!builder || !edge || edge->next) {
+		ERROR("Cannot add edge: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	if (edge->id && *(edge->id)) {
+		if (cyberiada_hash_get(&(builder->edge_ids), edge->id)) {
+			ERROR("The edge with the id %s already exists in the SM\n", edge->id);
+			return CYBERIADA_BAD_PARAMETER;
+		}
+		if (cyberiada_hash_put(&(builder->edge_ids), edge->id, edge) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+
+	tail = builder->edges_tail;
+	if (tail) {
+		while (tail->next) tail = tail->next;
+		tail->next = edge;
+	} else {
+		builder->sm->edges = edge;
+	}
+	builder->edges_tail = edge;
+	builder->edges_count++;
+	return CYBERIADA_NO_ERROR;
+}
+
+CyberiadaEdge* cyberiada_sm_builder_last_edge(CyberiadaSMBuilder* builder)
+{
+	if (!builder) {
+		return NULL;
+	}
+	if (builder->edges_tail) {
+		while (builder->edges_tail->next) builder->edges_tail = builder->edges_tail->next;
+	} else {
+		builder->edges_tail = builder->sm->edges;
+	}
+	return builder->edges_tail;
+}
+
+int cyberiada_sm_builder_add_action(CyberiadaSMBuilder* builder, CyberiadaAction** actions, CyberiadaAction* action)
+{
+	CyberiadaAction* tail;
+
+	if (!builder || !actions || !action || action->next) {
+		ERROR("Cannot add action: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	tail = (CyberiadaAction*)cyberiada_hash_get(&(builder->action_tails), actions);
+	if (!tail) {
+		tail = *actions;
+	}
+	if (cyberiada_hash_put(&(builder->action_tails), actions, action) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (tail) {
+		while (tail->next) tail = tail->next;
+		tail->next = action;
+	} else {
+		*actions = action;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_sm_builder_size(CyberiadaSMBuilder* builder, size_t* nodes, size_t* edges)
+{
+	if (!builder) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (nodes) *nodes = builder->nodes_count;
+	if (edges) *edges = builder->edges_count;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_destroy_sm_builder(CyberiadaSMBuilder* builder)
+{
+	if (!builder) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	cyberiada_hash_free(&(builder->children_tails));
+	cyberiada_hash_free(&(builder->action_tails));
+	cyberiada_hash_free(&(builder->edge_ids));
+	free(builder);
+	return CYBERIADA_NO_ERROR;
+}
@@ -0,0 +1,716 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The SM editor: indexed structural modifications of the SM graph
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_actions.h"
+#include "cyb_error.h"
+#include "cyb_structs.h"
+#include "cyb_types.h"
+
+/* -----------------------------------------------------------------------------
+ * The editor indexes the SM once: the node and edge identifiers, the link to
+ * every node and edge (the pointer that refers to the item: the parent
+ * children field, the SM list head or the previous sibling next field) and
+ * the incident edges of every node. The link makes the unlinking of an item
+ * from the singly linked list O(1), the incident edges make the node removal
+ * cascade to its edges without the scan of the SM edges list. The end of every
+ * children list (the next field of the last child) is kept like the end of the
+ * SM edges list, so the node is appended without the scan of its siblings.
+ *
+ * The editor of the shared document SM clones the document on the first
+ * mutation while the document is shared with other handles: the editor index
+ * is rebuilt for the SM copy and the node & edge arguments of the mutation
+ * are moved to the copy by their ordinals.
+ * ----------------------------------------------------------------------------- */
+
+typedef struct {
+	CyberiadaEdge**             edges;
+	size_t                      count;
+	size_t                      capacity;
+} CyberiadaEditorAdjacency;
+
+struct _CyberiadaSMEditor {
+	CyberiadaSM*                sm;
+	CyberiadaHash               node_ids;        /* node id -> node */
+	CyberiadaHash               edge_ids;        /* edge id -> edge */
+	CyberiadaHash               node_links;      /* node -> CyberiadaNode** referring to the node */
+	CyberiadaHash               edge_links;      /* edge -> CyberiadaEdge** referring to the edge */
+	CyberiadaHash               adjacency;       /* node -> CyberiadaEditorAdjacency */
+	CyberiadaHash               children_ends;   /* parent node -> the next field of the last child */
+	CyberiadaNode**             nodes_end;       /* the next field of the last top-level node */
+	CyberiadaEdge**             edges_end;       /* the next field of the last edge */
+	CyberiadaSharedDocument*    shared;          /* the shared document of the SM (NULL for the plain SM) */
+};
+
+/* -----------------------------------------------------------------------------
+ * Index helpers
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_editor_index_nodes(CyberiadaSMEditor* editor, CyberiadaNode** link, CyberiadaNode*** end)
+{
+	CyberiadaNode* node;
+	CyberiadaNode** children_end;
+	int res;
+
+	for (; *link; link = &((*link)->next)) {
+		node = *link;
+		if (node->id && *(node->id)) {
+			if (cyberiada_hash_get(&(editor->node_ids), node->id)) {
+				ERROR("The node with the id %s already exists in the SM\n", node->id);
+				return CYBERIADA_BAD_PARAMETER;
+			}
+			if (cyberiada_hash_put(&(editor->node_ids), node->id, node) != 0) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+		}
+		if (cyberiada_hash_put(&(editor->node_links), node, link) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (node->children) {
+			res = cyberiada_editor_index_nodes(editor, &(node->children), &children_end);
+			if (res != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+			if (cyberiada_hash_put(&(editor->children_ends), node, children_end) != 0) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+		}
+	}
+	*end = link;
+	return CYBERIADA_NO_ERROR;
+}
+
+static void cyberiada_editor_unindex_nodes(CyberiadaSMEditor* editor, CyberiadaNode* node, int siblings)
+{
+	CyberiadaEditorAdjacency* adj;
+
+	for (; node; node = siblings ? node->next : NULL) {
+		if (node->id && *(node->id) && cyberiada_hash_get(&(editor->node_ids), node->id) == node) {
+			cyberiada_hash_remove(&(editor->node_ids), node->id);
+		}
+		cyberiada_hash_remove(&(editor->node_links), node);
+		cyberiada_hash_remove(&(editor->children_ends), node);
+		adj = (CyberiadaEditorAdjacency*)cyberiada_hash_get(&(editor->adjacency), node);
+		if (adj) {
+			cyberiada_hash_remove(&(editor->adjacency), node);
+			if (adj->edges) free(adj->edges);
+			free(adj);
+		}
+		cyberiada_editor_unindex_nodes(editor, node->children, 1);
+	}
+}
+
+static int cyberiada_editor_adjacency_add(CyberiadaSMEditor* editor, CyberiadaNode* node, CyberiadaEdge* edge)
+{
+	CyberiadaEditorAdjacency* adj;
+	CyberiadaEdge** edges;
+
+	adj = (CyberiadaEditorAdjacency*)cyberiada_hash_get(&(editor->adjacency), node);
+	if (!adj) {
+		adj = (CyberiadaEditorAdjacency*)malloc(sizeof(CyberiadaEditorAdjacency));
+		if (!adj) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		memset(adj, 0, sizeof(CyberiadaEditorAdjacency));
+		if (cyberiada_hash_put(&(editor->adjacency), node, adj) != 0) {
+			free(adj);
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	if (adj->count == adj->capacity) {
+		adj->capacity = adj->capacity ? adj->capacity * 2 : 4;
+		edges = (CyberiadaEdge**)realloc(adj->edges, sizeof(CyberiadaEdge*) * adj->capacity);
+		if (!edges) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		adj->edges = edges;
+	}
+	adj->edges[adj->count++] = edge;
+	return CYBERIADA_NO_ERROR;
+}
+
+static void cyberiada_editor_adjacency_remove(CyberiadaSMEditor* editor, CyberiadaNode* node, CyberiadaEdge* edge)
+{
+	CyberiadaEditorAdjacency* adj;
+	size_t i;
+
+	if (!node) {
+		return ;
+	}
+	adj = (CyberiadaEditorAdjacency*)cyberiada_hash_get(&(editor->adjacency), node);
+	if (!adj) {
+		return ;
+	}
+	for (i = 0; i < adj->count; i++) {
+		if (adj->edges[i] == edge) {
+			adj->edges[i] = adj->edges[--adj->count];
+			return ;
+		}
+	}
+}
+
+static int cyberiada_editor_index_edge(CyberiadaSMEditor* editor, CyberiadaEdge* edge, CyberiadaEdge** link)
+{
+	int res;
+
+	if (edge->id && *(edge->id)) {
+		if (cyberiada_hash_get(&(editor->edge_ids), edge->id)) {
+			ERROR("The edge with the id %s already exists in the SM\n", edge->id);
+			return CYBERIADA_BAD_PARAMETER;
+		}
+		if (cyberiada_hash_put(&(editor->edge_ids), edge->id, edge) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	if (cyberiada_hash_put(&(editor->edge_links), edge, link) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (edge->source) {
+		res = cyberiada_editor_adjacency_add(editor, edge->source, edge);
+		if (res != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	if (edge->target && edge->target != edge->source) {
+		res = cyberiada_editor_adjacency_add(editor, edge->target, edge);
+		if (res != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* the composite state without (non-comment) substates becomes the simple one */
+static void cyberiada_editor_update_parent(CyberiadaNode* parent)
+{
+	CyberiadaNode* child;
+
+	if (!parent || parent->type != cybNodeCompositeState) {
+		return ;
+	}
+	for (child = parent->children; child; child = child->next) {
+		if (child->type != cybNodeComment && child->type != cybNodeFormalComment) {
+			return ;
+		}
+	}
+	parent->type = cybNodeSimpleState;
+}
+
+/* the next field of the last child of the parent (of the last top-level node for NULL) */
+static CyberiadaNode** cyberiada_editor_children_end(CyberiadaSMEditor* editor, CyberiadaNode* parent)
+{
+	CyberiadaNode** end;
+	if (!parent) {
+		end = editor->nodes_end;
+	} else {
+		end = (CyberiadaNode**)cyberiada_hash_get(&(editor->children_ends), parent);
+		if (!end) {
+			end = &(parent->children);
+		}
+	}
+	/* the appends made outside of the editor */
+	while (*end) end = &((*end)->next);
+	return end;
+}
+
+/* the missing end is found from the first child, so the end is dropped if it cannot be stored */
+static void cyberiada_editor_set_children_end(CyberiadaSMEditor* editor, CyberiadaNode* parent, CyberiadaNode** end)
+{
+	if (!parent) {
+		editor->nodes_end = end;
+	} else if (cyberiada_hash_put(&(editor->children_ends), parent, end) != 0) {
+		cyberiada_hash_remove(&(editor->children_ends), parent);
+	}
+}
+
+static void cyberiada_editor_unlink_node(CyberiadaSMEditor* editor, CyberiadaNode* node)
+{
+	CyberiadaNode** link = (CyberiadaNode**)cyberiada_hash_get(&(editor->node_links), node);
+	*link = node->next;
+	if (node->next) {
+		cyberiada_hash_put(&(editor->node_links), node->next, link);
+	} else {
+		/* the last child: the previous sibling link becomes the end */
+		cyberiada_editor_set_children_end(editor, node->parent, link);
+	}
+	node->next = NULL;
+}
+
+static int cyberiada_editor_append_node(CyberiadaSMEditor* editor, CyberiadaNode* parent, CyberiadaNode* node)
+{
+	CyberiadaNode** link = cyberiada_editor_children_end(editor, parent);
+	*link = node;
+	node->parent = parent;
+	cyberiada_editor_set_children_end(editor, parent, &(node->next));
+	if (cyberiada_hash_put(&(editor->node_links), node, link) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	return cyberiada_update_complex_state(node, parent);
+}
+
+static int cyberiada_editor_has_node(CyberiadaSMEditor* editor, CyberiadaNode* node)
+{
+	return cyberiada_hash_get(&(editor->node_links), node) != NULL;
+}
+
+/* -----------------------------------------------------------------------------
+ * The SM editor API
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_editor_index_sm(CyberiadaSMEditor* editor, CyberiadaSM* sm)
+{
+	CyberiadaEdge** link;
+	int res;
+
+	editor->sm = sm;
+	if (cyberiada_hash_init(&(editor->node_ids), 1, 0) != 0 ||
+		cyberiada_hash_init(&(editor->edge_ids), 1, 0) != 0 ||
+		cyberiada_hash_init(&(editor->node_links), 0, 0) != 0 ||
+		cyberiada_hash_init(&(editor->edge_links), 0, 0) != 0 ||
+		cyberiada_hash_init(&(editor->adjacency), 0, 0) != 0 ||
+		cyberiada_hash_init(&(editor->children_ends), 0, 0) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	res = cyberiada_editor_index_nodes(editor, &(sm->nodes), &(editor->nodes_end));
+	for (link = &(sm->edges); res == CYBERIADA_NO_ERROR && *link; link = &((*link)->next)) {
+		res = cyberiada_editor_index_edge(editor, *link, link);
+	}
+	editor->edges_end = link;
+	return res;
+}
+
+static void cyberiada_editor_free_index(CyberiadaSMEditor* editor);
+
+/* clone the shared document if it is shared with other handles and move the editor to the SM copy */
+static int cyberiada_editor_detach(CyberiadaSMEditor* editor, CyberiadaNode** node1, CyberiadaNode** node2,
+								   CyberiadaEdge** edge)
+{
+	CyberiadaDocument *doc, *clone;
+	CyberiadaSM* sm;
+	CyberiadaNode* const* nodes;
+	CyberiadaEdge* const* edges;
+	size_t refs, sm_index = 0, n1 = 0, n2 = 0, e = 0, nodes_count, edges_count;
+	int has_n1, has_n2, has_e, res;
+
+	if (!editor->shared ||
+		cyberiada_shared_document_refs(editor->shared, &refs) != CYBERIADA_NO_ERROR || refs <= 1) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	/* the ordinals of the arguments in the shared SM (the foreign ones are kept as is) */
+	has_n1 = node1 && *node1 && cyberiada_node_ordinal(editor->sm, *node1, &n1) == CYBERIADA_NO_ERROR;
+	has_n2 = node2 && *node2 && cyberiada_node_ordinal(editor->sm, *node2, &n2) == CYBERIADA_NO_ERROR;
+	has_e = edge && *edge && cyberiada_edge_ordinal(editor->sm, *edge, &e) == CYBERIADA_NO_ERROR;
+
+	doc = cyberiada_shared_document_read(editor->shared);
+	for (sm = doc->state_machines; sm && sm != editor->sm; sm = sm->next) {
+		sm_index++;
+	}
+	if (!sm) {
+		ERROR("The editor SM is not found in the shared document\n");
+		return CYBERIADA_ASSERT;
+	}
+
+	if ((res = cyberiada_shared_document_write(editor->shared, &clone)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (sm = clone->state_machines; sm_index > 0; sm_index--) {
+		sm = sm->next;
+	}
+
+	cyberiada_editor_free_index(editor);
+	if ((res = cyberiada_editor_index_sm(editor, sm)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_sm_ordinal_nodes(sm, &nodes, &nodes_count)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_sm_ordinal_edges(sm, &edges, &edges_count)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (has_n1 && n1 < nodes_count) *node1 = nodes[n1];
+	if (has_n2 && n2 < nodes_count) *node2 = nodes[n2];
+	if (has_e && e < edges_count) *edge = edges[e];
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_new_sm_editor(CyberiadaSM* sm, CyberiadaSMEditor** editor)
+{
+	CyberiadaSMEditor* ed;
+	int res;
+
+	if (!sm || !editor) {
+		ERROR("Cannot create SM editor: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	ed = (CyberiadaSMEditor*)malloc(sizeof(CyberiadaSMEditor));
+	if (!ed) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(ed, 0, sizeof(CyberiadaSMEditor));
+
+	res = cyberiada_editor_index_sm(ed, sm);
+	if (res != CYBERIADA_NO_ERROR) {
+		cyberiada_destroy_sm_editor(ed);
+		return res;
+	}
+
+	*editor = ed;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_new_shared_sm_editor(CyberiadaSharedDocument* shared, CyberiadaSM* sm, CyberiadaSMEditor** editor)
+{
+	CyberiadaDocument* doc;
+	CyberiadaSM* s;
+	int res;
+
+	doc = cyberiada_shared_document_read(shared);
+	if (!doc || !sm || !editor) {
+		ERROR("Cannot create shared SM editor: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	for (s = doc->state_machines; s && s != sm; s = s->next);
+	if (!s) {
+		ERROR("Cannot create shared SM editor: the SM is not found in the document\n");
+		return CYBERIADA_NOT_FOUND;
+	}
+
+	if ((res = cyberiada_new_sm_editor(sm, editor)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	(*editor)->shared = shared;
+	return CYBERIADA_NO_ERROR;
+}
+
+CyberiadaSM* cyberiada_sm_editor_sm(CyberiadaSMEditor* editor)
+{
+	if (!editor) {
+		return NULL;
+	}
+	return editor->sm;
+}
+
+CyberiadaNode* cyberiada_sm_editor_find_node(CyberiadaSMEditor* editor, const char* id)
+{
+	if (!editor || !id) {
+		return NULL;
+	}
+	return (CyberiadaNode*)cyberiada_hash_get(&(editor->node_ids), id);
+}
+
+CyberiadaEdge* cyberiada_sm_editor_find_edge(CyberiadaSMEditor* editor, const char* id)
+{
+	if (!editor || !id) {
+		return NULL;
+	}
+	return (CyberiadaEdge*)cyberiada_hash_get(&(editor->edge_ids), id);
+}
+
+int cyberiada_sm_editor_node_edges(CyberiadaSMEditor* editor, CyberiadaNode* node,
+								   CyberiadaEdge* const** edges, size_t* count)
+{
+	CyberiadaEditorAdjacency* adj;
+
+	if (!editor || !node || !edges || !count || !cyberiada_editor_has_node(editor, node)) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	adj = (CyberiadaEditorAdjacency*)cyberiada_hash_get(&(editor->adjacency), node);
+	*edges = adj ? adj->edges : NULL;
+	*count = adj ? adj->count : 0;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_sm_editor_add_node(CyberiadaSMEditor* editor, CyberiadaNode* parent, CyberiadaNode* node)
+{
+	CyberiadaNode** end;
+	int res;
+
+	if (editor && (res = cyberiada_editor_detach(editor, &parent, NULL, NULL)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (!editor || !node || node->next || cyberiada_editor_has_node(editor, node) ||
+		(parent && !cyberiada_editor_has_node(editor, parent))) {
+		ERROR("Cannot add node: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	/* index the subtree first to reject the duplicate identifiers */
+	res = cyberiada_editor_index_nodes(editor, &node, &end);
+	if (res != CYBERIADA_NO_ERROR) {
+		/* the SM nodes identifiers are kept since they don't refer to the subtree nodes */
+		cyberiada_editor_unindex_nodes(editor, node, 0);
+		return res;
+	}
+
+	res = cyberiada_editor_append_node(editor, parent, node);
+	cyberiada_invalidate_sm_absolute_geometry(editor->sm);
+	cyberiada_invalidate_sm_adjacency(editor->sm);
+	cyberiada_invalidate_sm_hierarchy(editor->sm);
+	cyberiada_invalidate_sm_ordinals(editor->sm);
+	return res;
+}
+
+int cyberiada_sm_editor_move_node(CyberiadaSMEditor* editor, CyberiadaNode* node, CyberiadaNode* new_parent)
+{
+	CyberiadaNode *n, *old_parent;
+	int res;
+
+	if (editor && (res = cyberiada_editor_detach(editor, &node, &new_parent, NULL)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (!editor || !node || !cyberiada_editor_has_node(editor, node) ||
+		(new_parent && !cyberiada_editor_has_node(editor, new_parent))) {
+		ERROR("Cannot move node: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	for (n = new_parent; n; n = n->parent) {
+		if (n == node) {
+			ERROR("Cannot move node %s to its own subtree\n", node->id);
+			return CYBERIADA_BAD_PARAMETER;
+		}
+	}
+	if (node->parent == new_parent) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	old_parent = node->parent;
+	cyberiada_editor_unlink_node(editor, node);
+	cyberiada_editor_update_parent(old_parent);
+	res = cyberiada_editor_append_node(editor, new_parent, node);
+	cyberiada_invalidate_sm_absolute_geometry(editor->sm);
+	cyberiada_invalidate_sm_adjacency(editor->sm);
+	cyberiada_invalidate_sm_hierarchy(editor->sm);
+	cyberiada_invalidate_sm_ordinals(editor->sm);
+	return res;
+}
+
+int cyberiada_sm_editor_remove_edge(CyberiadaSMEditor* editor, CyberiadaEdge* edge)
+{
+	CyberiadaEdge** link;
+	int res;
+
+	if (editor && (res = cyberiada_editor_detach(editor, NULL, NULL, &edge)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (!editor || !edge) {
+		ERROR("Cannot remove edge: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	link = (CyberiadaEdge**)cyberiada_hash_get(&(editor->edge_links), edge);
+	if (!link) {
+		ERROR("Cannot remove edge: the edge is not found in the SM\n");
+		return CYBERIADA_NOT_FOUND;
+	}
+
+	*link = edge->next;
+	if (edge->next) {
+		cyberiada_hash_put(&(editor->edge_links), edge->next, link);
+	} else {
+		editor->edges_end = link;
+	}
+	edge->next = NULL;
+
+	cyberiada_hash_remove(&(editor->edge_links), edge);
+	if (edge->id && *(edge->id)) {
+		cyberiada_hash_remove(&(editor->edge_ids), edge->id);
+	}
+	cyberiada_editor_adjacency_remove(editor, edge->source, edge);
+	if (edge->target != edge->source) {
+		cyberiada_editor_adjacency_remove(editor, edge->target, edge);
+	}
+
+	cyberiada_destroy_edge(edge);
+	cyberiada_invalidate_sm_adjacency(editor->sm);
+	cyberiada_invalidate_sm_ordinals(editor->sm);
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_editor_remove_incident_edges(CyberiadaSMEditor* editor, CyberiadaNode* node, int siblings)
+{
+	CyberiadaEditorAdjacency* adj;
+	int res;
+
+	for (; node; node = siblings ? node->next : NULL) {
+		adj = (CyberiadaEditorAdjacency*)cyberiada_hash_get(&(editor->adjacency), node);
+		while (adj && adj->count > 0) {
+			res = cyberiada_sm_editor_remove_edge(editor, adj->edges[adj->count - 1]);
+			if (res != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		res = cyberiada_editor_remove_incident_edges(editor, node->children, 1);
+		if (res != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_sm_editor_remove_node(CyberiadaSMEditor* editor, CyberiadaNode* node)
+{
+	CyberiadaNode* parent;
+	int res;
+
+	if (editor && (res = cyberiada_editor_detach(editor, &node, NULL, NULL)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (!editor || !node || !cyberiada_editor_has_node(editor, node)) {
+		ERROR("Cannot remove node: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	/* cascade to the incident edges of the node subtree */
+	res = cyberiada_editor_remove_incident_edges(editor, node, 0);
+	if (res != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	parent = node->parent;
+	cyberiada_editor_unlink_node(editor, node);
+	cyberiada_editor_unindex_nodes(editor, node, 0);
+	cyberiada_editor_update_parent(parent);
+	cyberiada_destroy_node(node);
+	cyberiada_invalidate_sm_absolute_geometry(editor->sm);
+	cyberiada_invalidate_sm_adjacency(editor->sm);
+	cyberiada_invalidate_sm_hierarchy(editor->sm);
+	cyberiada_invalidate_sm_ordinals(editor->sm);
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_sm_editor_add_edge(CyberiadaSMEditor* editor, CyberiadaEdge* edge)
+{
+	CyberiadaNode *source, *target;
+	int res;
+
+	if (editor && (res = cyberiada_editor_detach(editor, NULL, NULL, NULL)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (!editor || !edge || edge->next || !edge->source_id || !edge->target_id ||
+		cyberiada_hash_get(&(editor->edge_links), edge)) {
+		ERROR("Cannot add edge: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	source = cyberiada_sm_editor_find_node(editor, edge->source_id);
+	target = cyberiada_sm_editor_find_node(editor, edge->target_id);
+	if (!source || !target) {
+		ERROR("Cannot add edge %s: the source or target node is not found in the SM\n",
+			  edge->id ? edge->id : "");
+		return CYBERIADA_NOT_FOUND;
+	}
+	if (edge->id && *(edge->id) && cyberiada_hash_get(&(editor->edge_ids), edge->id)) {
+		ERROR("The edge with the id %s already exists in the SM\n", edge->id);
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	edge->source = source;
+	edge->target = target;
+	*(editor->edges_end) = edge;
+	res = cyberiada_editor_index_edge(editor, edge, editor->edges_end);
+	editor->edges_end = &(edge->next);
+	cyberiada_invalidate_sm_adjacency(editor->sm);
+	cyberiada_invalidate_sm_ordinals(editor->sm);
+	return res;
+}
+
+int cyberiada_sm_editor_set_node_actions(CyberiadaSMEditor* editor, CyberiadaNode* node, CyberiadaAction* actions)
+{
+	int res;
+
+	if (editor && (res = cyberiada_editor_detach(editor, &node, NULL, NULL)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (!editor || !node || !cyberiada_editor_has_node(editor, node)) {
+		ERROR("Cannot set node actions: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (node->raw_actions) {
+		cyberiada_destroy_raw_action(node->raw_actions);
+		node->raw_actions = NULL;
+	}
+	if (node->actions && node->actions != actions) {
+		cyberiada_destroy_action(node->actions);
+	}
+	node->actions = actions;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_sm_editor_set_edge_action(CyberiadaSMEditor* editor, CyberiadaEdge* edge, CyberiadaAction* action)
+{
+	int res;
+
+	if (editor && (res = cyberiada_editor_detach(editor, NULL, NULL, &edge)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (!editor || !edge || !cyberiada_hash_get(&(editor->edge_links), edge)) {
+		ERROR("Cannot set edge action: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (edge->raw_action) {
+		cyberiada_destroy_raw_action(edge->raw_action);
+		edge->raw_action = NULL;
+	}
+	if (edge->action && edge->action != action) {
+		cyberiada_destroy_action(edge->action);
+	}
+	edge->action = action;
+	return CYBERIADA_NO_ERROR;
+}
+
+static void cyberiada_editor_free_adjacency(CyberiadaSMEditor* editor, CyberiadaNode* node)
+{
+	CyberiadaEditorAdjacency* adj;
+
+	for (; node; node = node->next) {
+		adj = (CyberiadaEditorAdjacency*)cyberiada_hash_get(&(editor->adjacency), node);
+		if (adj) {
+			if (adj->edges) free(adj->edges);
+			free(adj);
+		}
+		cyberiada_editor_free_adjacency(editor, node->children);
+	}
+}
+
+static void cyberiada_editor_free_index(CyberiadaSMEditor* editor)
+{
+	if (editor->sm) {
+		cyberiada_editor_free_adjacency(editor, editor->sm->nodes);
+	}
+	cyberiada_hash_free(&(editor->node_ids));
+	cyberiada_hash_free(&(editor->edge_ids));
+	cyberiada_hash_free(&(editor->node_links));
+	cyberiada_hash_free(&(editor->edge_links));
+	cyberiada_hash_free(&(editor->adjacency));
+	cyberiada_hash_free(&(editor->children_ends));
+}
+
+int cyberiada_destroy_sm_editor(CyberiadaSMEditor* editor)
+{
+	if (!editor) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	cyberiada_editor_free_index(editor);
+	free(editor);
+	return CYBERIADA_NO_ERROR;
+}
@@ -0,0 +1,548 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The SM flattening: the hierarchical SM to the flat transition table
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_error.h"
+#include "cyb_graph.h"
+#include "cyb_structs.h"
+
+/* -----------------------------------------------------------------------------
+ * The flat states are the leaf states of the SM. Every leaf state gets the
+ * rows of its own transitions and the transitions of its ancestors (the inner
+ * ones first). The transition domain is the lowest common ancestor of the
+ * source and the target found in O(1) by the SM hierarchy index (the node
+ * numbers are the SM ordinals, the pre-order numbers of the index as well).
+ * The action sequence of the row is the exit actions from the leaf state up
+ * to the domain, the transition behavior (before or after the exits, see the
+ * transitionOrder meta flag) and the entry actions down to the target
+ * followed by the initial pseudostates chain until the leaf state is reached.
+ * The single region of a composite state (the nested graph of the Cyberiada
+ * format) is a part of the hierarchy without actions of its own.
+ * ----------------------------------------------------------------------------- */
+
+#define FLAT_NONE CYBERIADA_FLAT_NO_STATE
+
+typedef struct {
+	CyberiadaSM*                sm;
+	size_t                      count;           /* the nodes count; the ordinal count is the virtual root */
+	CyberiadaNode* const*       nodes;           /* the SM ordinal nodes (pre-order) */
+	size_t*                     parent;          /* parent ordinal (the virtual root for the top-level nodes) */
+	size_t*                     out_offsets;     /* the transitions by the source ordinal */
+	CyberiadaEdge**             out_edges;
+} CyberiadaFlatHierarchy;
+
+typedef struct {
+	CyberiadaFlatTable*         table;
+	CyberiadaFlatHierarchy*     h;
+	CyberiadaHash               events;          /* event name -> event id + 1 */
+	size_t*                     state_index;     /* ordinal -> state index or FLAT_NONE */
+	size_t                      transitions_capacity;
+	size_t                      actions_capacity;
+	size_t                      events_capacity;
+	size_t*                     path;            /* the entry path buffer */
+	int                         exit_first;
+} CyberiadaFlatContext;
+
+/* -----------------------------------------------------------------------------
+ * The hierarchy: ordinals, parents & transitions by the source
+ * ----------------------------------------------------------------------------- */
+
+static size_t cyberiada_flat_ordinal(CyberiadaFlatHierarchy* h, const CyberiadaNode* node)
+{
+	size_t ordinal;
+	if (!node) {
+		return FLAT_NONE;
+	}
+	if (cyberiada_node_ordinal(h->sm, node, &ordinal) != CYBERIADA_NO_ERROR) {
+		return FLAT_NONE;
+	}
+	return ordinal;
+}
+
+/* the parents in the pre-order of the node tree (the order of the SM ordinals) */
+static void cyberiada_flat_tour(CyberiadaFlatHierarchy* h, CyberiadaNode* node, size_t parent, size_t* counter)
+{
+	size_t i;
+	for (; node; node = node->next) {
+		i = (*counter)++;
+		h->parent[i] = parent;
+		if (node->children) {
+			cyberiada_flat_tour(h, node->children, i, counter);
+		}
+	}
+}
+
+static void cyberiada_flat_hierarchy_free(CyberiadaFlatHierarchy* h)
+{
+	if (h->parent) free(h->parent);
+	if (h->out_edges) free(h->out_edges);
+}
+
+static int cyberiada_flat_hierarchy_build(CyberiadaFlatHierarchy* h, CyberiadaSM* sm)
+{
+	CyberiadaEdge* edge;
+	size_t n, i, edges = 0, counter = 0, *pos;
+	int res;
+
+	memset(h, 0, sizeof(CyberiadaFlatHierarchy));
+	h->sm = sm;
+	/* rebuild the ordinals & the index since the SM could be changed */
+	if ((res = cyberiada_sm_build_ordinals(sm)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_sm_build_hierarchy(sm)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_sm_ordinal_nodes(sm, &(h->nodes), &n)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	h->parent = (size_t*)malloc(sizeof(size_t) * (n + 1) * 2);
+	if (!h->parent) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	h->count = n;
+	h->out_offsets = h->parent + n + 1;
+	h->parent[n] = FLAT_NONE;
+	cyberiada_flat_tour(h, sm->nodes, n, &counter);
+
+	/* the transitions by the source */
+	memset(h->out_offsets, 0, sizeof(size_t) * (n + 1));
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if (edge->type != cybEdgeComment &&
+			(i = cyberiada_flat_ordinal(h, edge->source)) != FLAT_NONE) {
+			h->out_offsets[i + 1]++;
+			edges++;
+		}
+	}
+	for (i = 1; i <= n; i++) {
+		h->out_offsets[i] += h->out_offsets[i - 1];
+	}
+	h->out_edges = (CyberiadaEdge**)malloc(sizeof(CyberiadaEdge*) * (edges + 1) + sizeof(size_t) * (n + 1));
+	if (!h->out_edges) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	pos = (size_t*)(h->out_edges + edges + 1);
+	memcpy(pos, h->out_offsets, sizeof(size_t) * (n + 1));
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if (edge->type != cybEdgeComment &&
+			(i = cyberiada_flat_ordinal(h, edge->source)) != FLAT_NONE) {
+			h->out_edges[pos[i]++] = edge;
+		}
+	}
+
+	return CYBERIADA_NO_ERROR;
+}
+
+/* the transition domain: the lowest common ancestor ordinal (the virtual root for the different trees) */
+static size_t cyberiada_flat_lca(CyberiadaFlatHierarchy* h, size_t u, size_t v)
+{
+	CyberiadaNode* lca = NULL;
+	if (cyberiada_nodes_lca(h->sm, h->nodes[u], h->nodes[v], &lca) != CYBERIADA_NO_ERROR || !lca) {
+		return h->count;
+	}
+	return cyberiada_flat_ordinal(h, lca);
+}
+
+/* -----------------------------------------------------------------------------
+ * The table construction
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_flat_is_leaf(const CyberiadaNode* node)
+{
+	CyberiadaNode* child;
+	if (node->type == cybNodeFinal || node->type == cybNodeSimpleState || node->type == cybNodeSubmachineState) {
+		return 1;
+	}
+	if (node->type == cybNodeCompositeState) {
+		for (child = node->children; child; child = child->next) {
+			if (child->type != cybNodeComment && child->type != cybNodeFormalComment) {
+				return 0;
+			}
+		}
+		return 1;
+	}
+	return 0;
+}
+
+static int cyberiada_flat_add_action(CyberiadaFlatContext* ctx, const char* behavior)
+{
+	CyberiadaFlatTable* t = ctx->table;
+	const char** actions;
+	if (!behavior || !*behavior) {
+		return CYBERIADA_NO_ERROR;
+	}
+	if (t->actions_count == ctx->actions_capacity) {
+		ctx->actions_capacity = ctx->actions_capacity ? ctx->actions_capacity * 2 : 64;
+		actions = (const char**)realloc((void*)t->actions, sizeof(const char*) * ctx->actions_capacity);
+		if (!actions) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		t->actions = actions;
+	}
+	t->actions[t->actions_count++] = behavior;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_flat_add_node_actions(CyberiadaFlatContext* ctx, const CyberiadaNode* node, CyberiadaActionType type)
+{
+	CyberiadaAction* a;
+	int res;
+	for (a = node->actions; a; a = a->next) {
+		if (a->type == type && (res = cyberiada_flat_add_action(ctx, a->behavior)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_flat_intern_event(CyberiadaFlatContext* ctx, const char* name, size_t* id)
+{
+	CyberiadaFlatTable* t = ctx->table;
+	const char** events;
+	void* found;
+
+	if (!name) {
+		name = "";
+	}
+	found = cyberiada_hash_get(&(ctx->events), name);
+	if (found) {
+		*id = (size_t)(uintptr_t)found - 1;
+		return CYBERIADA_NO_ERROR;
+	}
+	if (t->events_count == ctx->events_capacity) {
+		ctx->events_capacity = ctx->events_capacity ? ctx->events_capacity * 2 : 16;
+		events = (const char**)realloc((void*)t->events, sizeof(const char*) * ctx->events_capacity);
+		if (!events) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		t->events = events;
+	}
+	*id = t->events_count;
+	t->events[t->events_count++] = name;
+	if (cyberiada_hash_put(&(ctx->events), name, (void*)(uintptr_t)(*id + 1)) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* the entry actions on the path from the node below the domain down to the target */
+static int cyberiada_flat_enter(CyberiadaFlatContext* ctx, size_t domain, size_t target)
+{
+	CyberiadaFlatHierarchy* h = ctx->h;
+	size_t n = 0, v;
+	int res;
+	for (v = target; v != domain && v != FLAT_NONE && v != h->count; v = h->parent[v]) {
+		ctx->path[n++] = v;
+	}
+	while (n > 0) {
+		if ((res = cyberiada_flat_add_node_actions(ctx, h->nodes[ctx->path[--n]], cybActionEntry)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* follow the initial pseudostates chain from the target down to the leaf state */
+static int cyberiada_flat_resolve_initial(CyberiadaFlatContext* ctx, size_t* target)
+{
+	CyberiadaFlatHierarchy* h = ctx->h;
+	CyberiadaNode* child;
+	CyberiadaEdge* edge;
+	size_t v = *target, next, steps = 0, initial, region;
+	int res;
+
+	while (!cyberiada_flat_is_leaf(h->nodes[v]) && steps++ <= h->count) {
+		initial = region = FLAT_NONE;
+		for (child = h->nodes[v]->children; child; child = child->next) {
+			if (child->type == cybNodeInitial) {
+				initial = cyberiada_flat_ordinal(h, child);
+				break;
+			} else if (child->type == cybNodeRegion) {
+				region = cyberiada_flat_ordinal(h, child);
+			}
+		}
+		if (initial == FLAT_NONE && region != FLAT_NONE) {
+			/* the single region of the state has no actions and is entered with the state */
+			v = region;
+			continue;
+		}
+		if (initial == FLAT_NONE || h->out_offsets[initial] == h->out_offsets[initial + 1]) {
+			break;
+		}
+		edge = h->out_edges[h->out_offsets[initial]];
+		if (edge->action && (res = cyberiada_flat_add_action(ctx, edge->action->behavior)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		next = cyberiada_flat_ordinal(h, edge->target);
+		if (next == FLAT_NONE) {
+			break;
+		}
+		if ((res = cyberiada_flat_enter(ctx, v, next)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		v = next;
+	}
+	*target = v;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_flat_add_row(CyberiadaFlatContext* ctx, size_t leaf, size_t source,
+								  const CyberiadaEdge* edge, const CyberiadaAction* action)
+{
+	CyberiadaFlatHierarchy* h = ctx->h;
+	CyberiadaFlatTable* t = ctx->table;
+	CyberiadaFlatTransition* row;
+	size_t target, domain, v, event;
+	const char* behavior = action ? action->behavior : NULL;
+	int res;
+
+	if (t->transitions_count == ctx->transitions_capacity) {
+		ctx->transitions_capacity = ctx->transitions_capacity ? ctx->transitions_capacity * 2 : 64;
+		row = (CyberiadaFlatTransition*)realloc(t->transitions, sizeof(CyberiadaFlatTransition) * ctx->transitions_capacity);
+		if (!row) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		t->transitions = row;
+	}
+
+	if ((res = cyberiada_flat_intern_event(ctx, action ? action->trigger : NULL, &event)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	row = t->transitions + t->transitions_count;
+	memset(row, 0, sizeof(CyberiadaFlatTransition));
+	row->state = ctx->state_index[leaf];
+	row->event = event;
+	row->guard = action && action->guard && *(action->guard) ? action->guard : NULL;
+	row->edge = edge;
+	row->actions_offset = t->actions_count;
+
+	if (!edge) {
+		/* the internal transition */
+		row->internal = 1;
+		row->target = row->state;
+		row->target_node = h->nodes[leaf];
+		if ((res = cyberiada_flat_add_action(ctx, behavior)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		row->actions_count = t->actions_count - row->actions_offset;
+		t->transitions_count++;
+		return CYBERIADA_NO_ERROR;
+	}
+
+	target = cyberiada_flat_ordinal(h, edge->target);
+	if (target == FLAT_NONE) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	if (source == target) {
+		domain = h->parent[source];
+	} else {
+		domain = cyberiada_flat_lca(h, source, target);
+		if (domain == source && edge->type == cybEdgeLocalTransition) {
+			/* the local transition does not leave the source */
+		} else if (domain == source || domain == target) {
+			domain = h->parent[domain];
+		}
+	}
+
+	if (!ctx->exit_first && (res = cyberiada_flat_add_action(ctx, behavior)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (v = leaf; v != domain && v != h->count; v = h->parent[v]) {
+		if ((res = cyberiada_flat_add_node_actions(ctx, h->nodes[v], cybActionExit)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	if (ctx->exit_first && (res = cyberiada_flat_add_action(ctx, behavior)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if ((res = cyberiada_flat_enter(ctx, domain, target)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_flat_resolve_initial(ctx, &target)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	row->target = ctx->state_index[target];
+	row->target_node = h->nodes[target];
+	row->actions_count = t->actions_count - row->actions_offset;
+	t->transitions_count++;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_flat_state_rows(CyberiadaFlatContext* ctx, size_t leaf)
+{
+	CyberiadaFlatHierarchy* h = ctx->h;
+	CyberiadaEdge* edge;
+	CyberiadaAction* action;
+	size_t v, i;
+	int res, found;
+
+	/* the inner transitions go first */
+	for (v = leaf; v != h->count; v = h->parent[v]) {
+		for (action = h->nodes[v]->actions; action; action = action->next) {
+			if (action->type == cybActionTransition &&
+				(res = cyberiada_flat_add_row(ctx, leaf, v, NULL, action)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		for (i = h->out_offsets[v]; i < h->out_offsets[v + 1]; i++) {
+			edge = h->out_edges[i];
+			found = 0;
+			for (action = edge->action; action; action = action->next) {
+				if (action->type == cybActionTransition) {
+					found = 1;
+					if ((res = cyberiada_flat_add_row(ctx, leaf, v, edge, action)) != CYBERIADA_NO_ERROR) {
+						return res;
+					}
+				}
+			}
+			/* the completion transition */
+			if (!found && (res = cyberiada_flat_add_row(ctx, leaf, v, edge, NULL)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_flat_build(CyberiadaFlatContext* ctx, CyberiadaSM* sm)
+{
+	CyberiadaFlatHierarchy* h = ctx->h;
+	CyberiadaFlatTable* t = ctx->table;
+	CyberiadaNode *initial = NULL, *child;
+	size_t i, target, regions;
+	int res;
+
+	for (i = 0; i < h->count; i++) {
+		regions = 0;
+		for (child = h->nodes[i]->children; child; child = child->next) {
+			if (child->type == cybNodeRegion) {
+				regions++;
+			}
+		}
+		if (regions > 1) {
+			ERROR("Cannot flatten the SM %s with orthogonal regions\n", sm->nodes->id);
+			return CYBERIADA_NOT_IMPLEMENTED;
+		}
+	}
+
+	ctx->state_index = (size_t*)malloc(sizeof(size_t) * (h->count + 1) * 2);
+	t->states = (CyberiadaNode**)malloc(sizeof(CyberiadaNode*) * (h->count + 1));
+	t->state_offsets = (size_t*)malloc(sizeof(size_t) * (h->count + 2));
+	if (!ctx->state_index || !t->states || !t->state_offsets) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	ctx->path = ctx->state_index + h->count + 1;
+	for (i = 0; i <= h->count; i++) {
+		ctx->state_index[i] = FLAT_NONE;
+		if (i < h->count && cyberiada_flat_is_leaf(h->nodes[i])) {
+			ctx->state_index[i] = t->states_count;
+			t->states[t->states_count++] = h->nodes[i];
+		}
+	}
+
+	for (i = 0; i < h->count; i++) {
+		if (ctx->state_index[i] == FLAT_NONE) continue;
+		t->state_offsets[ctx->state_index[i]] = t->transitions_count;
+		if ((res = cyberiada_flat_state_rows(ctx, i)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	t->state_offsets[t->states_count] = t->transitions_count;
+
+	/* the initial state is the top-level initial pseudostate chain */
+	t->initial_state = FLAT_NONE;
+	t->initial_actions_offset = t->actions_count;
+	if (cyberiada_graph_get_initial_pseudostate(sm, &initial, NULL, 0) == CYBERIADA_NO_ERROR && initial) {
+		target = cyberiada_flat_ordinal(h, sm->nodes);
+		if ((res = cyberiada_flat_resolve_initial(ctx, &target)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		t->initial_state = ctx->state_index[target];
+	}
+	t->initial_actions_count = t->actions_count - t->initial_actions_offset;
+
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_flatten_sm(CyberiadaDocument* doc, CyberiadaSM* sm, CyberiadaFlatTable** table)
+{
+	CyberiadaFlatHierarchy h;
+	CyberiadaFlatContext ctx;
+	int res;
+
+	if (!doc || !sm || !sm->nodes || !table) {
+		ERROR("Cannot flatten SM: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	if ((res = cyberiada_decode_sm_actions(sm)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	memset(&ctx, 0, sizeof(CyberiadaFlatContext));
+	ctx.table = (CyberiadaFlatTable*)malloc(sizeof(CyberiadaFlatTable));
+	if (!ctx.table) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(ctx.table, 0, sizeof(CyberiadaFlatTable));
+	ctx.h = &h;
+	ctx.exit_first = doc->meta_info && doc->meta_info->transition_order_flag == 2;
+
+	do {
+		if ((res = cyberiada_flat_hierarchy_build(&h, sm)) != CYBERIADA_NO_ERROR) {
+			break;
+		}
+		if (cyberiada_hash_init(&(ctx.events), 1, 0) != 0) {
+			res = CYBERIADA_MEMORY_ERROR;
+			break;
+		}
+		res = cyberiada_flat_build(&ctx, sm);
+	} while (0);
+
+	cyberiada_flat_hierarchy_free(&h);
+	cyberiada_hash_free(&(ctx.events));
+	if (ctx.state_index) free(ctx.state_index);
+
+	if (res != CYBERIADA_NO_ERROR) {
+		cyberiada_destroy_flat_table(ctx.table);
+		return res;
+	}
+
+	*table = ctx.table;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_destroy_flat_table(CyberiadaFlatTable* table)
+{
+	if (!table) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (table->states) free(table->states);
+	if (table->state_offsets) free(table->state_offsets);
+	if (table->events) free((void*)table->events);
+	if (table->transitions) free(table->transitions);
+	if (table->actions) free((void*)table->actions);
+	free(table);
+	return CYBERIADA_NO_ERROR;
+}
@@ -0,0 +1,1385 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The frozen (flat, pointer-free, read-only) document snapshot
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cyberiadaml.h"
+#include "cyb_structs.h"
+#include "cyb_error.h"
+#include "cyb_actions.h"
+
+/* -----------------------------------------------------------------------------
+ * The snapshot is a single contiguous buffer of 8-byte aligned records.
+ * Every reference is a signed 32-bit offset relative to the start of the
+ * record that holds it (0 = NULL), so the buffer can be used at any address,
+ * e.g. mmaped read-only from a file and shared between processes. The
+ * integers and doubles use the host byte order; the header contains a byte
+ * order mark and snapshots from a host with the other byte order are rejected.
+ * ----------------------------------------------------------------------------- */
+
+#define CYBERIADA_FROZEN_MAGIC            "CYBF"
+#define CYBERIADA_FROZEN_MAGIC_LEN        4
+#define CYBERIADA_FROZEN_VERSION          1
+#define CYBERIADA_FROZEN_BYTE_ORDER       0x01020304
+#define CYBERIADA_FROZEN_ALIGN            8
+#define CYBERIADA_FROZEN_INITIAL_SIZE     4096
+
+typedef int32_t CyberiadaFrozenRef;
+
+struct _CyberiadaFrozenDocument {
+	char                magic[CYBERIADA_FROZEN_MAGIC_LEN];
+	uint32_t            version;
+	uint32_t            byte_order;
+	uint32_t            size;
+	CyberiadaFrozenRef  format;
+	uint32_t            geometry_format;
+	uint32_t            node_coord_format;
+	uint32_t            edge_coord_format;
+	uint32_t            edge_pl_coord_format;
+	uint32_t            edge_geom_format;
+	CyberiadaFrozenRef  bounding_rect;
+	CyberiadaFrozenRef  meta_info;
+	CyberiadaFrozenRef  state_machines;
+	uint32_t            reserved;
+};
+
+typedef struct {
+	CyberiadaFrozenRef  standard_version;
+	uint32_t            transition_order_flag;
+	uint32_t            event_propagation_flag;
+	CyberiadaFrozenRef  strings;
+} CyberiadaFrozenMeta;
+
+struct _CyberiadaFrozenMetaString {
+	CyberiadaFrozenRef  name;
+	CyberiadaFrozenRef  value;
+	CyberiadaFrozenRef  next;
+	uint32_t            reserved;
+};
+
+struct _CyberiadaFrozenSM {
+	CyberiadaFrozenRef  nodes;
+	CyberiadaFrozenRef  edges;
+	CyberiadaFrozenRef  next;
+	uint32_t            reserved;
+};
+
+struct _CyberiadaFrozenNode {
+	uint32_t            type;
+	CyberiadaFrozenRef  id;
+	CyberiadaFrozenRef  title;
+	CyberiadaFrozenRef  formal_title;
+	CyberiadaFrozenRef  actions;
+	CyberiadaFrozenRef  comment_body;
+	CyberiadaFrozenRef  comment_markup;
+	uint32_t            has_comment_data;
+	CyberiadaFrozenRef  link_ref;
+	uint32_t            has_link;
+	CyberiadaFrozenRef  geometry_point;
+	CyberiadaFrozenRef  geometry_rect;
+	uint32_t            collapsed_flag;
+	CyberiadaFrozenRef  color;
+	CyberiadaFrozenRef  parent;
+	CyberiadaFrozenRef  children;
+	CyberiadaFrozenRef  next;
+	uint32_t            reserved;
+};
+
+struct _CyberiadaFrozenEdge {
+	uint32_t            type;
+	CyberiadaFrozenRef  id;
+	CyberiadaFrozenRef  source_id;
+	CyberiadaFrozenRef  target_id;
+	CyberiadaFrozenRef  source;
+	CyberiadaFrozenRef  target;
+	CyberiadaFrozenRef  action;
+	uint32_t            comment_subject_type;
+	CyberiadaFrozenRef  comment_subject_fragment;
+	uint32_t            has_comment_subject;
+	CyberiadaFrozenRef  geometry_label_point;
+	CyberiadaFrozenRef  geometry_label_rect;
+	CyberiadaFrozenRef  geometry_polyline;
+	CyberiadaFrozenRef  geometry_source_point;
+	CyberiadaFrozenRef  geometry_target_point;
+	CyberiadaFrozenRef  color;
+	CyberiadaFrozenRef  next;
+	uint32_t            reserved;
+};
+
+struct _CyberiadaFrozenAction {
+	uint32_t            type;
+	CyberiadaFrozenRef  trigger;
+	CyberiadaFrozenRef  guard;
+	CyberiadaFrozenRef  behavior;
+	CyberiadaFrozenRef  next;
+	uint32_t            reserved;
+};
+
+typedef struct {
+	uint32_t            length;
+	char                data[1];                /* NULL-terminated */
+} CyberiadaFrozenString;
+
+typedef struct {
+	uint32_t            count;
+	uint32_t            reserved;
+	CyberiadaPoint      points[1];
+} CyberiadaFrozenPolyline;
+
+#define CYBERIADA_FROZEN_REF(rec, field) ((rec)->field ? (const void*)((const char*)(rec) + (rec)->field) : NULL)
+
+static const char* cyberiada_frozen_string(const void* rec, CyberiadaFrozenRef ref)
+{
+	if (!ref) {
+		return NULL;
+	}
+	return ((const CyberiadaFrozenString*)((const char*)rec + ref))->data;
+}
+
+/* -----------------------------------------------------------------------------
+ * Snapshot writer
+ * ----------------------------------------------------------------------------- */
+
+typedef struct {
+	char*               data;
+	size_t              size;
+	size_t              capacity;
+	CyberiadaHash       strings;                /* string -> record offset */
+	CyberiadaHash       nodes;                  /* node -> record offset */
+} CyberiadaFreezer;
+
+static int cyberiada_frozen_alloc(CyberiadaFreezer* f, size_t size, size_t* offset)
+{
+	size_t capacity;
+	char* data;
+	size = (size + CYBERIADA_FROZEN_ALIGN - 1) & ~(size_t)(CYBERIADA_FROZEN_ALIGN - 1);
+	if (f->size + size > INT32_MAX) {
+		ERROR("The frozen document is too big\n");
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (f->size + size > f->capacity) {
+		capacity = f->capacity ? f->capacity : CYBERIADA_FROZEN_INITIAL_SIZE;
+		while (capacity < f->size + size) capacity <<= 1;
+		data = (char*)realloc(f->data, capacity);
+		if (!data) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		f->data = data;
+		f->capacity = capacity;
+	}
+	memset(f->data + f->size, 0, size);
+	*offset = f->size;
+	f->size += size;
+	return CYBERIADA_NO_ERROR;
+}
+
+/* set the reference field of the record at rec_offset to the record at target_offset */
+static void cyberiada_frozen_set_ref(CyberiadaFreezer* f, size_t rec_offset, size_t field_offset, size_t target_offset)
+{
+	CyberiadaFrozenRef ref = 0;
+	if (target_offset) {
+		ref = (CyberiadaFrozenRef)((ptrdiff_t)target_offset - (ptrdiff_t)rec_offset);
+	}
+	memcpy(f->data + rec_offset + field_offset, &ref, sizeof(ref));
+}
+
+static void cyberiada_frozen_set_value(CyberiadaFreezer* f, size_t rec_offset, size_t field_offset, uint32_t value)
+{
+	memcpy(f->data + rec_offset + field_offset, &value, sizeof(value));
+}
+
+static int cyberiada_frozen_put_string(CyberiadaFreezer* f, size_t rec_offset, size_t field_offset, const char* s)
+{
+	size_t offset, len;
+	uint32_t len32;
+	int res;
+	if (!s) {
+		return CYBERIADA_NO_ERROR;
+	}
+	offset = (size_t)(uintptr_t)cyberiada_hash_get(&(f->strings), s);
+	if (!offset) {
+		len = strlen(s);
+		if ((res = cyberiada_frozen_alloc(f, offsetof(CyberiadaFrozenString, data) + len + 1, &offset)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		len32 = (uint32_t)len;
+		memcpy(f->data + offset, &len32, sizeof(len32));
+		memcpy(f->data + offset + offsetof(CyberiadaFrozenString, data), s, len + 1);
+		if (cyberiada_hash_put(&(f->strings), s, (void*)(uintptr_t)offset) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	cyberiada_frozen_set_ref(f, rec_offset, field_offset, offset);
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_put_data(CyberiadaFreezer* f, size_t rec_offset, size_t field_offset,
+									 const void* data, size_t size)
+{
+	size_t offset;
+	int res;
+	if (!data) {
+		return CYBERIADA_NO_ERROR;
+	}
+	if ((res = cyberiada_frozen_alloc(f, size, &offset)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	memcpy(f->data + offset, data, size);
+	cyberiada_frozen_set_ref(f, rec_offset, field_offset, offset);
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_put_actions(CyberiadaFreezer* f, size_t rec_offset, size_t field_offset,
+										CyberiadaAction* actions)
+{
+	CyberiadaAction* a;
+	size_t offset;
+	int res;
+	for (a = actions; a; a = a->next) {
+		if ((res = cyberiada_frozen_alloc(f, sizeof(CyberiadaFrozenAction), &offset)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		cyberiada_frozen_set_ref(f, rec_offset, field_offset, offset);
+		cyberiada_frozen_set_value(f, offset, offsetof(CyberiadaFrozenAction, type), a->type);
+		if ((res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenAction, trigger), a->trigger)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenAction, guard), a->guard)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenAction, behavior), a->behavior)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		rec_offset = offset;
+		field_offset = offsetof(CyberiadaFrozenAction, next);
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_put_nodes(CyberiadaFreezer* f, size_t rec_offset, size_t field_offset,
+									  size_t parent_offset, CyberiadaNode* nodes)
+{
+	CyberiadaNode* n;
+	size_t offset;
+	int res;
+	for (n = nodes; n; n = n->next) {
+		if ((res = cyberiada_frozen_alloc(f, sizeof(CyberiadaFrozenNode), &offset)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (cyberiada_hash_put(&(f->nodes), n, (void*)(uintptr_t)offset) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		cyberiada_frozen_set_ref(f, rec_offset, field_offset, offset);
+		cyberiada_frozen_set_ref(f, offset, offsetof(CyberiadaFrozenNode, parent), parent_offset);
+		cyberiada_frozen_set_value(f, offset, offsetof(CyberiadaFrozenNode, type), n->type);
+		cyberiada_frozen_set_value(f, offset, offsetof(CyberiadaFrozenNode, collapsed_flag), (unsigned char)n->collapsed_flag);
+		if ((res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenNode, id), n->id)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenNode, title), n->title)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenNode, formal_title), n->formal_title)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenNode, color), n->color)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_data(f, offset, offsetof(CyberiadaFrozenNode, geometry_point),
+											 n->geometry_point, sizeof(CyberiadaPoint))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_data(f, offset, offsetof(CyberiadaFrozenNode, geometry_rect),
+											 n->geometry_rect, sizeof(CyberiadaRect))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_actions(f, offset, offsetof(CyberiadaFrozenNode, actions), n->actions)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (n->comment_data) {
+			cyberiada_frozen_set_value(f, offset, offsetof(CyberiadaFrozenNode, has_comment_data), 1);
+			if ((res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenNode, comment_body),
+												   n->comment_data->body)) != CYBERIADA_NO_ERROR ||
+				(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenNode, comment_markup),
+												   n->comment_data->markup)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if (n->link) {
+			cyberiada_frozen_set_value(f, offset, offsetof(CyberiadaFrozenNode, has_link), 1);
+			if ((res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenNode, link_ref),
+												   n->link->ref)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if ((res = cyberiada_frozen_put_nodes(f, offset, offsetof(CyberiadaFrozenNode, children),
+											  offset, n->children)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		rec_offset = offset;
+		field_offset = offsetof(CyberiadaFrozenNode, next);
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_put_polyline(CyberiadaFreezer* f, size_t rec_offset, CyberiadaPolyline* polyline)
+{
+	CyberiadaPolyline* pl;
+	size_t offset, count = 0, i = 0;
+	uint32_t count32;
+	int res;
+	if (!polyline) {
+		return CYBERIADA_NO_ERROR;
+	}
+	for (pl = polyline; pl; pl = pl->next) count++;
+	if ((res = cyberiada_frozen_alloc(f, offsetof(CyberiadaFrozenPolyline, points) + sizeof(CyberiadaPoint) * count,
+									  &offset)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	count32 = (uint32_t)count;
+	memcpy(f->data + offset, &count32, sizeof(count32));
+	for (pl = polyline; pl; pl = pl->next, i++) {
+		memcpy(f->data + offset + offsetof(CyberiadaFrozenPolyline, points) + sizeof(CyberiadaPoint) * i,
+			   &(pl->point), sizeof(CyberiadaPoint));
+	}
+	cyberiada_frozen_set_ref(f, rec_offset, offsetof(CyberiadaFrozenEdge, geometry_polyline), offset);
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_put_edges(CyberiadaFreezer* f, size_t rec_offset, size_t field_offset,
+									  CyberiadaEdge* edges)
+{
+	CyberiadaEdge* e;
+	size_t offset;
+	int res;
+	for (e = edges; e; e = e->next) {
+		if ((res = cyberiada_frozen_alloc(f, sizeof(CyberiadaFrozenEdge), &offset)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		cyberiada_frozen_set_ref(f, rec_offset, field_offset, offset);
+		cyberiada_frozen_set_value(f, offset, offsetof(CyberiadaFrozenEdge, type), e->type);
+		cyberiada_frozen_set_ref(f, offset, offsetof(CyberiadaFrozenEdge, source),
+								 (size_t)(uintptr_t)cyberiada_hash_get(&(f->nodes), e->source));
+		cyberiada_frozen_set_ref(f, offset, offsetof(CyberiadaFrozenEdge, target),
+								 (size_t)(uintptr_t)cyberiada_hash_get(&(f->nodes), e->target));
+		if ((res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenEdge, id), e->id)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenEdge, source_id), e->source_id)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenEdge, target_id), e->target_id)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenEdge, color), e->color)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_actions(f, offset, offsetof(CyberiadaFrozenEdge, action), e->action)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_data(f, offset, offsetof(CyberiadaFrozenEdge, geometry_label_point),
+											 e->geometry_label_point, sizeof(CyberiadaPoint))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_data(f, offset, offsetof(CyberiadaFrozenEdge, geometry_label_rect),
+											 e->geometry_label_rect, sizeof(CyberiadaRect))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_data(f, offset, offsetof(CyberiadaFrozenEdge, geometry_source_point),
+											 e->geometry_source_point, sizeof(CyberiadaPoint))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_data(f, offset, offsetof(CyberiadaFrozenEdge, geometry_target_point),
+											 e->geometry_target_point, sizeof(CyberiadaPoint))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_polyline(f, offset, e->geometry_polyline)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (e->comment_subject) {
+			cyberiada_frozen_set_value(f, offset, offsetof(CyberiadaFrozenEdge, has_comment_subject), 1);
+			cyberiada_frozen_set_value(f, offset, offsetof(CyberiadaFrozenEdge, comment_subject_type),
+									   e->comment_subject->type);
+			if ((res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenEdge, comment_subject_fragment),
+												   e->comment_subject->fragment)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		rec_offset = offset;
+		field_offset = offsetof(CyberiadaFrozenEdge, next);
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_put_meta(CyberiadaFreezer* f, CyberiadaMetainformation* meta)
+{
+	CyberiadaMetaStringList* sl;
+	size_t meta_offset, offset, rec_offset, field_offset;
+	int res;
+	if (!meta) {
+		return CYBERIADA_NO_ERROR;
+	}
+	if ((res = cyberiada_frozen_alloc(f, sizeof(CyberiadaFrozenMeta), &meta_offset)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	cyberiada_frozen_set_ref(f, 0, offsetof(CyberiadaFrozenDocument, meta_info), meta_offset);
+	cyberiada_frozen_set_value(f, meta_offset, offsetof(CyberiadaFrozenMeta, transition_order_flag),
+							   (unsigned char)meta->transition_order_flag);
+	cyberiada_frozen_set_value(f, meta_offset, offsetof(CyberiadaFrozenMeta, event_propagation_flag),
+							   (unsigned char)meta->event_propagation_flag);
+	if ((res = cyberiada_frozen_put_string(f, meta_offset, offsetof(CyberiadaFrozenMeta, standard_version),
+										   meta->standard_version)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	rec_offset = meta_offset;
+	field_offset = offsetof(CyberiadaFrozenMeta, strings);
+	for (sl = meta->strings; sl; sl = sl->next) {
+		if ((res = cyberiada_frozen_alloc(f, sizeof(CyberiadaFrozenMetaString), &offset)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		cyberiada_frozen_set_ref(f, rec_offset, field_offset, offset);
+		if ((res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenMetaString, name), sl->name)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_string(f, offset, offsetof(CyberiadaFrozenMetaString, value), sl->value)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		rec_offset = offset;
+		field_offset = offsetof(CyberiadaFrozenMetaString, next);
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_put_document(CyberiadaFreezer* f, CyberiadaDocument* doc)
+{
+	CyberiadaFrozenDocument* header;
+	CyberiadaSM* sm;
+	size_t offset, rec_offset, field_offset;
+	int res;
+
+	if ((res = cyberiada_frozen_alloc(f, sizeof(CyberiadaFrozenDocument), &offset)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	header = (CyberiadaFrozenDocument*)f->data;
+	memcpy(header->magic, CYBERIADA_FROZEN_MAGIC, CYBERIADA_FROZEN_MAGIC_LEN);
+	header->version = CYBERIADA_FROZEN_VERSION;
+	header->byte_order = CYBERIADA_FROZEN_BYTE_ORDER;
+	header->geometry_format = doc->geometry_format;
+	header->node_coord_format = doc->node_coord_format;
+	header->edge_coord_format = doc->edge_coord_format;
+	header->edge_pl_coord_format = doc->edge_pl_coord_format;
+	header->edge_geom_format = doc->edge_geom_format;
+
+	if ((res = cyberiada_frozen_put_string(f, 0, offsetof(CyberiadaFrozenDocument, format), doc->format)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_frozen_put_data(f, 0, offsetof(CyberiadaFrozenDocument, bounding_rect),
+										 doc->bounding_rect, sizeof(CyberiadaRect))) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_frozen_put_meta(f, doc->meta_info)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	rec_offset = 0;
+	field_offset = offsetof(CyberiadaFrozenDocument, state_machines);
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		if ((res = cyberiada_frozen_alloc(f, sizeof(CyberiadaFrozenSM), &offset)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		cyberiada_frozen_set_ref(f, rec_offset, field_offset, offset);
+		if ((res = cyberiada_frozen_put_nodes(f, offset, offsetof(CyberiadaFrozenSM, nodes), 0, sm->nodes)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_put_edges(f, offset, offsetof(CyberiadaFrozenSM, edges), sm->edges)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		rec_offset = offset;
+		field_offset = offsetof(CyberiadaFrozenSM, next);
+	}
+
+	cyberiada_frozen_set_value(f, 0, offsetof(CyberiadaFrozenDocument, size), (uint32_t)f->size);
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_freeze_sm_document(CyberiadaDocument* doc, char** buffer, size_t* buffer_size)
+{
+	CyberiadaFreezer f;
+	int res;
+
+	if (!doc || !buffer || !buffer_size) {
+		ERROR("Bad parameters to freeze the document\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	/* the lazy actions are decoded for the snapshot only, the document keeps the raw text */
+	if ((res = cyberiada_attach_lazy_actions(doc)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	*buffer = NULL;
+	*buffer_size = 0;
+
+	memset(&f, 0, sizeof(CyberiadaFreezer));
+	if (cyberiada_hash_init(&(f.strings), 1, 0) != 0 ||
+		cyberiada_hash_init(&(f.nodes), 0, 0) != 0) {
+		cyberiada_hash_free(&(f.strings));
+		cyberiada_detach_lazy_actions(doc);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	res = cyberiada_frozen_put_document(&f, doc);
+	cyberiada_detach_lazy_actions(doc);
+
+	cyberiada_hash_free(&(f.strings));
+	cyberiada_hash_free(&(f.nodes));
+
+	if (res != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot freeze the document: %d\n", res);
+		if (f.data) free(f.data);
+		return res;
+	}
+
+	*buffer = f.data;
+	*buffer_size = f.size;
+	return CYBERIADA_NO_ERROR;
+}
+
+/* -----------------------------------------------------------------------------
+ * Snapshot validation
+ *
+ * The lists and the node tree are laid out in the traversal order, so every
+ * next/children/actions reference must point forward. This guarantees that
+ * the validation (and any accessor-based traversal) terminates.
+ * ----------------------------------------------------------------------------- */
+
+typedef struct {
+	const char*         data;
+	size_t              size;
+	CyberiadaHash       nodes;                  /* valid node records */
+} CyberiadaFrozenValidator;
+
+static int cyberiada_frozen_check_ref(CyberiadaFrozenValidator* v, const void* rec, CyberiadaFrozenRef ref,
+									  size_t size, int forward)
+{
+	ptrdiff_t offset;
+	if (!ref) {
+		return CYBERIADA_NO_ERROR;
+	}
+	offset = ((const char*)rec - v->data) + ref;
+	if ((forward && ref <= 0) || offset < 0 || (size_t)offset % CYBERIADA_FROZEN_ALIGN != 0 ||
+		(size_t)offset > v->size || v->size - (size_t)offset < size) {
+		ERROR("Bad frozen document reference at %ld\n", (long)((const char*)rec - v->data));
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_check_string(CyberiadaFrozenValidator* v, const void* rec, CyberiadaFrozenRef ref)
+{
+	const CyberiadaFrozenString* s;
+	size_t offset;
+	if (!ref) {
+		return CYBERIADA_NO_ERROR;
+	}
+	if (cyberiada_frozen_check_ref(v, rec, ref, offsetof(CyberiadaFrozenString, data) + 1, 0) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	s = (const CyberiadaFrozenString*)((const char*)rec + ref);
+	offset = (const char*)s - v->data + offsetof(CyberiadaFrozenString, data);
+	if (s->length >= v->size - offset || s->data[s->length] != 0) {
+		ERROR("Bad frozen document string at %lu\n", (unsigned long)offset);
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_check_actions(CyberiadaFrozenValidator* v, const void* rec, CyberiadaFrozenRef ref)
+{
+	const CyberiadaFrozenAction* a;
+	while (ref) {
+		if (cyberiada_frozen_check_ref(v, rec, ref, sizeof(CyberiadaFrozenAction), 1) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		a = (const CyberiadaFrozenAction*)((const char*)rec + ref);
+		if (cyberiada_frozen_check_string(v, a, a->trigger) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, a, a->guard) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, a, a->behavior) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		rec = a;
+		ref = a->next;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_check_nodes(CyberiadaFrozenValidator* v, const void* rec, CyberiadaFrozenRef ref,
+										const CyberiadaFrozenNode* parent)
+{
+	const CyberiadaFrozenNode* n;
+	while (ref) {
+		if (cyberiada_frozen_check_ref(v, rec, ref, sizeof(CyberiadaFrozenNode), 1) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		n = (const CyberiadaFrozenNode*)((const char*)rec + ref);
+		if (CYBERIADA_FROZEN_REF(n, parent) != (const void*)parent) {
+			ERROR("Bad frozen document node parent at %ld\n", (long)((const char*)n - v->data));
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		if (cyberiada_hash_put(&(v->nodes), n, (void*)n) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (cyberiada_frozen_check_string(v, n, n->id) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, n, n->title) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, n, n->formal_title) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, n, n->comment_body) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, n, n->comment_markup) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, n, n->link_ref) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, n, n->color) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_ref(v, n, n->geometry_point, sizeof(CyberiadaPoint), 0) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_ref(v, n, n->geometry_rect, sizeof(CyberiadaRect), 0) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_actions(v, n, n->actions) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_nodes(v, n, n->children, n) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		rec = n;
+		ref = n->next;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_check_node_ref(CyberiadaFrozenValidator* v, const void* rec, CyberiadaFrozenRef ref)
+{
+	if (ref && !cyberiada_hash_get(&(v->nodes), (const char*)rec + ref)) {
+		ERROR("Bad frozen document edge node reference at %ld\n", (long)((const char*)rec - v->data));
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_check_edges(CyberiadaFrozenValidator* v, const void* rec, CyberiadaFrozenRef ref)
+{
+	const CyberiadaFrozenEdge* e;
+	const CyberiadaFrozenPolyline* pl;
+	while (ref) {
+		if (cyberiada_frozen_check_ref(v, rec, ref, sizeof(CyberiadaFrozenEdge), 1) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		e = (const CyberiadaFrozenEdge*)((const char*)rec + ref);
+		if (cyberiada_frozen_check_string(v, e, e->id) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, e, e->source_id) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, e, e->target_id) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, e, e->comment_subject_fragment) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_string(v, e, e->color) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_node_ref(v, e, e->source) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_node_ref(v, e, e->target) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_ref(v, e, e->geometry_label_point, sizeof(CyberiadaPoint), 0) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_ref(v, e, e->geometry_label_rect, sizeof(CyberiadaRect), 0) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_ref(v, e, e->geometry_source_point, sizeof(CyberiadaPoint), 0) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_ref(v, e, e->geometry_target_point, sizeof(CyberiadaPoint), 0) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_ref(v, e, e->geometry_polyline, offsetof(CyberiadaFrozenPolyline, points), 0) != CYBERIADA_NO_ERROR ||
+			cyberiada_frozen_check_actions(v, e, e->action) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		if (e->geometry_polyline) {
+			pl = (const CyberiadaFrozenPolyline*)CYBERIADA_FROZEN_REF(e, geometry_polyline);
+			if (cyberiada_frozen_check_ref(v, e, e->geometry_polyline,
+										   offsetof(CyberiadaFrozenPolyline, points) +
+										   sizeof(CyberiadaPoint) * (size_t)pl->count, 0) != CYBERIADA_NO_ERROR) {
+				return CYBERIADA_FORMAT_ERROR;
+			}
+		}
+		rec = e;
+		ref = e->next;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_frozen_check_document(CyberiadaFrozenValidator* v)
+{
+	const CyberiadaFrozenDocument* header = (const CyberiadaFrozenDocument*)v->data;
+	const CyberiadaFrozenMeta* meta;
+	const CyberiadaFrozenMetaString* ms;
+	const CyberiadaFrozenSM* sm;
+	const void* rec;
+	CyberiadaFrozenRef ref;
+	int res;
+
+	if (v->size < sizeof(CyberiadaFrozenDocument) ||
+		memcmp(header->magic, CYBERIADA_FROZEN_MAGIC, CYBERIADA_FROZEN_MAGIC_LEN) != 0) {
+		ERROR("Bad frozen document magic\n");
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	if (header->byte_order != CYBERIADA_FROZEN_BYTE_ORDER) {
+		ERROR("The frozen document byte order does not match the host\n");
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	if (header->version != CYBERIADA_FROZEN_VERSION) {
+		ERROR("Unsupported frozen document version %u\n", header->version);
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	if (header->size != v->size) {
+		ERROR("The frozen document size %u does not match the buffer size %lu\n",
+			  header->size, (unsigned long)v->size);
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	if (cyberiada_frozen_check_string(v, header, header->format) != CYBERIADA_NO_ERROR ||
+		cyberiada_frozen_check_ref(v, header, header->bounding_rect, sizeof(CyberiadaRect), 0) != CYBERIADA_NO_ERROR ||
+		cyberiada_frozen_check_ref(v, header, header->meta_info, sizeof(CyberiadaFrozenMeta), 1) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	if (header->meta_info) {
+		meta = (const CyberiadaFrozenMeta*)CYBERIADA_FROZEN_REF(header, meta_info);
+		if (cyberiada_frozen_check_string(v, meta, meta->standard_version) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		rec = meta;
+		ref = meta->strings;
+		while (ref) {
+			if (cyberiada_frozen_check_ref(v, rec, ref, sizeof(CyberiadaFrozenMetaString), 1) != CYBERIADA_NO_ERROR) {
+				return CYBERIADA_FORMAT_ERROR;
+			}
+			ms = (const CyberiadaFrozenMetaString*)((const char*)rec + ref);
+			if (cyberiada_frozen_check_string(v, ms, ms->name) != CYBERIADA_NO_ERROR ||
+				cyberiada_frozen_check_string(v, ms, ms->value) != CYBERIADA_NO_ERROR) {
+				return CYBERIADA_FORMAT_ERROR;
+			}
+			rec = ms;
+			ref = ms->next;
+		}
+	}
+	rec = header;
+	ref = header->state_machines;
+	while (ref) {
+		if (cyberiada_frozen_check_ref(v, rec, ref, sizeof(CyberiadaFrozenSM), 1) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		sm = (const CyberiadaFrozenSM*)((const char*)rec + ref);
+		if ((res = cyberiada_frozen_check_nodes(v, sm, sm->nodes, NULL)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_frozen_check_edges(v, sm, sm->edges)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		rec = sm;
+		ref = sm->next;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_open_frozen_sm_document(const char* buffer, size_t buffer_size, const CyberiadaFrozenDocument** frozen)
+{
+	CyberiadaFrozenValidator v;
+	int res;
+
+	if (!buffer || !frozen) {
+		ERROR("Bad parameters to open the frozen document\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	*frozen = NULL;
+	if ((uintptr_t)buffer % CYBERIADA_FROZEN_ALIGN != 0) {
+		ERROR("The frozen document buffer is not aligned\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	memset(&v, 0, sizeof(CyberiadaFrozenValidator));
+	v.data = buffer;
+	v.size = buffer_size;
+	if (cyberiada_hash_init(&(v.nodes), 0, 0) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	res = cyberiada_frozen_check_document(&v);
+	cyberiada_hash_free(&(v.nodes));
+
+	if (res == CYBERIADA_NO_ERROR) {
+		*frozen = (const CyberiadaFrozenDocument*)buffer;
+	}
+	return res;
+}
+
+/* -----------------------------------------------------------------------------
+ * Snapshot accessors
+ * ----------------------------------------------------------------------------- */
+
+const char* cyberiada_frozen_document_format(const CyberiadaFrozenDocument* doc)
+{
+	return doc ? cyberiada_frozen_string(doc, doc->format) : NULL;
+}
+
+CyberiadaGeometryFormat cyberiada_frozen_document_geometry_format(const CyberiadaFrozenDocument* doc)
+{
+	return doc ? (CyberiadaGeometryFormat)doc->geometry_format : cybgeomNone;
+}
+
+CyberiadaGeometryCoordFormat cyberiada_frozen_document_node_coord_format(const CyberiadaFrozenDocument* doc)
+{
+	return doc ? (CyberiadaGeometryCoordFormat)doc->node_coord_format : coordNone;
+}
+
+CyberiadaGeometryCoordFormat cyberiada_frozen_document_edge_coord_format(const CyberiadaFrozenDocument* doc)
+{
+	return doc ? (CyberiadaGeometryCoordFormat)doc->edge_coord_format : coordNone;
+}
+
+CyberiadaGeometryCoordFormat cyberiada_frozen_document_edge_pl_coord_format(const CyberiadaFrozenDocument* doc)
+{
+	return doc ? (CyberiadaGeometryCoordFormat)doc->edge_pl_coord_format : coordNone;
+}
+
+CyberiadaGeometryEdgeFormat cyberiada_frozen_document_edge_geom_format(const CyberiadaFrozenDocument* doc)
+{
+	return doc ? (CyberiadaGeometryEdgeFormat)doc->edge_geom_format : edgeNone;
+}
+
+const CyberiadaRect* cyberiada_frozen_document_bounding_rect(const CyberiadaFrozenDocument* doc)
+{
+	return doc ? (const CyberiadaRect*)CYBERIADA_FROZEN_REF(doc, bounding_rect) : NULL;
+}
+
+int cyberiada_frozen_document_has_meta(const CyberiadaFrozenDocument* doc)
+{
+	return doc && doc->meta_info;
+}
+
+const char* cyberiada_frozen_document_standard_version(const CyberiadaFrozenDocument* doc)
+{
+	const CyberiadaFrozenMeta* meta;
+	if (!doc || !doc->meta_info) {
+		return NULL;
+	}
+	meta = (const CyberiadaFrozenMeta*)CYBERIADA_FROZEN_REF(doc, meta_info);
+	return cyberiada_frozen_string(meta, meta->standard_version);
+}
+
+char cyberiada_frozen_document_transition_order_flag(const CyberiadaFrozenDocument* doc)
+{
+	if (!doc || !doc->meta_info) {
+		return 0;
+	}
+	return (char)((const CyberiadaFrozenMeta*)CYBERIADA_FROZEN_REF(doc, meta_info))->transition_order_flag;
+}
+
+char cyberiada_frozen_document_event_propagation_flag(const CyberiadaFrozenDocument* doc)
+{
+	if (!doc || !doc->meta_info) {
+		return 0;
+	}
+	return (char)((const CyberiadaFrozenMeta*)CYBERIADA_FROZEN_REF(doc, meta_info))->event_propagation_flag;
+}
+
+const CyberiadaFrozenMetaString* cyberiada_frozen_document_meta_strings(const CyberiadaFrozenDocument* doc)
+{
+	const CyberiadaFrozenMeta* meta;
+	if (!doc || !doc->meta_info) {
+		return NULL;
+	}
+	meta = (const CyberiadaFrozenMeta*)CYBERIADA_FROZEN_REF(doc, meta_info);
+	return (const CyberiadaFrozenMetaString*)CYBERIADA_FROZEN_REF(meta, strings);
+}
+
+const char* cyberiada_frozen_meta_string_name(const CyberiadaFrozenMetaString* ms)
+{
+	return ms ? cyberiada_frozen_string(ms, ms->name) : NULL;
+}
+
+const char* cyberiada_frozen_meta_string_value(const CyberiadaFrozenMetaString* ms)
+{
+	return ms ? cyberiada_frozen_string(ms, ms->value) : NULL;
+}
+
+const CyberiadaFrozenMetaString* cyberiada_frozen_meta_string_next(const CyberiadaFrozenMetaString* ms)
+{
+	return ms ? (const CyberiadaFrozenMetaString*)CYBERIADA_FROZEN_REF(ms, next) : NULL;
+}
+
+const CyberiadaFrozenSM* cyberiada_frozen_document_sms(const CyberiadaFrozenDocument* doc)
+{
+	return doc ? (const CyberiadaFrozenSM*)CYBERIADA_FROZEN_REF(doc, state_machines) : NULL;
+}
+
+const CyberiadaFrozenNode* cyberiada_frozen_sm_nodes(const CyberiadaFrozenSM* sm)
+{
+	return sm ? (const CyberiadaFrozenNode*)CYBERIADA_FROZEN_REF(sm, nodes) : NULL;
+}
+
+const CyberiadaFrozenEdge* cyberiada_frozen_sm_edges(const CyberiadaFrozenSM* sm)
+{
+	return sm ? (const CyberiadaFrozenEdge*)CYBERIADA_FROZEN_REF(sm, edges) : NULL;
+}
+
+const CyberiadaFrozenSM* cyberiada_frozen_sm_next(const CyberiadaFrozenSM* sm)
+{
+	return sm ? (const CyberiadaFrozenSM*)CYBERIADA_FROZEN_REF(sm, next) : NULL;
+}
+
+CyberiadaNodeType cyberiada_frozen_node_type(const CyberiadaFrozenNode* node)
+{
+	return node ? (CyberiadaNodeType)node->type : cybNodeSM;
+}
+
+const char* cyberiada_frozen_node_id(const CyberiadaFrozenNode* node)
+{
+	return node ? cyberiada_frozen_string(node, node->id) : NULL;
+}
+
+const char* cyberiada_frozen_node_title(const CyberiadaFrozenNode* node)
+{
+	return node ? cyberiada_frozen_string(node, node->title) : NULL;
+}
+
+const char* cyberiada_frozen_node_formal_title(const CyberiadaFrozenNode* node)
+{
+	return node ? cyberiada_frozen_string(node, node->formal_title) : NULL;
+}
+
+const CyberiadaFrozenAction* cyberiada_frozen_node_actions(const CyberiadaFrozenNode* node)
+{
+	return node ? (const CyberiadaFrozenAction*)CYBERIADA_FROZEN_REF(node, actions) : NULL;
+}
+
+int cyberiada_frozen_node_has_comment_data(const CyberiadaFrozenNode* node)
+{
+	return node && node->has_comment_data;
+}
+
+const char* cyberiada_frozen_node_comment_body(const CyberiadaFrozenNode* node)
+{
+	return node ? cyberiada_frozen_string(node, node->comment_body) : NULL;
+}
+
+const char* cyberiada_frozen_node_comment_markup(const CyberiadaFrozenNode* node)
+{
+	return node ? cyberiada_frozen_string(node, node->comment_markup) : NULL;
+}
+
+int cyberiada_frozen_node_has_link(const CyberiadaFrozenNode* node)
+{
+	return node && node->has_link;
+}
+
+const char* cyberiada_frozen_node_link_ref(const CyberiadaFrozenNode* node)
+{
+	return node ? cyberiada_frozen_string(node, node->link_ref) : NULL;
+}
+
+const CyberiadaPoint* cyberiada_frozen_node_geometry_point(const CyberiadaFrozenNode* node)
+{
+	return node ? (const CyberiadaPoint*)CYBERIADA_FROZEN_REF(node, geometry_point) : NULL;
+}
+
+const CyberiadaRect* cyberiada_frozen_node_geometry_rect(const CyberiadaFrozenNode* node)
+{
+	return node ? (const CyberiadaRect*)CYBERIADA_FROZEN_REF(node, geometry_rect) : NULL;
+}
+
+char cyberiada_frozen_node_collapsed_flag(const CyberiadaFrozenNode* node)
+{
+	return node ? (char)node->collapsed_flag : 0;
+}
+
+const char* cyberiada_frozen_node_color(const CyberiadaFrozenNode* node)
+{
+	return node ? cyberiada_frozen_string(node, node->color) : NULL;
+}
+
+const CyberiadaFrozenNode* cyberiada_frozen_node_parent(const CyberiadaFrozenNode* node)
+{
+	return node ? (const CyberiadaFrozenNode*)CYBERIADA_FROZEN_REF(node, parent) : NULL;
+}
+
+const CyberiadaFrozenNode* cyberiada_frozen_node_children(const CyberiadaFrozenNode* node)
+{
+	return node ? (const CyberiadaFrozenNode*)CYBERIADA_FROZEN_REF(node, children) : NULL;
+}
+
+const CyberiadaFrozenNode* cyberiada_frozen_node_next(const CyberiadaFrozenNode* node)
+{
+	return node ? (const CyberiadaFrozenNode*)CYBERIADA_FROZEN_REF(node, next) : NULL;
+}
+
+CyberiadaEdgeType cyberiada_frozen_edge_type(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (CyberiadaEdgeType)edge->type : cybEdgeLocalTransition;
+}
+
+const char* cyberiada_frozen_edge_id(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? cyberiada_frozen_string(edge, edge->id) : NULL;
+}
+
+const char* cyberiada_frozen_edge_source_id(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? cyberiada_frozen_string(edge, edge->source_id) : NULL;
+}
+
+const char* cyberiada_frozen_edge_target_id(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? cyberiada_frozen_string(edge, edge->target_id) : NULL;
+}
+
+const CyberiadaFrozenNode* cyberiada_frozen_edge_source(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (const CyberiadaFrozenNode*)CYBERIADA_FROZEN_REF(edge, source) : NULL;
+}
+
+const CyberiadaFrozenNode* cyberiada_frozen_edge_target(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (const CyberiadaFrozenNode*)CYBERIADA_FROZEN_REF(edge, target) : NULL;
+}
+
+const CyberiadaFrozenAction* cyberiada_frozen_edge_action(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (const CyberiadaFrozenAction*)CYBERIADA_FROZEN_REF(edge, action) : NULL;
+}
+
+int cyberiada_frozen_edge_has_comment_subject(const CyberiadaFrozenEdge* edge)
+{
+	return edge && edge->has_comment_subject;
+}
+
+CyberiadaCommentSubjectType cyberiada_frozen_edge_comment_subject_type(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (CyberiadaCommentSubjectType)edge->comment_subject_type : cybCommentSubjectNode;
+}
+
+const char* cyberiada_frozen_edge_comment_subject_fragment(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? cyberiada_frozen_string(edge, edge->comment_subject_fragment) : NULL;
+}
+
+const CyberiadaPoint* cyberiada_frozen_edge_geometry_label_point(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (const CyberiadaPoint*)CYBERIADA_FROZEN_REF(edge, geometry_label_point) : NULL;
+}
+
+const CyberiadaRect* cyberiada_frozen_edge_geometry_label_rect(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (const CyberiadaRect*)CYBERIADA_FROZEN_REF(edge, geometry_label_rect) : NULL;
+}
+
+const CyberiadaPoint* cyberiada_frozen_edge_geometry_polyline(const CyberiadaFrozenEdge* edge, size_t* count)
+{
+	const CyberiadaFrozenPolyline* pl;
+	if (count) *count = 0;
+	if (!edge || !edge->geometry_polyline) {
+		return NULL;
+	}
+	pl = (const CyberiadaFrozenPolyline*)CYBERIADA_FROZEN_REF(edge, geometry_polyline);
+	if (count) *count = pl->count;
+	return pl->points;
+}
+
+const CyberiadaPoint* cyberiada_frozen_edge_geometry_source_point(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (const CyberiadaPoint*)CYBERIADA_FROZEN_REF(edge, geometry_source_point) : NULL;
+}
+
+const CyberiadaPoint* cyberiada_frozen_edge_geometry_target_point(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (const CyberiadaPoint*)CYBERIADA_FROZEN_REF(edge, geometry_target_point) : NULL;
+}
+
+const char* cyberiada_frozen_edge_color(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? cyberiada_frozen_string(edge, edge->color) : NULL;
+}
+
+const CyberiadaFrozenEdge* cyberiada_frozen_edge_next(const CyberiadaFrozenEdge* edge)
+{
+	return edge ? (const CyberiadaFrozenEdge*)CYBERIADA_FROZEN_REF(edge, next) : NULL;
+}
+
+CyberiadaActionType cyberiada_frozen_action_type(const CyberiadaFrozenAction* action)
+{
+	return action ? (CyberiadaActionType)action->type : cybActionTransition;
+}
+
+const char* cyberiada_frozen_action_trigger(const CyberiadaFrozenAction* action)
+{
+	return action ? cyberiada_frozen_string(action, action->trigger) : NULL;
+}
+
+const char* cyberiada_frozen_action_guard(const CyberiadaFrozenAction* action)
+{
+	return action ? cyberiada_frozen_string(action, action->guard) : NULL;
+}
+
+const char* cyberiada_frozen_action_behavior(const CyberiadaFrozenAction* action)
+{
+	return action ? cyberiada_frozen_string(action, action->behavior) : NULL;
+}
+
+const CyberiadaFrozenAction* cyberiada_frozen_action_next(const CyberiadaFrozenAction* action)
+{
+	return action ? (const CyberiadaFrozenAction*)CYBERIADA_FROZEN_REF(action, next) : NULL;
+}
+
+/* -----------------------------------------------------------------------------
+ * Conversion to the mutable document
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_thaw_string(char** target, size_t* target_len, const void* rec, CyberiadaFrozenRef ref)
+{
+	const CyberiadaFrozenString* s;
+	*target = NULL;
+	*target_len = 0;
+	if (!ref) {
+		return CYBERIADA_NO_ERROR;
+	}
+	s = (const CyberiadaFrozenString*)((const char*)rec + ref);
+	*target = (char*)malloc(s->length + 1);
+	if (!*target) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memcpy(*target, s->data, s->length + 1);
+	*target_len = s->length;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_thaw_point(CyberiadaPoint** point, const CyberiadaPoint* src)
+{
+	if (!src) {
+		return CYBERIADA_NO_ERROR;
+	}
+	*point = htree_copy_point(src);
+	return *point ? CYBERIADA_NO_ERROR : CYBERIADA_MEMORY_ERROR;
+}
+
+static int cyberiada_thaw_rect(CyberiadaRect** rect, const CyberiadaRect* src)
+{
+	if (!src) {
+		return CYBERIADA_NO_ERROR;
+	}
+	*rect = htree_copy_rect(src);
+	return *rect ? CYBERIADA_NO_ERROR : CYBERIADA_MEMORY_ERROR;
+}
+
+static int cyberiada_thaw_actions(CyberiadaAction** actions, const CyberiadaFrozenAction* fa)
+{
+	CyberiadaAction *a, *last = NULL;
+	int res;
+	for (; fa; fa = cyberiada_frozen_action_next(fa)) {
+		a = (CyberiadaAction*)malloc(sizeof(CyberiadaAction));
+		if (!a) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		memset(a, 0, sizeof(CyberiadaAction));
+		if (last) {
+			last->next = a;
+		} else {
+			*actions = a;
+		}
+		last = a;
+		a->type = (CyberiadaActionType)fa->type;
+		if ((res = cyberiada_thaw_string(&(a->trigger), &(a->trigger_len), fa, fa->trigger)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_string(&(a->guard), &(a->guard_len), fa, fa->guard)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_string(&(a->behavior), &(a->behavior_len), fa, fa->behavior)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_thaw_nodes(CyberiadaHash* nodes_map, CyberiadaNode* parent, CyberiadaNode** nodes,
+								const CyberiadaFrozenNode* fn)
+{
+	CyberiadaNode *n, *last = NULL;
+	int res;
+	for (; fn; fn = cyberiada_frozen_node_next(fn)) {
+		n = (CyberiadaNode*)malloc(sizeof(CyberiadaNode));
+		if (!n) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		memset(n, 0, sizeof(CyberiadaNode));
+		n->parent = parent;
+		if (last) {
+			last->next = n;
+		} else {
+			*nodes = n;
+		}
+		last = n;
+		if (cyberiada_hash_put(nodes_map, fn, n) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		n->type = (CyberiadaNodeType)fn->type;
+		n->collapsed_flag = (char)fn->collapsed_flag;
+		if ((res = cyberiada_thaw_string(&(n->id), &(n->id_len), fn, fn->id)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_string(&(n->title), &(n->title_len), fn, fn->title)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_string(&(n->formal_title), &(n->formal_title_len), fn, fn->formal_title)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_string(&(n->color), &(n->color_len), fn, fn->color)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_point(&(n->geometry_point), cyberiada_frozen_node_geometry_point(fn))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_rect(&(n->geometry_rect), cyberiada_frozen_node_geometry_rect(fn))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_actions(&(n->actions), cyberiada_frozen_node_actions(fn))) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (fn->has_comment_data) {
+			n->comment_data = cyberiada_new_comment_data();
+			if (!n->comment_data) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			if ((res = cyberiada_thaw_string(&(n->comment_data->body), &(n->comment_data->body_len),
+											 fn, fn->comment_body)) != CYBERIADA_NO_ERROR ||
+				(res = cyberiada_thaw_string(&(n->comment_data->markup), &(n->comment_data->markup_len),
+											 fn, fn->comment_markup)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if (fn->has_link) {
+			n->link = cyberiada_new_link(NULL);
+			if (!n->link) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			if ((res = cyberiada_thaw_string(&(n->link->ref), &(n->link->ref_len), fn, fn->link_ref)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		if ((res = cyberiada_thaw_nodes(nodes_map, n, &(n->children), cyberiada_frozen_node_children(fn))) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_thaw_edges(CyberiadaHash* nodes_map, CyberiadaEdge** edges, const CyberiadaFrozenEdge* fe)
+{
+	CyberiadaEdge *e, *last = NULL;
+	CyberiadaPolyline *pl, *last_pl;
+	const CyberiadaPoint* points;
+	size_t i, count;
+	int res;
+	for (; fe; fe = cyberiada_frozen_edge_next(fe)) {
+		e = (CyberiadaEdge*)malloc(sizeof(CyberiadaEdge));
+		if (!e) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		memset(e, 0, sizeof(CyberiadaEdge));
+		if (last) {
+			last->next = e;
+		} else {
+			*edges = e;
+		}
+		last = e;
+		e->type = (CyberiadaEdgeType)fe->type;
+		e->source = (CyberiadaNode*)cyberiada_hash_get(nodes_map, cyberiada_frozen_edge_source(fe));
+		e->target = (CyberiadaNode*)cyberiada_hash_get(nodes_map, cyberiada_frozen_edge_target(fe));
+		if ((res = cyberiada_thaw_string(&(e->id), &(e->id_len), fe, fe->id)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_string(&(e->source_id), &(e->source_id_len), fe, fe->source_id)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_string(&(e->target_id), &(e->target_id_len), fe, fe->target_id)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_string(&(e->color), &(e->color_len), fe, fe->color)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_actions(&(e->action), cyberiada_frozen_edge_action(fe))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_point(&(e->geometry_label_point),
+										cyberiada_frozen_edge_geometry_label_point(fe))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_rect(&(e->geometry_label_rect),
+									   cyberiada_frozen_edge_geometry_label_rect(fe))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_point(&(e->geometry_source_point),
+										cyberiada_frozen_edge_geometry_source_point(fe))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_point(&(e->geometry_target_point),
+										cyberiada_frozen_edge_geometry_target_point(fe))) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (fe->has_comment_subject) {
+			e->comment_subject = cyberiada_new_comment_subject((CyberiadaCommentSubjectType)fe->comment_subject_type);
+			if (!e->comment_subject) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			if ((res = cyberiada_thaw_string(&(e->comment_subject->fragment), &(e->comment_subject->fragment_len),
+											 fe, fe->comment_subject_fragment)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+		points = cyberiada_frozen_edge_geometry_polyline(fe, &count);
+		last_pl = NULL;
+		for (i = 0; points && i < count; i++) {
+			pl = htree_new_polyline();
+			if (!pl) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			pl->point = points[i];
+			if (last_pl) {
+				last_pl->next = pl;
+			} else {
+				e->geometry_polyline = pl;
+			}
+			last_pl = pl;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_thaw_meta(CyberiadaDocument* doc, const CyberiadaFrozenDocument* frozen)
+{
+	const CyberiadaFrozenMeta* fm;
+	const CyberiadaFrozenMetaString* fms;
+	CyberiadaMetaStringList *sl, *last = NULL;
+	CyberiadaMetainformation* meta;
+	int res;
+	if (!frozen->meta_info) {
+		return CYBERIADA_NO_ERROR;
+	}
+	fm = (const CyberiadaFrozenMeta*)CYBERIADA_FROZEN_REF(frozen, meta_info);
+	meta = (CyberiadaMetainformation*)malloc(sizeof(CyberiadaMetainformation));
+	if (!meta) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(meta, 0, sizeof(CyberiadaMetainformation));
+	doc->meta_info = meta;
+	meta->transition_order_flag = (char)fm->transition_order_flag;
+	meta->event_propagation_flag = (char)fm->event_propagation_flag;
+	if ((res = cyberiada_thaw_string(&(meta->standard_version), &(meta->standard_version_len),
+									 fm, fm->standard_version)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (fms = cyberiada_frozen_document_meta_strings(frozen); fms; fms = cyberiada_frozen_meta_string_next(fms)) {
+		sl = (CyberiadaMetaStringList*)malloc(sizeof(CyberiadaMetaStringList));
+		if (!sl) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		memset(sl, 0, sizeof(CyberiadaMetaStringList));
+		if (last) {
+			last->next = sl;
+		} else {
+			meta->strings = sl;
+		}
+		last = sl;
+		if ((res = cyberiada_thaw_string(&(sl->name), &(sl->name_len), fms, fms->name)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_string(&(sl->value), &(sl->value_len), fms, fms->value)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_thaw_sm_document(CyberiadaDocument* doc, const CyberiadaFrozenDocument* frozen)
+{
+	const CyberiadaFrozenSM* fsm;
+	CyberiadaSM *sm, *last = NULL;
+	CyberiadaHash nodes_map;
+	int res;
+
+	if (!doc || !frozen) {
+		ERROR("Bad parameters to thaw the frozen document\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	cyberiada_init_sm_document(doc);
+	if (cyberiada_hash_init(&nodes_map, 0, 0) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	do {
+		doc->geometry_format = (CyberiadaGeometryFormat)frozen->geometry_format;
+		doc->node_coord_format = (CyberiadaGeometryCoordFormat)frozen->node_coord_format;
+		doc->edge_coord_format = (CyberiadaGeometryCoordFormat)frozen->edge_coord_format;
+		doc->edge_pl_coord_format = (CyberiadaGeometryCoordFormat)frozen->edge_pl_coord_format;
+		doc->edge_geom_format = (CyberiadaGeometryEdgeFormat)frozen->edge_geom_format;
+		if ((res = cyberiada_thaw_string(&(doc->format), &(doc->format_len), frozen, frozen->format)) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_rect(&(doc->bounding_rect),
+									   cyberiada_frozen_document_bounding_rect(frozen))) != CYBERIADA_NO_ERROR ||
+			(res = cyberiada_thaw_meta(doc, frozen)) != CYBERIADA_NO_ERROR) {
+			break;
+		}
+		for (fsm = cyberiada_frozen_document_sms(frozen); fsm; fsm = cyberiada_frozen_sm_next(fsm)) {
+			sm = cyberiada_new_sm();
+			if (!sm) {
+				res = CYBERIADA_MEMORY_ERROR;
+				break;
+			}
+			if (last) {
+				last->next = sm;
+			} else {
+				doc->state_machines = sm;
+			}
+			last = sm;
+			if ((res = cyberiada_thaw_nodes(&nodes_map, NULL, &(sm->nodes),
+											cyberiada_frozen_sm_nodes(fsm))) != CYBERIADA_NO_ERROR ||
+				(res = cyberiada_thaw_edges(&nodes_map, &(sm->edges),
+											cyberiada_frozen_sm_edges(fsm))) != CYBERIADA_NO_ERROR) {
+				break;
+			}
+		}
+	} while (0);
+
+	cyberiada_hash_free(&nodes_map);
+
+	if (res != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot thaw the frozen document: %d\n", res);
+		cyberiada_cleanup_sm_document(doc);
+	}
+	return res;
+}
@@ -0,0 +1,586 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The packed (structure of arrays) SM geometry store
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_types.h"
+#include "cyb_error.h"
+
+/* -----------------------------------------------------------------------------
+ * The store keeps the SM geometry in contiguous coordinate arrays indexed by
+ * the node ordinal (pre-order) and the edge ordinal (the list order). The
+ * polyline points of all edges are pooled in one pair of arrays. The missing
+ * geometry objects are stored as zeros and masked by the presence flags, so
+ * the bulk kernels run over the whole arrays without branches. The translation
+ * depends on the document coordinates formats: the local node coordinates are
+ * relative to the parent, so only the topmost nodes having geometry are moved
+ * (the node_move mask), and the local edge coordinates are relative to the nodes.
+ * ----------------------------------------------------------------------------- */
+
+#define STORE_NODE_POINT        1
+#define STORE_NODE_RECT         2
+
+#define STORE_EDGE_SOURCE       1
+#define STORE_EDGE_TARGET       2
+#define STORE_EDGE_LABEL        4
+#define STORE_EDGE_POLYLINE     8
+#define STORE_EDGE_LABEL_RECT   16
+
+struct _CyberiadaGeometryStore {
+	CyberiadaDocument*          doc;
+	CyberiadaSM*                sm;
+	/* nodes */
+	size_t                      nodes_count;
+	CyberiadaNode**             nodes;
+	unsigned char*              node_flags;
+	double*                     node_move;              /* 1.0 if the node is moved by translation, 0.0 otherwise */
+	double*                     node_x;
+	double*                     node_y;
+	double*                     node_w;
+	double*                     node_h;
+	/* edges */
+	size_t                      edges_count;
+	CyberiadaEdge**             edges;
+	unsigned char*              edge_flags;
+	double*                     source_x;
+	double*                     source_y;
+	double*                     target_x;
+	double*                     target_y;
+	double*                     label_x;
+	double*                     label_y;
+	double*                     label_rect_x;
+	double*                     label_rect_y;
+	double*                     label_rect_w;
+	double*                     label_rect_h;
+	size_t*                     pl_first;
+	size_t*                     pl_count;
+	/* polyline points pool */
+	size_t                      points_count;
+	double*                     pl_x;
+	double*                     pl_y;
+};
+
+/* -----------------------------------------------------------------------------
+ * Packing
+ * ----------------------------------------------------------------------------- */
+
+static void cyberiada_geometry_store_free_arrays(CyberiadaGeometryStore* store)
+{
+	CyberiadaDocument* doc;
+	CyberiadaSM* sm;
+	if (store->nodes) free(store->nodes);
+	if (store->node_flags) free(store->node_flags);
+	if (store->node_move) free(store->node_move);
+	if (store->node_x) free(store->node_x);
+	if (store->node_y) free(store->node_y);
+	if (store->node_w) free(store->node_w);
+	if (store->node_h) free(store->node_h);
+	if (store->edges) free(store->edges);
+	if (store->edge_flags) free(store->edge_flags);
+	if (store->source_x) free(store->source_x);
+	if (store->source_y) free(store->source_y);
+	if (store->target_x) free(store->target_x);
+	if (store->target_y) free(store->target_y);
+	if (store->label_x) free(store->label_x);
+	if (store->label_y) free(store->label_y);
+	if (store->label_rect_x) free(store->label_rect_x);
+	if (store->label_rect_y) free(store->label_rect_y);
+	if (store->label_rect_w) free(store->label_rect_w);
+	if (store->label_rect_h) free(store->label_rect_h);
+	if (store->pl_first) free(store->pl_first);
+	if (store->pl_count) free(store->pl_count);
+	if (store->pl_x) free(store->pl_x);
+	if (store->pl_y) free(store->pl_y);
+	doc = store->doc;
+	sm = store->sm;
+	memset(store, 0, sizeof(CyberiadaGeometryStore));
+	store->doc = doc;
+	store->sm = sm;
+}
+
+static void* cyberiada_geometry_store_array(size_t count, size_t size, int* error)
+{
+	void* array;
+	if (!count) {
+		return NULL;
+	}
+	array = calloc(count, size);
+	if (!array) {
+		*error = 1;
+	}
+	return array;
+}
+
+/* in the local coordinates the node is moved with the closest ancestor having geometry */
+static void cyberiada_geometry_store_pack_nodes(CyberiadaGeometryStore* store, CyberiadaNode* nodes, size_t* i,
+												int ancestor_moved)
+{
+	int absolute = store->doc->node_coord_format == coordAbsolute;
+	for (; nodes; nodes = nodes->next) {
+		store->nodes[*i] = nodes;
+		store->node_move[*i] = (absolute || !ancestor_moved) ? 1.0 : 0.0;
+		if (nodes->geometry_rect) {
+			store->node_flags[*i] = STORE_NODE_RECT;
+			store->node_x[*i] = nodes->geometry_rect->x;
+			store->node_y[*i] = nodes->geometry_rect->y;
+			store->node_w[*i] = nodes->geometry_rect->width;
+			store->node_h[*i] = nodes->geometry_rect->height;
+		} else if (nodes->geometry_point) {
+			store->node_flags[*i] = STORE_NODE_POINT;
+			store->node_x[*i] = nodes->geometry_point->x;
+			store->node_y[*i] = nodes->geometry_point->y;
+		}
+		(*i)++;
+		cyberiada_geometry_store_pack_nodes(store, nodes->children, i,
+											ancestor_moved || nodes->geometry_rect || nodes->geometry_point);
+	}
+}
+
+static int cyberiada_geometry_store_pack(CyberiadaGeometryStore* store)
+{
+	CyberiadaEdge* edge;
+	CyberiadaPolyline* pl;
+	size_t i, p;
+	int error = 0;
+
+	cyberiada_geometry_store_free_arrays(store);
+
+	store->nodes_count = cyberiada_count_nodes(store->sm->nodes);
+	for (edge = store->sm->edges; edge; edge = edge->next) {
+		store->edges_count++;
+		for (pl = edge->geometry_polyline; pl; pl = pl->next) {
+			store->points_count++;
+		}
+	}
+
+	store->nodes = (CyberiadaNode**)cyberiada_geometry_store_array(store->nodes_count, sizeof(CyberiadaNode*), &error);
+	store->node_flags = (unsigned char*)cyberiada_geometry_store_array(store->nodes_count, 1, &error);
+	store->node_move = (double*)cyberiada_geometry_store_array(store->nodes_count, sizeof(double), &error);
+	store->node_x = (double*)cyberiada_geometry_store_array(store->nodes_count, sizeof(double), &error);
+	store->node_y = (double*)cyberiada_geometry_store_array(store->nodes_count, sizeof(double), &error);
+	store->node_w = (double*)cyberiada_geometry_store_array(store->nodes_count, sizeof(double), &error);
+	store->node_h = (double*)cyberiada_geometry_store_array(store->nodes_count, sizeof(double), &error);
+	store->edges = (CyberiadaEdge**)cyberiada_geometry_store_array(store->edges_count, sizeof(CyberiadaEdge*), &error);
+	store->edge_flags = (unsigned char*)cyberiada_geometry_store_array(store->edges_count, 1, &error);
+	store->source_x = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->source_y = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->target_x = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->target_y = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->label_x = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->label_y = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->label_rect_x = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->label_rect_y = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->label_rect_w = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->label_rect_h = (double*)cyberiada_geometry_store_array(store->edges_count, sizeof(double), &error);
+	store->pl_first = (size_t*)cyberiada_geometry_store_array(store->edges_count, sizeof(size_t), &error);
+	store->pl_count = (size_t*)cyberiada_geometry_store_array(store->edges_count, sizeof(size_t), &error);
+	store->pl_x = (double*)cyberiada_geometry_store_array(store->points_count, sizeof(double), &error);
+	store->pl_y = (double*)cyberiada_geometry_store_array(store->points_count, sizeof(double), &error);
+	if (error) {
+		cyberiada_geometry_store_free_arrays(store);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	i = 0;
+	cyberiada_geometry_store_pack_nodes(store, store->sm->nodes, &i, 0);
+
+	for (i = 0, p = 0, edge = store->sm->edges; edge; edge = edge->next, i++) {
+		store->edges[i] = edge;
+		if (edge->geometry_source_point) {
+			store->edge_flags[i] |= STORE_EDGE_SOURCE;
+			store->source_x[i] = edge->geometry_source_point->x;
+			store->source_y[i] = edge->geometry_source_point->y;
+		}
+		if (edge->geometry_target_point) {
+			store->edge_flags[i] |= STORE_EDGE_TARGET;
+			store->target_x[i] = edge->geometry_target_point->x;
+			store->target_y[i] = edge->geometry_target_point->y;
+		}
+		if (edge->geometry_label_point) {
+			store->edge_flags[i] |= STORE_EDGE_LABEL;
+			store->label_x[i] = edge->geometry_label_point->x;
+			store->label_y[i] = edge->geometry_label_point->y;
+		}
+		if (edge->geometry_label_rect) {
+			store->edge_flags[i] |= STORE_EDGE_LABEL_RECT;
+			store->label_rect_x[i] = edge->geometry_label_rect->x;
+			store->label_rect_y[i] = edge->geometry_label_rect->y;
+			store->label_rect_w[i] = edge->geometry_label_rect->width;
+			store->label_rect_h[i] = edge->geometry_label_rect->height;
+		}
+		store->pl_first[i] = p;
+		for (pl = edge->geometry_polyline; pl; pl = pl->next, p++) {
+			store->pl_x[p] = pl->point.x;
+			store->pl_y[p] = pl->point.y;
+		}
+		store->pl_count[i] = p - store->pl_first[i];
+		if (store->pl_count[i]) {
+			store->edge_flags[i] |= STORE_EDGE_POLYLINE;
+		}
+	}
+
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_new_sm_geometry_store(CyberiadaDocument* doc, CyberiadaSM* sm, CyberiadaGeometryStore** store)
+{
+	CyberiadaGeometryStore* new_store;
+	int res;
+
+	if (!doc || !sm || !store) {
+		ERROR("Cannot create geometry store: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	new_store = (CyberiadaGeometryStore*)malloc(sizeof(CyberiadaGeometryStore));
+	if (!new_store) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(new_store, 0, sizeof(CyberiadaGeometryStore));
+	new_store->doc = doc;
+	new_store->sm = sm;
+
+	if ((res = cyberiada_geometry_store_pack(new_store)) != CYBERIADA_NO_ERROR) {
+		free(new_store);
+		return res;
+	}
+
+	*store = new_store;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_geometry_store_load(CyberiadaGeometryStore* store)
+{
+	if (!store) {
+		ERROR("Cannot load geometry store: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	return cyberiada_geometry_store_pack(store);
+}
+
+int cyberiada_destroy_geometry_store(CyberiadaGeometryStore* store)
+{
+	if (!store) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	cyberiada_geometry_store_free_arrays(store);
+	free(store);
+	return CYBERIADA_NO_ERROR;
+}
+
+/* -----------------------------------------------------------------------------
+ * Unpacking
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_geometry_store_set_point(CyberiadaPoint** point, double x, double y)
+{
+	if (!*point) {
+		*point = htree_new_point();
+		if (!*point) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	(*point)->x = x;
+	(*point)->y = y;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_geometry_store_set_rect(CyberiadaRect** rect, double x, double y, double width, double height)
+{
+	if (!*rect) {
+		*rect = htree_new_rect();
+		if (!*rect) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	(*rect)->x = x;
+	(*rect)->y = y;
+	(*rect)->width = width;
+	(*rect)->height = height;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_geometry_store_set_polyline(CyberiadaEdge* edge, const double* xs, const double* ys, size_t count)
+{
+	CyberiadaPolyline *pl, *prev = NULL;
+	size_t i;
+
+	/* reuse the existing polyline points if possible */
+	for (i = 0, pl = edge->geometry_polyline; pl && i < count; prev = pl, pl = pl->next, i++) {
+		pl->point.x = xs[i];
+		pl->point.y = ys[i];
+	}
+	if (pl) {
+		if (prev) {
+			prev->next = NULL;
+		} else {
+			edge->geometry_polyline = NULL;
+		}
+		htree_destroy_polyline(pl);
+	}
+	for (; i < count; i++) {
+		pl = htree_new_polyline();
+		if (!pl) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		pl->point.x = xs[i];
+		pl->point.y = ys[i];
+		if (prev) {
+			prev->next = pl;
+		} else {
+			edge->geometry_polyline = pl;
+		}
+		prev = pl;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_geometry_store_sync(CyberiadaGeometryStore* store)
+{
+	CyberiadaNode* node;
+	CyberiadaEdge* edge;
+	size_t i;
+	int res = CYBERIADA_NO_ERROR;
+
+	if (!store) {
+		ERROR("Cannot sync geometry store: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	cyberiada_invalidate_sm_absolute_geometry(store->sm);
+
+	for (i = 0; i < store->nodes_count && res == CYBERIADA_NO_ERROR; i++) {
+		node = store->nodes[i];
+		if (store->node_flags[i] == STORE_NODE_RECT) {
+			res = cyberiada_geometry_store_set_rect(&(node->geometry_rect),
+													store->node_x[i], store->node_y[i],
+													store->node_w[i], store->node_h[i]);
+		} else if (store->node_flags[i] == STORE_NODE_POINT) {
+			res = cyberiada_geometry_store_set_point(&(node->geometry_point), store->node_x[i], store->node_y[i]);
+		}
+	}
+
+	for (i = 0; i < store->edges_count && res == CYBERIADA_NO_ERROR; i++) {
+		edge = store->edges[i];
+		if (store->edge_flags[i] & STORE_EDGE_SOURCE) {
+			res = cyberiada_geometry_store_set_point(&(edge->geometry_source_point),
+													 store->source_x[i], store->source_y[i]);
+		}
+		if (res == CYBERIADA_NO_ERROR && (store->edge_flags[i] & STORE_EDGE_TARGET)) {
+			res = cyberiada_geometry_store_set_point(&(edge->geometry_target_point),
+													 store->target_x[i], store->target_y[i]);
+		}
+		if (res == CYBERIADA_NO_ERROR && (store->edge_flags[i] & STORE_EDGE_LABEL)) {
+			res = cyberiada_geometry_store_set_point(&(edge->geometry_label_point),
+													 store->label_x[i], store->label_y[i]);
+		}
+		if (res == CYBERIADA_NO_ERROR && (store->edge_flags[i] & STORE_EDGE_LABEL_RECT)) {
+			res = cyberiada_geometry_store_set_rect(&(edge->geometry_label_rect),
+													store->label_rect_x[i], store->label_rect_y[i],
+													store->label_rect_w[i], store->label_rect_h[i]);
+		}
+		if (res == CYBERIADA_NO_ERROR && (store->edge_flags[i] & STORE_EDGE_POLYLINE)) {
+			res = cyberiada_geometry_store_set_polyline(edge,
+														store->pl_x + store->pl_first[i],
+														store->pl_y + store->pl_first[i],
+														store->pl_count[i]);
+		}
+	}
+
+	if (res != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot sync geometry store: %d\n", res);
+	}
+	return res;
+}
+
+/* -----------------------------------------------------------------------------
+ * Bulk kernels: plain loops over single contiguous arrays without
+ * branches, so the compiler vectorizes them
+ * ----------------------------------------------------------------------------- */
+
+static void cyberiada_kernel_offset(double* a, size_t n, double d)
+{
+	size_t i;
+	for (i = 0; i < n; i++) {
+		a[i] += d;
+	}
+}
+
+static void cyberiada_kernel_offset_masked(double* a, const double* mask, size_t n, double d)
+{
+	size_t i;
+	for (i = 0; i < n; i++) {
+		a[i] += mask[i] * d;
+	}
+}
+
+static void cyberiada_kernel_scale(double* a, size_t n, double k)
+{
+	size_t i;
+	for (i = 0; i < n; i++) {
+		a[i] *= k;
+	}
+}
+
+/* the rounding is delegated to the htgeom helpers to keep the precision of the geometry rounding */
+static void cyberiada_kernel_round_points(double* x, double* y, size_t n)
+{
+	size_t i;
+	HTreePoint p;
+	for (i = 0; i < n; i++) {
+		p.x = x[i];
+		p.y = y[i];
+		htree_round_point(&p, 0);
+		x[i] = p.x;
+		y[i] = p.y;
+	}
+}
+
+static void cyberiada_kernel_round_rects(double* x, double* y, double* w, double* h, size_t n)
+{
+	size_t i;
+	HTreeRect r;
+	for (i = 0; i < n; i++) {
+		r.x = x[i];
+		r.y = y[i];
+		r.width = w[i];
+		r.height = h[i];
+		htree_round_rect(&r, 0);
+		x[i] = r.x;
+		y[i] = r.y;
+		w[i] = r.width;
+		h[i] = r.height;
+	}
+}
+
+int cyberiada_geometry_store_translate(CyberiadaGeometryStore* store, double dx, double dy)
+{
+	if (!store) {
+		ERROR("Cannot translate geometry store: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	/* the nested nodes are moved with the parents in the local coordinates */
+	cyberiada_kernel_offset_masked(store->node_x, store->node_move, store->nodes_count, dx);
+	cyberiada_kernel_offset_masked(store->node_y, store->node_move, store->nodes_count, dy);
+	/* the local edge points & labels are moved with the nodes */
+	if (store->doc->edge_coord_format == coordAbsolute) {
+		cyberiada_kernel_offset(store->source_x, store->edges_count, dx);
+		cyberiada_kernel_offset(store->source_y, store->edges_count, dy);
+		cyberiada_kernel_offset(store->target_x, store->edges_count, dx);
+		cyberiada_kernel_offset(store->target_y, store->edges_count, dy);
+		cyberiada_kernel_offset(store->label_x, store->edges_count, dx);
+		cyberiada_kernel_offset(store->label_y, store->edges_count, dy);
+		cyberiada_kernel_offset(store->label_rect_x, store->edges_count, dx);
+		cyberiada_kernel_offset(store->label_rect_y, store->edges_count, dy);
+	}
+	if (store->doc->edge_pl_coord_format == coordAbsolute) {
+		cyberiada_kernel_offset(store->pl_x, store->points_count, dx);
+		cyberiada_kernel_offset(store->pl_y, store->points_count, dy);
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_geometry_store_scale(CyberiadaGeometryStore* store, double kx, double ky)
+{
+	if (!store) {
+		ERROR("Cannot scale geometry store: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	cyberiada_kernel_scale(store->node_x, store->nodes_count, kx);
+	cyberiada_kernel_scale(store->node_y, store->nodes_count, ky);
+	cyberiada_kernel_scale(store->node_w, store->nodes_count, kx);
+	cyberiada_kernel_scale(store->node_h, store->nodes_count, ky);
+	cyberiada_kernel_scale(store->source_x, store->edges_count, kx);
+	cyberiada_kernel_scale(store->source_y, store->edges_count, ky);
+	cyberiada_kernel_scale(store->target_x, store->edges_count, kx);
+	cyberiada_kernel_scale(store->target_y, store->edges_count, ky);
+	cyberiada_kernel_scale(store->label_x, store->edges_count, kx);
+	cyberiada_kernel_scale(store->label_y, store->edges_count, ky);
+	cyberiada_kernel_scale(store->label_rect_x, store->edges_count, kx);
+	cyberiada_kernel_scale(store->label_rect_y, store->edges_count, ky);
+	cyberiada_kernel_scale(store->label_rect_w, store->edges_count, kx);
+	cyberiada_kernel_scale(store->label_rect_h, store->edges_count, ky);
+	cyberiada_kernel_scale(store->pl_x, store->points_count, kx);
+	cyberiada_kernel_scale(store->pl_y, store->points_count, ky);
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_geometry_store_round(CyberiadaGeometryStore* store)
+{
+	if (!store) {
+		ERROR("Cannot round geometry store: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	cyberiada_kernel_round_rects(store->node_x, store->node_y, store->node_w, store->node_h, store->nodes_count);
+	cyberiada_kernel_round_points(store->source_x, store->source_y, store->edges_count);
+	cyberiada_kernel_round_points(store->target_x, store->target_y, store->edges_count);
+	cyberiada_kernel_round_points(store->label_x, store->label_y, store->edges_count);
+	cyberiada_kernel_round_rects(store->label_rect_x, store->label_rect_y,
+								 store->label_rect_w, store->label_rect_h, store->edges_count);
+	cyberiada_kernel_round_points(store->pl_x, store->pl_y, store->points_count);
+	return CYBERIADA_NO_ERROR;
+}
+
+/* -----------------------------------------------------------------------------
+ * Direct access
+ * ----------------------------------------------------------------------------- */
+
+size_t cyberiada_geometry_store_nodes_count(const CyberiadaGeometryStore* store)
+{
+	return store ? store->nodes_count : 0;
+}
+
+size_t cyberiada_geometry_store_edges_count(const CyberiadaGeometryStore* store)
+{
+	return store ? store->edges_count : 0;
+}
+
+CyberiadaNode* cyberiada_geometry_store_node(const CyberiadaGeometryStore* store, size_t ordinal)
+{
+	if (!store || ordinal >= store->nodes_count) {
+		return NULL;
+	}
+	return store->nodes[ordinal];
+}
+
+CyberiadaEdge* cyberiada_geometry_store_edge(const CyberiadaGeometryStore* store, size_t ordinal)
+{
+	if (!store || ordinal >= store->edges_count) {
+		return NULL;
+	}
+	return store->edges[ordinal];
+}
+
+int cyberiada_geometry_store_node_arrays(CyberiadaGeometryStore* store,
+										 double** x, double** y, double** width, double** height)
+{
+	if (!store) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (x) *x = store->node_x;
+	if (y) *y = store->node_y;
+	if (width) *width = store->node_w;
+	if (height) *height = store->node_h;
+	return CYBERIADA_NO_ERROR;
+}
@@ -201,3 +201,52 @@ CyberiadaEdge* cyberiada_graph_find_last_edge(CyberiadaSM* sm)
 	}
 	return CYBERIADA_NO_ERROR;
 	}*/
+
+int cyberiada_graph_get_initial_pseudostate(CyberiadaSM* sm,
+											CyberiadaNode** initial_node,
+											CyberiadaEdge** initial_edge,
+											int check)
+{
+	CyberiadaNode* n;
+	CyberiadaEdge* e;
+	CyberiadaNode* init_n = NULL;
+	size_t initial = 0, edges_count = 0;
+
+	if (!sm || !sm->nodes) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	
+	for (n = sm->nodes->children; n; n = n->next) {
+		if (n->type == cybNodeInitial) {
+			initial++;
+			init_n = n;
+			if (initial_node) {
+				*initial_node = n;
+			}
+		}
+	}
+
+	if (check) {
+		if (initial != 1) {
+			ERROR("The SM %s should have one single initial pseudostate on the top level\n",
+				  sm->nodes->id);
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		
+		for (e = sm->edges; e; e = e->next) {
+			if (e->source == init_n) {
+				edges_count++;
+				if (initial_edge) {
+					*initial_edge = e;
+				}
+			}
+		}
+		if (!edges_count) {
+			ERROR("The SM %s has no edge form the top level initial pseudostate\n",
+				  sm->nodes->id);
+			return CYBERIADA_FORMAT_ERROR;
+		}
+	}
+		
+	return CYBERIADA_NO_ERROR;
+}
@@ -35,6 +35,8 @@ extern "C" {
 	int cyberiada_graph_add_sibling_node(CyberiadaNode* sibling, CyberiadaNode* new_node);
 	int cyberiada_graph_add_edge(CyberiadaSM* sm, const char* id, const char* source, const char* target, int external);
 	CyberiadaEdge* cyberiada_graph_find_last_edge(CyberiadaSM* sm);
+	int cyberiada_graph_get_initial_pseudostate(CyberiadaSM* sm, CyberiadaNode** initial_node,
+												CyberiadaEdge** initial_edge, int check);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,247 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The SM hierarchy index: depth, ancestor & lowest common ancestor queries
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_error.h"
+
+/* -----------------------------------------------------------------------------
+ * The nodes get the pre-order and post-order numbers: the node A is an
+ * ancestor of the node B iff pre(A) < pre(B) and post(B) < post(A). The lowest
+ * common ancestor is the minimum depth node between the first occurrences of
+ * the nodes in the Euler tour of the node tree; the range minimum is answered
+ * in O(1) by the sparse table of O(V log V) items. The top-level nodes are the
+ * children of the virtual root (the ordinal nodes_count) so the SM with
+ * several top-level nodes is one tree. The pre-order numbers are the SM
+ * ordinals, so the nodes are found by the SM ordinals index. The index is
+ * built on the first query and lives until it is invalidated explicitly or by
+ * the SM editor.
+ * ----------------------------------------------------------------------------- */
+
+struct _CyberiadaHierarchy {
+	size_t                      nodes_count;
+	CyberiadaNode**             nodes;           /* pre-order, nodes_count + 1 items (with the virtual root) */
+	size_t*                     post;
+	size_t*                     depth;           /* the virtual root depth is 0 */
+	size_t*                     first;           /* the first occurrence in the Euler tour */
+	size_t*                     euler;           /* 2 * nodes_count + 1 items */
+	size_t                      euler_count;
+	size_t*                     sparse;          /* levels x euler_count: the min depth Euler tour positions */
+	size_t                      levels;
+};
+
+static void cyberiada_hierarchy_tour(struct _CyberiadaHierarchy* h, CyberiadaNode* node, size_t parent,
+									 size_t* pre, size_t* post)
+{
+	size_t i;
+	for (; node; node = node->next) {
+		i = (*pre)++;
+		h->nodes[i] = node;
+		h->depth[i] = h->depth[parent] + 1;
+		h->first[i] = h->euler_count;
+		h->euler[h->euler_count++] = i;
+		if (node->children) {
+			cyberiada_hierarchy_tour(h, node->children, i, pre, post);
+		}
+		h->post[i] = (*post)++;
+		h->euler[h->euler_count++] = parent;
+	}
+}
+
+static int cyberiada_hierarchy_build(CyberiadaSM* sm)
+{
+	struct _CyberiadaHierarchy* h;
+	CyberiadaNode* const* ordinal_nodes;
+	size_t n, i, k, len, a, b, pre = 0, post = 0;
+	int res;
+
+	/* the ordinals first: building them drops the indexes keyed by the ordinals */
+	if ((res = cyberiada_sm_ordinal_nodes(sm, &ordinal_nodes, &n)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	h = (struct _CyberiadaHierarchy*)malloc(sizeof(struct _CyberiadaHierarchy));
+	if (!h) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(h, 0, sizeof(struct _CyberiadaHierarchy));
+	sm->hierarchy = h;
+	h->nodes_count = n;
+
+	/* the per node arrays and the Euler tour in one block */
+	h->nodes = (CyberiadaNode**)malloc(sizeof(CyberiadaNode*) * (n + 1) + sizeof(size_t) * ((n + 1) * 3 + 2 * n + 1));
+	if (!h->nodes) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	h->post = (size_t*)(h->nodes + n + 1);
+	h->depth = h->post + n + 1;
+	h->first = h->depth + n + 1;
+	h->euler = h->first + n + 1;
+	h->nodes[n] = NULL;
+	h->post[n] = n;
+	h->depth[n] = 0;
+	h->first[n] = 0;
+	h->euler[h->euler_count++] = n;
+	cyberiada_hierarchy_tour(h, sm->nodes, n, &pre, &post);
+
+	for (h->levels = 1; ((size_t)1 << h->levels) <= h->euler_count; h->levels++);
+	h->sparse = (size_t*)malloc(sizeof(size_t) * h->levels * h->euler_count);
+	if (!h->sparse) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	for (i = 0; i < h->euler_count; i++) {
+		h->sparse[i] = i;
+	}
+	for (k = 1; k < h->levels; k++) {
+		len = (size_t)1 << (k - 1);
+		for (i = 0; i + 2 * len <= h->euler_count; i++) {
+			a = h->sparse[(k - 1) * h->euler_count + i];
+			b = h->sparse[(k - 1) * h->euler_count + i + len];
+			h->sparse[k * h->euler_count + i] = h->depth[h->euler[a]] <= h->depth[h->euler[b]] ? a : b;
+		}
+	}
+
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_sm_build_hierarchy(CyberiadaSM* sm)
+{
+	int res;
+
+	if (!sm) {
+		ERROR("Cannot build SM hierarchy: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	cyberiada_invalidate_sm_hierarchy(sm);
+	if ((res = cyberiada_hierarchy_build(sm)) != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot build the SM hierarchy index: %d\n", res);
+		cyberiada_invalidate_sm_hierarchy(sm);
+	}
+	return res;
+}
+
+/* the node pre-order ordinal + 1 or 0 if the node is not indexed; builds the index on demand */
+static size_t cyberiada_hierarchy_ordinal(CyberiadaSM* sm, const CyberiadaNode* node, int* res)
+{
+	size_t ordinal;
+	if (!sm->hierarchy && (*res = cyberiada_sm_build_hierarchy(sm)) != CYBERIADA_NO_ERROR) {
+		return 0;
+	}
+	if ((*res = cyberiada_node_ordinal(sm, node, &ordinal)) != CYBERIADA_NO_ERROR ||
+		ordinal >= sm->hierarchy->nodes_count) {
+		if (*res == CYBERIADA_NO_ERROR) *res = CYBERIADA_NOT_FOUND;
+		return 0;
+	}
+	return ordinal + 1;
+}
+
+int cyberiada_node_hierarchy_position(CyberiadaSM* sm, const CyberiadaNode* node,
+									  size_t* pre, size_t* post, size_t* depth)
+{
+	size_t ordinal;
+	int res;
+
+	if (!sm || !node) {
+		ERROR("Cannot get node hierarchy position: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	ordinal = cyberiada_hierarchy_ordinal(sm, node, &res);
+	if (!ordinal) {
+		return res;
+	}
+	if (pre) *pre = ordinal - 1;
+	if (post) *post = sm->hierarchy->post[ordinal - 1];
+	if (depth) *depth = sm->hierarchy->depth[ordinal - 1] - 1;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_node_is_ancestor(CyberiadaSM* sm, const CyberiadaNode* ancestor, const CyberiadaNode* node, int* result)
+{
+	size_t a, b;
+	int res;
+
+	if (!sm || !ancestor || !node || !result) {
+		ERROR("Cannot check node ancestor: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (!(a = cyberiada_hierarchy_ordinal(sm, ancestor, &res)) ||
+		!(b = cyberiada_hierarchy_ordinal(sm, node, &res))) {
+		return res;
+	}
+	*result = a < b && sm->hierarchy->post[b - 1] < sm->hierarchy->post[a - 1];
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_nodes_lca(CyberiadaSM* sm, const CyberiadaNode* node1, const CyberiadaNode* node2, CyberiadaNode** lca)
+{
+	struct _CyberiadaHierarchy* h;
+	size_t l, r, k = 0, a, b;
+	int res;
+
+	if (!sm || !node1 || !node2 || !lca) {
+		ERROR("Cannot find nodes LCA: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (!(l = cyberiada_hierarchy_ordinal(sm, node1, &res)) ||
+		!(r = cyberiada_hierarchy_ordinal(sm, node2, &res))) {
+		return res;
+	}
+	h = sm->hierarchy;
+	l = h->first[l - 1];
+	r = h->first[r - 1];
+	if (l > r) {
+		a = l; l = r; r = a;
+	}
+	while (((size_t)2 << k) <= r - l + 1) k++;
+	a = h->sparse[k * h->euler_count + l];
+	b = h->sparse[k * h->euler_count + r + 1 - ((size_t)1 << k)];
+	*lca = h->nodes[h->depth[h->euler[a]] <= h->depth[h->euler[b]] ? h->euler[a] : h->euler[b]];
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_invalidate_sm_hierarchy(CyberiadaSM* sm)
+{
+	if (!sm) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (sm->hierarchy) {
+		if (sm->hierarchy->nodes) free(sm->hierarchy->nodes);
+		if (sm->hierarchy->sparse) free(sm->hierarchy->sparse);
+		free(sm->hierarchy);
+		sm->hierarchy = NULL;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_invalidate_document_hierarchy(CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	if (!doc) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		cyberiada_invalidate_sm_hierarchy(sm);
+	}
+	return CYBERIADA_NO_ERROR;
+}
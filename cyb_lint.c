@@ -0,0 +1,285 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The document geometry validation (lint)
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_error.h"
+#include "geometry.h"
+
+/* -----------------------------------------------------------------------------
+ * The lint runs over the absolute geometry table: one traversal of the node
+ * tree checks the geometry kind, the size and the containment, the siblings
+ * of each node are checked for overlapping with a sweep line over the
+ * sorted left borders, and one pass over the edges checks the endpoints.
+ * ----------------------------------------------------------------------------- */
+
+typedef struct {
+	CyberiadaGeometryIssue*     issues;
+	size_t                      count;
+	size_t                      capacity;
+	const CyberiadaGeometryTable* table;
+	double                      tolerance;
+	/* the sweep line buffer */
+	const CyberiadaNodeGeometry** siblings;
+	size_t                      siblings_capacity;
+} CyberiadaLintContext;
+
+static int cyberiada_lint_add(CyberiadaLintContext* ctx, CyberiadaGeometryIssueType type,
+							  CyberiadaNode* node, CyberiadaNode* other_node, CyberiadaEdge* edge)
+{
+	CyberiadaGeometryIssue* issues;
+	CyberiadaGeometryIssue* issue;
+
+	if (ctx->count == ctx->capacity) {
+		ctx->capacity = ctx->capacity ? ctx->capacity * 2 : 16;
+		issues = (CyberiadaGeometryIssue*)realloc(ctx->issues, sizeof(CyberiadaGeometryIssue) * ctx->capacity);
+		if (!issues) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		ctx->issues = issues;
+	}
+	issue = ctx->issues + ctx->count++;
+	issue->type = type;
+	issue->node = node;
+	issue->other_node = other_node;
+	issue->edge = edge;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_lint_is_comment(const CyberiadaNode* node)
+{
+	return node->type == cybNodeComment || node->type == cybNodeFormalComment;
+}
+
+/* the point is inside the rect extended by the tolerance */
+static int cyberiada_lint_point_in_rect(const CyberiadaPoint* p, const CyberiadaRect* r, double tol)
+{
+	return (p->x >= r->x - tol && p->x <= r->x + r->width + tol &&
+			p->y >= r->y - tol && p->y <= r->y + r->height + tol);
+}
+
+static int cyberiada_lint_rect_in_rect(const CyberiadaRect* inner, const CyberiadaRect* outer, double tol)
+{
+	return (inner->x >= outer->x - tol &&
+			inner->y >= outer->y - tol &&
+			inner->x + inner->width <= outer->x + outer->width + tol &&
+			inner->y + inner->height <= outer->y + outer->height + tol);
+}
+
+static int cyberiada_lint_sibling_cmp(const void* a, const void* b)
+{
+	const CyberiadaRect* ra = (*(const CyberiadaNodeGeometry* const*)a)->rect;
+	const CyberiadaRect* rb = (*(const CyberiadaNodeGeometry* const*)b)->rect;
+	return ra->x < rb->x ? -1 : (ra->x > rb->x ? 1 : 0);
+}
+
+static int cyberiada_lint_overlaps(CyberiadaLintContext* ctx, CyberiadaNode* children)
+{
+	CyberiadaNode* child;
+	const CyberiadaNodeGeometry* g;
+	const CyberiadaNodeGeometry** siblings;
+	const CyberiadaRect *a, *b;
+	size_t count = 0, i, j;
+	double tol = ctx->tolerance;
+	int res;
+
+	for (child = children; child; child = child->next) {
+		g = cyberiada_geometry_table_node(ctx->table, child);
+		if (!g || !g->rect || cyberiada_lint_is_comment(child)) {
+			continue;
+		}
+		if (count == ctx->siblings_capacity) {
+			ctx->siblings_capacity = ctx->siblings_capacity ? ctx->siblings_capacity * 2 : 16;
+			siblings = (const CyberiadaNodeGeometry**)realloc(ctx->siblings,
+															  sizeof(CyberiadaNodeGeometry*) * ctx->siblings_capacity);
+			if (!siblings) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			ctx->siblings = siblings;
+		}
+		ctx->siblings[count++] = g;
+	}
+	if (count < 2) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	qsort(ctx->siblings, count, sizeof(CyberiadaNodeGeometry*), cyberiada_lint_sibling_cmp);
+	for (i = 0; i < count; i++) {
+		a = ctx->siblings[i]->rect;
+		for (j = i + 1; j < count; j++) {
+			b = ctx->siblings[j]->rect;
+			if (b->x >= a->x + a->width - tol) {
+				/* the rest of the siblings start to the right */
+				break;
+			}
+			if (b->y < a->y + a->height - tol && a->y < b->y + b->height - tol &&
+				b->x + b->width > a->x + tol) {
+				res = cyberiada_lint_add(ctx, cybGeomIssueOverlap,
+										 (CyberiadaNode*)ctx->siblings[i]->node,
+										 (CyberiadaNode*)ctx->siblings[j]->node, NULL);
+				if (res != CYBERIADA_NO_ERROR) {
+					return res;
+				}
+			}
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_lint_nodes(CyberiadaLintContext* ctx, CyberiadaNode* nodes, const CyberiadaRect* parent_rect)
+{
+	CyberiadaNode* node;
+	const CyberiadaNodeGeometry* g;
+	int res = CYBERIADA_NO_ERROR, outside;
+
+	for (node = nodes; node && res == CYBERIADA_NO_ERROR; node = node->next) {
+		g = cyberiada_geometry_table_node(ctx->table, node);
+		if ((node->geometry_point && (node->type & NODE_GEOMETRY_RECT)) ||
+			(node->geometry_rect && (node->type & NODE_GEOMETRY_POINT))) {
+			res = cyberiada_lint_add(ctx, cybGeomIssueBadKind, node, NULL, NULL);
+		}
+		if (res == CYBERIADA_NO_ERROR && node->geometry_rect &&
+			(node->geometry_rect->width <= 0.0 || node->geometry_rect->height <= 0.0)) {
+			res = cyberiada_lint_add(ctx, cybGeomIssueZeroSize, node, NULL, NULL);
+		}
+		if (res == CYBERIADA_NO_ERROR && g && parent_rect && !cyberiada_lint_is_comment(node)) {
+			if (g->rect) {
+				outside = !cyberiada_lint_rect_in_rect(g->rect, parent_rect, ctx->tolerance);
+			} else if (g->point) {
+				outside = !cyberiada_lint_point_in_rect(g->point, parent_rect, ctx->tolerance);
+			} else {
+				outside = 0;
+			}
+			if (outside) {
+				res = cyberiada_lint_add(ctx, cybGeomIssueOutsideParent, node, node->parent, NULL);
+			}
+		}
+		if (res == CYBERIADA_NO_ERROR && node->children) {
+			res = cyberiada_lint_overlaps(ctx, node->children);
+			if (res == CYBERIADA_NO_ERROR) {
+				res = cyberiada_lint_nodes(ctx, node->children, g && g->rect ? g->rect : NULL);
+			}
+		}
+	}
+	return res;
+}
+
+/* the point is on the border of the node (rect or point) */
+static int cyberiada_lint_on_border(const CyberiadaNodeGeometry* g, const CyberiadaPoint* p, double tol)
+{
+	const CyberiadaRect* r = g->rect;
+	if (r) {
+		if (!cyberiada_lint_point_in_rect(p, r, tol)) {
+			return 0;
+		}
+		/* not strictly inside the rect shrinked by the tolerance */
+		return !(p->x > r->x + tol && p->x < r->x + r->width - tol &&
+				 p->y > r->y + tol && p->y < r->y + r->height - tol);
+	}
+	/* the point nodes have no visible size */
+	return 1;
+}
+
+static int cyberiada_lint_edges(CyberiadaLintContext* ctx, CyberiadaEdge* edges)
+{
+	CyberiadaEdge* edge;
+	const CyberiadaEdgeGeometry* g;
+	const CyberiadaNodeGeometry *source, *target;
+	int res = CYBERIADA_NO_ERROR;
+
+	for (edge = edges; edge && res == CYBERIADA_NO_ERROR; edge = edge->next) {
+		g = cyberiada_geometry_table_edge(ctx->table, edge);
+		if (!g) {
+			continue;
+		}
+		source = cyberiada_geometry_table_node(ctx->table, edge->source);
+		target = cyberiada_geometry_table_node(ctx->table, edge->target);
+		if (g->polyline &&
+			(!source || !target || (!source->rect && !source->point) || (!target->rect && !target->point))) {
+			res = cyberiada_lint_add(ctx, cybGeomIssueDanglingPolyline, NULL, NULL, edge);
+			continue;
+		}
+		if (g->source_point && source && !cyberiada_lint_on_border(source, g->source_point, ctx->tolerance)) {
+			res = cyberiada_lint_add(ctx, cybGeomIssueEndpointOffBorder, edge->source, NULL, edge);
+		}
+		if (res == CYBERIADA_NO_ERROR &&
+			g->target_point && target && !cyberiada_lint_on_border(target, g->target_point, ctx->tolerance)) {
+			res = cyberiada_lint_add(ctx, cybGeomIssueEndpointOffBorder, edge->target, NULL, edge);
+		}
+	}
+	return res;
+}
+
+int cyberiada_lint_document_geometry(CyberiadaDocument* doc, double tolerance,
+									 CyberiadaGeometryIssue** issues, size_t* issues_count)
+{
+	CyberiadaLintContext ctx;
+	CyberiadaGeometryTable* table;
+	CyberiadaSM* sm;
+	int res = CYBERIADA_NO_ERROR;
+
+	if (!doc || !issues || !issues_count || tolerance < 0.0) {
+		ERROR("Cannot lint document geometry: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	*issues = NULL;
+	*issues_count = 0;
+
+	if (!cyberiada_document_has_geometry(doc)) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	table = cyberiada_new_absolute_geometry_table(doc);
+	if (!table) {
+		ERROR("Cannot convert the document geometry to absolute coordinates\n");
+		return CYBERIADA_FORMAT_ERROR;
+	}
+
+	memset(&ctx, 0, sizeof(CyberiadaLintContext));
+	ctx.table = table;
+	ctx.tolerance = tolerance;
+
+	for (sm = doc->state_machines; sm && res == CYBERIADA_NO_ERROR; sm = sm->next) {
+		res = cyberiada_lint_overlaps(&ctx, sm->nodes);
+		if (res == CYBERIADA_NO_ERROR) {
+			res = cyberiada_lint_nodes(&ctx, sm->nodes, NULL);
+		}
+		if (res == CYBERIADA_NO_ERROR) {
+			res = cyberiada_lint_edges(&ctx, sm->edges);
+		}
+	}
+
+	if (ctx.siblings) free(ctx.siblings);
+	cyberiada_destroy_geometry_table(table);
+
+	if (res != CYBERIADA_NO_ERROR) {
+		if (ctx.issues) free(ctx.issues);
+		return res;
+	}
+
+	*issues = ctx.issues;
+	*issues_count = ctx.count;
+	return CYBERIADA_NO_ERROR;
+}
@@ -76,6 +76,7 @@ CyberiadaMetainformation* cyberiada_copy_meta(CyberiadaMetainformation* src)
 {
 	CyberiadaMetainformation* dst;
 	CyberiadaMetaStringList* sl;
+	CyberiadaMetaStringList** dst_tail;
 	if (!src) {
 		return NULL;
 	}
@@ -88,15 +89,10 @@ CyberiadaMetainformation* cyberiada_copy_meta(CyberiadaMetainformation* src)
 	dst->transition_order_flag = src->transition_order_flag;
 	dst->event_propagation_flag = src->event_propagation_flag;
 	sl = src->strings;
+	dst_tail = &(dst->strings);
 	while(sl) {
-		CyberiadaMetaStringList* dst_sl = NULL;
-		if (dst->strings) {
-			dst_sl = dst->strings;
-			while (dst_sl->next) dst_sl = dst_sl->next;
-			dst_sl->next = cyberiada_new_meta_string(sl->name, sl->value);
-		} else {
-			dst->strings = cyberiada_new_meta_string(sl->name, sl->value);
-		}
+		*dst_tail = cyberiada_new_meta_string(sl->name, sl->value);
+		dst_tail = &((*dst_tail)->next);
 		sl = sl->next;
 	}
 	return dst;
@@ -230,6 +226,7 @@ int cyberiada_encode_meta(CyberiadaMetainformation* meta, char** meta_body, size
 int cyberiada_decode_meta(CyberiadaDocument* doc, char* metadata, CyberiadaRegexps* regexps)
 {
 	CyberiadaMetainformation* meta;
+	CyberiadaMetaStringList** strings_tail;
 	char  *start, *block, *block2, *next, *parts;
 	
 	if (doc->meta_info) {
@@ -241,6 +238,7 @@ int cyberiada_decode_meta(CyberiadaDocument* doc, char* metadata, CyberiadaRegex
 		return CYBERIADA_MEMORY_ERROR;
 	}
 	memset(meta, 0, sizeof(CyberiadaMetainformation));
+	strings_tail = &(meta->strings);
 
 	next = metadata;	
 	while (*next) {
@@ -301,14 +299,8 @@ int cyberiada_decode_meta(CyberiadaDocument* doc, char* metadata, CyberiadaRegex
 			cyberiada_destroy_meta(meta);
 			return CYBERIADA_METADATA_FORMAT_ERROR;
 		} else {
-			CyberiadaMetaStringList *sl;
-			if (meta->strings) {
-				sl = meta->strings;
-				while (sl->next) sl = sl->next;
-				sl->next = cyberiada_new_meta_string(start, parts);
-			} else {
-				meta->strings = cyberiada_new_meta_string(start, parts);
-			}
+			*strings_tail = cyberiada_new_meta_string(start, parts);
+			strings_tail = &((*strings_tail)->next);
 		}
 	}
 	
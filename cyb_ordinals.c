@@ -0,0 +1,225 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The SM ordinals: dense node & edge numbers for array-indexed side tables
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_types.h"
+#include "cyb_error.h"
+#include "cyb_structs.h"
+
+/* -----------------------------------------------------------------------------
+ * The nodes are numbered 0..nodes_count-1 in the pre-order of the node tree
+ * (the same numbers as the pre-order numbers of the hierarchy index), the
+ * edges are numbered 0..edges_count-1 in the SM edges list order. The numbers
+ * depend on the SM structure only, so the rebuilt ordinals of the unchanged SM
+ * are the same. The ordinal-to-pointer arrays and the pointer-to-ordinal
+ * hashes are built on the first access and live until the ordinals are
+ * invalidated explicitly or by the SM editor. The arrays are NULL-terminated.
+ * The hierarchy & adjacency indexes, the analysis and the flattening number
+ * the nodes by the ordinals as well, so the indexes are invalidated together
+ * with the ordinals (and thus on every ordinals rebuild).
+ * ----------------------------------------------------------------------------- */
+
+struct _CyberiadaOrdinals {
+	size_t                      nodes_count;
+	size_t                      edges_count;
+	CyberiadaNode**             nodes;
+	CyberiadaEdge**             edges;
+	CyberiadaHash               node_index;      /* node -> ordinal + 1 */
+	CyberiadaHash               edge_index;      /* edge -> ordinal + 1 */
+};
+
+static int cyberiada_ordinals_number_nodes(struct _CyberiadaOrdinals* ord, CyberiadaNode* node)
+{
+	int res;
+	for (; node; node = node->next) {
+		ord->nodes[ord->nodes_count++] = node;
+		if (cyberiada_hash_put(&(ord->node_index), node, (void*)(uintptr_t)ord->nodes_count) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (node->children && (res = cyberiada_ordinals_number_nodes(ord, node->children)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_ordinals_build(CyberiadaSM* sm)
+{
+	struct _CyberiadaOrdinals* ord;
+	CyberiadaEdge* edge;
+	size_t n, e = 0;
+
+	ord = (struct _CyberiadaOrdinals*)malloc(sizeof(struct _CyberiadaOrdinals));
+	if (!ord) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(ord, 0, sizeof(struct _CyberiadaOrdinals));
+	sm->ordinals = ord;
+
+	n = cyberiada_count_nodes(sm->nodes);
+	for (edge = sm->edges; edge; edge = edge->next) {
+		e++;
+	}
+	if (cyberiada_hash_init(&(ord->node_index), 0, n) != 0 ||
+		cyberiada_hash_init(&(ord->edge_index), 0, e) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	/* the nodes & the edges arrays in one block */
+	ord->nodes = (CyberiadaNode**)malloc(sizeof(CyberiadaNode*) * (n + 1) + sizeof(CyberiadaEdge*) * (e + 1));
+	if (!ord->nodes) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	ord->edges = (CyberiadaEdge**)(ord->nodes + n + 1);
+
+	for (edge = sm->edges; edge; edge = edge->next) {
+		ord->edges[ord->edges_count++] = edge;
+		if (cyberiada_hash_put(&(ord->edge_index), edge, (void*)(uintptr_t)ord->edges_count) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	ord->edges[e] = NULL;
+	ord->nodes[n] = NULL;
+	return cyberiada_ordinals_number_nodes(ord, sm->nodes);
+}
+
+int cyberiada_sm_build_ordinals(CyberiadaSM* sm)
+{
+	int res;
+
+	if (!sm) {
+		ERROR("Cannot build SM ordinals: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	cyberiada_invalidate_sm_ordinals(sm);
+	if ((res = cyberiada_ordinals_build(sm)) != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot build the SM ordinals: %d\n", res);
+		cyberiada_invalidate_sm_ordinals(sm);
+	}
+	return res;
+}
+
+int cyberiada_sm_ordinal_nodes(CyberiadaSM* sm, CyberiadaNode* const** nodes, size_t* count)
+{
+	int res;
+
+	if (!sm || !nodes || !count) {
+		ERROR("Cannot get SM ordinal nodes: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (!sm->ordinals && (res = cyberiada_sm_build_ordinals(sm)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	*nodes = sm->ordinals->nodes;
+	*count = sm->ordinals->nodes_count;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_sm_ordinal_edges(CyberiadaSM* sm, CyberiadaEdge* const** edges, size_t* count)
+{
+	int res;
+
+	if (!sm || !edges || !count) {
+		ERROR("Cannot get SM ordinal edges: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (!sm->ordinals && (res = cyberiada_sm_build_ordinals(sm)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	*edges = sm->ordinals->edges;
+	*count = sm->ordinals->edges_count;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_node_ordinal(CyberiadaSM* sm, const CyberiadaNode* node, size_t* ordinal)
+{
+	size_t o;
+	int res;
+
+	if (!sm || !node || !ordinal) {
+		ERROR("Cannot get node ordinal: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (!sm->ordinals && (res = cyberiada_sm_build_ordinals(sm)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	o = (size_t)(uintptr_t)cyberiada_hash_get(&(sm->ordinals->node_index), node);
+	if (!o) {
+		return CYBERIADA_NOT_FOUND;
+	}
+	*ordinal = o - 1;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_edge_ordinal(CyberiadaSM* sm, const CyberiadaEdge* edge, size_t* ordinal)
+{
+	size_t o;
+	int res;
+
+	if (!sm || !edge || !ordinal) {
+		ERROR("Cannot get edge ordinal: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (!sm->ordinals && (res = cyberiada_sm_build_ordinals(sm)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	o = (size_t)(uintptr_t)cyberiada_hash_get(&(sm->ordinals->edge_index), edge);
+	if (!o) {
+		return CYBERIADA_NOT_FOUND;
+	}
+	*ordinal = o - 1;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_invalidate_sm_ordinals(CyberiadaSM* sm)
+{
+	if (!sm) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	/* the adjacency & hierarchy indexes are keyed by the ordinals */
+	cyberiada_invalidate_sm_adjacency(sm);
+	cyberiada_invalidate_sm_hierarchy(sm);
+	if (sm->ordinals) {
+		cyberiada_hash_free(&(sm->ordinals->node_index));
+		cyberiada_hash_free(&(sm->ordinals->edge_index));
+		if (sm->ordinals->nodes) free(sm->ordinals->nodes);
+		free(sm->ordinals);
+		sm->ordinals = NULL;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_invalidate_document_ordinals(CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	if (!doc) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		cyberiada_invalidate_sm_ordinals(sm);
+	}
+	return CYBERIADA_NO_ERROR;
+}
@@ -0,0 +1,413 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The lazy actions: the raw actions text decoded on the first access
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_actions.h"
+#include "cyb_error.h"
+#include "cyb_string.h"
+
+/* -----------------------------------------------------------------------------
+ * With CYBERIADA_FLAG_LAZY_ACTIONS the decoder keeps the node/edge label text
+ * together with the decoder state (the legacy format & the regexps kind) and
+ * the entries options instead of running the action regexps. The text is
+ * decoded by the same functions on the first access to the actions and then
+ * freed, so the result is the same as the eager decoding result; the format
+ * errors are reported at the access time.
+ *
+ * The raw actions decoded from one document share the reference counted
+ * regexps set that is compiled on the first access and freed together with
+ * the last raw action, so the regexps are compiled once per document. The
+ * counter is not atomic: the document should not be accessed concurrently.
+ * ----------------------------------------------------------------------------- */
+
+static CyberiadaRawRegexps* cyberiada_new_raw_regexps(int flattened)
+{
+	CyberiadaRawRegexps* shared = (CyberiadaRawRegexps*)malloc(sizeof(CyberiadaRawRegexps));
+	if (!shared) {
+		return NULL;
+	}
+	memset(shared, 0, sizeof(CyberiadaRawRegexps));
+	shared->flattened = flattened;
+	shared->refs = 1;
+	return shared;
+}
+
+static void cyberiada_unref_raw_regexps(CyberiadaRawRegexps* shared)
+{
+	if (shared && --(shared->refs) == 0) {
+		if (shared->ready) {
+			cyberiada_free_action_regexps(&(shared->regexps));
+		}
+		free(shared);
+	}
+}
+
+void cyberiada_release_raw_regexps(CyberiadaRawRegexps** shared)
+{
+	if (shared && *shared) {
+		cyberiada_unref_raw_regexps(*shared);
+		*shared = NULL;
+	}
+}
+
+int cyberiada_new_raw_action(const char* text, int yed, CyberiadaRegexps* regexps, int flags,
+							 CyberiadaRawRegexps** shared, CyberiadaRawAction** raw)
+{
+	CyberiadaRawAction* new_raw;
+	const char* s;
+
+	if (!text || !regexps || !shared || !raw) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	*raw = NULL;
+	for (s = text; *s && isspace((unsigned char)*s); s++);
+	if (!*s) {
+		/* the blank text has no actions */
+		return CYBERIADA_NO_ERROR;
+	}
+
+	/* the decoder keeps a reference to the current regexps set */
+	if (*shared && (*shared)->flattened != regexps->flattened_regexps) {
+		cyberiada_release_raw_regexps(shared);
+	}
+	if (!*shared) {
+		*shared = cyberiada_new_raw_regexps(regexps->flattened_regexps);
+		if (!*shared) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+
+	new_raw = (CyberiadaRawAction*)malloc(sizeof(CyberiadaRawAction));
+	if (!new_raw) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(new_raw, 0, sizeof(CyberiadaRawAction));
+	if (cyberiada_copy_string(&(new_raw->text), &(new_raw->text_len), text) != CYBERIADA_NO_ERROR) {
+		free(new_raw);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	new_raw->yed = yed;
+	new_raw->berloga_legacy = regexps->berloga_legacy;
+	new_raw->flags = flags;
+	new_raw->shared = *shared;
+	new_raw->shared->refs++;
+	*raw = new_raw;
+	return CYBERIADA_NO_ERROR;
+}
+
+CyberiadaRawAction* cyberiada_copy_raw_action(const CyberiadaRawAction* src)
+{
+	CyberiadaRawAction* raw;
+	if (!src) {
+		return NULL;
+	}
+	raw = (CyberiadaRawAction*)malloc(sizeof(CyberiadaRawAction));
+	if (!raw) {
+		return NULL;
+	}
+	*raw = *src;
+	raw->text = NULL;
+	if (cyberiada_copy_string(&(raw->text), &(raw->text_len), src->text) != CYBERIADA_NO_ERROR) {
+		free(raw);
+		return NULL;
+	}
+	raw->shared->refs++;
+	return raw;
+}
+
+int cyberiada_destroy_raw_action(CyberiadaRawAction* raw)
+{
+	if (!raw) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (raw->text) free(raw->text);
+	cyberiada_unref_raw_regexps(raw->shared);
+	free(raw);
+	return CYBERIADA_NO_ERROR;
+}
+
+/* the shared regexps are compiled on the first access */
+static int cyberiada_raw_prepare_regexps(CyberiadaRawAction* raw, CyberiadaRegexps** regexps)
+{
+	CyberiadaRawRegexps* shared = raw->shared;
+	int res;
+	if (!shared->ready) {
+		if ((res = cyberiada_init_action_regexps(&(shared->regexps), shared->flattened)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		shared->ready = 1;
+	}
+	shared->regexps.berloga_legacy = raw->berloga_legacy;
+	*regexps = &(shared->regexps);
+	return CYBERIADA_NO_ERROR;
+}
+
+/* decode the raw actions of the node into the new action list, the node is not changed */
+static int cyberiada_raw_decode_node_text(const CyberiadaNode* node, CyberiadaAction** result)
+{
+	CyberiadaRawAction* raw = node->raw_actions;
+	CyberiadaAction* actions = NULL;
+	CyberiadaRegexps* regexps;
+	int res;
+
+	if ((res = cyberiada_raw_prepare_regexps(raw, &regexps)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if (raw->yed) {
+		res = cyberiada_decode_state_actions_yed(raw->text, &actions, regexps);
+	} else {
+		res = cyberiada_decode_state_actions(raw->text, &actions, regexps);
+	}
+	if (res == CYBERIADA_NO_ERROR && actions) {
+		if (raw->flags & CYBERIADA_FLAG_STRICT_ACTION_ENTRIES) {
+			res = cyberiada_check_action_doubles(actions);
+		} else {
+			res = cyberiada_join_action_doubles(&actions);
+		}
+		if (res == CYBERIADA_NO_ERROR && (raw->flags & CYBERIADA_FLAG_SKIP_EMPTY_BEHAVIOR)) {
+			res = cyberiada_remove_empty_actions(&actions);
+		}
+	}
+	if (res != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot decode node %s actions: %d\n", node->id, res);
+		if (actions) cyberiada_destroy_action(actions);
+		return res;
+	}
+	*result = actions;
+	return CYBERIADA_NO_ERROR;
+}
+
+/* decode the raw action of the edge into the new action list, the edge is not changed */
+static int cyberiada_raw_decode_edge_text(const CyberiadaEdge* edge, CyberiadaAction** result)
+{
+	CyberiadaRawAction* raw = edge->raw_action;
+	CyberiadaAction* action = NULL;
+	CyberiadaRegexps* regexps;
+	int res;
+
+	if ((res = cyberiada_raw_prepare_regexps(raw, &regexps)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	if ((res = cyberiada_decode_edge_action(raw->text, &action, regexps)) != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot decode edge %s action: %d\n", edge->id, res);
+		if (action) cyberiada_destroy_action(action);
+		return res;
+	}
+	*result = action;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_raw_decode_node(CyberiadaNode* node)
+{
+	CyberiadaAction* actions = NULL;
+	int res;
+
+	if ((res = cyberiada_raw_decode_node_text(node, &actions)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	node->actions = actions;
+	cyberiada_destroy_raw_action(node->raw_actions);
+	node->raw_actions = NULL;
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_raw_decode_edge(CyberiadaEdge* edge)
+{
+	CyberiadaAction* action = NULL;
+	int res;
+
+	if ((res = cyberiada_raw_decode_edge_text(edge, &action)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	edge->action = action;
+	cyberiada_destroy_raw_action(edge->raw_action);
+	edge->raw_action = NULL;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_node_get_actions(CyberiadaNode* node, CyberiadaAction** actions)
+{
+	int res = CYBERIADA_NO_ERROR;
+
+	if (!node || !actions) {
+		ERROR("Cannot get node actions: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (node->raw_actions) {
+		res = cyberiada_raw_decode_node(node);
+	}
+	*actions = node->actions;
+	return res;
+}
+
+int cyberiada_edge_get_action(CyberiadaEdge* edge, CyberiadaAction** action)
+{
+	int res = CYBERIADA_NO_ERROR;
+
+	if (!edge || !action) {
+		ERROR("Cannot get edge action: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (edge->raw_action) {
+		res = cyberiada_raw_decode_edge(edge);
+	}
+	*action = edge->action;
+	return res;
+}
+
+static int cyberiada_raw_decode_nodes(CyberiadaNode* nodes)
+{
+	CyberiadaNode* node;
+	int res;
+	for (node = nodes; node; node = node->next) {
+		if (node->raw_actions && (res = cyberiada_raw_decode_node(node)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (node->children && (res = cyberiada_raw_decode_nodes(node->children)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_decode_sm_actions(CyberiadaSM* sm)
+{
+	CyberiadaEdge* edge;
+	int res;
+
+	if (!sm) {
+		ERROR("Cannot decode SM actions: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if ((res = cyberiada_raw_decode_nodes(sm->nodes)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if (edge->raw_action && (res = cyberiada_raw_decode_edge(edge)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_decode_document_actions(CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	int res;
+
+	if (!doc) {
+		ERROR("Cannot decode document actions: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		if ((res = cyberiada_decode_sm_actions(sm)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* -----------------------------------------------------------------------------
+ * The temporary actions of the exporters: the lazy actions are decoded into
+ * the action fields while the raw text is kept, so the writers see the actions
+ * and the document is restored by the detach. The raw and decoded actions are
+ * mutually exclusive otherwise, so the detach frees the actions of the nodes
+ * and edges that still keep the raw text.
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_attach_node_actions(CyberiadaNode* nodes)
+{
+	CyberiadaNode* node;
+	int res;
+	for (node = nodes; node; node = node->next) {
+		if (node->raw_actions && !node->actions &&
+			(res = cyberiada_raw_decode_node_text(node, &(node->actions))) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		if (node->children && (res = cyberiada_attach_node_actions(node->children)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static void cyberiada_detach_node_actions(CyberiadaNode* nodes)
+{
+	CyberiadaNode* node;
+	for (node = nodes; node; node = node->next) {
+		if (node->raw_actions && node->actions) {
+			cyberiada_destroy_action(node->actions);
+			node->actions = NULL;
+		}
+		if (node->children) {
+			cyberiada_detach_node_actions(node->children);
+		}
+	}
+}
+
+int cyberiada_attach_lazy_actions(CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	CyberiadaEdge* edge;
+	int res;
+
+	if (!doc) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		if ((res = cyberiada_attach_node_actions(sm->nodes)) != CYBERIADA_NO_ERROR) {
+			cyberiada_detach_lazy_actions(doc);
+			return res;
+		}
+		for (edge = sm->edges; edge; edge = edge->next) {
+			if (edge->raw_action && !edge->action &&
+				(res = cyberiada_raw_decode_edge_text(edge, &(edge->action))) != CYBERIADA_NO_ERROR) {
+				cyberiada_detach_lazy_actions(doc);
+				return res;
+			}
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+void cyberiada_detach_lazy_actions(CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	CyberiadaEdge* edge;
+
+	if (!doc) {
+		return;
+	}
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		cyberiada_detach_node_actions(sm->nodes);
+		for (edge = sm->edges; edge; edge = edge->next) {
+			if (edge->raw_action && edge->action) {
+				cyberiada_destroy_action(edge->action);
+				edge->action = NULL;
+			}
+		}
+	}
+}
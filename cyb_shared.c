@@ -0,0 +1,159 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The shared documents: reference counted copy-on-write document handles
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cyberiadaml.h"
+#include "cyb_error.h"
+
+/* -----------------------------------------------------------------------------
+ * The shared document handles refer to the reference counted body with the
+ * document. The copy of the handle shares the body while the document is not
+ * changed. There is no structural sharing: the write access deep copies the
+ * whole document (nodes, edges, actions, strings and geometry) if the body is
+ * shared by several handles, the other handles keep the old document. So the
+ * handles save the memory of the unchanged copies only, every changed copy
+ * costs a full document.
+ *
+ * The reference counter is a plain integer: the handles of one body should
+ * not be copied, written or destroyed from different threads concurrently.
+ * ----------------------------------------------------------------------------- */
+
+typedef struct {
+	size_t                      refs;
+	CyberiadaDocument*          doc;
+} CyberiadaSharedBody;
+
+struct _CyberiadaSharedDocument {
+	CyberiadaSharedBody*        body;
+};
+
+static int cyberiada_shared_new_handle(CyberiadaSharedBody* body, CyberiadaSharedDocument** shared)
+{
+	CyberiadaSharedDocument* handle = (CyberiadaSharedDocument*)malloc(sizeof(CyberiadaSharedDocument));
+	if (!handle) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	handle->body = body;
+	body->refs++;
+	*shared = handle;
+	return CYBERIADA_NO_ERROR;
+}
+
+static void cyberiada_shared_release_body(CyberiadaSharedBody* body)
+{
+	if (--body->refs == 0) {
+		cyberiada_destroy_sm_document(body->doc);
+		free(body);
+	}
+}
+
+int cyberiada_new_shared_document(CyberiadaDocument* doc, CyberiadaSharedDocument** shared)
+{
+	CyberiadaSharedBody* body;
+	int res;
+
+	if (!doc || !shared) {
+		ERROR("Cannot create shared document: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	body = (CyberiadaSharedBody*)malloc(sizeof(CyberiadaSharedBody));
+	if (!body) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	body->refs = 0;
+	body->doc = doc;
+	if ((res = cyberiada_shared_new_handle(body, shared)) != CYBERIADA_NO_ERROR) {
+		free(body);
+	}
+	return res;
+}
+
+int cyberiada_shared_document_copy(CyberiadaSharedDocument* shared, CyberiadaSharedDocument** copy)
+{
+	if (!shared || !copy) {
+		ERROR("Cannot copy shared document: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	return cyberiada_shared_new_handle(shared->body, copy);
+}
+
+CyberiadaDocument* cyberiada_shared_document_read(CyberiadaSharedDocument* shared)
+{
+	if (!shared) {
+		return NULL;
+	}
+	return shared->body->doc;
+}
+
+int cyberiada_shared_document_write(CyberiadaSharedDocument* shared, CyberiadaDocument** doc)
+{
+	CyberiadaSharedBody* body;
+	CyberiadaDocument* clone;
+
+	if (!shared || !doc) {
+		ERROR("Cannot write shared document: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	if (shared->body->refs > 1) {
+		/* detach the handle from the shared body */
+		clone = cyberiada_copy_sm_document(shared->body->doc);
+		if (!clone) {
+			ERROR("Cannot clone the shared document\n");
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		body = (CyberiadaSharedBody*)malloc(sizeof(CyberiadaSharedBody));
+		if (!body) {
+			cyberiada_destroy_sm_document(clone);
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		body->refs = 1;
+		body->doc = clone;
+		shared->body->refs--;
+		shared->body = body;
+	}
+
+	*doc = shared->body->doc;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_shared_document_refs(CyberiadaSharedDocument* shared, size_t* refs)
+{
+	if (!shared || !refs) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	*refs = shared->body->refs;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_destroy_shared_document(CyberiadaSharedDocument* shared)
+{
+	if (!shared) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	cyberiada_shared_release_body(shared->body);
+	free(shared);
+	return CYBERIADA_NO_ERROR;
+}
@@ -0,0 +1,743 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The spatial index (R-tree) over the document geometry
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ *
+ * ----------------------------------------------------------------------------- */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "cyberiadaml.h"
+#include "cyb_types.h"
+#include "cyb_structs.h"
+#include "cyb_error.h"
+#include "geometry.h"
+
+/* -----------------------------------------------------------------------------
+ * The index is a static R-tree bulk-loaded with the Sort-Tile-Recursive
+ * algorithm. The elements are the absolute bounding boxes of the nodes and
+ * the edges (polyline, source/target points and label point; the label rects
+ * are not converted by the geometry library and are skipped). The R-tree nodes
+ * are stored in a single array, the children of each node are contiguous.
+ * The edge entries are indexed by their source & target nodes as well, so the
+ * translation of a subtree updates the incident edges only.
+ * ----------------------------------------------------------------------------- */
+
+#define CYBERIADA_RTREE_FANOUT      16
+#define CYBERIADA_RTREE_NONE        ((size_t)-1)
+#define CYBERIADA_RTREE_MAX_HEIGHT  16
+
+#define EDGE_PART_SOURCE            0
+#define EDGE_PART_TARGET            1
+#define EDGE_PART_BODY              2
+#define EDGE_PARTS                  3
+
+typedef struct {
+	double x1, y1, x2, y2;
+} CyberiadaBox;
+
+/* NOTE: the box should be the first field of the R-tree nodes and entries */
+
+typedef struct {
+	CyberiadaBox                box;
+	size_t                      first;     /* the first child entry / R-tree node */
+	size_t                      count;
+	size_t                      parent;
+	int                         leaf;
+} CyberiadaRTreeNode;
+
+typedef struct {
+	CyberiadaBox                box;
+	CyberiadaBox                parts[EDGE_PARTS];
+	char                        has_part[EDGE_PARTS];
+	CyberiadaNode*              node;
+	CyberiadaEdge*              edge;
+	size_t                      depth;
+	size_t                      parent;
+} CyberiadaSpatialEntry;
+
+struct _CyberiadaSpatialIndex {
+	CyberiadaSpatialEntry*      entries;
+	size_t                      entries_count;
+	CyberiadaRTreeNode*         rnodes;
+	size_t                      rnodes_count;
+	size_t                      root;
+	CyberiadaHash               lookup;    /* node/edge -> entry index + 1 */
+	CyberiadaHash               ends;      /* edge end node -> incident slot + 1 */
+	size_t*                     incident_offsets;
+	size_t*                     incident;  /* the edge entries by the end node slot */
+};
+
+/* -----------------------------------------------------------------------------
+ * Boxes
+ * ----------------------------------------------------------------------------- */
+
+static void cyberiada_box_from_point(CyberiadaBox* box, const CyberiadaPoint* p)
+{
+	box->x1 = box->x2 = p->x;
+	box->y1 = box->y2 = p->y;
+}
+
+static void cyberiada_box_from_rect(CyberiadaBox* box, const CyberiadaRect* r)
+{
+	box->x1 = r->x;
+	box->y1 = r->y;
+	box->x2 = r->x + r->width;
+	box->y2 = r->y + r->height;
+}
+
+static void cyberiada_box_add_point(CyberiadaBox* box, int* empty, const CyberiadaPoint* p)
+{
+	if (*empty) {
+		cyberiada_box_from_point(box, p);
+		*empty = 0;
+	} else {
+		if (p->x < box->x1) box->x1 = p->x;
+		if (p->y < box->y1) box->y1 = p->y;
+		if (p->x > box->x2) box->x2 = p->x;
+		if (p->y > box->y2) box->y2 = p->y;
+	}
+}
+
+static void cyberiada_box_add_box(CyberiadaBox* box, int* empty, const CyberiadaBox* b)
+{
+	if (*empty) {
+		*box = *b;
+		*empty = 0;
+	} else {
+		if (b->x1 < box->x1) box->x1 = b->x1;
+		if (b->y1 < box->y1) box->y1 = b->y1;
+		if (b->x2 > box->x2) box->x2 = b->x2;
+		if (b->y2 > box->y2) box->y2 = b->y2;
+	}
+}
+
+static void cyberiada_box_translate(CyberiadaBox* box, double dx, double dy)
+{
+	box->x1 += dx;
+	box->x2 += dx;
+	box->y1 += dy;
+	box->y2 += dy;
+}
+
+static int cyberiada_box_intersects(const CyberiadaBox* a, const CyberiadaBox* b)
+{
+	return a->x1 <= b->x2 && b->x1 <= a->x2 && a->y1 <= b->y2 && b->y1 <= a->y2;
+}
+
+static int cyberiada_box_center_x_cmp(const void* a, const void* b)
+{
+	const CyberiadaBox* ba = (const CyberiadaBox*)a;
+	const CyberiadaBox* bb = (const CyberiadaBox*)b;
+	double ca = ba->x1 + ba->x2, cb = bb->x1 + bb->x2;
+	return ca < cb ? -1 : (ca > cb ? 1 : 0);
+}
+
+static int cyberiada_box_center_y_cmp(const void* a, const void* b)
+{
+	const CyberiadaBox* ba = (const CyberiadaBox*)a;
+	const CyberiadaBox* bb = (const CyberiadaBox*)b;
+	double ca = ba->y1 + ba->y2, cb = bb->y1 + bb->y2;
+	return ca < cb ? -1 : (ca > cb ? 1 : 0);
+}
+
+/* -----------------------------------------------------------------------------
+ * Index construction
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_node_center(const CyberiadaGeometryTable* table, const CyberiadaNode* node,
+								 CyberiadaPoint* center)
+{
+	const CyberiadaNodeGeometry* g = cyberiada_geometry_table_node(table, node);
+	if (!g) {
+		return 0;
+	}
+	if (g->rect) {
+		center->x = g->rect->x + g->rect->width / 2.0;
+		center->y = g->rect->y + g->rect->height / 2.0;
+		return 1;
+	}
+	if (g->point) {
+		*center = *(g->point);
+		return 1;
+	}
+	return 0;
+}
+
+static void cyberiada_spatial_add_nodes(CyberiadaSpatialIndex* index, const CyberiadaGeometryTable* table,
+										CyberiadaNode* nodes, size_t depth)
+{
+	CyberiadaSpatialEntry* entry;
+	const CyberiadaNodeGeometry* g;
+
+	for (; nodes; nodes = nodes->next) {
+		g = cyberiada_geometry_table_node(table, nodes);
+		if (g && (g->rect || g->point)) {
+			entry = index->entries + index->entries_count++;
+			memset(entry, 0, sizeof(CyberiadaSpatialEntry));
+			if (g->rect) {
+				cyberiada_box_from_rect(&(entry->box), g->rect);
+			} else {
+				cyberiada_box_from_point(&(entry->box), g->point);
+			}
+			entry->node = nodes;
+			entry->depth = depth;
+			entry->parent = CYBERIADA_RTREE_NONE;
+		}
+		cyberiada_spatial_add_nodes(index, table, nodes->children, depth + 1);
+	}
+}
+
+static void cyberiada_spatial_entry_update_box(CyberiadaSpatialEntry* entry)
+{
+	int i, empty = 1;
+	for (i = 0; i < EDGE_PARTS; i++) {
+		if (entry->has_part[i]) {
+			cyberiada_box_add_box(&(entry->box), &empty, entry->parts + i);
+		}
+	}
+}
+
+static void cyberiada_spatial_add_edges(CyberiadaSpatialIndex* index, const CyberiadaGeometryTable* table,
+										CyberiadaEdge* edges)
+{
+	CyberiadaSpatialEntry* entry;
+	const CyberiadaEdgeGeometry* g;
+	CyberiadaPolyline* pl;
+	CyberiadaPoint p;
+	int empty;
+
+	for (; edges; edges = edges->next) {
+		g = cyberiada_geometry_table_edge(table, edges);
+		entry = index->entries + index->entries_count;
+		memset(entry, 0, sizeof(CyberiadaSpatialEntry));
+
+		/* the edge ends: the source/target points or the node centers */
+		if (g && g->source_point) {
+			cyberiada_box_from_point(entry->parts + EDGE_PART_SOURCE, g->source_point);
+			entry->has_part[EDGE_PART_SOURCE] = 1;
+		} else if (cyberiada_node_center(table, edges->source, &p)) {
+			cyberiada_box_from_point(entry->parts + EDGE_PART_SOURCE, &p);
+			entry->has_part[EDGE_PART_SOURCE] = 1;
+		}
+		if (g && g->target_point) {
+			cyberiada_box_from_point(entry->parts + EDGE_PART_TARGET, g->target_point);
+			entry->has_part[EDGE_PART_TARGET] = 1;
+		} else if (cyberiada_node_center(table, edges->target, &p)) {
+			cyberiada_box_from_point(entry->parts + EDGE_PART_TARGET, &p);
+			entry->has_part[EDGE_PART_TARGET] = 1;
+		}
+
+		/* the polyline & the label */
+		empty = 1;
+		if (g) {
+			for (pl = g->polyline; pl; pl = pl->next) {
+				cyberiada_box_add_point(entry->parts + EDGE_PART_BODY, &empty, &(pl->point));
+			}
+			if (g->label_point) {
+				cyberiada_box_add_point(entry->parts + EDGE_PART_BODY, &empty, g->label_point);
+			}
+		}
+		entry->has_part[EDGE_PART_BODY] = !empty;
+
+		if (entry->has_part[EDGE_PART_SOURCE] ||
+			entry->has_part[EDGE_PART_TARGET] ||
+			entry->has_part[EDGE_PART_BODY]) {
+			cyberiada_spatial_entry_update_box(entry);
+			entry->edge = edges;
+			entry->parent = CYBERIADA_RTREE_NONE;
+			index->entries_count++;
+		}
+	}
+}
+
+/* the self-loop is indexed once by its source */
+static int cyberiada_spatial_edge_ends(const CyberiadaEdge* edge, const CyberiadaNode* ends[2])
+{
+	int n = 0;
+	if (edge->source) ends[n++] = edge->source;
+	if (edge->target && edge->target != edge->source) ends[n++] = edge->target;
+	return n;
+}
+
+/* the edge entries by the end nodes in the compressed sparse row form (after the entries are sorted) */
+static int cyberiada_spatial_build_incident(CyberiadaSpatialIndex* index)
+{
+	const CyberiadaNode* ends[2];
+	size_t i, slot, slots = 0, total = 0, *pos;
+	int k, n;
+
+	if (cyberiada_hash_init(&(index->ends), 0, index->entries_count) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	for (i = 0; i < index->entries_count; i++) {
+		if (!index->entries[i].edge) continue;
+		n = cyberiada_spatial_edge_ends(index->entries[i].edge, ends);
+		for (k = 0; k < n; k++) {
+			if (!cyberiada_hash_get(&(index->ends), ends[k]) &&
+				cyberiada_hash_put(&(index->ends), ends[k], (void*)(uintptr_t)(++slots)) != 0) {
+				return CYBERIADA_MEMORY_ERROR;
+			}
+			total++;
+		}
+	}
+
+	index->incident_offsets = (size_t*)malloc(sizeof(size_t) * ((slots + 1) * 2 + total));
+	if (!index->incident_offsets) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	pos = index->incident_offsets + slots + 1;
+	index->incident = pos + slots + 1;
+	memset(index->incident_offsets, 0, sizeof(size_t) * (slots + 1));
+	for (i = 0; i < index->entries_count; i++) {
+		if (!index->entries[i].edge) continue;
+		n = cyberiada_spatial_edge_ends(index->entries[i].edge, ends);
+		for (k = 0; k < n; k++) {
+			slot = (size_t)(uintptr_t)cyberiada_hash_get(&(index->ends), ends[k]);
+			index->incident_offsets[slot]++;
+		}
+	}
+	for (slot = 1; slot <= slots; slot++) {
+		index->incident_offsets[slot] += index->incident_offsets[slot - 1];
+	}
+	memcpy(pos, index->incident_offsets, sizeof(size_t) * (slots + 1));
+	for (i = 0; i < index->entries_count; i++) {
+		if (!index->entries[i].edge) continue;
+		n = cyberiada_spatial_edge_ends(index->entries[i].edge, ends);
+		for (k = 0; k < n; k++) {
+			slot = (size_t)(uintptr_t)cyberiada_hash_get(&(index->ends), ends[k]);
+			index->incident[pos[slot - 1]++] = i;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* Sort-Tile-Recursive ordering of the items (entries or R-tree nodes) */
+static void cyberiada_str_sort(void* items, size_t count, size_t item_size)
+{
+	size_t pages, slices, slice_size, i, n;
+
+	if (count <= CYBERIADA_RTREE_FANOUT) {
+		return;
+	}
+	pages = (count + CYBERIADA_RTREE_FANOUT - 1) / CYBERIADA_RTREE_FANOUT;
+	slices = (size_t)ceil(sqrt((double)pages));
+	slice_size = slices * CYBERIADA_RTREE_FANOUT;
+
+	qsort(items, count, item_size, cyberiada_box_center_x_cmp);
+	for (i = 0; i < count; i += slice_size) {
+		n = count - i < slice_size ? count - i : slice_size;
+		qsort((char*)items + i * item_size, n, item_size, cyberiada_box_center_y_cmp);
+	}
+}
+
+static void cyberiada_rtree_node_update_box(CyberiadaSpatialIndex* index, CyberiadaRTreeNode* rnode)
+{
+	size_t i;
+	int empty = 1;
+	for (i = rnode->first; i < rnode->first + rnode->count; i++) {
+		cyberiada_box_add_box(&(rnode->box), &empty,
+							  rnode->leaf ? &(index->entries[i].box) : &(index->rnodes[i].box));
+	}
+}
+
+/* Create the level of the R-tree nodes over the items [first, first + count) */
+static size_t cyberiada_rtree_add_level(CyberiadaSpatialIndex* index, size_t first, size_t count, int leaf)
+{
+	size_t i, level_first = index->rnodes_count;
+	CyberiadaRTreeNode* rnode;
+
+	for (i = 0; i < count; i += CYBERIADA_RTREE_FANOUT) {
+		rnode = index->rnodes + index->rnodes_count++;
+		rnode->first = first + i;
+		rnode->count = count - i < CYBERIADA_RTREE_FANOUT ? count - i : CYBERIADA_RTREE_FANOUT;
+		rnode->parent = CYBERIADA_RTREE_NONE;
+		rnode->leaf = leaf;
+		cyberiada_rtree_node_update_box(index, rnode);
+	}
+	return level_first;
+}
+
+static int cyberiada_rtree_build(CyberiadaSpatialIndex* index)
+{
+	size_t n, total, level_first, level_count, i, j;
+	CyberiadaRTreeNode* rnode;
+
+	if (!index->entries_count) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	/* the total number of the R-tree nodes */
+	total = 0;
+	n = index->entries_count;
+	do {
+		n = (n + CYBERIADA_RTREE_FANOUT - 1) / CYBERIADA_RTREE_FANOUT;
+		total += n;
+	} while (n > 1);
+
+	index->rnodes = (CyberiadaRTreeNode*)malloc(sizeof(CyberiadaRTreeNode) * total);
+	if (!index->rnodes) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	cyberiada_str_sort(index->entries, index->entries_count, sizeof(CyberiadaSpatialEntry));
+	level_first = cyberiada_rtree_add_level(index, 0, index->entries_count, 1);
+	level_count = index->rnodes_count - level_first;
+	while (level_count > 1) {
+		cyberiada_str_sort(index->rnodes + level_first, level_count, sizeof(CyberiadaRTreeNode));
+		level_first = cyberiada_rtree_add_level(index, level_first, level_count, 0);
+		level_count = index->rnodes_count - level_first;
+	}
+	index->root = level_first;
+
+	/* the parent links are set when all the levels are sorted */
+	for (i = 0; i < index->rnodes_count; i++) {
+		rnode = index->rnodes + i;
+		for (j = rnode->first; j < rnode->first + rnode->count; j++) {
+			if (rnode->leaf) {
+				index->entries[j].parent = i;
+			} else {
+				index->rnodes[j].parent = i;
+			}
+		}
+	}
+
+	for (i = 0; i < index->entries_count; i++) {
+		if (cyberiada_hash_put(&(index->lookup),
+							   index->entries[i].node ? (const void*)index->entries[i].node :
+							                            (const void*)index->entries[i].edge,
+							   (void*)(uintptr_t)(i + 1)) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+
+	return cyberiada_spatial_build_incident(index);
+}
+
+int cyberiada_new_spatial_index(CyberiadaDocument* doc, CyberiadaSpatialIndex** index)
+{
+	CyberiadaSpatialIndex* new_index;
+	CyberiadaGeometryTable* table = NULL;
+	CyberiadaSM* sm;
+	size_t count = 0;
+	int res;
+
+	if (!doc || !index) {
+		ERROR("Cannot create spatial index: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		CyberiadaEdge* edge;
+		count += cyberiada_count_nodes(sm->nodes);
+		for (edge = sm->edges; edge; edge = edge->next) {
+			count++;
+		}
+	}
+
+	new_index = (CyberiadaSpatialIndex*)malloc(sizeof(CyberiadaSpatialIndex));
+	if (!new_index) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	memset(new_index, 0, sizeof(CyberiadaSpatialIndex));
+	new_index->root = CYBERIADA_RTREE_NONE;
+
+	if (count) {
+		new_index->entries = (CyberiadaSpatialEntry*)malloc(sizeof(CyberiadaSpatialEntry) * count);
+		if (!new_index->entries ||
+			cyberiada_hash_init(&(new_index->lookup), 0, count) != 0) {
+			cyberiada_destroy_spatial_index(new_index);
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+
+	if (count && cyberiada_document_has_geometry(doc)) {
+		table = cyberiada_new_absolute_geometry_table(doc);
+		if (!table) {
+			ERROR("Cannot convert the document geometry to absolute coordinates\n");
+			cyberiada_destroy_spatial_index(new_index);
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		for (sm = doc->state_machines; sm; sm = sm->next) {
+			cyberiada_spatial_add_nodes(new_index, table, sm->nodes, 0);
+		}
+		for (sm = doc->state_machines; sm; sm = sm->next) {
+			cyberiada_spatial_add_edges(new_index, table, sm->edges);
+		}
+		cyberiada_destroy_geometry_table(table);
+	}
+
+	if ((res = cyberiada_rtree_build(new_index)) != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot build the spatial index: %d\n", res);
+		cyberiada_destroy_spatial_index(new_index);
+		return res;
+	}
+
+	*index = new_index;
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_destroy_spatial_index(CyberiadaSpatialIndex* index)
+{
+	if (!index) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	if (index->entries) free(index->entries);
+	if (index->rnodes) free(index->rnodes);
+	if (index->incident_offsets) free(index->incident_offsets);
+	cyberiada_hash_free(&(index->lookup));
+	cyberiada_hash_free(&(index->ends));
+	free(index);
+	return CYBERIADA_NO_ERROR;
+}
+
+/* -----------------------------------------------------------------------------
+ * Queries
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_spatial_entry_depth_cmp(const void* a, const void* b)
+{
+	const CyberiadaSpatialEntry* ea = *(const CyberiadaSpatialEntry* const*)a;
+	const CyberiadaSpatialEntry* eb = *(const CyberiadaSpatialEntry* const*)b;
+	if (ea->depth != eb->depth) {
+		return ea->depth > eb->depth ? -1 : 1;
+	}
+	return ea < eb ? -1 : (ea > eb ? 1 : 0);
+}
+
+static int cyberiada_spatial_query(CyberiadaSpatialIndex* index, const CyberiadaBox* query, int by_depth,
+								   CyberiadaNode*** nodes, size_t* nodes_count,
+								   CyberiadaEdge*** edges, size_t* edges_count)
+{
+	size_t stack[CYBERIADA_RTREE_MAX_HEIGHT * CYBERIADA_RTREE_FANOUT];
+	size_t stack_size = 0, i, found_count = 0, found_capacity = 0, n = 0, e = 0;
+	const CyberiadaSpatialEntry** found = NULL;
+	const CyberiadaSpatialEntry** new_found;
+	const CyberiadaRTreeNode* rnode;
+	const CyberiadaSpatialEntry* entry;
+	int res = CYBERIADA_NO_ERROR;
+
+	if (nodes) *nodes = NULL;
+	if (nodes_count) *nodes_count = 0;
+	if (edges) *edges = NULL;
+	if (edges_count) *edges_count = 0;
+
+	if (index->root != CYBERIADA_RTREE_NONE &&
+		cyberiada_box_intersects(&(index->rnodes[index->root].box), query)) {
+		stack[stack_size++] = index->root;
+	}
+	while (stack_size > 0) {
+		rnode = index->rnodes + stack[--stack_size];
+		for (i = rnode->first; i < rnode->first + rnode->count; i++) {
+			if (rnode->leaf) {
+				entry = index->entries + i;
+				if ((entry->node ? !nodes : !edges) ||
+					!cyberiada_box_intersects(&(entry->box), query)) {
+					continue;
+				}
+				if (found_count == found_capacity) {
+					found_capacity = found_capacity ? found_capacity * 2 : CYBERIADA_RTREE_FANOUT;
+					new_found = (const CyberiadaSpatialEntry**)realloc(found,
+																	   sizeof(CyberiadaSpatialEntry*) * found_capacity);
+					if (!new_found) {
+						free(found);
+						return CYBERIADA_MEMORY_ERROR;
+					}
+					found = new_found;
+				}
+				found[found_count++] = entry;
+			} else if (cyberiada_box_intersects(&(index->rnodes[i].box), query)) {
+				stack[stack_size++] = i;
+			}
+		}
+	}
+
+	if (!found_count) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	if (by_depth && found_count > 1) {
+		qsort(found, found_count, sizeof(CyberiadaSpatialEntry*), cyberiada_spatial_entry_depth_cmp);
+	}
+	for (i = 0; i < found_count; i++) {
+		if (found[i]->node) {
+			n++;
+		} else {
+			e++;
+		}
+	}
+	if (n) {
+		*nodes = (CyberiadaNode**)malloc(sizeof(CyberiadaNode*) * n);
+	}
+	if (e) {
+		*edges = (CyberiadaEdge**)malloc(sizeof(CyberiadaEdge*) * e);
+	}
+	if ((n && !*nodes) || (e && !*edges)) {
+		if (n && *nodes) {
+			free(*nodes);
+			*nodes = NULL;
+		}
+		if (e && *edges) {
+			free(*edges);
+			*edges = NULL;
+		}
+		res = CYBERIADA_MEMORY_ERROR;
+	} else {
+		for (i = 0; i < found_count; i++) {
+			if (found[i]->node) {
+				(*nodes)[(*nodes_count)++] = found[i]->node;
+			} else {
+				(*edges)[(*edges_count)++] = found[i]->edge;
+			}
+		}
+	}
+	free(found);
+
+	return res;
+}
+
+int cyberiada_spatial_index_query_point(CyberiadaSpatialIndex* index, double x, double y, double tolerance,
+										CyberiadaNode*** nodes, size_t* nodes_count,
+										CyberiadaEdge*** edges, size_t* edges_count)
+{
+	CyberiadaBox query;
+
+	if (!index || (nodes && !nodes_count) || (edges && !edges_count) || tolerance < 0.0) {
+		ERROR("Cannot query spatial index: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	query.x1 = x - tolerance;
+	query.y1 = y - tolerance;
+	query.x2 = x + tolerance;
+	query.y2 = y + tolerance;
+	return cyberiada_spatial_query(index, &query, 1, nodes, nodes_count, edges, edges_count);
+}
+
+int cyberiada_spatial_index_query_rect(CyberiadaSpatialIndex* index, const CyberiadaRect* rect,
+									   CyberiadaNode*** nodes, size_t* nodes_count,
+									   CyberiadaEdge*** edges, size_t* edges_count)
+{
+	CyberiadaBox query;
+
+	if (!index || !rect || (nodes && !nodes_count) || (edges && !edges_count)) {
+		ERROR("Cannot query spatial index: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	cyberiada_box_from_rect(&query, rect);
+	return cyberiada_spatial_query(index, &query, 0, nodes, nodes_count, edges, edges_count);
+}
+
+/* -----------------------------------------------------------------------------
+ * Incremental update
+ * ----------------------------------------------------------------------------- */
+
+static void cyberiada_spatial_refit(CyberiadaSpatialIndex* index, size_t rnode)
+{
+	while (rnode != CYBERIADA_RTREE_NONE) {
+		cyberiada_rtree_node_update_box(index, index->rnodes + rnode);
+		rnode = index->rnodes[rnode].parent;
+	}
+}
+
+static CyberiadaSpatialEntry* cyberiada_spatial_lookup(CyberiadaSpatialIndex* index, const void* element)
+{
+	uintptr_t i = (uintptr_t)cyberiada_hash_get(&(index->lookup), element);
+	return i ? index->entries + (i - 1) : NULL;
+}
+
+static int cyberiada_spatial_translate_nodes(CyberiadaSpatialIndex* index, CyberiadaNode* node,
+											 int with_siblings, double dx, double dy, CyberiadaHash* moved)
+{
+	CyberiadaSpatialEntry* entry;
+	for (; node; node = with_siblings ? node->next : NULL) {
+		if (cyberiada_hash_put(moved, node, node) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		entry = cyberiada_spatial_lookup(index, node);
+		if (entry) {
+			cyberiada_box_translate(&(entry->box), dx, dy);
+			cyberiada_spatial_refit(index, entry->parent);
+		}
+		if (cyberiada_spatial_translate_nodes(index, node->children, 1, dx, dy, moved) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* the incident edges of the moved nodes; the edge is updated once: at the source if it's moved */
+static void cyberiada_spatial_translate_edges(CyberiadaSpatialIndex* index, CyberiadaNode* node,
+											  int with_siblings, double dx, double dy, CyberiadaHash* moved)
+{
+	CyberiadaSpatialEntry* entry;
+	int source_moved, target_moved, i;
+	size_t slot, j;
+
+	for (; node; node = with_siblings ? node->next : NULL) {
+		slot = (size_t)(uintptr_t)cyberiada_hash_get(&(index->ends), node);
+		for (j = slot ? index->incident_offsets[slot - 1] : 0; j < (slot ? index->incident_offsets[slot] : 0); j++) {
+			entry = index->entries + index->incident[j];
+			source_moved = entry->edge->source && cyberiada_hash_get(moved, entry->edge->source) != NULL;
+			target_moved = entry->edge->target && cyberiada_hash_get(moved, entry->edge->target) != NULL;
+			if (node != entry->edge->source && source_moved) {
+				continue;
+			}
+			for (i = 0; i < EDGE_PARTS; i++) {
+				if (entry->has_part[i] &&
+					((source_moved && target_moved) ||
+					 (i == EDGE_PART_SOURCE && source_moved) ||
+					 (i == EDGE_PART_TARGET && target_moved))) {
+					cyberiada_box_translate(entry->parts + i, dx, dy);
+				}
+			}
+			cyberiada_spatial_entry_update_box(entry);
+			cyberiada_spatial_refit(index, entry->parent);
+		}
+		cyberiada_spatial_translate_edges(index, node->children, 1, dx, dy, moved);
+	}
+}
+
+int cyberiada_spatial_index_translate_node(CyberiadaSpatialIndex* index, CyberiadaNode* node, double dx, double dy)
+{
+	CyberiadaHash moved;
+
+	if (!index || !node) {
+		ERROR("Cannot update spatial index: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	if (cyberiada_hash_init(&moved, 0, 0) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (cyberiada_spatial_translate_nodes(index, node, 0, dx, dy, &moved) != CYBERIADA_NO_ERROR) {
+		cyberiada_hash_free(&moved);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
+	/* the edges inside the moved subtree are moved entirely, the edges crossing
+	   the subtree border are moved at the inner end only */
+	cyberiada_spatial_translate_edges(index, node, 0, dx, dy, &moved);
+
+	cyberiada_hash_free(&moved);
+	return CYBERIADA_NO_ERROR;
+}
@@ -20,9 +20,11 @@
  *
  * ----------------------------------------------------------------------------- */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
 
 #include "cyberiadaml.h"
 #include "cyb_string.h"
@@ -123,3 +125,125 @@ int cyberiada_append_string(char** target, size_t* size, const char* source, con
 	}
 	return CYBERIADA_NO_ERROR;
 }
+
+/* The decimal number parser does not depend on the C locale: the only decimal
+   separator accepted is the dot used by the GraphML files. The common case (up to
+   15 significant digits & moderate exponents) is computed exactly by a single
+   floating point operation (Clinger's fast path); the rest of the numbers are
+   normalized to the <digits>e<exponent> form without the separator and passed
+   to strtod */
+
+#define CYBERIADA_NUMBER_MAX_DIGITS            19
+#define CYBERIADA_NUMBER_FAST_MAX_MANTISSA     ((unsigned long long)1 << 53)
+#define CYBERIADA_NUMBER_FAST_MAX_EXPONENT     22
+#define CYBERIADA_NUMBER_MAX_EXPONENT          100000
+#define CYBERIADA_NUMBER_BUFFER_LEN            48
+
+static const double cyberiada_exact_powers_of_ten[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+int cyberiada_string_to_double(const char* s, double* result)
+{
+	unsigned long long mantissa = 0;
+	int negative = 0, digits = 0, significant = 0, exponent = 0;
+	double value;
+	
+	if (!s || !result) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	while (isspace((unsigned char)*s)) s++;
+	if (*s == '-' || *s == '+') {
+		negative = (*s == '-');
+		s++;
+	}
+
+	while (*s == '0') {
+		digits++;
+		s++;
+	}
+	while (*s >= '0' && *s <= '9') {
+		if (significant < CYBERIADA_NUMBER_MAX_DIGITS) {
+			mantissa = mantissa * 10 + (unsigned long long)(*s - '0');
+			significant++;
+		} else {
+			/* the digits beyond the double precision affect the exponent only */
+			exponent++;
+		}
+		digits++;
+		s++;
+	}
+	if (*s == '.') {
+		s++;
+		if (significant == 0) {
+			while (*s == '0') {
+				exponent--;
+				digits++;
+				s++;
+			}
+		}
+		while (*s >= '0' && *s <= '9') {
+			if (significant < CYBERIADA_NUMBER_MAX_DIGITS) {
+				mantissa = mantissa * 10 + (unsigned long long)(*s - '0');
+				significant++;
+				exponent--;
+			}
+			digits++;
+			s++;
+		}
+	}
+	if (digits == 0) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	
+	if (*s == 'e' || *s == 'E') {
+		int exp_negative = 0, exp_value = 0;
+		s++;
+		if (*s == '-' || *s == '+') {
+			exp_negative = (*s == '-');
+			s++;
+		}
+		if (*s < '0' || *s > '9') {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+		while (*s >= '0' && *s <= '9') {
+			if (exp_value < CYBERIADA_NUMBER_MAX_EXPONENT) {
+				exp_value = exp_value * 10 + (*s - '0');
+			}
+			s++;
+		}
+		exponent += exp_negative ? -exp_value : exp_value;
+	}
+
+	while (isspace((unsigned char)*s)) s++;
+	if (*s) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+
+	if (mantissa == 0) {
+		value = 0.0;
+	} else if (mantissa <= CYBERIADA_NUMBER_FAST_MAX_MANTISSA &&
+			   exponent >= -CYBERIADA_NUMBER_FAST_MAX_EXPONENT &&
+			   exponent <= CYBERIADA_NUMBER_FAST_MAX_EXPONENT) {
+		value = (double)mantissa;
+		if (exponent < 0) {
+			value /= cyberiada_exact_powers_of_ten[-exponent];
+		} else {
+			value *= cyberiada_exact_powers_of_ten[exponent];
+		}
+	} else {
+		char buffer[CYBERIADA_NUMBER_BUFFER_LEN];
+		char* end = NULL;
+		snprintf(buffer, sizeof(buffer), "%llue%d", mantissa, exponent);
+		errno = 0;
+		value = strtod(buffer, &end);
+		if (!end || *end || (errno == ERANGE && (value > 1.0 || value < -1.0))) {
+			return CYBERIADA_FORMAT_ERROR;
+		}
+	}
+
+	*result = negative ? -value : value;
+	return CYBERIADA_NO_ERROR;
+}
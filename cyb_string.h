@@ -41,6 +41,7 @@ extern "C" {
 	int cyberiada_string_is_empty(const char* s);
 	int cyberiada_string_trim(char* orig);
 	int cyberiada_append_string(char** target, size_t* size, const char* source, const char* separator);
+	int cyberiada_string_to_double(const char* s, double* result);
 	
 #ifdef __cplusplus
 }
@@ -22,6 +22,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include "cyb_structs.h"
 	
 int   cyberiada_stack_push(CyberiadaStack** stack)
@@ -279,3 +280,156 @@ int   cyberiada_queue_free(CyberiadaQueue** queue)
 	return 0;
 }
 
+
+#define CYBERIADA_HASH_MIN_SIZE 16
+
+static size_t cyberiada_hash_key(CyberiadaHash* hash, const void* key)
+{
+	size_t h;
+	if (hash->string_keys) {
+		/* FNV-1a */
+		const unsigned char* s = (const unsigned char*)key;
+		h = (size_t)2166136261u;
+		while (*s) {
+			h ^= *s++;
+			h *= (size_t)16777619u;
+		}
+	} else {
+		h = (size_t)(uintptr_t)key;
+		h ^= h >> 17;
+		h *= (size_t)0x9e3779b1u;
+		h ^= h >> 13;
+	}
+	return h & (hash->size - 1);
+}
+
+static int cyberiada_hash_key_equal(CyberiadaHash* hash, const void* key1, const void* key2)
+{
+	if (hash->string_keys) {
+		return strcmp((const char*)key1, (const char*)key2) == 0;
+	} else {
+		return key1 == key2;
+	}
+}
+
+static size_t cyberiada_hash_find_slot(CyberiadaHash* hash, const void* key)
+{
+	size_t i = cyberiada_hash_key(hash, key);
+	while (hash->keys[i] && !cyberiada_hash_key_equal(hash, hash->keys[i], key)) {
+		i = (i + 1) & (hash->size - 1);
+	}
+	return i;
+}
+
+static int cyberiada_hash_resize(CyberiadaHash* hash, size_t new_size)
+{
+	size_t i, j, old_size = hash->size;
+	const void** old_keys = hash->keys;
+	void** old_data = hash->data;
+	hash->keys = (const void**)malloc(sizeof(void*) * new_size);
+	hash->data = (void**)malloc(sizeof(void*) * new_size);
+	if (!hash->keys || !hash->data) {
+		if (hash->keys) free((void*)hash->keys);
+		if (hash->data) free(hash->data);
+		hash->keys = old_keys;
+		hash->data = old_data;
+		return -1;
+	}
+	memset((void*)hash->keys, 0, sizeof(void*) * new_size);
+	memset(hash->data, 0, sizeof(void*) * new_size);
+	hash->size = new_size;
+	for (i = 0; i < old_size; i++) {
+		if (old_keys[i]) {
+			j = cyberiada_hash_find_slot(hash, old_keys[i]);
+			hash->keys[j] = old_keys[i];
+			hash->data[j] = old_data[i];
+		}
+	}
+	if (old_keys) free((void*)old_keys);
+	if (old_data) free(old_data);
+	return 0;
+}
+
+int cyberiada_hash_init(CyberiadaHash* hash, int string_keys, size_t expected_count)
+{
+	size_t size = CYBERIADA_HASH_MIN_SIZE;
+	if (!hash) {
+		return -1;
+	}
+	memset(hash, 0, sizeof(CyberiadaHash));
+	hash->string_keys = string_keys;
+	/* keep the load factor below 1/2 */
+	while (size < expected_count * 2) size <<= 1;
+	return cyberiada_hash_resize(hash, size);
+}
+
+int cyberiada_hash_put(CyberiadaHash* hash, const void* key, void* data)
+{
+	size_t i;
+	if (!hash || !hash->keys || !key) {
+		return -1;
+	}
+	if ((hash->count + 1) * 2 > hash->size) {
+		if (cyberiada_hash_resize(hash, hash->size * 2) != 0) {
+			return -1;
+		}
+	}
+	i = cyberiada_hash_find_slot(hash, key);
+	if (!hash->keys[i]) {
+		hash->keys[i] = key;
+		hash->count++;
+	}
+	hash->data[i] = data;
+	return 0;
+}
+
+void* cyberiada_hash_get(CyberiadaHash* hash, const void* key)
+{
+	size_t i;
+	if (!hash || !hash->keys || !key) {
+		return NULL;
+	}
+	i = cyberiada_hash_find_slot(hash, key);
+	return hash->keys[i] ? hash->data[i] : NULL;
+}
+
+int cyberiada_hash_remove(CyberiadaHash* hash, const void* key)
+{
+	size_t i, j, k;
+	if (!hash || !hash->keys || !key) {
+		return -1;
+	}
+	i = cyberiada_hash_find_slot(hash, key);
+	if (!hash->keys[i]) {
+		return -1;
+	}
+	/* backward shift deletion keeps the probe sequences w/o tombstones */
+	j = i;
+	for (;;) {
+		j = (j + 1) & (hash->size - 1);
+		if (!hash->keys[j]) {
+			break;
+		}
+		k = cyberiada_hash_key(hash, hash->keys[j]);
+		if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+			hash->keys[i] = hash->keys[j];
+			hash->data[i] = hash->data[j];
+			i = j;
+		}
+	}
+	hash->keys[i] = NULL;
+	hash->data[i] = NULL;
+	hash->count--;
+	return 0;
+}
+
+int cyberiada_hash_free(CyberiadaHash* hash)
+{
+	if (!hash) {
+		return -1;
+	}
+	if (hash->keys) free((void*)hash->keys);
+	if (hash->data) free(hash->data);
+	memset(hash, 0, sizeof(CyberiadaHash));
+	return 0;
+}
@@ -63,6 +63,24 @@ extern "C" {
 	int    cyberiada_queue_add(CyberiadaQueue** queue, void* key, void* data);	
 	int    cyberiada_queue_get(CyberiadaQueue** queue, void** key, void**data);
 	int    cyberiada_queue_free(CyberiadaQueue** queue);
+
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML hash table (open addressing) with string or pointer keys
+ * ----------------------------------------------------------------------------- */
+
+	typedef struct {
+		const void**             keys;
+		void**                   data;
+		size_t                   size;
+		size_t                   count;
+		int                      string_keys;
+	} CyberiadaHash;
+
+	int    cyberiada_hash_init(CyberiadaHash* hash, int string_keys, size_t expected_count);
+	int    cyberiada_hash_put(CyberiadaHash* hash, const void* key, void* data);
+	void*  cyberiada_hash_get(CyberiadaHash* hash, const void* key);
+	int    cyberiada_hash_remove(CyberiadaHash* hash, const void* key);
+	int    cyberiada_hash_free(CyberiadaHash* hash);
 	
 #ifdef __cplusplus
 }
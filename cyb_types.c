@@ -25,6 +25,7 @@
 #include <stdio.h>
 
 #include "cyb_types.h"
+#include "cyb_structs.h"
 #include "cyb_actions.h"
 #include "cyb_meta.h"
 
@@ -149,6 +150,9 @@ static CyberiadaNode* cyberiada_copy_node(CyberiadaNode* src)
 			}
 		}
 	}
+	if (src->raw_actions) {
+		dst->raw_actions = cyberiada_copy_raw_action(src->raw_actions);
+	}
 	if (src->children) {
 		for (src_child = src->children; src_child; src_child = src_child->next) {
 			dst_child = cyberiada_copy_node(src_child);
@@ -183,16 +187,17 @@ int cyberiada_destroy_action(CyberiadaAction* action)
 
 static int cyberiada_destroy_all_nodes(CyberiadaNode* node);
 
-static int cyberiada_destroy_node(CyberiadaNode* node)
+int cyberiada_destroy_node(CyberiadaNode* node)
 {
 	if(node != NULL) {
 		if (node->id) free(node->id);
 		if (node->title) free(node->title);
-		if (node->formal_title) free(node->title);
+		if (node->formal_title) free(node->formal_title);
 		if (node->children) {
 			cyberiada_destroy_all_nodes(node->children);
 		}
 		if (node->actions) cyberiada_destroy_action(node->actions);
+		if (node->raw_actions) cyberiada_destroy_raw_action(node->raw_actions);
 		if (node->geometry_point) htree_destroy_point(node->geometry_point);
 		if (node->geometry_rect) htree_destroy_rect(node->geometry_rect);
 		if (node->color) free(node->color);
@@ -223,6 +228,15 @@ static int cyberiada_destroy_all_nodes(CyberiadaNode* node)
 	return CYBERIADA_NO_ERROR;
 }
 
+size_t cyberiada_count_nodes(CyberiadaNode* nodes)
+{
+	size_t count = 0;
+	for (; nodes; nodes = nodes->next) {
+		count += 1 + cyberiada_count_nodes(nodes->children);
+	}
+	return count;
+}
+
 int cyberiada_update_complex_state(CyberiadaNode* node, CyberiadaNode* parent)
 {
 	if (parent && parent->type == cybNodeSimpleState &&
@@ -288,6 +302,9 @@ static CyberiadaEdge* cyberiada_copy_edge(CyberiadaEdge* src)
 	if (src->action) {
 		dst->action = cyberiada_copy_action(src->action);
 	}
+	if (src->raw_action) {
+		dst->raw_action = cyberiada_copy_raw_action(src->raw_action);
+	}
 	if (src->comment_subject) {
 		dst->comment_subject = cyberiada_copy_comment_subject(src->comment_subject);
 	}
@@ -312,7 +329,7 @@ static CyberiadaEdge* cyberiada_copy_edge(CyberiadaEdge* src)
 	return dst;
 }
 
-static int cyberiada_destroy_edge(CyberiadaEdge* e)
+int cyberiada_destroy_edge(CyberiadaEdge* e)
 {
 	if (!e) {
 		return CYBERIADA_BAD_PARAMETER;
@@ -321,6 +338,7 @@ static int cyberiada_destroy_edge(CyberiadaEdge* e)
 	if (e->source_id) free(e->source_id);
 	if (e->target_id) free(e->target_id);
 	if (e->action) cyberiada_destroy_action(e->action);
+	if (e->raw_action) cyberiada_destroy_raw_action(e->raw_action);
 	if (e->comment_subject) {
 		if (e->comment_subject->fragment) free(e->comment_subject->fragment);
 		free(e->comment_subject);
@@ -360,16 +378,35 @@ int cyberiada_destroy_sm(CyberiadaSM* sm)
 				cyberiada_destroy_edge(e);
 			} while (edge);
 		}
+		cyberiada_invalidate_sm_absolute_geometry(sm);
+		cyberiada_invalidate_sm_adjacency(sm);
+		cyberiada_invalidate_sm_hierarchy(sm);
+		cyberiada_invalidate_sm_ordinals(sm);
 		free(sm);
 	}
 	return CYBERIADA_NO_ERROR;
 }
 
+/* index the node identifiers in the pre-order (the first node with the id wins as in the id search) */
+static int cyberiada_copy_index_nodes(CyberiadaHash* ids, CyberiadaNode* node)
+{
+	for (; node; node = node->next) {
+		if (node->id && !cyberiada_hash_get(ids, node->id) && cyberiada_hash_put(ids, node->id, node) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (node->children && cyberiada_copy_index_nodes(ids, node->children) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
 static CyberiadaSM* cyberiada_copy_sm(CyberiadaSM* src)
 {
 	CyberiadaSM* dst;
 	CyberiadaNode* node, *new_node, *prev_node;
 	CyberiadaEdge *edge, *new_edge, *prev_edge;
+	CyberiadaHash ids;
 
 	if (!src) {
 		return NULL;
@@ -403,11 +440,18 @@ static CyberiadaSM* cyberiada_copy_sm(CyberiadaSM* src)
 		}
 	}
 	/* update links to the source & target nodes */
+	if (cyberiada_hash_init(&ids, 1, 0) != 0 ||
+		cyberiada_copy_index_nodes(&ids, dst->nodes) != CYBERIADA_NO_ERROR) {
+		cyberiada_hash_free(&ids);
+		cyberiada_destroy_sm(dst);
+		return NULL;
+	}
 	edge = dst->edges;
 	while (edge) {
-		CyberiadaNode* source = cyberiada_graph_find_node_by_id(dst->nodes, edge->source_id);
-		CyberiadaNode* target = cyberiada_graph_find_node_by_id(dst->nodes, edge->target_id);
+		CyberiadaNode* source = edge->source_id ? (CyberiadaNode*)cyberiada_hash_get(&ids, edge->source_id) : NULL;
+		CyberiadaNode* target = edge->target_id ? (CyberiadaNode*)cyberiada_hash_get(&ids, edge->target_id) : NULL;
 		if (!source || !target) {
+			cyberiada_hash_free(&ids);
 			cyberiada_destroy_sm(dst);
 			return NULL;
 		}
@@ -415,6 +459,7 @@ static CyberiadaSM* cyberiada_copy_sm(CyberiadaSM* src)
 		edge->target = target;
 		edge = edge->next;
 	}
+	cyberiada_hash_free(&ids);
 	return dst;
 }
 
@@ -564,6 +609,9 @@ int cyberiada_print_node(CyberiadaNode* node, int level)
 	}
 	
 	cyberiada_print_action(node->actions, level + 1);
+	if (node->raw_actions) {
+		printf("%sRaw actions: %s\n", levelspace, node->raw_actions->text);
+	}
 	
 	printf("%sChildren:\n", levelspace);
 	for (cur_node = node->children; cur_node; cur_node = cur_node->next) {
@@ -622,6 +670,9 @@ int cyberiada_print_edge(CyberiadaEdge* edge)
 			   edge->geometry_label_rect->height);
 	}
 	cyberiada_print_action(edge->action, 2);
+	if (edge->raw_action) {
+		printf("   Raw action: %s\n", edge->raw_action->text);
+	}
 	return CYBERIADA_NO_ERROR;
 }
 
@@ -30,6 +30,10 @@ extern "C" {
 #endif
 
 	int cyberiada_update_complex_state(CyberiadaNode* node, CyberiadaNode* parent);
+	/* the number of the nodes in the node lists & their subtrees */
+	size_t cyberiada_count_nodes(CyberiadaNode* nodes);
+	int cyberiada_destroy_node(CyberiadaNode* node);
+	int cyberiada_destroy_edge(CyberiadaEdge* e);
 	
 #ifdef __cplusplus
 }
@@ -38,6 +38,7 @@
 #include "cyb_node_stack.h"
 #include "cyb_regexps.h"
 #include "cyb_string.h"
+#include "cyb_structs.h"
 #include "cyb_types.h"
 #include "geometry.h"
 #include "utf8enc.h"
@@ -425,14 +426,78 @@ static int cyberiada_xml_read_coord(xmlNode* xml_node,
 									const char* attr_name,
 									double* result)
 {
-	char buffer[MAX_STR_LEN];
-	size_t buffer_len = sizeof(buffer);
-	if (cyberiada_get_attr_value(buffer, buffer_len,
-								 xml_node,
-								 attr_name) != CYBERIADA_NO_ERROR) {
-		return CYBERIADA_BAD_PARAMETER;
+	xmlAttr* attribute = xml_node->properties;
+	xmlChar* value;
+	int res;
+	while(attribute) {
+		if (strcmp((const char*)attribute->name, attr_name) == 0) {
+			if (attribute->children &&
+				attribute->children->type == XML_TEXT_NODE &&
+				attribute->children->next == NULL) {
+				/* the usual single text node value is parsed in place */
+				value = attribute->children->content;
+				res = cyberiada_string_to_double((const char*)value, result);
+			} else {
+				value = xmlNodeListGetString(xml_node->doc, attribute->children, 1);
+				res = cyberiada_string_to_double((const char*)value, result);
+				xmlFree(value);
+				value = NULL;
+			}
+			if (res != CYBERIADA_NO_ERROR) {
+				ERROR("Bad coordinate value %s of the attribute %s\n",
+					  value ? (const char*)value : "", attr_name);
+				return CYBERIADA_FORMAT_ERROR;
+			}
+			return CYBERIADA_NO_ERROR;
+		}
+		attribute = attribute->next;
+	}
+	return CYBERIADA_NOT_FOUND;
+}
+
+static int cyberiada_xml_read_optional_coord(xmlNode* xml_node,
+											 const char* attr_name,
+											 double* result)
+{
+	int res = cyberiada_xml_read_coord(xml_node, attr_name, result);
+	if (res == CYBERIADA_NOT_FOUND) {
+		*result = 0.0;
+		return CYBERIADA_NO_ERROR;
+	}
+	return res;
+}
+
+static int cyberiada_xml_read_point_coords(xmlNode* xml_node,
+										   CyberiadaPoint* p)
+{
+	if (cyberiada_xml_read_optional_coord(xml_node,
+										  GRAPHML_GEOM_X_ATTRIBUTE,
+										  &(p->x)) != CYBERIADA_NO_ERROR ||
+		cyberiada_xml_read_optional_coord(xml_node,
+										  GRAPHML_GEOM_Y_ATTRIBUTE,
+										  &(p->y)) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_xml_read_rect_coords(xmlNode* xml_node,
+										  CyberiadaRect* r)
+{
+	if (cyberiada_xml_read_optional_coord(xml_node,
+										  GRAPHML_GEOM_X_ATTRIBUTE,
+										  &(r->x)) != CYBERIADA_NO_ERROR ||
+		cyberiada_xml_read_optional_coord(xml_node,
+										  GRAPHML_GEOM_Y_ATTRIBUTE,
+										  &(r->y)) != CYBERIADA_NO_ERROR ||
+		cyberiada_xml_read_optional_coord(xml_node,
+										  GRAPHML_GEOM_WIDTH_ATTRIBUTE,
+										  &(r->width)) != CYBERIADA_NO_ERROR ||
+		cyberiada_xml_read_optional_coord(xml_node,
+										  GRAPHML_GEOM_HEIGHT_ATTRIBUTE,
+										  &(r->height)) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_FORMAT_ERROR;
 	}
-	*result = (double)atof(buffer);
 	return CYBERIADA_NO_ERROR;
 }
 
@@ -440,15 +505,9 @@ static int cyberiada_xml_read_point(xmlNode* xml_node,
 									CyberiadaPoint** point)
 {
 	CyberiadaPoint* p = htree_new_point();
-	if (cyberiada_xml_read_coord(xml_node,
-								 GRAPHML_GEOM_X_ATTRIBUTE,
-								 &(p->x))) {
-		p->x = 0.0;
-	}
-	if (cyberiada_xml_read_coord(xml_node,
-								 GRAPHML_GEOM_Y_ATTRIBUTE,
-								 &(p->y)) != CYBERIADA_NO_ERROR) {
-		p->y = 0.0;
+	if (cyberiada_xml_read_point_coords(xml_node, p) != CYBERIADA_NO_ERROR) {
+		htree_destroy_point(p);
+		return CYBERIADA_FORMAT_ERROR;
 	}
 	*point = p;
 	return CYBERIADA_NO_ERROR;
@@ -458,30 +517,265 @@ static int cyberiada_xml_read_rect(xmlNode* xml_node,
 								   CyberiadaRect** rect)
 {
 	CyberiadaRect* r = htree_new_rect();
-	if (cyberiada_xml_read_coord(xml_node,
-								 GRAPHML_GEOM_X_ATTRIBUTE,
-								 &(r->x)) != CYBERIADA_NO_ERROR) {
-		r->x = 0.0;
+	if (cyberiada_xml_read_rect_coords(xml_node, r) != CYBERIADA_NO_ERROR) {
+		htree_destroy_rect(r);
+		return CYBERIADA_FORMAT_ERROR;
 	}
-	if (cyberiada_xml_read_coord(xml_node,
-								 GRAPHML_GEOM_Y_ATTRIBUTE,
-								 &(r->y)) != CYBERIADA_NO_ERROR) {
-		r->y = 0.0;
+	*rect = r;
+	return CYBERIADA_NO_ERROR;
+}
+
+/* -----------------------------------------------------------------------------
+ * The decoder viewport clipping: the nodes geometry wholly outside the
+ * viewport (and the geometry of their descendants) is counted but not stored
+ * ----------------------------------------------------------------------------- */
+
+typedef struct _CyberiadaDecodeClip {
+	CyberiadaRect                viewport;
+	int                          local;           /* the node coordinates are relative to the parent left-top */
+	CyberiadaHash                clipped;         /* the clipped nodes */
+	size_t                       clipped_nodes;
+	size_t                       clipped_edges;
+} CyberiadaDecodeClip;
+
+/* check the node geometry rect (zero-sized for points) in the file coordinates and */
+/* register the node as clipped if it is outside the viewport; returns 1 if clipped */
+static int cyberiada_decode_clip_node(CyberiadaDecodeClip* clip, CyberiadaNode* node,
+									  double x, double y, double width, double height)
+{
+	CyberiadaNode* parent;
+	int outside = 0;
+
+	for (parent = node->parent; parent; parent = parent->parent) {
+		if (cyberiada_hash_get(&(clip->clipped), parent)) {
+			outside = 1;
+			break;
+		}
+		if (clip->local && parent->geometry_rect) {
+			x += parent->geometry_rect->x;
+			y += parent->geometry_rect->y;
+		}
 	}
-	if (cyberiada_xml_read_coord(xml_node,
-								 GRAPHML_GEOM_WIDTH_ATTRIBUTE,
-								 &(r->width)) != CYBERIADA_NO_ERROR) {
-		r->width = 0.0;
+
+	if (!outside) {
+		outside = (x + width < clip->viewport.x || x > clip->viewport.x + clip->viewport.width ||
+				   y + height < clip->viewport.y || y > clip->viewport.y + clip->viewport.height);
 	}
-	if (cyberiada_xml_read_coord(xml_node,
-								 GRAPHML_GEOM_HEIGHT_ATTRIBUTE,
-								 &(r->height)) != CYBERIADA_NO_ERROR) {
-		r->height = 0.0;
+
+	if (outside) {
+		if (!cyberiada_hash_get(&(clip->clipped), node)) {
+			cyberiada_hash_put(&(clip->clipped), node, node);
+		}
+		clip->clipped_nodes++;
+	}
+	return outside;
+}
+
+/* drop the geometry of the edges connecting the clipped nodes */
+static void cyberiada_decode_clip_edges(CyberiadaDecodeClip* clip, CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	CyberiadaEdge* edge;
+
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		for (edge = sm->edges; edge; edge = edge->next) {
+			if (edge->source && edge->target &&
+				cyberiada_hash_get(&(clip->clipped), edge->source) &&
+				cyberiada_hash_get(&(clip->clipped), edge->target)) {
+				cyberiada_clean_edge_geometry(edge);
+				clip->clipped_edges++;
+			}
+		}
+	}
+}
+
+/* -----------------------------------------------------------------------------
+ * The decoder category skipping: the comment nodes, the comment edges, the
+ * actions, the geometry or the meta node selected by the decode options are
+ * not allocated and the XML subtrees of the skipped elements are not walked.
+ * The edges of the skipped nodes are skipped too.
+ * ----------------------------------------------------------------------------- */
+
+typedef struct _CyberiadaDecodeSkip {
+	int                          mask;            /* CYBERIADA_DECODE_SKIP_* */
+	int                          subtree;         /* do not walk the children of the current XML element */
+	CyberiadaHash                nodes;           /* the skipped node ids (owned) */
+	CyberiadaHash                comments;        /* the decoded comment node ids (owned) */
+	size_t                       skipped_nodes;
+	size_t                       skipped_edges;
+} CyberiadaDecodeSkip;
+
+/* -----------------------------------------------------------------------------
+ * The decoder context passed through the XML handlers: the action regexps
+ * (with the format legacy state) and the state of the current decoding
+ * ----------------------------------------------------------------------------- */
+
+typedef struct {
+	CyberiadaRegexps*            regexps;         /* the action regexps */
+	int                          flags;           /* the import flags */
+	CyberiadaDecodeClip*         clip;            /* the viewport clipping state (NULL if not used) */
+	CyberiadaDecodeSkip*         skip;            /* the category skipping state (NULL if not used) */
+	CyberiadaSMBuilder*          builder;         /* the builder of the current SM */
+	CyberiadaRawRegexps*         raw_regexps;     /* the shared regexps of the lazy actions (NULL if not used) */
+} CyberiadaDecodeContext;
+
+static const char* cyberiada_init_table_find_name(const char* id);
+
+static int cyberiada_decode_skip(CyberiadaDecodeContext* ctx, int category)
+{
+	return ctx->skip && (ctx->skip->mask & category);
+}
+
+/* skip the current XML element children */
+static void cyberiada_decode_skip_subtree(CyberiadaDecodeContext* ctx)
+{
+	ctx->skip->subtree = 1;
+}
+
+static int cyberiada_decode_skip_register(CyberiadaHash* hash, const char* id)
+{
+	char* key = NULL;
+	size_t key_len;
+	if (cyberiada_hash_get(hash, id)) {
+		return CYBERIADA_NO_ERROR;
+	}
+	if (cyberiada_copy_string(&key, &key_len, id) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (cyberiada_hash_put(hash, key, key) != 0) {
+		free(key);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* the skip category of the Cyberiada GraphML node by the node data elements */
+static int cyberiada_decode_skip_cyb_node_category(xmlNode* xml_node)
+{
+	char buffer[MAX_STR_LEN];
+	size_t buffer_len = sizeof(buffer);
+	xmlNode* data;
+	const char* key_name;
+	int comment = 0, formal = 0, meta = 0;
+
+	for (data = xml_node->children; data; data = data->next) {
+		if (data->type != XML_ELEMENT_NODE ||
+			strcmp((const char*)data->name, GRAPHML_DATA_ELEMENT) != 0 ||
+			cyberiada_get_attr_value(buffer, buffer_len, data, GRAPHML_KEY_ATTRIBUTE) != CYBERIADA_NO_ERROR ||
+			(key_name = cyberiada_init_table_find_name(buffer)) == NULL) {
+			continue;
+		}
+		if (strcmp(key_name, GRAPHML_CYB_KEY_COMMENT_NAME) == 0) {
+			cyberiada_get_element_text(buffer, buffer_len, data);
+			comment = 1;
+			formal = strcmp(buffer, GRAPHML_CYB_COMMENT_FORMAL) == 0;
+		} else if (strcmp(key_name, GRAPHML_CYB_KEY_NAME_NAME) == 0) {
+			cyberiada_get_element_text(buffer, buffer_len, data);
+			cyberiada_string_trim(buffer);
+			meta = strcmp(buffer, CYBERIADA_META_NODE_TITLE) == 0;
+		}
+	}
+	if (!comment) {
+		return 0;
+	} else if (formal) {
+		return meta ? CYBERIADA_DECODE_SKIP_META : CYBERIADA_DECODE_SKIP_FORMAL_COMMENTS;
+	} else {
+		return CYBERIADA_DECODE_SKIP_COMMENTS;
+	}
+}
+
+/* the skip category of the YED node by the node id & the node shape */
+static int cyberiada_decode_skip_yed_node_category(xmlNode* xml_node, const char* id)
+{
+	xmlNode *data, *shape;
+
+	if (strcmp(id, YED_CORE_META) == 0) {
+		return CYBERIADA_DECODE_SKIP_META;
+	}
+	for (data = xml_node->children; data; data = data->next) {
+		if (data->type != XML_ELEMENT_NODE ||
+			strcmp((const char*)data->name, GRAPHML_DATA_ELEMENT) != 0) {
+			continue;
+		}
+		for (shape = data->children; shape; shape = shape->next) {
+			if (shape->type == XML_ELEMENT_NODE &&
+				strcmp((const char*)shape->name, GRAPHML_YED_COMMENTNODE) == 0) {
+				return CYBERIADA_DECODE_SKIP_COMMENTS;
+			}
+		}
+	}
+	return 0;
+}
+
+/* check the new node category; sets skipped to 1 if the node is skipped */
+static int cyberiada_decode_skip_node(CyberiadaDecodeSkip* skip, const char* id, int category, int* skipped)
+{
+	*skipped = 0;
+	if (category & skip->mask) {
+		if (cyberiada_decode_skip_register(&(skip->nodes), id) != CYBERIADA_NO_ERROR) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		skip->skipped_nodes++;
+		skip->subtree = 1;
+		*skipped = 1;
+		return CYBERIADA_NO_ERROR;
+	}
+	if (category && (skip->mask & CYBERIADA_DECODE_SKIP_COMMENT_EDGES)) {
+		return cyberiada_decode_skip_register(&(skip->comments), id);
 	}
-	*rect = r;
 	return CYBERIADA_NO_ERROR;
 }
 
+/* check the new edge; returns 1 if the edge is skipped */
+static int cyberiada_decode_skip_edge(CyberiadaDecodeSkip* skip, const char* source_id, const char* target_id)
+{
+	if (cyberiada_hash_get(&(skip->nodes), source_id) ||
+		cyberiada_hash_get(&(skip->nodes), target_id) ||
+		((skip->mask & CYBERIADA_DECODE_SKIP_COMMENT_EDGES) &&
+		 cyberiada_hash_get(&(skip->comments), source_id))) {
+		skip->skipped_edges++;
+		skip->subtree = 1;
+		return 1;
+	}
+	return 0;
+}
+
+/* drop the edges declared before the skipped nodes & the comment edges not recognized by the source */
+static void cyberiada_decode_skip_edges(CyberiadaDecodeSkip* skip, CyberiadaDocument* doc)
+{
+	CyberiadaSM* sm;
+	CyberiadaEdge *edge, **prev;
+
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		prev = &(sm->edges);
+		while ((edge = *prev) != NULL) {
+			if (cyberiada_hash_get(&(skip->nodes), edge->source_id) ||
+				cyberiada_hash_get(&(skip->nodes), edge->target_id) ||
+				((skip->mask & CYBERIADA_DECODE_SKIP_COMMENT_EDGES) && edge->type == cybEdgeComment)) {
+				*prev = edge->next;
+				edge->next = NULL;
+				cyberiada_destroy_edge(edge);
+				skip->skipped_edges++;
+			} else {
+				prev = &(edge->next);
+			}
+		}
+	}
+}
+
+static void cyberiada_decode_skip_free(CyberiadaDecodeSkip* skip)
+{
+	size_t i;
+	for (i = 0; i < skip->nodes.size; i++) {
+		if (skip->nodes.keys[i]) free((void*)skip->nodes.keys[i]);
+	}
+	for (i = 0; i < skip->comments.size; i++) {
+		if (skip->comments.keys[i]) free((void*)skip->comments.keys[i]);
+	}
+	cyberiada_hash_free(&(skip->nodes));
+	cyberiada_hash_free(&(skip->comments));
+}
+
 /* -----------------------------------------------------------------------------
  * Common handlers for the GraphML processor 
  * ----------------------------------------------------------------------------- */
@@ -489,14 +783,13 @@ static int cyberiada_xml_read_rect(xmlNode* xml_node,
 static GraphProcessorState handle_new_graph(xmlNode* xml_node,
 											CyberiadaDocument* doc,
 											NodeStack** stack,
-											CyberiadaRegexps* regexps)
+											CyberiadaDecodeContext* ctx)
 {
-	(void)regexps; /* unused parameter */
-	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
 	CyberiadaSM* sm = doc->state_machines;
 	CyberiadaNode* parent = node_stack_current_node(stack);
+	CyberiadaNode* node;
 	/* process the top graph element only */
 	if(cyberiada_get_attr_value(buffer, buffer_len,
 								xml_node,
@@ -509,10 +802,19 @@ static GraphProcessorState handle_new_graph(xmlNode* xml_node,
 		if (sm->nodes != NULL) {
 			sm->next = cyberiada_new_sm();
 			sm = sm->next;
+			cyberiada_destroy_sm_builder(ctx->builder);
+			ctx->builder = NULL;
+			if (cyberiada_new_sm_builder(sm, &(ctx->builder)) != CYBERIADA_NO_ERROR) {
+				return gpsInvalid;
+			}
+		}
+		node = cyberiada_new_node(buffer);
+		node->type = cybNodeSM;
+		if (cyberiada_sm_builder_add_node(ctx->builder, NULL, node) != CYBERIADA_NO_ERROR) {
+			cyberiada_destroy_node(node);
+			return gpsInvalid;
 		}
-		sm->nodes = cyberiada_new_node(buffer);
-		sm->nodes->type = cybNodeSM;
-		node_stack_set_top_node(stack, sm->nodes);
+		node_stack_set_top_node(stack, node);
 		return gpsGraph;
 	} else {
 		/* DEBUG("graph parent %s type %d\n", parent->id, parent->type); */
@@ -520,15 +822,13 @@ static GraphProcessorState handle_new_graph(xmlNode* xml_node,
 			ERROR("Children graph for region is allowed only for states\n");
 			return gpsInvalid;
 		}
-		CyberiadaNode* region_node = cyberiada_new_node(buffer);
-		region_node->type = cybNodeRegion;
-		region_node->parent = parent;
-		if (parent->children) {
-			cyberiada_graph_add_sibling_node(parent->children, region_node);		
-		} else {
-			parent->children = region_node;
+		node = cyberiada_new_node(buffer);
+		node->type = cybNodeRegion;
+		if (cyberiada_sm_builder_add_node(ctx->builder, parent, node) != CYBERIADA_NO_ERROR) {
+			cyberiada_destroy_node(node);
+			return gpsInvalid;
 		}
-		node_stack_set_top_node(stack, region_node);
+		node_stack_set_top_node(stack, node);
 		parent->type = cybNodeCompositeState;
 		/* DEBUG("region node added\n"); */
 		return gpsRegion;
@@ -538,15 +838,15 @@ static GraphProcessorState handle_new_graph(xmlNode* xml_node,
 static GraphProcessorState handle_new_node(xmlNode* xml_node,	
 										   CyberiadaDocument* doc,
 										   NodeStack** stack,
-										   CyberiadaRegexps* regexps)
+										   CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */
-	(void)regexps; /* unused parameter */
 
 	CyberiadaNode* node;	
 	CyberiadaNode* parent;	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
+	int skipped = 0;
 	if (cyberiada_get_attr_value(buffer, buffer_len,
 								 xml_node,
 								 GRAPHML_ID_ATTRIBUTE) != CYBERIADA_NO_ERROR) {
@@ -558,24 +858,32 @@ static GraphProcessorState handle_new_node(xmlNode* xml_node,
 		ERROR("Cannot process new node: current node is invalid\n");
 		return gpsInvalid;
 	}
+	if (ctx->skip) {
+		if (cyberiada_decode_skip_node(ctx->skip, buffer, cyberiada_decode_skip_cyb_node_category(xml_node),
+									   &skipped) != CYBERIADA_NO_ERROR) {
+			ERROR("cannot register skipped node %s\n", buffer);
+			return gpsInvalid;
+		}
+		if (skipped) {
+			return gpsNode;
+		}
+	}
 	node = cyberiada_new_node(buffer);
-	node->parent = parent;
-	node_stack_set_top_node(stack, node);
-	if (parent->children) {
-		cyberiada_graph_add_sibling_node(parent->children, node);
-	} else {
-		parent->children = node;
+	if (cyberiada_sm_builder_add_node(ctx->builder, parent, node) != CYBERIADA_NO_ERROR) {
+		cyberiada_destroy_node(node);
+		return gpsInvalid;
 	}
+	node_stack_set_top_node(stack, node);
 	return gpsNode;
 }
 
 static GraphProcessorState handle_new_edge(xmlNode* xml_node,
 										   CyberiadaDocument* doc,
 										   NodeStack** stack,
-										   CyberiadaRegexps* regexps)
+										   CyberiadaDecodeContext* ctx)
 {
 	(void)stack; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)doc; /* unused parameter */	
 	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
@@ -583,8 +891,7 @@ static GraphProcessorState handle_new_edge(xmlNode* xml_node,
 	size_t source_buffer_len = sizeof(source_buffer);
 	char target_buffer[MAX_STR_LEN];
 	size_t target_buffer_len = sizeof(target_buffer);
-	CyberiadaSM* sm = doc->state_machines;
-	while (sm->next) sm = sm->next;
+	CyberiadaEdge* edge;
 	if(cyberiada_get_attr_value(source_buffer, source_buffer_len,
 								xml_node,
 								GRAPHML_SOURCE_ATTRIBUTE) != CYBERIADA_NO_ERROR) {
@@ -600,20 +907,25 @@ static GraphProcessorState handle_new_edge(xmlNode* xml_node,
 								GRAPHML_ID_ATTRIBUTE) != CYBERIADA_NO_ERROR) {
 		buffer[0] = 0;
 	}
-	if (regexps->arena_legacy) {
+	if (ctx->skip && cyberiada_decode_skip_edge(ctx->skip, source_buffer, target_buffer)) {
+		return gpsEdge;
+	}
+	if (ctx->regexps->arena_legacy) {
 		/* check if the edge with the same name found */
 		unsigned int n = 2;
-		if (cyberiada_graph_find_edge_by_id(sm->edges, buffer) != NULL) {
+		if (cyberiada_sm_builder_find_edge(ctx->builder, buffer) != NULL) {
 			char buffer2[MAX_STR_LEN - 64];
 			strncpy(buffer2, buffer, MAX_STR_LEN - 64);
 			do {
 				snprintf(buffer, MAX_STR_LEN - 20, "%s-%u", buffer2, n);
 				n++;
-			} while (cyberiada_graph_find_edge_by_id(sm->edges, buffer) != NULL);
+			} while (cyberiada_sm_builder_find_edge(ctx->builder, buffer) != NULL);
 		}
 	}
 	/*DEBUG("add edge '%s' '%s' -> '%s'\n", buffer, source_buffer, target_buffer);*/
-	if (cyberiada_graph_add_edge(sm, buffer, source_buffer, target_buffer, 0) != CYBERIADA_NO_ERROR) {
+	edge = cyberiada_new_edge(buffer, source_buffer, target_buffer, 0);
+	if (cyberiada_sm_builder_add_edge(ctx->builder, edge) != CYBERIADA_NO_ERROR) {
+		cyberiada_destroy_edge(edge);
 		return gpsInvalid;
 	}
 	return gpsEdge;
@@ -622,17 +934,15 @@ static GraphProcessorState handle_new_edge(xmlNode* xml_node,
 static GraphProcessorState handle_edge_point(xmlNode* xml_node,
 											 CyberiadaDocument* doc,
 											 NodeStack** stack,
-											 CyberiadaRegexps* regexps)
+											 CyberiadaDecodeContext* ctx)
 {
 	(void)stack; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)doc; /* unused parameter */	
 	
 	CyberiadaEdge *current;
 	CyberiadaPoint* p;
 	CyberiadaPolyline *pl, *last_pl;
-	CyberiadaSM* sm = doc->state_machines;
-	while (sm->next) sm = sm->next;
-	current = cyberiada_graph_find_last_edge(sm);
+	current = cyberiada_sm_builder_last_edge(ctx->builder);
 	if (current == NULL) {
 		ERROR("no current edge\n");
 		return gpsInvalid;
@@ -661,15 +971,15 @@ static GraphProcessorState handle_edge_point(xmlNode* xml_node,
 static GraphProcessorState handle_new_yed_node(xmlNode* xml_node,	
 											   CyberiadaDocument* doc,
 											   NodeStack** stack,
-											   CyberiadaRegexps* regexps)
+											   CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */
-	(void)regexps; /* unused parameter */
 
 	CyberiadaNode* node;	
 	CyberiadaNode* parent;	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
+	int skipped = 0;
 	if (cyberiada_get_attr_value(buffer, buffer_len,
 								 xml_node,
 								 GRAPHML_ID_ATTRIBUTE) != CYBERIADA_NO_ERROR) {
@@ -681,20 +991,32 @@ static GraphProcessorState handle_new_yed_node(xmlNode* xml_node,
 		ERROR("Cannot process new node: current node is invalid\n");
 		return gpsInvalid;
 	}
+	if (ctx->skip) {
+		if (cyberiada_decode_skip_node(ctx->skip, buffer, cyberiada_decode_skip_yed_node_category(xml_node, buffer),
+									   &skipped) != CYBERIADA_NO_ERROR) {
+			ERROR("cannot register skipped node %s\n", buffer);
+			return gpsInvalid;
+		}
+		if (skipped) {
+			if (strcmp(buffer, YED_CORE_META) == 0) {
+				/* the meta node marks the Berloga 1.6 actions format */
+				ctx->regexps->berloga_legacy = 16;
+			}
+			return gpsGraph;
+		}
+	}
 	node = cyberiada_new_node(buffer);
-	node->parent = parent;
-	node_stack_set_top_node(stack, node);
-	if (parent->children) {
-		cyberiada_graph_add_sibling_node(parent->children, node);
-	} else {
-		parent->children = node;
+	if (cyberiada_sm_builder_add_node(ctx->builder, parent, node) != CYBERIADA_NO_ERROR) {
+		cyberiada_destroy_node(node);
+		return gpsInvalid;
 	}
+	node_stack_set_top_node(stack, node);
 	if (strcmp(buffer, YED_CORE_META) == 0) {
 		/* comment node */
 		node->type = cybNodeFormalComment;
 		cyberiada_copy_string(&(node->title),
 							  &(node->title_len), CYBERIADA_META_NODE_TITLE);
-		regexps->berloga_legacy = 16;
+		ctx->regexps->berloga_legacy = 16;
 		return gpsMeta;
 	} else {
 		return gpsNode;
@@ -704,7 +1026,7 @@ static GraphProcessorState handle_new_yed_node(xmlNode* xml_node,
 static GraphProcessorState handle_meta_data(xmlNode* xml_node,
 											CyberiadaDocument* doc,
 											NodeStack** stack,
-											CyberiadaRegexps* regexps)
+											CyberiadaDecodeContext* ctx)
 {
 	char buffer[MAX_STR_LEN];
 	char metabuffer[MAX_STR_LEN + 32];
@@ -746,7 +1068,7 @@ static GraphProcessorState handle_meta_data(xmlNode* xml_node,
 	metabuffer[sizeof(metabuffer) - 1] = 0;
 	cyberiada_copy_string(&(current->comment_data->body),
 						  &(current->comment_data->body_len), metabuffer);
-	if (cyberiada_decode_meta(doc, metabuffer, regexps) != CYBERIADA_NO_ERROR) {
+	if (cyberiada_decode_meta(doc, metabuffer, ctx->regexps) != CYBERIADA_NO_ERROR) {
 		ERROR("Error while decoging metainfo comment\n");
 		return gpsInvalid;
 	}
@@ -756,11 +1078,11 @@ static GraphProcessorState handle_meta_data(xmlNode* xml_node,
 static GraphProcessorState handle_group_node(xmlNode* xml_node,
 											 CyberiadaDocument* doc,
 											 NodeStack** stack,
-											 CyberiadaRegexps* regexps)
+											 CyberiadaDecodeContext* ctx)
 {
 	(void)xml_node; /* unused parameter */	
 	(void)doc; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)ctx; /* unused parameter */	
 	
 	CyberiadaNode* current = node_stack_current_node(stack);
 	if (!current) {
@@ -792,11 +1114,11 @@ static GraphProcessorState handle_group_node(xmlNode* xml_node,
 static GraphProcessorState handle_comment_node(xmlNode* xml_node,
 											   CyberiadaDocument* doc,
 											   NodeStack** stack,
-											   CyberiadaRegexps* regexps)
+											   CyberiadaDecodeContext* ctx)
 {
 	(void)xml_node; /* unused parameter */	
 	(void)doc; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)ctx; /* unused parameter */	
 	
 	CyberiadaNode* current = node_stack_current_node(stack);
 	if (current == NULL) {
@@ -812,10 +1134,10 @@ static GraphProcessorState handle_comment_node(xmlNode* xml_node,
 static GraphProcessorState handle_generic_node(xmlNode* xml_node,
 											   CyberiadaDocument* doc,
 											   NodeStack** stack,
-											   CyberiadaRegexps* regexps)
+											   CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)ctx; /* unused parameter */	
 	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
@@ -844,10 +1166,9 @@ static GraphProcessorState handle_generic_node(xmlNode* xml_node,
 static GraphProcessorState handle_node_geometry(xmlNode* xml_node,
 												CyberiadaDocument* doc,
 												NodeStack** stack,
-												CyberiadaRegexps* regexps)
+												CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
 	
 	CyberiadaNodeType type;
 	CyberiadaNode* current = node_stack_current_node(stack);
@@ -858,10 +1179,23 @@ static GraphProcessorState handle_node_geometry(xmlNode* xml_node,
 	}
 	/* DEBUG("found geometry node\n"); */
 	type = current->type;
-	if (cyberiada_xml_read_rect(xml_node,
-								&rect) != CYBERIADA_NO_ERROR) {
+	if (cyberiada_decode_skip(ctx, CYBERIADA_DECODE_SKIP_GEOMETRY)) {
+		rect = NULL;
+	} else if (cyberiada_xml_read_rect(xml_node,
+									   &rect) != CYBERIADA_NO_ERROR) {
 		return gpsInvalid;
 	}
+	if (!rect || (ctx->clip &&
+				  cyberiada_decode_clip_node(ctx->clip, current, rect->x, rect->y, rect->width, rect->height))) {
+		if (rect) htree_destroy_rect(rect);
+		if (type == cybNodeInitial || type == cybNodeFinal) {
+			return gpsNodeStart;
+		} else if (type == cybNodeComment) {
+			return gpsNodeAction;
+		} else {
+			return gpsNodeTitle;
+		}
+	}
 	if (type == cybNodeInitial || type == cybNodeFinal) {
 		current->geometry_point = htree_new_point();
 		current->geometry_point->x = rect->x + rect->width / 2.0;
@@ -887,11 +1221,11 @@ static GraphProcessorState handle_node_geometry(xmlNode* xml_node,
 static GraphProcessorState handle_property(xmlNode* xml_node,
 										   CyberiadaDocument* doc,
 										   NodeStack** stack,
-										   CyberiadaRegexps* regexps)
+										   CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */	
 	(void)stack; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)ctx; /* unused parameter */	
 	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
@@ -918,10 +1252,10 @@ static GraphProcessorState handle_property(xmlNode* xml_node,
 static GraphProcessorState handle_node_title(xmlNode* xml_node,
 											 CyberiadaDocument* doc,
 											 NodeStack** stack,
-											 CyberiadaRegexps* regexps)
+											 CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */
-	(void)regexps; /* unused parameter */		
+	(void)ctx; /* unused parameter */		
 	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
@@ -945,7 +1279,7 @@ static GraphProcessorState handle_node_title(xmlNode* xml_node,
 static GraphProcessorState handle_node_action(xmlNode* xml_node,
 											  CyberiadaDocument* doc,
 											  NodeStack** stack,
-											  CyberiadaRegexps* regexps)
+											  CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */	
 	
@@ -957,7 +1291,7 @@ static GraphProcessorState handle_node_action(xmlNode* xml_node,
 		return gpsInvalid;
 	}
 	cyberiada_get_element_text(buffer, buffer_len, xml_node);
-	if (current->actions != NULL) {
+	if (current->actions != NULL || current->raw_actions != NULL) {
 		ERROR("Trying to set node %s actions twice\n", current->id);
 		return gpsInvalid;
 	}
@@ -975,7 +1309,14 @@ static GraphProcessorState handle_node_action(xmlNode* xml_node,
 							  &(current->comment_data->body_len), buffer);
 	} else {
 		/* DEBUG("Set node %s action %s\n", current->id, buffer); */
-		if (cyberiada_decode_state_actions_yed(buffer, &(current->actions), regexps) != CYBERIADA_NO_ERROR) {
+		if (cyberiada_decode_skip(ctx, CYBERIADA_DECODE_SKIP_ACTIONS)) {
+			return gpsGraph;
+		} else if (ctx->flags & CYBERIADA_FLAG_LAZY_ACTIONS) {
+			if (cyberiada_new_raw_action(buffer, 1, ctx->regexps, ctx->flags, &(ctx->raw_regexps), &(current->raw_actions)) != CYBERIADA_NO_ERROR) {
+				ERROR("cannot keep yed node raw action\n");
+				return gpsInvalid;
+			}
+		} else if (cyberiada_decode_state_actions_yed(buffer, &(current->actions), ctx->regexps) != CYBERIADA_NO_ERROR) {
 			ERROR("cannot decode yed node action\n");
 			return gpsInvalid;
 		}
@@ -986,19 +1327,21 @@ static GraphProcessorState handle_node_action(xmlNode* xml_node,
 static GraphProcessorState handle_edge_geometry(xmlNode* xml_node,
 												CyberiadaDocument* doc,
 												NodeStack** stack,
-												CyberiadaRegexps* regexps)
+												CyberiadaDecodeContext* ctx)
 {
 	(void)stack; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)doc; /* unused parameter */	
 	
 	CyberiadaEdge *current;
-	CyberiadaSM* sm = doc->state_machines;
-	while (sm->next) sm = sm->next;
-	current = cyberiada_graph_find_last_edge(sm);
+	current = cyberiada_sm_builder_last_edge(ctx->builder);
 	if (current == NULL) {
 		ERROR("no current edge\n");
 		return gpsInvalid;
 	}
+	if (cyberiada_decode_skip(ctx, CYBERIADA_DECODE_SKIP_GEOMETRY)) {
+		cyberiada_decode_skip_subtree(ctx);
+		return gpsEdgeGeometry;
+	}
 	current->geometry_source_point = htree_new_point();
 	current->geometry_target_point = htree_new_point();
 	if (cyberiada_xml_read_coord(xml_node,
@@ -1025,22 +1368,22 @@ static GraphProcessorState handle_edge_geometry(xmlNode* xml_node,
 static GraphProcessorState handle_edge_label(xmlNode* xml_node,
 											 CyberiadaDocument* doc,
 											 NodeStack** stack,
-											 CyberiadaRegexps* regexps)
+											 CyberiadaDecodeContext* ctx)
 {
+	(void)doc; /* unused parameter */
 	(void)stack; /* unused parameter */	
 	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
 	double x = 0.0, y = 0.0;
+	int label = 0;
 	CyberiadaEdge *current;
-	CyberiadaSM* sm = doc->state_machines;
-	while (sm->next) sm = sm->next;
-	current = cyberiada_graph_find_last_edge(sm);
+	current = cyberiada_sm_builder_last_edge(ctx->builder);
 	if (current == NULL) {
 		ERROR("no current edge\n");
 		return gpsInvalid;
 	}
-	if (current->action != NULL) {
+	if (current->action != NULL || current->raw_action != NULL) {
 		ERROR("Trying to set edge %s:%s label twice\n",
 			  current->source_id, current->target_id);
 		return gpsInvalid;
@@ -1048,27 +1391,37 @@ static GraphProcessorState handle_edge_label(xmlNode* xml_node,
 	cyberiada_get_element_text(buffer, buffer_len, xml_node);
 	/* DEBUG("add edge %s:%s action %s\n",
 	   current->source_id, current->target_id, buffer); */
-	if (cyberiada_decode_edge_action(buffer, &(current->action), regexps) != CYBERIADA_NO_ERROR) {
+	if (cyberiada_decode_skip(ctx, CYBERIADA_DECODE_SKIP_ACTIONS)) {
+		/* the label point is kept without the action */
+		label = !cyberiada_string_is_empty(buffer);
+	} else if (ctx->flags & CYBERIADA_FLAG_LAZY_ACTIONS) {
+		if (cyberiada_new_raw_action(buffer, 1, ctx->regexps, ctx->flags, &(ctx->raw_regexps), &(current->raw_action)) != CYBERIADA_NO_ERROR) {
+			ERROR("cannot keep edge raw action\n");
+			return gpsInvalid;
+		}
+	} else if (cyberiada_decode_edge_action(buffer, &(current->action), ctx->regexps) != CYBERIADA_NO_ERROR) {
 		ERROR("cannot decode edge action\n");
 		return gpsInvalid;
 	}
-	if (current->action &&
+	if ((label || current->action || current->raw_action) &&
+		!cyberiada_decode_skip(ctx, CYBERIADA_DECODE_SKIP_GEOMETRY) &&
 		cyberiada_has_attr(xml_node, GRAPHML_GEOM_X_ATTRIBUTE) == CYBERIADA_NO_ERROR &&
 		cyberiada_has_attr(xml_node, GRAPHML_GEOM_Y_ATTRIBUTE) == CYBERIADA_NO_ERROR) {
 		
-		if (cyberiada_xml_read_coord(xml_node, GRAPHML_GEOM_X_ATTRIBUTE, &x) == CYBERIADA_NO_ERROR &&
-			cyberiada_xml_read_coord(xml_node, GRAPHML_GEOM_Y_ATTRIBUTE, &y) == CYBERIADA_NO_ERROR) {
+		if (cyberiada_xml_read_coord(xml_node, GRAPHML_GEOM_X_ATTRIBUTE, &x) != CYBERIADA_NO_ERROR ||
+			cyberiada_xml_read_coord(xml_node, GRAPHML_GEOM_Y_ATTRIBUTE, &y) != CYBERIADA_NO_ERROR) {
+			return gpsInvalid;
+		}
 			
-			if (current->geometry_label_point) {
-				ERROR("Trying to set edge %s:%s label coordinates twice\n",
-					  current->source_id, current->target_id);
-				return gpsInvalid;
-			}
-		
-			current->geometry_label_point = htree_new_point();
-			current->geometry_label_point->x = x;
-			current->geometry_label_point->y = y;
+		if (current->geometry_label_point) {
+			ERROR("Trying to set edge %s:%s label coordinates twice\n",
+				  current->source_id, current->target_id);
+			return gpsInvalid;
 		}
+		
+		current->geometry_label_point = htree_new_point();
+		current->geometry_label_point->x = x;
+		current->geometry_label_point->y = y;
 	}
 	return gpsGraph;
 }
@@ -1137,10 +1490,10 @@ static void cyberiada_init_table_free_extensitions(void)
 static GraphProcessorState handle_new_init_data(xmlNode* xml_node,
 												CyberiadaDocument* doc,
 												NodeStack** stack,
-												CyberiadaRegexps* regexps)
+												CyberiadaDecodeContext* ctx)
 {
 	(void)stack; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)ctx; /* unused parameter */	
 	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
@@ -1171,11 +1524,11 @@ static GraphProcessorState handle_new_init_data(xmlNode* xml_node,
 static GraphProcessorState handle_new_init_key(xmlNode* xml_node,
 											   CyberiadaDocument* doc,
 											   NodeStack** stack,
-											   CyberiadaRegexps* regexps)
+											   CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */	
 	(void)stack; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)ctx; /* unused parameter */	
 	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
@@ -1221,7 +1574,7 @@ static GraphProcessorState handle_new_init_key(xmlNode* xml_node,
 static GraphProcessorState handle_node_data(xmlNode* xml_node,
 											CyberiadaDocument* doc,
 											NodeStack** stack,
-											CyberiadaRegexps* regexps)
+											CyberiadaDecodeContext* ctx)
 {
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
@@ -1275,7 +1628,7 @@ static GraphProcessorState handle_node_data(xmlNode* xml_node,
 		}
 		return gpsRegion;
 	} else if (strcmp(key_name, GRAPHML_CYB_KEY_DATA_NAME) == 0) {
-		if (current->actions != NULL) {
+		if (current->actions != NULL || current->raw_actions != NULL) {
 			ERROR("Trying to set node %s action twice\n", current->id);
 			return gpsInvalid;
 		}
@@ -1292,20 +1645,27 @@ static GraphProcessorState handle_node_data(xmlNode* xml_node,
 								  &(current->comment_data->body_len), buffer);
 			if (current->type == cybNodeFormalComment &&
 				current->title && strcmp(current->title, CYBERIADA_META_NODE_TITLE) == 0) {
-				if (cyberiada_decode_meta(doc, buffer, regexps) != CYBERIADA_NO_ERROR) {
+				if (cyberiada_decode_meta(doc, buffer, ctx->regexps) != CYBERIADA_NO_ERROR) {
 					ERROR("Error while decoging metainfo comment\n");
 					return gpsInvalid;
 				}
 			}
 		} else {
 			/* DEBUG("Set node %s action %s\n", current->id, buffer); */
-			if (cyberiada_decode_state_actions(buffer, &(current->actions), regexps) != CYBERIADA_NO_ERROR) {
+			if (cyberiada_decode_skip(ctx, CYBERIADA_DECODE_SKIP_ACTIONS)) {
+				return gpsNode;
+			} else if (ctx->flags & CYBERIADA_FLAG_LAZY_ACTIONS) {
+				if (cyberiada_new_raw_action(buffer, 0, ctx->regexps, ctx->flags, &(ctx->raw_regexps), &(current->raw_actions)) != CYBERIADA_NO_ERROR) {
+					ERROR("cannot keep cyberiada node raw action\n");
+					return gpsInvalid;
+				}
+			} else if (cyberiada_decode_state_actions(buffer, &(current->actions), ctx->regexps) != CYBERIADA_NO_ERROR) {
 				ERROR("Cannot decode cyberiada node action\n");
 				return gpsInvalid;
 			}
 		}
 	} else if (strcmp(key_name, GRAPHML_CYB_KEY_VERTEX_NAME) == 0) {
-		if (current->actions != NULL) {
+		if (current->actions != NULL || current->raw_actions != NULL) {
 			ERROR("Trying to set the vertex %s action\n", current->id);
 			return gpsInvalid;
 		}
@@ -1373,10 +1733,14 @@ static GraphProcessorState handle_node_data(xmlNode* xml_node,
 		}
 		current->link = cyberiada_new_link(buffer);
 	} else if (strcmp(key_name, GRAPHML_CYB_KEY_GEOMETRY_NAME) == 0) {
+		if (cyberiada_decode_skip(ctx, CYBERIADA_DECODE_SKIP_GEOMETRY)) {
+			cyberiada_decode_skip_subtree(ctx);
+			return gpsNode;
+		}
 		return gpsNodeGeometry;
 	} else if (strcmp(key_name, GRAPHML_CYB_KEY_ARENA_REFERENCE_ID_NAME) == 0) {
 		/* ugly Arena-specific Cyberiada GraphML found */
-		regexps->arena_legacy = 1;
+		ctx->regexps->arena_legacy = 1;
 	} else {
 		ERROR("Bad data key attribute '%s'\n", key_name);
 		return gpsInvalid;
@@ -1387,11 +1751,11 @@ static GraphProcessorState handle_node_data(xmlNode* xml_node,
 static GraphProcessorState handle_node_point(xmlNode* xml_node,
 											 CyberiadaDocument* doc,
 											 NodeStack** stack,
-											 CyberiadaRegexps* regexps)
+											 CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
 	
+	CyberiadaPoint p;
 	CyberiadaNode* current = node_stack_current_node(stack);
 	if (current == NULL) {
 		ERROR("no current node\n");
@@ -1401,6 +1765,14 @@ static GraphProcessorState handle_node_point(xmlNode* xml_node,
 		ERROR("Trying to set node %s geometry point twice\n", current->id);
 		return gpsInvalid;
 	}
+	if (ctx->clip) {
+		if (cyberiada_xml_read_point_coords(xml_node, &p) != CYBERIADA_NO_ERROR) {
+			return gpsInvalid;
+		}
+		if (cyberiada_decode_clip_node(ctx->clip, current, p.x, p.y, 0.0, 0.0)) {
+			return gpsNode;
+		}
+	}
 	if (cyberiada_xml_read_point(xml_node,
 								 &(current->geometry_point)) != CYBERIADA_NO_ERROR) {
 		return gpsInvalid;
@@ -1411,11 +1783,11 @@ static GraphProcessorState handle_node_point(xmlNode* xml_node,
 static GraphProcessorState handle_node_rect(xmlNode* xml_node,
 											CyberiadaDocument* doc,
 											NodeStack** stack,
-											CyberiadaRegexps* regexps)
+											CyberiadaDecodeContext* ctx)
 {
 	(void)doc; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
 	
+	CyberiadaRect r;
 	CyberiadaNode* current = node_stack_current_node(stack);
 	if (current == NULL) {
 		ERROR("no current node\n");
@@ -1425,8 +1797,16 @@ static GraphProcessorState handle_node_rect(xmlNode* xml_node,
 		ERROR("Trying to set node %s geometry rect twice\n", current->id);
 		return gpsInvalid;
 	}
-	if (cyberiada_xml_read_rect(xml_node,
-							   &(current->geometry_rect)) != CYBERIADA_NO_ERROR) {
+	if (ctx->clip) {
+		if (cyberiada_xml_read_rect_coords(xml_node, &r) != CYBERIADA_NO_ERROR) {
+			return gpsInvalid;
+		}
+		if (!cyberiada_decode_clip_node(ctx->clip, current, r.x, r.y, r.width, r.height)) {
+			current->geometry_rect = htree_new_rect();
+			*(current->geometry_rect) = r;
+		}
+	} else if (cyberiada_xml_read_rect(xml_node,
+									   &(current->geometry_rect)) != CYBERIADA_NO_ERROR) {
 		return gpsInvalid;
 	}
 	/* if (current->geometry_rect->width == 0.0 && current->geometry_rect->height == 0.0) { */
@@ -1446,17 +1826,16 @@ static GraphProcessorState handle_node_rect(xmlNode* xml_node,
 static GraphProcessorState handle_edge_data(xmlNode* xml_node,
 											CyberiadaDocument* doc,
 											NodeStack** stack,
-											CyberiadaRegexps* regexps)
+											CyberiadaDecodeContext* ctx)
 {
+	(void)doc; /* unused parameter */
 	(void)stack; /* unused parameter */	
 	
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
 	CyberiadaEdge *current;
 	const char* key_name;
-	CyberiadaSM* sm = doc->state_machines;
-	while (sm->next) sm = sm->next;
-	current = cyberiada_graph_find_last_edge(sm);
+	current = cyberiada_sm_builder_last_edge(ctx->builder);
 	if (current == NULL) {
 		ERROR("no current edge\n");
 		return gpsInvalid;
@@ -1473,15 +1852,29 @@ static GraphProcessorState handle_edge_data(xmlNode* xml_node,
 	}
 	cyberiada_get_element_text(buffer, buffer_len, xml_node);
 	if (strcmp(key_name, GRAPHML_CYB_KEY_DATA_NAME) == 0) {
-		if (current->action != NULL) {
+		if (current->action != NULL || current->raw_action != NULL) {
 			ERROR("Trying to set edge %s action twice\n", current->id);
 			return gpsInvalid;
 		}
 		/* DEBUG("Set edge %s action %s\n", current->id, buffer); */
-		if (cyberiada_decode_edge_action(buffer, &(current->action), regexps) != CYBERIADA_NO_ERROR) {
+		if (cyberiada_decode_skip(ctx, CYBERIADA_DECODE_SKIP_ACTIONS)) {
+			return gpsEdge;
+		} else if (ctx->flags & CYBERIADA_FLAG_LAZY_ACTIONS) {
+			if (cyberiada_new_raw_action(buffer, 0, ctx->regexps, ctx->flags, &(ctx->raw_regexps), &(current->raw_action)) != CYBERIADA_NO_ERROR) {
+				ERROR("cannot keep edge raw action\n");
+				return gpsInvalid;
+			}
+		} else if (cyberiada_decode_edge_action(buffer, &(current->action), ctx->regexps) != CYBERIADA_NO_ERROR) {
 			ERROR("cannot decode edge action\n");
 			return gpsInvalid;
 		}
+	} else if (cyberiada_decode_skip(ctx, CYBERIADA_DECODE_SKIP_GEOMETRY) &&
+			   (strcmp(key_name, GRAPHML_CYB_KEY_GEOMETRY_NAME) == 0 ||
+				strcmp(key_name, GRAPHML_CYB_KEY_SOURCE_POINT_NAME) == 0 ||
+				strcmp(key_name, GRAPHML_CYB_KEY_TARGET_POINT_NAME) == 0 ||
+				strcmp(key_name, GRAPHML_CYB_KEY_LABEL_GEOMETRY_NAME) == 0)) {
+		cyberiada_decode_skip_subtree(ctx);
+		return gpsEdge;
 	} else if (strcmp(key_name, GRAPHML_CYB_KEY_GEOMETRY_NAME) == 0) {
 		return gpsEdgeGeometry;
 	} else if (strcmp(key_name, GRAPHML_CYB_KEY_SOURCE_POINT_NAME) == 0) {
@@ -1540,15 +1933,13 @@ static GraphProcessorState handle_edge_data(xmlNode* xml_node,
 static GraphProcessorState handle_edge_source_point(xmlNode* xml_node,
 													CyberiadaDocument* doc,
 													NodeStack** stack,
-													CyberiadaRegexps* regexps)
+													CyberiadaDecodeContext* ctx)
 {
 	(void)stack; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)doc; /* unused parameter */	
 	
 	CyberiadaEdge *current;
-	CyberiadaSM* sm = doc->state_machines;
-	while (sm->next) sm = sm->next;
-	current = cyberiada_graph_find_last_edge(sm);
+	current = cyberiada_sm_builder_last_edge(ctx->builder);
 	if (current == NULL) {
 		ERROR("no current edge\n");
 		return gpsInvalid;
@@ -1567,15 +1958,13 @@ static GraphProcessorState handle_edge_source_point(xmlNode* xml_node,
 static GraphProcessorState handle_edge_target_point(xmlNode* xml_node,
 													CyberiadaDocument* doc,
 													NodeStack** stack,
-													CyberiadaRegexps* regexps)
+													CyberiadaDecodeContext* ctx)
 {
 	(void)stack; /* unused parameter */
-	(void)regexps; /* unused parameter */
+	(void)doc; /* unused parameter */
 	
 	CyberiadaEdge *current;
-	CyberiadaSM* sm = doc->state_machines;
-	while (sm->next) sm = sm->next;
-	current = cyberiada_graph_find_last_edge(sm);
+	current = cyberiada_sm_builder_last_edge(ctx->builder);
 	if (current == NULL) {
 		ERROR("no current edge\n");
 		return gpsInvalid;
@@ -1594,15 +1983,13 @@ static GraphProcessorState handle_edge_target_point(xmlNode* xml_node,
 static GraphProcessorState handle_edge_label_point(xmlNode* xml_node,
 												   CyberiadaDocument* doc,
 												   NodeStack** stack,
-												   CyberiadaRegexps* regexps)
+												   CyberiadaDecodeContext* ctx)
 {
 	(void)stack; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)doc; /* unused parameter */	
 	
 	CyberiadaEdge *current;
-	CyberiadaSM* sm = doc->state_machines;
-	while (sm->next) sm = sm->next;
-	current = cyberiada_graph_find_last_edge(sm);
+	current = cyberiada_sm_builder_last_edge(ctx->builder);
 	if (current == NULL) {
 		ERROR("no current edge\n");
 		return gpsInvalid;
@@ -1621,15 +2008,13 @@ static GraphProcessorState handle_edge_label_point(xmlNode* xml_node,
 static GraphProcessorState handle_edge_label_rect(xmlNode* xml_node,
 												  CyberiadaDocument* doc,
 												  NodeStack** stack,
-												  CyberiadaRegexps* regexps)
+												  CyberiadaDecodeContext* ctx)
 {
 	(void)stack; /* unused parameter */	
-	(void)regexps; /* unused parameter */	
+	(void)doc; /* unused parameter */	
 	
 	CyberiadaEdge *current;
-	CyberiadaSM* sm = doc->state_machines;
-	while (sm->next) sm = sm->next;
-	current = cyberiada_graph_find_last_edge(sm);
+	current = cyberiada_sm_builder_last_edge(ctx->builder);
 	if (current == NULL) {
 		ERROR("no current edge\n");
 		return gpsInvalid;
@@ -1648,7 +2033,7 @@ static GraphProcessorState handle_edge_label_rect(xmlNode* xml_node,
 typedef GraphProcessorState (*GraphProcessorHandler)(xmlNode* xml_root,
 													 CyberiadaDocument* doc,
 													 NodeStack** stack,
-													 CyberiadaRegexps* regexps);
+													 CyberiadaDecodeContext* ctx);
 
 typedef struct {
 	GraphProcessorState		state;
@@ -1716,7 +2101,7 @@ static int dispatch_processor(xmlNode* xml_node,
 							  GraphProcessorState* gps,
 							  ProcessorTransition* processor_state_table,
 							  size_t processor_state_table_size,
-							  CyberiadaRegexps* regexps)
+							  CyberiadaDecodeContext* ctx)
 {
 	size_t i;
 	if (xml_node->type == XML_ELEMENT_NODE) {
@@ -1725,7 +2110,7 @@ static int dispatch_processor(xmlNode* xml_node,
 		for (i = 0; i < processor_state_table_size; i++) {
 			if (processor_state_table[i].state == *gps &&
 				strcmp(xml_element_name, processor_state_table[i].symbol) == 0) {
-				*gps = (*(processor_state_table[i].handler))(xml_node, doc, stack, regexps);
+				*gps = (*(processor_state_table[i].handler))(xml_node, doc, stack, ctx);
 				return CYBERIADA_NO_ERROR;
 			}
 		}
@@ -1739,7 +2124,7 @@ static int cyberiada_build_graphs(xmlNode* xml_root,
 								  GraphProcessorState* gps,
 								  ProcessorTransition* processor_state_table,
 								  size_t processor_state_table_size,
-								  CyberiadaRegexps* regexps)
+								  CyberiadaDecodeContext* ctx)
 {
 	xmlNode *cur_xml_node = NULL;
 	for (cur_xml_node = xml_root; cur_xml_node; cur_xml_node = cur_xml_node->next) {
@@ -1751,14 +2136,17 @@ static int cyberiada_build_graphs(xmlNode* xml_root,
 		node_stack_push(stack);
 		dispatch_processor(cur_xml_node, doc, stack, gps,
 						   processor_state_table, processor_state_table_size,
-						   regexps);
+						   ctx);
 		if (*gps == gpsInvalid) {
 			return CYBERIADA_FORMAT_ERROR;
 		}
-		if (cur_xml_node->children) {
+		if (ctx->skip && ctx->skip->subtree) {
+			/* fast-forward the skipped element */
+			ctx->skip->subtree = 0;
+		} else if (cur_xml_node->children) {
 			int res = cyberiada_build_graphs(cur_xml_node->children, doc, stack, gps,
 											 processor_state_table, processor_state_table_size,
-											 regexps);
+											 ctx);
 			if (res != CYBERIADA_NO_ERROR) {
 				return res;
 			}
@@ -1768,7 +2156,7 @@ static int cyberiada_build_graphs(xmlNode* xml_root,
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_decode_yed_xml(xmlNode* root, CyberiadaDocument* doc, CyberiadaRegexps* regexps)
+static int cyberiada_decode_yed_xml(xmlNode* root, CyberiadaDocument* doc, CyberiadaDecodeContext* ctx)
 {
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
@@ -1784,7 +2172,7 @@ static int cyberiada_decode_yed_xml(xmlNode* root, CyberiadaDocument* doc, Cyber
 								 GRAPHML_BERLOGA_SCHEMENAME_ATTR) == CYBERIADA_NO_ERROR) {
 		cyberiada_copy_string(&(doc->format), &(doc->format_len), CYBERIADA_FORMAT_BERLOGA);
 		berloga_format = 1;
-		regexps->berloga_legacy = 1;
+		ctx->regexps->berloga_legacy = 1;
 	} else {
 		cyberiada_copy_string(&(doc->format), &(doc->format_len), CYBERIADA_FORMAT_OSTRANNA);
 		berloga_format = 0;
@@ -1794,7 +2182,7 @@ static int cyberiada_decode_yed_xml(xmlNode* root, CyberiadaDocument* doc, Cyber
 	if ((res = cyberiada_build_graphs(root, doc, &stack, &gps,
 									  yed_processor_state_table,
 									  yed_processor_state_table_size,
-									  regexps)) != CYBERIADA_NO_ERROR) {
+									  ctx)) != CYBERIADA_NO_ERROR) {
 		return res;
 	}
 	
@@ -1806,7 +2194,7 @@ static int cyberiada_decode_yed_xml(xmlNode* root, CyberiadaDocument* doc, Cyber
 
 	if (berloga_format) {
 		sm_name = buffer;
-		if (regexps->berloga_legacy > 1) {
+		if (ctx->regexps->berloga_legacy > 1) {
 			if (doc->format) {
 				free(doc->format);
 			}
@@ -1832,7 +2220,7 @@ static int cyberiada_decode_yed_xml(xmlNode* root, CyberiadaDocument* doc, Cyber
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_decode_cyberiada_xml(xmlNode* root, CyberiadaDocument* doc, CyberiadaRegexps* regexps)
+static int cyberiada_decode_cyberiada_xml(xmlNode* root, CyberiadaDocument* doc, CyberiadaDecodeContext* ctx)
 {
 	GraphProcessorState gps = gpsInit;
 	CyberiadaSM* sm;
@@ -1844,7 +2232,7 @@ static int cyberiada_decode_cyberiada_xml(xmlNode* root, CyberiadaDocument* doc,
 	if ((res = cyberiada_build_graphs(root, doc, &stack, &gps,
 									  cyb_processor_state_table,
 									  cyb_processor_state_table_size,
-									  regexps)) != CYBERIADA_NO_ERROR) {
+									  ctx)) != CYBERIADA_NO_ERROR) {
 		cyberiada_init_table_free_extensitions();
 		return res;
 	}
@@ -2008,11 +2396,11 @@ static int cyberiada_check_node_ids(CyberiadaNode* root, CyberiadaNode* nodes)
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_check_pseudostates(CyberiadaNode* nodes, CyberiadaEdge* edges, int check_initial, int toplevel)
+static int cyberiada_check_pseudostates(CyberiadaNode* nodes, int check_initial, int toplevel)
 {
-	CyberiadaNode *n, *init_n = NULL;
-	CyberiadaEdge *e;
-	size_t initial = 0, initial_edges = 0;
+	CyberiadaNode *n;
+	size_t initial = 0;
+	int res;
 
 	if (!nodes) {
 		return CYBERIADA_NO_ERROR;
@@ -2026,10 +2414,9 @@ static int cyberiada_check_pseudostates(CyberiadaNode* nodes, CyberiadaEdge* edg
 	for (n = nodes; n; n = n->next) {
 		if (n->type == cybNodeInitial) {
 			initial++;
-			init_n = n;
 		}
 		if (n->children) {
-			int res = cyberiada_check_pseudostates(n->children, edges, check_initial, 0);
+			res = cyberiada_check_pseudostates(n->children, check_initial, 0);
 			if (res != CYBERIADA_NO_ERROR) {
 				ERROR("Error while checking pseudostates: %d\n", res);
 				return res;
@@ -2042,19 +2429,6 @@ static int cyberiada_check_pseudostates(CyberiadaNode* nodes, CyberiadaEdge* edg
 		return CYBERIADA_FORMAT_ERROR;
 	}
 
-	if (init_n) {
-		for (e = edges; e; e = e->next) {
-			if (e->source && e->source == init_n) {
-				initial_edges++;
-			}
-		}
-		
-		if (initial_edges > 1) {
-			ERROR("Too many edges from the initial pseudostate %s: %lu\n", init_n->id, initial_edges);
-			return CYBERIADA_FORMAT_ERROR;
-		}
-	}
-	
 	if (check_initial && toplevel) {
 		if (initial != 1) {
 			ERROR("SM should have single initial pseudostate on the top level\n");
@@ -2065,6 +2439,45 @@ static int cyberiada_check_pseudostates(CyberiadaNode* nodes, CyberiadaEdge* edg
 	return CYBERIADA_NO_ERROR;
 }
 
+/* the initial pseudostates have a single outgoing edge; the edges are scanned once with a private */
+/* index, the SM adjacency index is not used since the document may be edited after it was built   */
+static int cyberiada_check_initial_edges(CyberiadaSM* sm)
+{
+	CyberiadaEdge* e;
+	CyberiadaHash sources;
+	size_t count = 0;
+	int res = CYBERIADA_NO_ERROR;
+
+	for (e = sm->edges; e; e = e->next) {
+		if (e->source && e->source->type == cybNodeInitial) {
+			count++;
+		}
+	}
+	if (count < 2) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	if (cyberiada_hash_init(&sources, 0, count) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	for (e = sm->edges; e; e = e->next) {
+		if (!e->source || e->source->type != cybNodeInitial) {
+			continue;
+		}
+		if (cyberiada_hash_get(&sources, e->source)) {
+			ERROR("Too many edges from the initial pseudostate %s\n", e->source->id);
+			res = CYBERIADA_FORMAT_ERROR;
+			break;
+		}
+		if (cyberiada_hash_put(&sources, e->source, e) != 0) {
+			res = CYBERIADA_MEMORY_ERROR;
+			break;
+		}
+	}
+	cyberiada_hash_free(&sources);
+	return res;
+}
+
 static int cyberiada_check_graphs(CyberiadaDocument* doc, int skip_geometry, int check_initial, int strict_entries, int skip_empty)
 {
 	int res = CYBERIADA_NO_ERROR;
@@ -2076,7 +2489,8 @@ static int cyberiada_check_graphs(CyberiadaDocument* doc, int skip_geometry, int
 
 	for (sm = doc->state_machines; sm; sm = sm->next) {
 		if (sm->nodes) {
-			if ((res = cyberiada_check_pseudostates(sm->nodes->children, sm->edges, check_initial, 1)) != CYBERIADA_NO_ERROR) {
+			if ((res = cyberiada_check_pseudostates(sm->nodes->children, check_initial, 1)) != CYBERIADA_NO_ERROR ||
+				(res = cyberiada_check_initial_edges(sm)) != CYBERIADA_NO_ERROR) {
 				ERROR("error: state machine %s has wrong structure - bad pseudostates\n", sm->nodes->id);
 				break;
 			}
@@ -2145,7 +2559,8 @@ static int cyberiada_update_metainfo_comment(CyberiadaDocument* doc)
 /* -----------------------------------------------------------------------------
  * GraphML reader interface
  * ----------------------------------------------------------------------------- */
-static int cyberiada_process_decode_sm_document(CyberiadaDocument* cyb_doc, xmlDoc* doc, CyberiadaXMLFormat format, int flags)
+static int cyberiada_process_decode_sm_document(CyberiadaDocument* cyb_doc, xmlDoc* doc, CyberiadaXMLFormat format,
+												int flags, CyberiadaDecodeOptions* options)
 {
 	int res;
 	int skip_geometry = 0;
@@ -2154,12 +2569,27 @@ static int cyberiada_process_decode_sm_document(CyberiadaDocument* cyb_doc, xmlD
 	NamesList* nl = NULL;
 	int geom_flags;
 	CyberiadaRegexps cyberiada_regexps;
+	CyberiadaDecodeContext ctx;
+	CyberiadaDecodeClip clip;
+	CyberiadaDecodeSkip skip;
+
+	if (options && (options->skip & CYBERIADA_DECODE_SKIP_GEOMETRY)) {
+		flags |= CYBERIADA_FLAG_SKIP_GEOMETRY;
+	}
+	if (options && (options->skip & CYBERIADA_DECODE_SKIP_META)) {
+		flags |= CYBERIADA_FLAG_SKIP_META;
+	}
 	
 	if (flags & CYBERIADA_FLAG_ROUND_GEOMETRY) {
 		ERROR("Round geometry flag is not supported on import\n");
 		return CYBERIADA_BAD_PARAMETER;
 	}
 
+	if (flags & CYBERIADA_FLAG_SIMPLIFY_GEOMETRY) {
+		ERROR("Simplify geometry flag is not supported on import\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
 	skip_geometry = flags & CYBERIADA_FLAG_SKIP_GEOMETRY;
 	if (skip_geometry &&
 		(flags & ~CYBERIADA_FLAG_NON_GEOMETRY) != CYBERIADA_FLAG_SKIP_GEOMETRY) {
@@ -2213,8 +2643,38 @@ static int cyberiada_process_decode_sm_document(CyberiadaDocument* cyb_doc, xmlD
 		}
 	}
 	
+	if (options && options->viewport) {
+		if (options->viewport->width < 0.0 || options->viewport->height < 0.0) {
+			ERROR("Bad decode viewport size\n");
+			return CYBERIADA_BAD_PARAMETER;
+		}
+		memset(&clip, 0, sizeof(CyberiadaDecodeClip));
+		clip.viewport = *(options->viewport);
+		if (cyberiada_hash_init(&(clip.clipped), 0, 0) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+
+	if (options && options->skip) {
+		memset(&skip, 0, sizeof(CyberiadaDecodeSkip));
+		skip.mask = options->skip;
+		if (cyberiada_hash_init(&(skip.nodes), 1, 0) != 0 ||
+			cyberiada_hash_init(&(skip.comments), 1, 0) != 0) {
+			cyberiada_decode_skip_free(&skip);
+			if (options->viewport) {
+				cyberiada_hash_free(&(clip.clipped));
+			}
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	
 	cyberiada_init_sm_document(cyb_doc);
 	cyberiada_init_action_regexps(&cyberiada_regexps, flags & CYBERIADA_FLAG_FLATTENED);
+	memset(&ctx, 0, sizeof(CyberiadaDecodeContext));
+	ctx.regexps = &cyberiada_regexps;
+	ctx.flags = flags;
+	ctx.clip = options && options->viewport ? &clip : NULL;
+	ctx.skip = options && options->skip ? &skip : NULL;
 	
 	do {
 
@@ -2235,22 +2695,39 @@ static int cyberiada_process_decode_sm_document(CyberiadaDocument* cyb_doc, xmlD
 		}
 
 		cyb_doc->state_machines = cyberiada_new_sm();
+		if ((res = cyberiada_new_sm_builder(cyb_doc->state_machines,
+											&(ctx.builder))) != CYBERIADA_NO_ERROR) {
+			break;
+		}
+
+		if (ctx.clip) {
+			/* the Cyberiada GraphML nodes geometry is left-top local, the YED one is absolute */
+			clip.local = format == cybxmlCyberiada10;
+		}
 		
 		/* DEBUG("reading format %d\n", format); */
 		if (format == cybxmlYED) {
-			res = cyberiada_decode_yed_xml(root, cyb_doc, &cyberiada_regexps);
+			res = cyberiada_decode_yed_xml(root, cyb_doc, &ctx);
 		} else if (format == cybxmlCyberiada10) {
-			res = cyberiada_decode_cyberiada_xml(root, cyb_doc, &cyberiada_regexps);
+			res = cyberiada_decode_cyberiada_xml(root, cyb_doc, &ctx);
 		} else {
 			ERROR("error: unsupported GraphML format of file\n");
 			res = CYBERIADA_XML_ERROR;
 			break;
 		}
 
+		/* the builder is used by the decoder only */
+		cyberiada_destroy_sm_builder(ctx.builder);
+		ctx.builder = NULL;
+		
 		if (res != CYBERIADA_NO_ERROR) {
 			break;
 		}
 
+		if (ctx.skip) {
+			cyberiada_decode_skip_edges(&skip, cyb_doc);
+		}
+
 		if (cyberiada_regexps.arena_legacy) {
 			if (cyb_doc->format) {
 				free(cyb_doc->format);
@@ -2276,6 +2753,10 @@ static int cyberiada_process_decode_sm_document(CyberiadaDocument* cyb_doc, xmlD
 			break;
 		}
 
+		if (ctx.clip) {
+			cyberiada_decode_clip_edges(&clip, cyb_doc);
+		}
+
 		res = cyberiada_check_graphs(cyb_doc,
 									 flags & CYBERIADA_FLAG_SKIP_GEOMETRY,
 									 flags & CYBERIADA_FLAG_CHECK_INITIAL,
@@ -2315,10 +2796,32 @@ static int cyberiada_process_decode_sm_document(CyberiadaDocument* cyb_doc, xmlD
 									  CYBERIADA_FORMAT_CYBERIADAML);
 			}
 		}
+
+		if (flags & CYBERIADA_FLAG_BUILD_ADJACENCY) {
+			for (sm = cyb_doc->state_machines; sm; sm = sm->next) {
+				if (!sm->adjacency && (res = cyberiada_sm_build_adjacency(sm)) != CYBERIADA_NO_ERROR) {
+					break;
+				}
+			}
+		}
 		
 	} while(0);
 
 	cyberiada_free_name_list(&nl);
+	if (ctx.builder) {
+		cyberiada_destroy_sm_builder(ctx.builder);
+	}
+	if (ctx.clip) {
+		options->clipped_nodes = clip.clipped_nodes;
+		options->clipped_edges = clip.clipped_edges;
+		cyberiada_hash_free(&(clip.clipped));
+	}
+	if (ctx.skip) {
+		options->skipped_nodes = skip.skipped_nodes;
+		options->skipped_edges = skip.skipped_edges;
+		cyberiada_decode_skip_free(&skip);
+	}
+	cyberiada_release_raw_regexps(&(ctx.raw_regexps));
 	cyberiada_free_action_regexps(&cyberiada_regexps);
 	
     return res;	
@@ -2378,8 +2881,24 @@ static int cyberiada_detect_flattened_buffer(const char* buffer, size_t buffer_s
 int cyberiada_read_sm_document(CyberiadaDocument* cyb_doc, const char* filename,
 							   CyberiadaXMLFormat format, int flags)
 {
-	int res;
+	CyberiadaDecodeOptions options;
+	memset(&options, 0, sizeof(CyberiadaDecodeOptions));
+	options.flags = flags;
+	return cyberiada_read_sm_document_with_options(cyb_doc, filename, format, &options);
+}
+
+int cyberiada_read_sm_document_with_options(CyberiadaDocument* cyb_doc, const char* filename,
+											CyberiadaXMLFormat format, CyberiadaDecodeOptions* options)
+{
+	int res, flags;
 	xmlDoc* doc = NULL;
+
+	if (!options) {
+		ERROR("error: no decode options\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	flags = options->flags;
+	
 	xmlInitParser();
 
 	if (format != cybxmlCyberiada10) {
@@ -2398,7 +2917,7 @@ int cyberiada_read_sm_document(CyberiadaDocument* cyb_doc, const char* filename,
 		return CYBERIADA_XML_ERROR;
 	}
 
-	res = cyberiada_process_decode_sm_document(cyb_doc, doc, format, flags);
+	res = cyberiada_process_decode_sm_document(cyb_doc, doc, format, flags, options);
 	
 	if (doc) {
 		xmlFreeDoc(doc);
@@ -2410,8 +2929,24 @@ int cyberiada_read_sm_document(CyberiadaDocument* cyb_doc, const char* filename,
 int cyberiada_decode_sm_document(CyberiadaDocument* cyb_doc, const char* buffer, size_t buffer_size,
 								 CyberiadaXMLFormat format, int flags)
 {
-	int res;
+	CyberiadaDecodeOptions options;
+	memset(&options, 0, sizeof(CyberiadaDecodeOptions));
+	options.flags = flags;
+	return cyberiada_decode_sm_document_with_options(cyb_doc, buffer, buffer_size, format, &options);
+}
+
+int cyberiada_decode_sm_document_with_options(CyberiadaDocument* cyb_doc, const char* buffer, size_t buffer_size,
+											  CyberiadaXMLFormat format, CyberiadaDecodeOptions* options)
+{
+	int res, flags;
 	xmlDoc* doc = NULL;
+
+	if (!options) {
+		ERROR("error: no decode options\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	flags = options->flags;
+	
 	xmlInitParser();
 
 	if (format != cybxmlCyberiada10) {
@@ -2430,7 +2965,7 @@ int cyberiada_decode_sm_document(CyberiadaDocument* cyb_doc, const char* buffer,
 		return CYBERIADA_XML_ERROR;
 	}
 
-	res = cyberiada_process_decode_sm_document(cyb_doc, doc, format, flags);
+	res = cyberiada_process_decode_sm_document(cyb_doc, doc, format, flags, options);
 	
 	if (doc) {
 		xmlFreeDoc(doc);
@@ -2532,7 +3067,13 @@ static int cyberiada_write_geometry_point_cyberiada(xmlTextWriterPtr writer, Cyb
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode* node, int indent)
+static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode* node,
+										  const CyberiadaGeometryTable* geometry, int indent);
+
+static int cyberiada_write_node_content_cyberiada(xmlTextWriterPtr writer, CyberiadaNode* node,
+												  const CyberiadaNodeGeometry* node_geometry,
+												  const char* comment_body,
+												  const CyberiadaGeometryTable* geometry, int indent)
 {
 	int res, found;
 	CyberiadaNode* cur_node;
@@ -2548,11 +3089,11 @@ static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode
 		XML_WRITE_ATTR(writer, GRAPHML_ID_ATTRIBUTE, buffer);
 		XML_WRITE_ATTR(writer, GRAPHML_EDGEDEFAULT_ATTRIBUTE, GRAPHML_EDGEDEFAULT_ATTRIBUTE_VALUE);
 
-		if (node->geometry_rect) {
+		if (node_geometry && node_geometry->rect) {
 			XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, indent + 1);
 			XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_GEOMETRY);
 			if ((res = cyberiada_write_geometry_rect_cyberiada(writer,
-															   node->geometry_rect,
+															   node_geometry->rect,
 															   indent + 2)) != CYBERIADA_NO_ERROR) {
 				ERROR("Cannot write node %s geometry rect\n", node->id);
 				return res;
@@ -2561,7 +3102,7 @@ static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode
 		}
 
 		for (cur_node = node->children; cur_node; cur_node = cur_node->next) {
-			res = cyberiada_write_node_cyberiada(writer, cur_node, indent + 1);
+			res = cyberiada_write_node_cyberiada(writer, cur_node, geometry, indent + 1);
 			if (res != CYBERIADA_NO_ERROR) {
 				ERROR("error while writing node %s\n", cur_node->id);
 				return CYBERIADA_XML_ERROR;
@@ -2641,14 +3182,14 @@ static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode
 		XML_WRITE_CLOSE_E(writer);		
 	}
 	
-	if ((node->type == cybNodeComment || node->type == cybNodeFormalComment) && node->comment_data) {
-		if (node->comment_data->body) {
+	if (node->type == cybNodeComment || node->type == cybNodeFormalComment) {
+		if (comment_body) {
 			XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, indent + 1);
 			XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_DATA);
-			XML_WRITE_TEXT(writer, node->comment_data->body);
+			XML_WRITE_TEXT(writer, comment_body);
 			XML_WRITE_CLOSE_E(writer);
 		}
-		if (node->comment_data->markup) {
+		if (node->comment_data && node->comment_data->markup) {
 			XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, indent + 1);
 			XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_MARKUP);
 			XML_WRITE_TEXT(writer, node->comment_data->markup);
@@ -2663,11 +3204,11 @@ static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode
 		XML_WRITE_CLOSE_E(writer);		
 	}
 
-	if (node->geometry_rect) {
+	if (node_geometry && node_geometry->rect) {
 		XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, indent + 1);
 		XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_GEOMETRY);
 		if ((res = cyberiada_write_geometry_rect_cyberiada(writer,
-														   node->geometry_rect,
+														   node_geometry->rect,
 														   indent + 2)) != CYBERIADA_NO_ERROR) {
 			ERROR("Cannot write node %s geometry rect\n", node->id);
 			return res;
@@ -2675,11 +3216,11 @@ static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode
 		XML_WRITE_CLOSE_E_I(writer, indent + 1);
 	}
 
-	if (node->geometry_point) {
+	if (node_geometry && node_geometry->point) {
 		XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, indent + 1);
 		XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_GEOMETRY);
 		if ((res = cyberiada_write_geometry_point_cyberiada(writer,
-															node->geometry_point,
+															node_geometry->point,
 															indent + 2)) != CYBERIADA_NO_ERROR) {
 			ERROR("Cannot write node %s geometry point\n", node->id);
 			return res;
@@ -2700,7 +3241,7 @@ static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode
 			return CYBERIADA_XML_ERROR;
 		}
 
-		res = cyberiada_write_node_cyberiada(writer, node->children, indent + 1);
+		res = cyberiada_write_node_cyberiada(writer, node->children, geometry, indent + 1);
 		if (res != CYBERIADA_NO_ERROR) {
 			ERROR("error while writing node %s\n", node->children->id);
 			return CYBERIADA_XML_ERROR;
@@ -2712,9 +3253,65 @@ static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_write_edge_cyberiada(xmlTextWriterPtr writer, CyberiadaEdge* edge, int indent)
+static int cyberiada_write_node_cyberiada(xmlTextWriterPtr writer, CyberiadaNode* node,
+										  const CyberiadaGeometryTable* geometry, int indent)
+{
+	return cyberiada_write_node_content_cyberiada(writer, node,
+												  cyberiada_geometry_table_node(geometry, node),
+												  node->comment_data ? node->comment_data->body : NULL,
+												  geometry, indent);
+}
+
+static int cyberiada_write_meta_node_cyberiada(xmlTextWriterPtr writer, CyberiadaDocument* doc,
+											   const CyberiadaGeometryTable* geometry, int indent)
 {
+	/* write the metainformation comment with the actual meta data like
+	   cyberiada_update_metainfo_comment() does but without modifying the document */
 	int res;
+	CyberiadaNode *sm_node, *first_node, *meta_node;
+	CyberiadaNode default_meta_node;
+	char default_meta_id[] = CYBERIADA_META_NODE_DEFAULT_ID;
+	char default_meta_title[] = CYBERIADA_META_NODE_TITLE;
+	char* body = NULL;
+	size_t body_len = 0;
+
+	sm_node = doc->state_machines->nodes;
+	if (sm_node->type != cybNodeSM ||
+		sm_node->next != NULL) {
+		ERROR("Inconsistem SM node\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	first_node = sm_node->children; 
+	if (first_node &&
+		first_node->type == cybNodeFormalComment &&
+		first_node->title &&
+		strcmp(first_node->title, CYBERIADA_META_NODE_TITLE) == 0) {
+		meta_node = first_node;
+	} else {
+		memset(&default_meta_node, 0, sizeof(CyberiadaNode));
+		default_meta_node.type = cybNodeFormalComment;
+		default_meta_node.id = default_meta_id;
+		default_meta_node.title = default_meta_title;
+		default_meta_node.title_len = strlen(default_meta_title);
+		meta_node = &default_meta_node;
+	}
+
+	cyberiada_encode_meta(doc->meta_info, &body, &body_len);
+	res = cyberiada_write_node_content_cyberiada(writer, meta_node,
+												 cyberiada_geometry_table_node(geometry, meta_node),
+												 body, geometry, indent);
+	if (body) {
+		free(body);
+	}
+	
+	return res;
+}
+
+static int cyberiada_write_edge_cyberiada(xmlTextWriterPtr writer, CyberiadaEdge* edge,
+										  const CyberiadaGeometryTable* geometry, int indent)
+{
+	int res;
+	const CyberiadaEdgeGeometry* edge_geometry = cyberiada_geometry_table_edge(geometry, edge);
 /*	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer) - 1;*/
 	CyberiadaPolyline* pl;
@@ -2771,10 +3368,10 @@ static int cyberiada_write_edge_cyberiada(xmlTextWriterPtr writer, CyberiadaEdge
 	/* 	XML_WRITE_ATTR(writer, GRAPHML_YED_GEOM_TARGET_Y_ATTRIBUTE, "0"); */
 	/* } */
 
-	if (edge->geometry_polyline) {
+	if (edge_geometry && edge_geometry->polyline) {
 		XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, indent + 1);
 		XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_GEOMETRY);
-		pl = edge->geometry_polyline;
+		pl = edge_geometry->polyline;
 		do {
 			cyberiada_write_geometry_point_cyberiada(writer, &(pl->point), indent + 2);
 			pl = pl->next;
@@ -2782,24 +3379,24 @@ static int cyberiada_write_edge_cyberiada(xmlTextWriterPtr writer, CyberiadaEdge
 		XML_WRITE_CLOSE_E_I(writer, indent + 1);
 	}
 	
-	if (edge->geometry_source_point) {
+	if (edge_geometry && edge_geometry->source_point) {
 		XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, indent + 1);
 		XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_SOURCE_POINT);
-		cyberiada_write_geometry_point_cyberiada(writer, edge->geometry_source_point, indent + 2);
+		cyberiada_write_geometry_point_cyberiada(writer, edge_geometry->source_point, indent + 2);
 		XML_WRITE_CLOSE_E_I(writer, indent + 1);
 	}
 
-	if (edge->geometry_target_point) {
+	if (edge_geometry && edge_geometry->target_point) {
 		XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, indent + 1);
 		XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_TARGET_POINT);
-		cyberiada_write_geometry_point_cyberiada(writer, edge->geometry_target_point, indent + 2);
+		cyberiada_write_geometry_point_cyberiada(writer, edge_geometry->target_point, indent + 2);
 		XML_WRITE_CLOSE_E_I(writer, indent + 1);
 	}
 
-	if (edge->geometry_label_point) {
+	if (edge_geometry && edge_geometry->label_point) {
 		XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, indent + 1);
 		XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_LABEL_GEOMETRY);
-		cyberiada_write_geometry_point_cyberiada(writer, edge->geometry_label_point, indent + 2);
+		cyberiada_write_geometry_point_cyberiada(writer, edge_geometry->label_point, indent + 2);
 		XML_WRITE_CLOSE_E_I(writer, indent + 1);
 	}
 
@@ -2822,11 +3419,13 @@ static int cyberiada_write_edge_cyberiada(xmlTextWriterPtr writer, CyberiadaEdge
 	return CYBERIADA_NO_ERROR;	
 }
 
-static int cyberiada_write_sm_cyberiada(CyberiadaSM* sm, xmlTextWriterPtr writer)
+static int cyberiada_write_sm_cyberiada(CyberiadaDocument* doc, CyberiadaSM* sm,
+									   const CyberiadaGeometryTable* geometry, xmlTextWriterPtr writer)
 {
 	int res;
 	CyberiadaNode* cur_node;
 	CyberiadaEdge* cur_edge;
+	const CyberiadaNodeGeometry* sm_geometry;
 
 	if (!sm->nodes) {
 		ERROR("SM node is required\n");
@@ -2855,11 +3454,12 @@ static int cyberiada_write_sm_cyberiada(CyberiadaSM* sm, xmlTextWriterPtr writer
 	XML_WRITE_TEXT(writer, sm->nodes->title);	
 	XML_WRITE_CLOSE_E(writer);
 
-	if (sm->nodes->geometry_rect) {
+	sm_geometry = cyberiada_geometry_table_node(geometry, sm->nodes);
+	if (sm_geometry && sm_geometry->rect) {
 		XML_WRITE_OPEN_E_I(writer, GRAPHML_DATA_ELEMENT, 2);
 		XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_CYB_KEY_GEOMETRY);
 		if ((res = cyberiada_write_geometry_rect_cyberiada(writer,
-														   sm->nodes->geometry_rect,
+														   sm_geometry->rect,
 														   3)) != CYBERIADA_NO_ERROR) {
 			ERROR("Cannot write SM %s geometry rect\n", sm->nodes->id);
 			return CYBERIADA_XML_ERROR;
@@ -2868,8 +3468,23 @@ static int cyberiada_write_sm_cyberiada(CyberiadaSM* sm, xmlTextWriterPtr writer
 	}
 	
 	/* write nodes */
-	for (cur_node = sm->nodes->children; cur_node; cur_node = cur_node->next) {
-		res = cyberiada_write_node_cyberiada(writer, cur_node, 2);
+	cur_node = sm->nodes->children;
+	if (sm == doc->state_machines) {
+		/* the first SM contains the metainformation comment */
+		res = cyberiada_write_meta_node_cyberiada(writer, doc, geometry, 2);
+		if (res != CYBERIADA_NO_ERROR) {
+			ERROR("error while writing metainformation node\n");
+			return CYBERIADA_XML_ERROR;
+		}
+		if (cur_node &&
+			cur_node->type == cybNodeFormalComment &&
+			cur_node->title &&
+			strcmp(cur_node->title, CYBERIADA_META_NODE_TITLE) == 0) {
+			cur_node = cur_node->next;
+		}
+	}
+	for (; cur_node; cur_node = cur_node->next) {
+		res = cyberiada_write_node_cyberiada(writer, cur_node, geometry, 2);
 		if (res != CYBERIADA_NO_ERROR) {
 			ERROR("error while writing node %s\n", cur_node->id);
 			return CYBERIADA_XML_ERROR;
@@ -2878,7 +3493,7 @@ static int cyberiada_write_sm_cyberiada(CyberiadaSM* sm, xmlTextWriterPtr writer
 		
 	/* write edges */
 	for (cur_edge = sm->edges; cur_edge; cur_edge = cur_edge->next) {
-		res = cyberiada_write_edge_cyberiada(writer, cur_edge, 2);
+		res = cyberiada_write_edge_cyberiada(writer, cur_edge, geometry, 2);
 		if (res != CYBERIADA_NO_ERROR) {
 			ERROR("error while writing edge %s\n", cur_edge->id);
 			return CYBERIADA_XML_ERROR;
@@ -2890,20 +3505,18 @@ static int cyberiada_write_sm_cyberiada(CyberiadaSM* sm, xmlTextWriterPtr writer
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_write_sm_document_cyberiada(CyberiadaDocument* doc, xmlTextWriterPtr writer)
+static int cyberiada_write_sm_document_cyberiada(CyberiadaDocument* doc, const CyberiadaGeometryTable* geometry,
+												 xmlTextWriterPtr writer)
 {
 	int res;
 	size_t i;
 	GraphMLKey* key;
 	CyberiadaSM* sm;
-	if (!doc->format) {
-		cyberiada_copy_string(&(doc->format),
-							  &(doc->format_len),
-							  CYBERIADA_FORMAT_CYBERIADAML);	
-	}
-	res = cyberiada_update_metainfo_comment(doc);
-	if (res != CYBERIADA_NO_ERROR) {
-		return res;
+
+	if (!doc->state_machines) {
+		/* empty doc */
+		ERROR("At least one SM required\n");
+		return CYBERIADA_BAD_PARAMETER;
 	}
 
 	XML_WRITE_OPEN_E(writer, GRAPHML_GRAPHML_ELEMENT);
@@ -2931,7 +3544,7 @@ static int cyberiada_write_sm_document_cyberiada(CyberiadaDocument* doc, xmlText
 	}
 
 	for (sm = doc->state_machines; sm; sm = sm->next) {
-		if ((res = cyberiada_write_sm_cyberiada(sm, writer)) != CYBERIADA_NO_ERROR) {
+		if ((res = cyberiada_write_sm_cyberiada(doc, sm, geometry, writer)) != CYBERIADA_NO_ERROR) {
 			ERROR("Error while writing SM: %d\n", res);
 			return res;
 		}
@@ -3105,10 +3718,12 @@ static int cyberiada_write_geometry_yed(xmlTextWriterPtr writer, CyberiadaRect*
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_write_node_yed(xmlTextWriterPtr writer, CyberiadaNode* node, int indent)
+static int cyberiada_write_node_yed(xmlTextWriterPtr writer, CyberiadaNode* node,
+									const CyberiadaGeometryTable* geometry, int indent)
 {
 	int res;
 	CyberiadaNode* cur_node;
+	const CyberiadaNodeGeometry* node_geometry = cyberiada_geometry_table_node(geometry, node);
 	const char* text;
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
@@ -3116,7 +3731,7 @@ static int cyberiada_write_node_yed(xmlTextWriterPtr writer, CyberiadaNode* node
 	if (node->type == cybNodeSM) {
 		
 		for (cur_node = node->children; cur_node; cur_node = cur_node->next) {
-			res = cyberiada_write_node_yed(writer, cur_node, indent);
+			res = cyberiada_write_node_yed(writer, cur_node, geometry, indent);
 			if (res != CYBERIADA_NO_ERROR) {
 				ERROR("error while writing root node %s\n", cur_node->id);
 				return CYBERIADA_XML_ERROR;
@@ -3136,8 +3751,8 @@ static int cyberiada_write_node_yed(xmlTextWriterPtr writer, CyberiadaNode* node
 			XML_WRITE_OPEN_E_NS_I(writer, GRAPHML_YED_GENERICNODE, GRAPHML_YED_NS, indent + 2);
 			XML_WRITE_ATTR(writer, "configuration", GRAPHML_YED_NODE_CONFIG_START2);
 
-			if (node->geometry_rect) {
-				if (cyberiada_write_geometry_yed(writer, node->geometry_rect, indent + 3) != CYBERIADA_NO_ERROR) {
+			if (node_geometry && node_geometry->rect) {
+				if (cyberiada_write_geometry_yed(writer, node_geometry->rect, indent + 3) != CYBERIADA_NO_ERROR) {
 					ERROR("error while writing initial node geometry\n");
 					return CYBERIADA_XML_ERROR;
 				}
@@ -3163,8 +3778,8 @@ static int cyberiada_write_node_yed(xmlTextWriterPtr writer, CyberiadaNode* node
 			XML_WRITE_ATTR(writer, GRAPHML_KEY_ATTRIBUTE, GRAPHML_YED_KEY_NODE_GRAPHICS);
 			XML_WRITE_OPEN_E_NS_I(writer, GRAPHML_YED_GENERICNODE, GRAPHML_YED_NS, indent + 2);
 
-			if (node->geometry_rect) {
-				if (cyberiada_write_geometry_yed(writer, node->geometry_rect, indent + 3) != CYBERIADA_NO_ERROR) {
+			if (node_geometry && node_geometry->rect) {
+				if (cyberiada_write_geometry_yed(writer, node_geometry->rect, indent + 3) != CYBERIADA_NO_ERROR) {
 					ERROR("error while writing composite node geometry\n");
 					return CYBERIADA_XML_ERROR;
 				}
@@ -3204,8 +3819,8 @@ static int cyberiada_write_node_yed(xmlTextWriterPtr writer, CyberiadaNode* node
 			XML_WRITE_ATTR(writer, "active", "0");
 			XML_WRITE_OPEN_E_NS_I(writer, GRAPHML_YED_GROUPNODE, GRAPHML_YED_NS, indent + 4);
 
-			if (node->geometry_rect) {
-				if (cyberiada_write_geometry_yed(writer, node->geometry_rect, indent + 5) != CYBERIADA_NO_ERROR) {
+			if (node_geometry && node_geometry->rect) {
+				if (cyberiada_write_geometry_yed(writer, node_geometry->rect, indent + 5) != CYBERIADA_NO_ERROR) {
 					ERROR("error while writing composite node geometry\n");
 					return CYBERIADA_XML_ERROR;
 				}
@@ -3249,7 +3864,7 @@ static int cyberiada_write_node_yed(xmlTextWriterPtr writer, CyberiadaNode* node
 			XML_WRITE_ATTR(writer, GRAPHML_EDGEDEFAULT_ATTRIBUTE, GRAPHML_EDGEDEFAULT_ATTRIBUTE_VALUE);
 
 			for (cur_node = node->children->children; cur_node; cur_node = cur_node->next) {
-				res = cyberiada_write_node_yed(writer, cur_node, indent + 2);
+				res = cyberiada_write_node_yed(writer, cur_node, geometry, indent + 2);
 				if (res != CYBERIADA_NO_ERROR) {
 					ERROR("error while writing node %s\n", cur_node->id);
 					return CYBERIADA_XML_ERROR;
@@ -3265,9 +3880,11 @@ static int cyberiada_write_node_yed(xmlTextWriterPtr writer, CyberiadaNode* node
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_write_edge_yed(xmlTextWriterPtr writer, CyberiadaEdge* edge, int indent)
+static int cyberiada_write_edge_yed(xmlTextWriterPtr writer, CyberiadaEdge* edge,
+									const CyberiadaGeometryTable* geometry, int indent)
 {
 	int res;
+	const CyberiadaEdgeGeometry* edge_geometry = cyberiada_geometry_table_edge(geometry, edge);
 	char buffer[MAX_STR_LEN];
 	size_t buffer_len = sizeof(buffer);
 	buffer[buffer_len - 1] = 0;	
@@ -3282,14 +3899,14 @@ static int cyberiada_write_edge_yed(xmlTextWriterPtr writer, CyberiadaEdge* edge
 	XML_WRITE_OPEN_E_I(writer, GRAPHML_YED_POLYLINEEDGE, indent + 2);
 
 	XML_WRITE_OPEN_E_I(writer, GRAPHML_YED_PATHNODE, indent + 3);
-	if (edge->geometry_source_point && edge->geometry_target_point) {	
-		snprintf(buffer, buffer_len - 1, "%lf", edge->geometry_source_point->x);
+	if (edge_geometry && edge_geometry->source_point && edge_geometry->target_point) {	
+		snprintf(buffer, buffer_len - 1, "%lf", edge_geometry->source_point->x);
 		XML_WRITE_ATTR(writer, GRAPHML_YED_GEOM_SOURCE_X_ATTRIBUTE, buffer);
-		snprintf(buffer, buffer_len - 1, "%lf", edge->geometry_source_point->y);
+		snprintf(buffer, buffer_len - 1, "%lf", edge_geometry->source_point->y);
 		XML_WRITE_ATTR(writer, GRAPHML_YED_GEOM_SOURCE_Y_ATTRIBUTE, buffer);
-		snprintf(buffer, buffer_len - 1, "%lf", edge->geometry_target_point->x);
+		snprintf(buffer, buffer_len - 1, "%lf", edge_geometry->target_point->x);
 		XML_WRITE_ATTR(writer, GRAPHML_YED_GEOM_TARGET_X_ATTRIBUTE, buffer);
-		snprintf(buffer, buffer_len - 1, "%lf", edge->geometry_target_point->y);
+		snprintf(buffer, buffer_len - 1, "%lf", edge_geometry->target_point->y);
 		XML_WRITE_ATTR(writer, GRAPHML_YED_GEOM_TARGET_Y_ATTRIBUTE, buffer);
 	} else {
 		XML_WRITE_ATTR(writer, GRAPHML_YED_GEOM_SOURCE_X_ATTRIBUTE, "0");
@@ -3322,7 +3939,8 @@ static int cyberiada_write_edge_yed(xmlTextWriterPtr writer, CyberiadaEdge* edge
 	return CYBERIADA_NO_ERROR;	
 }
 
-static int cyberiada_write_sm_document_yed(CyberiadaDocument* doc, xmlTextWriterPtr writer)
+static int cyberiada_write_sm_document_yed(CyberiadaDocument* doc, const CyberiadaGeometryTable* geometry,
+										   xmlTextWriterPtr writer)
 {
 	size_t i;
 	int res;
@@ -3375,7 +3993,7 @@ static int cyberiada_write_sm_document_yed(CyberiadaDocument* doc, xmlTextWriter
 
 	/* write nodes */
 	for (cur_node = sm->nodes; cur_node; cur_node = cur_node->next) {
-		res = cyberiada_write_node_yed(writer, cur_node, 2);
+		res = cyberiada_write_node_yed(writer, cur_node, geometry, 2);
 		if (res != CYBERIADA_NO_ERROR) {
 			ERROR("error while writing node %s\n", cur_node->id);
 			return CYBERIADA_XML_ERROR;
@@ -3384,7 +4002,7 @@ static int cyberiada_write_sm_document_yed(CyberiadaDocument* doc, xmlTextWriter
 		
 	/* write edges */
 	for (cur_edge = sm->edges; cur_edge; cur_edge = cur_edge->next) {
-		res = cyberiada_write_edge_yed(writer, cur_edge, 2);
+		res = cyberiada_write_edge_yed(writer, cur_edge, geometry, 2);
 		if (res != CYBERIADA_NO_ERROR) {
 			ERROR("error while writing edge %s\n", cur_edge->id);
 			return CYBERIADA_XML_ERROR;
@@ -3401,11 +4019,30 @@ static int cyberiada_write_sm_document_yed(CyberiadaDocument* doc, xmlTextWriter
  * GraphML writer interface
  * ----------------------------------------------------------------------------- */
 
+static void cyberiada_init_encode_options(CyberiadaEncodeOptions* options, int flags)
+{
+	memset(options, 0, sizeof(CyberiadaEncodeOptions));
+	options->flags = flags;
+	options->simplify_tolerance = CYBERIADA_SIMPLIFY_DEFAULT_TOLERANCE;
+	options->simplify_grid = CYBERIADA_SIMPLIFY_DEFAULT_GRID;
+}
+
 static int cyberiada_process_encode_sm_document(CyberiadaDocument* doc, xmlTextWriterPtr writer,
-												CyberiadaXMLFormat format, int flags)
+												CyberiadaXMLFormat format, const CyberiadaEncodeOptions* options)
 {
-	CyberiadaDocument* copy_doc = NULL;
-	int res;
+	CyberiadaGeometryTable* geometry = NULL;
+	int res, flags;
+
+	if (!options) {
+		ERROR("error: no encode options\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	flags = options->flags;
+
+	if (options->simplify_tolerance < 0.0 || options->simplify_grid < 0.0) {
+		ERROR("Bad geometry simplification tolerance or grid\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
 
 	if (flags & (CYBERIADA_FLAG_RECONSTRUCT_GEOMETRY | CYBERIADA_FLAG_RECONSTRUCT_SM_GEOMETRY)) {
 		ERROR("Geometry reconstructioin flag is not supported on export\n");
@@ -3443,6 +4080,13 @@ static int cyberiada_process_encode_sm_document(CyberiadaDocument* doc, xmlTextW
 		return CYBERIADA_BAD_PARAMETER;
 	}
 
+	/* the lazy actions text is decoded (and validated) for the write only, the document */
+	/* keeps the raw text                                                                  */
+	if ((res = cyberiada_attach_lazy_actions(doc)) != CYBERIADA_NO_ERROR) {
+		ERROR("error while decoding the document actions\n");
+		return res;
+	}
+
 	res = cyberiada_check_graphs(doc,
 								 flags & CYBERIADA_FLAG_SKIP_GEOMETRY,
 								 flags & CYBERIADA_FLAG_CHECK_INITIAL,
@@ -3450,6 +4094,7 @@ static int cyberiada_process_encode_sm_document(CyberiadaDocument* doc, xmlTextW
 								 flags & CYBERIADA_FLAG_SKIP_EMPTY_BEHAVIOR);
 	if (res != CYBERIADA_NO_ERROR) {
 		ERROR("error while checking graphs\n");
+		cyberiada_detach_lazy_actions(doc);
 		return res;
 	}
 
@@ -3461,20 +4106,22 @@ static int cyberiada_process_encode_sm_document(CyberiadaDocument* doc, xmlTextW
 			break;
 		}
 
-		copy_doc = cyberiada_copy_sm_document(doc);
-
-		if (flags & CYBERIADA_FLAG_SKIP_GEOMETRY) {
-			cyberiada_clean_document_geometry(copy_doc);
-		} else {
-			cyberiada_export_document_geometry(copy_doc, flags, format);
+		/* the document is written as is while the converted geometry is kept aside */
+		geometry = cyberiada_new_export_geometry_table(doc, flags, format,
+													   options->simplify_tolerance,
+													   options->simplify_grid);
+		if (!geometry) {
+			ERROR("error while converting document geometry\n");
+			res = CYBERIADA_BAD_PARAMETER;
+			break;
 		}
 		
 		if (format == cybxmlYED) {
-			res = cyberiada_write_sm_document_yed(copy_doc, writer);
+			res = cyberiada_write_sm_document_yed(doc, geometry, writer);
 		} else if (format == cybxmlCyberiada10) {
-			res = cyberiada_write_sm_document_cyberiada(copy_doc, writer);
+			res = cyberiada_write_sm_document_cyberiada(doc, geometry, writer);
 		}
-		cyberiada_destroy_sm_document(copy_doc);
+		cyberiada_destroy_geometry_table(geometry);
 
 		if (res != CYBERIADA_NO_ERROR) {
 			ERROR("error writing xml %d\n", res);
@@ -3491,6 +4138,8 @@ static int cyberiada_process_encode_sm_document(CyberiadaDocument* doc, xmlTextW
 
 		res = CYBERIADA_NO_ERROR;
 	} while (0);
+
+	cyberiada_detach_lazy_actions(doc);
 	
 	if (res != CYBERIADA_NO_ERROR) {
 		return res;
@@ -3501,6 +4150,14 @@ static int cyberiada_process_encode_sm_document(CyberiadaDocument* doc, xmlTextW
 
 int cyberiada_write_sm_document(CyberiadaDocument* doc, const char* filename,
 								CyberiadaXMLFormat format, int flags)
+{
+	CyberiadaEncodeOptions options;
+	cyberiada_init_encode_options(&options, flags);
+	return cyberiada_write_sm_document_with_options(doc, filename, format, &options);
+}
+
+int cyberiada_write_sm_document_with_options(CyberiadaDocument* doc, const char* filename,
+											 CyberiadaXMLFormat format, CyberiadaEncodeOptions* options)
 {
 	int res;
 	xmlTextWriterPtr writer = NULL;	
@@ -3512,7 +4169,7 @@ int cyberiada_write_sm_document(CyberiadaDocument* doc, const char* filename,
 		return CYBERIADA_XML_ERROR;
 	}
 
-	res = cyberiada_process_encode_sm_document(doc, writer, format, flags);
+	res = cyberiada_process_encode_sm_document(doc, writer, format, options);
 	
 	xmlFreeTextWriter(writer);
 	xmlCleanupParser();
@@ -3522,11 +4179,26 @@ int cyberiada_write_sm_document(CyberiadaDocument* doc, const char* filename,
 
 int cyberiada_encode_sm_document(CyberiadaDocument* doc, char** buffer, size_t* buffer_size,
 								 CyberiadaXMLFormat format, int flags)
+{
+	CyberiadaEncodeOptions options;
+	cyberiada_init_encode_options(&options, flags);
+	return cyberiada_encode_sm_document_with_options(doc, buffer, buffer_size, format, &options);
+}
+
+static int cyberiada_encode_sm_document_to_buffer(CyberiadaDocument* doc, char** buffer, size_t* buffer_size,
+												  CyberiadaXMLFormat format, CyberiadaEncodeOptions* options,
+												  int detach)
 {
 	int res;
 	xmlBufferPtr xml_buffer;
 	xmlTextWriterPtr writer = NULL;	
 
+	if (!buffer || !buffer_size) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	*buffer = NULL;
+	*buffer_size = 0;
+	
 	xmlInitParser();
 	xml_buffer = xmlBufferCreate();
 	if (!xml_buffer) {
@@ -3542,26 +4214,104 @@ int cyberiada_encode_sm_document(CyberiadaDocument* doc, char** buffer, size_t*
 		return CYBERIADA_XML_ERROR;
 	}
 
- 	res = cyberiada_process_encode_sm_document(doc, writer, format, flags);
+ 	res = cyberiada_process_encode_sm_document(doc, writer, format, options);
+	xmlFreeTextWriter(writer);
 
 	if (res == CYBERIADA_NO_ERROR) {
-		size_t size = xml_buffer->use;
-		*buffer = (char*)malloc(size + 1);
+		size_t size = (size_t)xmlBufferLength(xml_buffer);
+		if (detach) {
+			/* hand over the writer buffer content to the caller */
+			*buffer = (char*)xmlBufferDetach(xml_buffer);
+		} else {
+			*buffer = (char*)malloc(size + 1);
+			if (*buffer) {
+				memcpy(*buffer, xmlBufferContent(xml_buffer), size);
+				(*buffer)[size] = 0;
+			}
+		}
 		if (*buffer) {
-			memcpy(*buffer, xml_buffer->content, size);
-			(*buffer)[size] = 0;
 			*buffer_size = size;
 		} else {
 			res = CYBERIADA_MEMORY_ERROR;
 		}
-	} else {
-		*buffer = NULL;
-		*buffer_size = 0;
 	}
 	
-	xmlFreeTextWriter(writer);
 	xmlBufferFree(xml_buffer);
 	xmlCleanupParser();
 
 	return res;
 }
+
+int cyberiada_encode_sm_document_with_options(CyberiadaDocument* doc, char** buffer, size_t* buffer_size,
+											  CyberiadaXMLFormat format, CyberiadaEncodeOptions* options)
+{
+	return cyberiada_encode_sm_document_to_buffer(doc, buffer, buffer_size, format, options, 0);
+}
+
+int cyberiada_encode_sm_document_nocopy(CyberiadaDocument* doc, char** buffer, size_t* buffer_size,
+										CyberiadaXMLFormat format, CyberiadaEncodeOptions* options)
+{
+	return cyberiada_encode_sm_document_to_buffer(doc, buffer, buffer_size, format, options, 1);
+}
+
+static int cyberiada_encode_sm_document_output(CyberiadaDocument* doc, xmlOutputBufferPtr output,
+											   CyberiadaXMLFormat format, int flags)
+{
+	int res;
+	xmlTextWriterPtr writer = NULL;
+	CyberiadaEncodeOptions options;
+
+	if (!output) {
+		ERROR("cannot create xml output buffer\n");
+		return CYBERIADA_XML_ERROR;
+	}
+	/* the writer owns the output buffer since now */
+	writer = xmlNewTextWriter(output);
+	if (!writer) {
+		ERROR("cannot create output writter\n");
+		xmlOutputBufferClose(output);
+		return CYBERIADA_XML_ERROR;
+	}
+
+	cyberiada_init_encode_options(&options, flags);
+	res = cyberiada_process_encode_sm_document(doc, writer, format, &options);
+	
+	xmlFreeTextWriter(writer);
+
+	return res;
+}
+
+int cyberiada_stream_sm_document(CyberiadaDocument* doc, CyberiadaWriteCallback write_callback, void* context,
+								 CyberiadaXMLFormat format, int flags)
+{
+	int res;
+	
+	if (!write_callback) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	
+	xmlInitParser();
+	res = cyberiada_encode_sm_document_output(doc,
+											  xmlOutputBufferCreateIO(write_callback, NULL, context, NULL),
+											  format, flags);
+	xmlCleanupParser();
+
+	return res;
+}
+
+int cyberiada_write_sm_document_fd(CyberiadaDocument* doc, int fd, CyberiadaXMLFormat format, int flags)
+{
+	int res;
+	
+	if (fd < 0) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	xmlInitParser();
+	res = cyberiada_encode_sm_document_output(doc,
+											  xmlOutputBufferCreateFd(fd, NULL),
+											  format, flags);
+	xmlCleanupParser();
+
+	return res;
+}
@@ -148,6 +148,8 @@ typedef struct _CyberiadaNode {
     struct _CyberiadaNode*      children;
 	/* siblings */
     struct _CyberiadaNode*      next;
+	/* lazy decoding (appended to keep the layout of the fields above) */
+	struct _CyberiadaRawAction* raw_actions;            /* the actions text not decoded yet (see CYBERIADA_FLAG_LAZY_ACTIONS) */
 } CyberiadaNode;
 	
 typedef struct {                                        /* the pair of nodes */
@@ -208,6 +210,8 @@ typedef struct _CyberiadaEdge {
     size_t                       color_len;
 	/* list of edges */
     struct _CyberiadaEdge*       next;                  /* the next edge in the SM */
+	/* lazy decoding (appended to keep the layout of the fields above) */
+	struct _CyberiadaRawAction*  raw_action;            /* the action text not decoded yet (see CYBERIADA_FLAG_LAZY_ACTIONS) */
 } CyberiadaEdge;
 
 typedef struct {                                        /* the pair of nodes */
@@ -220,6 +224,10 @@ typedef struct _CyberiadaSM {
     CyberiadaNode*               nodes;                 /* the tree of nodes (starting from the SM roots) */
     CyberiadaEdge*               edges;                 /* the list of edges */
     struct _CyberiadaSM*         next;                  /* the next SM in the document */
+	struct _CyberiadaAbsoluteCache* absolute_cache;     /* the cached absolute nodes geometry (NULL if not built) */
+	struct _CyberiadaAdjacency*  adjacency;             /* the nodes incoming/outgoing edges index (NULL if not built) */
+	struct _CyberiadaHierarchy*  hierarchy;             /* the nodes depth/ancestor/LCA index (NULL if not built) */
+	struct _CyberiadaOrdinals*   ordinals;              /* the dense nodes & edges numbers (NULL if not built) */
 } CyberiadaSM;
 
 /* SM mandatory metainformation constants */
@@ -283,6 +291,124 @@ typedef enum {
     cybxmlYED = 1,                                         /* Old YED-based Berloga/Ostranna format */
     cybxmlUnknown = 99                                     /* Format is not specified */
 } CyberiadaXMLFormat;
+
+/* Cyberiada GraphML Library decoding categories to skip */
+#define CYBERIADA_DECODE_SKIP_COMMENTS                    0x01 /* the informal comment nodes */
+#define CYBERIADA_DECODE_SKIP_FORMAL_COMMENTS             0x02 /* the formal comment nodes (except the meta node) */
+#define CYBERIADA_DECODE_SKIP_COMMENT_EDGES               0x04 /* the comment subject edges */
+#define CYBERIADA_DECODE_SKIP_ACTIONS                     0x08 /* the node & edge actions */
+#define CYBERIADA_DECODE_SKIP_GEOMETRY                    0x10 /* the geometry (implies CYBERIADA_FLAG_SKIP_GEOMETRY) */
+#define CYBERIADA_DECODE_SKIP_META                        0x20 /* the meta node (implies CYBERIADA_FLAG_SKIP_META) */
+
+/* Cyberiada GraphML Library decoding options */
+typedef struct {
+	int                              flags;                /* the import flags (CYBERIADA_FLAG_*) */
+	const CyberiadaRect*             viewport;             /* store the nodes geometry intersecting the viewport only */
+	                                                       /* (in the file absolute coordinates); NULL to store all */
+	size_t                           clipped_nodes;        /* output: the number of the node geometry objects skipped */
+	size_t                           clipped_edges;        /* output: the number of the edges with the geometry skipped */
+	int                              skip;                 /* the categories not decoded (CYBERIADA_DECODE_SKIP_*) */
+	size_t                           skipped_nodes;        /* output: the number of the nodes skipped */
+	size_t                           skipped_edges;        /* output: the number of the edges skipped */
+} CyberiadaDecodeOptions;
+
+/* Cyberiada GraphML Library encoding options */
+typedef struct {
+	int                              flags;                /* the export flags (CYBERIADA_FLAG_*) */
+	double                           simplify_tolerance;   /* the polyline simplification tolerance and the coordinates */
+	double                           simplify_grid;        /* quantization grid used with CYBERIADA_FLAG_SIMPLIFY_GEOMETRY; */
+	                                                       /* zero disables the corresponding step */
+} CyberiadaEncodeOptions;
+
+/* Cyberiada GraphML Library output sink callback used by the streaming encoder: */
+/* write len bytes from the buffer and return the number of bytes written or -1 on error */
+typedef int (*CyberiadaWriteCallback)(void* context, const char* buffer, int len);
+
+/* Cyberiada GraphML Library frozen (flat, read-only) document snapshot records */
+/* The records are accessed via the cyberiada_frozen_* functions only */
+typedef struct _CyberiadaFrozenDocument   CyberiadaFrozenDocument;
+typedef struct _CyberiadaFrozenMetaString CyberiadaFrozenMetaString;
+typedef struct _CyberiadaFrozenSM         CyberiadaFrozenSM;
+typedef struct _CyberiadaFrozenNode       CyberiadaFrozenNode;
+typedef struct _CyberiadaFrozenEdge       CyberiadaFrozenEdge;
+typedef struct _CyberiadaFrozenAction     CyberiadaFrozenAction;
+
+/* Cyberiada GraphML Library spatial index (R-tree) over the document geometry */
+typedef struct _CyberiadaSpatialIndex     CyberiadaSpatialIndex;
+
+/* Cyberiada GraphML Library geometry lint issues */
+typedef enum {
+	cybGeomIssueBadKind = 0,                               /* point geometry of a rect node or vice versa */
+	cybGeomIssueZeroSize = 1,                              /* rect with zero (or negative) width or height */
+	cybGeomIssueOutsideParent = 2,                         /* node is not contained in the parent rect */
+	cybGeomIssueOverlap = 3,                               /* sibling nodes overlap */
+	cybGeomIssueEndpointOffBorder = 4,                     /* edge source/target point is off the node border */
+	cybGeomIssueDanglingPolyline = 5                       /* edge polyline with no source/target node geometry */
+} CyberiadaGeometryIssueType;
+
+typedef struct {
+	CyberiadaGeometryIssueType  type;
+	CyberiadaNode*              node;                      /* the node (the edge end for endpoint issues) */
+	CyberiadaNode*              other_node;                /* the parent or the overlapping sibling */
+	CyberiadaEdge*              edge;                      /* the edge for the edge issues */
+} CyberiadaGeometryIssue;
+
+/* Cyberiada GraphML Library packed (structure of arrays) SM geometry store */
+typedef struct _CyberiadaGeometryStore    CyberiadaGeometryStore;
+
+/* Cyberiada GraphML Library SM builder (constant time appending) */
+typedef struct _CyberiadaSMBuilder        CyberiadaSMBuilder;
+
+/* Cyberiada GraphML Library SM editor (indexed structural modifications) */
+typedef struct _CyberiadaSMEditor         CyberiadaSMEditor;
+
+/* Cyberiada GraphML Library shared document (reference counted copy-on-write document handle) */
+typedef struct _CyberiadaSharedDocument   CyberiadaSharedDocument;
+
+/* Cyberiada GraphML Library SM graph analysis results (the arrays refer to the SM nodes) */
+typedef struct {
+	CyberiadaNode*              initial;                   /* the top-level initial pseudostate (NULL if absent) */
+	CyberiadaNode**             unreachable;               /* the nodes unreachable from the initial pseudostate */
+	size_t                      unreachable_count;
+	CyberiadaNode**             unreachable_composites;    /* the topmost unreachable composite states & regions */
+	size_t                      unreachable_composites_count;
+	CyberiadaNode**             dead;                      /* the non-final leaf nodes without (inherited) transitions */
+	size_t                      dead_count;
+	CyberiadaNode**             scc_nodes;                 /* the nodes of the non-trivial strongly connected */
+	size_t*                     scc_offsets;               /* components: the component i is the scc_nodes range */
+	size_t                      scc_count;                 /* [scc_offsets[i], scc_offsets[i + 1])              */
+} CyberiadaSMAnalysis;
+
+/* Cyberiada GraphML Library flat transition table row (the strings refer to the document) */
+#define CYBERIADA_FLAT_NO_STATE                           ((size_t)-1)
+typedef struct {
+	size_t                      state;                     /* the source leaf state index */
+	size_t                      event;                     /* the event id (the empty event for completion) */
+	const char*                 guard;                     /* the guard or NULL */
+	size_t                      target;                    /* the target leaf state index or CYBERIADA_FLAT_NO_STATE */
+	CyberiadaNode*              target_node;               /* the target node (the leaf state or the pseudostate) */
+	const CyberiadaEdge*        edge;                      /* the SM edge (NULL for the internal transitions) */
+	int                         internal;                  /* the internal transition: no exit & entry */
+	size_t                      actions_offset;            /* the action sequence: the table actions range */
+	size_t                      actions_count;             /* [actions_offset, actions_offset + actions_count) */
+} CyberiadaFlatTransition;
+
+/* Cyberiada GraphML Library flat transition table (the rows of the state i are the transitions range */
+/* [state_offsets[i], state_offsets[i + 1]), the inner state transitions go first)                   */
+typedef struct {
+	CyberiadaNode**             states;                    /* the leaf states in pre-order */
+	size_t                      states_count;
+	size_t*                     state_offsets;             /* states_count + 1 items */
+	const char**                events;                    /* the interned event names */
+	size_t                      events_count;
+	CyberiadaFlatTransition*    transitions;
+	size_t                      transitions_count;
+	const char**                actions;                   /* the action behaviors of all sequences */
+	size_t                      actions_count;
+	size_t                      initial_state;             /* the initial leaf state or CYBERIADA_FLAT_NO_STATE */
+	size_t                      initial_actions_offset;    /* the initial action sequence */
+	size_t                      initial_actions_count;
+} CyberiadaFlatTable;
 	
 /* Cyberiada GraphML Library import/export flags */
 #define CYBERIADA_FLAG_NO                                 0
@@ -324,9 +450,17 @@ typedef enum {
 #define CYBERIADA_FLAG_SKIP_GEOMETRY                      0x4000 /* skip geometry node/edge during import/export */
 #define CYBERIADA_FLAG_SHRINK_GEOMETRY                    0x8000 /* shrink geometry node/edge during import/export */
 #define CYBERIADA_FLAG_ROUND_GEOMETRY                     0x10000 /* export geometry with round coordinates to 0.001 */
+#define CYBERIADA_FLAG_COLLAPSED_GEOMETRY                 0x800000 /* convert the collapsed nodes own geometry only, skip the geometry inside */
+#define CYBERIADA_FLAG_SIMPLIFY_GEOMETRY                  0x1000000 /* export simplified polylines & coordinates quantized to the grid */
 #define CYBERIADA_FLAG_EXPORT_GEOMETRY                    (CYBERIADA_FLAG_SKIP_GEOMETRY | \
 														   CYBERIADA_FLAG_SHRINK_GEOMETRY | \
-														   CYBERIADA_FLAG_ROUND_GEOMETRY)
+														   CYBERIADA_FLAG_ROUND_GEOMETRY | \
+														   CYBERIADA_FLAG_COLLAPSED_GEOMETRY | \
+														   CYBERIADA_FLAG_SIMPLIFY_GEOMETRY)
+
+/* The polyline simplification tolerance & quantization grid for CYBERIADA_FLAG_SIMPLIFY_GEOMETRY w/o the encoding options */
+#define CYBERIADA_SIMPLIFY_DEFAULT_TOLERANCE              1.0
+#define CYBERIADA_SIMPLIFY_DEFAULT_GRID                   0.5
 
 #define CYBERIADA_FLAG_FLATTENED                          0x20000 /* the document is flattened  */
 #define CYBERIADA_FLAG_CHECK_INITIAL                      0x40000 /* check initial state on the top level  */
@@ -334,12 +468,17 @@ typedef enum {
 #define CYBERIADA_FLAG_SKIP_EMPTY_BEHAVIOR                0x100000 /* skip empty behaviour in actions  */
 #define CYBERIADA_FLAG_SIMPLIFY_IDS                       0x200000 /* simplify node/edge identifiers  */
 #define CYBERIADA_FLAG_SKIP_META                          0x400000 /* skip meta-information and format from graphml */
+#define CYBERIADA_FLAG_PARALLEL_GEOMETRY                  0x2000000 /* import the geometry of each SM in a separate thread */
+#define CYBERIADA_FLAG_BUILD_ADJACENCY                    0x4000000 /* build the SM adjacency index after import */
+#define CYBERIADA_FLAG_LAZY_ACTIONS                       0x8000000 /* keep the actions text & decode it on the first access */
 #define CYBERIADA_FLAG_NON_GEOMETRY                       (CYBERIADA_FLAG_FLATTENED | \
 														   CYBERIADA_FLAG_CHECK_INITIAL | \
 														   CYBERIADA_FLAG_STRICT_ACTION_ENTRIES | \
 														   CYBERIADA_FLAG_SKIP_EMPTY_BEHAVIOR | \
 														   CYBERIADA_FLAG_SIMPLIFY_IDS | \
-														   CYBERIADA_FLAG_SKIP_META)
+														   CYBERIADA_FLAG_SKIP_META | \
+														   CYBERIADA_FLAG_BUILD_ADJACENCY | \
+														   CYBERIADA_FLAG_LAZY_ACTIONS)
 
 /* -----------------------------------------------------------------------------
  * The Cyberiada isomorphism check codes
@@ -402,8 +541,48 @@ typedef enum {
 	/* Do not use the structure before the initialization! */
     int cyberiada_init_sm_document(CyberiadaDocument* doc);
 
+	/* Get the node/edge actions decoding the actions text kept by CYBERIADA_FLAG_LAZY_ACTIONS on the */
+	/* first access; the decoding errors are returned here. The plain node/edge actions are returned */
+	/* as is. The action regexps are compiled once and shared by the raw actions of the document;     */
+	/* use cyberiada_decode_document_actions to decode all the actions at once                        */
+	int cyberiada_node_get_actions(CyberiadaNode* node, CyberiadaAction** actions);
+	int cyberiada_edge_get_action(CyberiadaEdge* edge, CyberiadaAction** action);
+
+	/* Decode (validate) all the actions text kept by CYBERIADA_FLAG_LAZY_ACTIONS in the SM/document; */
+	/* the first decoding error is returned, the text of the wrong actions is kept. The exporters     */
+	/* (write/encode, binary encode, freeze) decode the actions text for the output only and leave the */
+	/* document actions text as is                                                                     */
+	int cyberiada_decode_sm_actions(CyberiadaSM* sm);
+	int cyberiada_decode_document_actions(CyberiadaDocument* doc);
+
     /* Deep copy the SM structure */
     CyberiadaDocument* cyberiada_copy_sm_document(CyberiadaDocument* source_doc);
+
+	/* Create the shared document handle; the handle takes the ownership of the document.          */
+	/* The handles save the document copies only while the document is not changed: the first write */
+	/* access through a shared handle deep copies the whole document (there is no structural sharing */
+	/* of the unchanged SMs, subtrees, actions or strings between the old and the new documents, so  */
+	/* every changed copy costs a full document). The reference counter is not atomic: the handles   */
+	/* sharing the document should not be copied, written or freed concurrently without external    */
+	/* locking                                                                                       */
+	int cyberiada_new_shared_document(CyberiadaDocument* doc, CyberiadaSharedDocument** shared);
+
+	/* Copy the shared document handle in O(1): the copies share the document until the write access */
+	int cyberiada_shared_document_copy(CyberiadaSharedDocument* shared, CyberiadaSharedDocument** copy);
+
+	/* Get the document for reading; the document should not be modified since it can be shared */
+	CyberiadaDocument* cyberiada_shared_document_read(CyberiadaSharedDocument* shared);
+
+	/* Get the document for writing: the document shared with other handles is deep copied first   */
+	/* (O(document size)), so the pointers got from the handle before are not valid for the returned */
+	/* document                                                                                      */
+	int cyberiada_shared_document_write(CyberiadaSharedDocument* shared, CyberiadaDocument** doc);
+
+	/* Get the number of handles sharing the document */
+	int cyberiada_shared_document_refs(CyberiadaSharedDocument* shared, size_t* refs);
+
+	/* Free the handle; the document is freed with the last handle */
+	int cyberiada_destroy_shared_document(CyberiadaSharedDocument* shared);
 	
     /* Cleanup the content of the SM structure */
 	/* Free the allocated memory of the structure content but not the structure itself */
@@ -416,17 +595,357 @@ typedef enum {
     /* Allocate the SM document structure first */
     int cyberiada_read_sm_document(CyberiadaDocument* doc, const char* filename, CyberiadaXMLFormat format, int flags);
 
+    /* Read an XML file and decode the SM structure using the decoding options */
+	/* The nodes geometry wholly outside the viewport and the geometry of their descendants is skipped, */
+	/* as well as the geometry of the edges between the skipped nodes; the SM structure is complete     */
+	/* The skipped categories are not allocated and their XML subtrees are not walked; the edges of the */
+	/* skipped nodes are skipped too                                                                    */
+    int cyberiada_read_sm_document_with_options(CyberiadaDocument* doc, const char* filename,
+												CyberiadaXMLFormat format, CyberiadaDecodeOptions* options);
+
     /* Encode the SM document structure and write the data to an XML file */
     int cyberiada_write_sm_document(CyberiadaDocument* doc, const char* filename, CyberiadaXMLFormat format, int flags);
 
+    /* Encode the SM document structure and write the data to an XML file using the encoding options */
+	/* The simplified polylines keep the edge source & target points as their fixed ends              */
+    int cyberiada_write_sm_document_with_options(CyberiadaDocument* doc, const char* filename,
+												 CyberiadaXMLFormat format, CyberiadaEncodeOptions* options);
+
     /* Decode the SM structure */
     /* Allocate the SM document structure first */
     int cyberiada_decode_sm_document(CyberiadaDocument* doc, const char* buffer, size_t buffer_size,
 									 CyberiadaXMLFormat format, int flags);
 
+    /* Decode the SM structure using the decoding options (see cyberiada_read_sm_document_with_options) */
+    int cyberiada_decode_sm_document_with_options(CyberiadaDocument* doc, const char* buffer, size_t buffer_size,
+												  CyberiadaXMLFormat format, CyberiadaDecodeOptions* options);
+
     /* Encode the SM document structure */
+	/* The result buffer is allocated by the library, free it using free() */
     int cyberiada_encode_sm_document(CyberiadaDocument* doc, char** buffer, size_t* buffer_size,
 									 CyberiadaXMLFormat format, int flags);
+
+    /* Encode the SM document structure using the encoding options (see cyberiada_write_sm_document_with_options) */
+    int cyberiada_encode_sm_document_with_options(CyberiadaDocument* doc, char** buffer, size_t* buffer_size,
+												  CyberiadaXMLFormat format, CyberiadaEncodeOptions* options);
+
+    /* Encode the SM document structure without the copy of the result (see cyberiada_encode_sm_document_with_options) */
+	/* The result buffer is allocated by libxml2 (xmlMalloc) and handed over to the caller, free it using */
+	/* xmlFree() since libxml2 may use a custom allocator                                                 */
+    int cyberiada_encode_sm_document_nocopy(CyberiadaDocument* doc, char** buffer, size_t* buffer_size,
+											CyberiadaXMLFormat format, CyberiadaEncodeOptions* options);
+
+    /* Encode the SM document structure and stream the data to the callback sink */
+	/* The data is passed to the callback in chunks while the document is being encoded */
+    int cyberiada_stream_sm_document(CyberiadaDocument* doc, CyberiadaWriteCallback write_callback, void* context,
+									 CyberiadaXMLFormat format, int flags);
+
+    /* Encode the SM document structure and write the data to the open file descriptor */
+	/* The file descriptor is not closed */
+    int cyberiada_write_sm_document_fd(CyberiadaDocument* doc, int fd, CyberiadaXMLFormat format, int flags);
+
+    /* Encode the SM document structure to the compact binary format (for caching and IPC) */
+	/* The result buffer is allocated by the library, free it using free() */
+    int cyberiada_encode_sm_document_binary(CyberiadaDocument* doc, char** buffer, size_t* buffer_size);
+
+    /* Decode the SM structure from the compact binary format */
+    /* Allocate the SM document structure first */
+    int cyberiada_decode_sm_document_binary(CyberiadaDocument* doc, const char* buffer, size_t buffer_size);
+
+    /* Convert the SM document structure to the frozen snapshot: a single pointer-free buffer */
+	/* that can be written to a file and mmaped read-only at any address. The snapshot uses */
+	/* the host byte order. The result buffer is allocated by the library, free it using free() */
+    int cyberiada_freeze_sm_document(CyberiadaDocument* doc, char** buffer, size_t* buffer_size);
+
+    /* Validate the frozen snapshot buffer (8-byte aligned, e.g. mmaped) and get the document record */
+	/* The buffer is not copied and should be available while the snapshot is in use */
+    int cyberiada_open_frozen_sm_document(const char* buffer, size_t buffer_size, const CyberiadaFrozenDocument** frozen);
+
+    /* Convert the frozen snapshot to the mutable SM document structure */
+    /* Allocate the SM document structure first */
+    int cyberiada_thaw_sm_document(CyberiadaDocument* doc, const CyberiadaFrozenDocument* frozen);
+
+	/* The frozen snapshot accessors mirror the fields of the SM document structures */
+	const char*                       cyberiada_frozen_document_format(const CyberiadaFrozenDocument* doc);
+	CyberiadaGeometryFormat           cyberiada_frozen_document_geometry_format(const CyberiadaFrozenDocument* doc);
+	CyberiadaGeometryCoordFormat      cyberiada_frozen_document_node_coord_format(const CyberiadaFrozenDocument* doc);
+	CyberiadaGeometryCoordFormat      cyberiada_frozen_document_edge_coord_format(const CyberiadaFrozenDocument* doc);
+	CyberiadaGeometryCoordFormat      cyberiada_frozen_document_edge_pl_coord_format(const CyberiadaFrozenDocument* doc);
+	CyberiadaGeometryEdgeFormat       cyberiada_frozen_document_edge_geom_format(const CyberiadaFrozenDocument* doc);
+	const CyberiadaRect*              cyberiada_frozen_document_bounding_rect(const CyberiadaFrozenDocument* doc);
+	int                               cyberiada_frozen_document_has_meta(const CyberiadaFrozenDocument* doc);
+	const char*                       cyberiada_frozen_document_standard_version(const CyberiadaFrozenDocument* doc);
+	char                              cyberiada_frozen_document_transition_order_flag(const CyberiadaFrozenDocument* doc);
+	char                              cyberiada_frozen_document_event_propagation_flag(const CyberiadaFrozenDocument* doc);
+	const CyberiadaFrozenMetaString*  cyberiada_frozen_document_meta_strings(const CyberiadaFrozenDocument* doc);
+	const char*                       cyberiada_frozen_meta_string_name(const CyberiadaFrozenMetaString* ms);
+	const char*                       cyberiada_frozen_meta_string_value(const CyberiadaFrozenMetaString* ms);
+	const CyberiadaFrozenMetaString*  cyberiada_frozen_meta_string_next(const CyberiadaFrozenMetaString* ms);
+	const CyberiadaFrozenSM*          cyberiada_frozen_document_sms(const CyberiadaFrozenDocument* doc);
+	const CyberiadaFrozenNode*        cyberiada_frozen_sm_nodes(const CyberiadaFrozenSM* sm);
+	const CyberiadaFrozenEdge*        cyberiada_frozen_sm_edges(const CyberiadaFrozenSM* sm);
+	const CyberiadaFrozenSM*          cyberiada_frozen_sm_next(const CyberiadaFrozenSM* sm);
+	CyberiadaNodeType                 cyberiada_frozen_node_type(const CyberiadaFrozenNode* node);
+	const char*                       cyberiada_frozen_node_id(const CyberiadaFrozenNode* node);
+	const char*                       cyberiada_frozen_node_title(const CyberiadaFrozenNode* node);
+	const char*                       cyberiada_frozen_node_formal_title(const CyberiadaFrozenNode* node);
+	const CyberiadaFrozenAction*      cyberiada_frozen_node_actions(const CyberiadaFrozenNode* node);
+	int                               cyberiada_frozen_node_has_comment_data(const CyberiadaFrozenNode* node);
+	const char*                       cyberiada_frozen_node_comment_body(const CyberiadaFrozenNode* node);
+	const char*                       cyberiada_frozen_node_comment_markup(const CyberiadaFrozenNode* node);
+	int                               cyberiada_frozen_node_has_link(const CyberiadaFrozenNode* node);
+	const char*                       cyberiada_frozen_node_link_ref(const CyberiadaFrozenNode* node);
+	const CyberiadaPoint*             cyberiada_frozen_node_geometry_point(const CyberiadaFrozenNode* node);
+	const CyberiadaRect*              cyberiada_frozen_node_geometry_rect(const CyberiadaFrozenNode* node);
+	char                              cyberiada_frozen_node_collapsed_flag(const CyberiadaFrozenNode* node);
+	const char*                       cyberiada_frozen_node_color(const CyberiadaFrozenNode* node);
+	const CyberiadaFrozenNode*        cyberiada_frozen_node_parent(const CyberiadaFrozenNode* node);
+	const CyberiadaFrozenNode*        cyberiada_frozen_node_children(const CyberiadaFrozenNode* node);
+	const CyberiadaFrozenNode*        cyberiada_frozen_node_next(const CyberiadaFrozenNode* node);
+	CyberiadaEdgeType                 cyberiada_frozen_edge_type(const CyberiadaFrozenEdge* edge);
+	const char*                       cyberiada_frozen_edge_id(const CyberiadaFrozenEdge* edge);
+	const char*                       cyberiada_frozen_edge_source_id(const CyberiadaFrozenEdge* edge);
+	const char*                       cyberiada_frozen_edge_target_id(const CyberiadaFrozenEdge* edge);
+	const CyberiadaFrozenNode*        cyberiada_frozen_edge_source(const CyberiadaFrozenEdge* edge);
+	const CyberiadaFrozenNode*        cyberiada_frozen_edge_target(const CyberiadaFrozenEdge* edge);
+	const CyberiadaFrozenAction*      cyberiada_frozen_edge_action(const CyberiadaFrozenEdge* edge);
+	int                               cyberiada_frozen_edge_has_comment_subject(const CyberiadaFrozenEdge* edge);
+	CyberiadaCommentSubjectType       cyberiada_frozen_edge_comment_subject_type(const CyberiadaFrozenEdge* edge);
+	const char*                       cyberiada_frozen_edge_comment_subject_fragment(const CyberiadaFrozenEdge* edge);
+	const CyberiadaPoint*             cyberiada_frozen_edge_geometry_label_point(const CyberiadaFrozenEdge* edge);
+	const CyberiadaRect*              cyberiada_frozen_edge_geometry_label_rect(const CyberiadaFrozenEdge* edge);
+	const CyberiadaPoint*             cyberiada_frozen_edge_geometry_polyline(const CyberiadaFrozenEdge* edge, size_t* count);
+	const CyberiadaPoint*             cyberiada_frozen_edge_geometry_source_point(const CyberiadaFrozenEdge* edge);
+	const CyberiadaPoint*             cyberiada_frozen_edge_geometry_target_point(const CyberiadaFrozenEdge* edge);
+	const char*                       cyberiada_frozen_edge_color(const CyberiadaFrozenEdge* edge);
+	const CyberiadaFrozenEdge*        cyberiada_frozen_edge_next(const CyberiadaFrozenEdge* edge);
+	CyberiadaActionType               cyberiada_frozen_action_type(const CyberiadaFrozenAction* action);
+	const char*                       cyberiada_frozen_action_trigger(const CyberiadaFrozenAction* action);
+	const char*                       cyberiada_frozen_action_guard(const CyberiadaFrozenAction* action);
+	const char*                       cyberiada_frozen_action_behavior(const CyberiadaFrozenAction* action);
+	const CyberiadaFrozenAction*      cyberiada_frozen_action_next(const CyberiadaFrozenAction* action);
+
+	/* Build the spatial index over the absolute node rects/points and edge bounding boxes (polyline, */
+	/* source/target points & label) of the document. The document geometry is not modified, but the */
+	/* index refers to the document nodes & edges and should be destroyed before the document          */
+	int cyberiada_new_spatial_index(CyberiadaDocument* doc, CyberiadaSpatialIndex** index);
+
+	/* Find the nodes & edges within the tolerance distance from the point (absolute coordinates). */
+	/* The nodes are sorted from the deepest to the top-level ones. The nodes/edges arrays should  */
+	/* be freed by the caller; pass NULL as nodes or edges to skip this kind of elements           */
+	int cyberiada_spatial_index_query_point(CyberiadaSpatialIndex* index, double x, double y, double tolerance,
+											CyberiadaNode*** nodes, size_t* nodes_count,
+											CyberiadaEdge*** edges, size_t* edges_count);
+
+	/* Find the nodes & edges intersecting the rect (absolute coordinates, e.g. the viewport). */
+	/* The nodes/edges arrays should be freed by the caller                                    */
+	int cyberiada_spatial_index_query_rect(CyberiadaSpatialIndex* index, const CyberiadaRect* rect,
+										   CyberiadaNode*** nodes, size_t* nodes_count,
+										   CyberiadaEdge*** edges, size_t* edges_count);
+
+	/* Update the index when the node (with its children) was moved by (dx, dy) in absolute coordinates */
+	int cyberiada_spatial_index_translate_node(CyberiadaSpatialIndex* index, CyberiadaNode* node, double dx, double dy);
+
+	/* Free the spatial index */
+	int cyberiada_destroy_spatial_index(CyberiadaSpatialIndex* index);
+
+	/* Pack the SM geometry to the contiguous coordinate arrays indexed by the node (pre-order) */
+	/* and edge (list order) ordinals. The store refers to the document SM nodes & edges and   */
+	/* uses the document geometry formats                                                      */
+	int cyberiada_new_sm_geometry_store(CyberiadaDocument* doc, CyberiadaSM* sm, CyberiadaGeometryStore** store);
+
+	/* Reload the store from the SM geometry (e.g. after the SM structure was changed) */
+	int cyberiada_geometry_store_load(CyberiadaGeometryStore* store);
+
+	/* Write the store coordinates back to the SM nodes & edges geometry fields */
+	int cyberiada_geometry_store_sync(CyberiadaGeometryStore* store);
+
+	/* Bulk transformations of all the stored coordinates. In the local coordinates the translation */
+	/* moves the topmost nodes having geometry and keeps the coordinates relative to them (the edge  */
+	/* points & labels, the local polylines). Rounding uses the same htgeom routines as the          */
+	/* CYBERIADA_FLAG_ROUND_GEOMETRY flag                                                            */
+	int cyberiada_geometry_store_translate(CyberiadaGeometryStore* store, double dx, double dy);
+	int cyberiada_geometry_store_scale(CyberiadaGeometryStore* store, double kx, double ky);
+	int cyberiada_geometry_store_round(CyberiadaGeometryStore* store);
+
+	/* Access the stored nodes & edges by ordinals and the node coordinate arrays */
+	size_t         cyberiada_geometry_store_nodes_count(const CyberiadaGeometryStore* store);
+	size_t         cyberiada_geometry_store_edges_count(const CyberiadaGeometryStore* store);
+	CyberiadaNode* cyberiada_geometry_store_node(const CyberiadaGeometryStore* store, size_t ordinal);
+	CyberiadaEdge* cyberiada_geometry_store_edge(const CyberiadaGeometryStore* store, size_t ordinal);
+	int            cyberiada_geometry_store_node_arrays(CyberiadaGeometryStore* store,
+														double** x, double** y, double** width, double** height);
+
+	/* Free the geometry store */
+	int cyberiada_destroy_geometry_store(CyberiadaGeometryStore* store);
+
+	/* Check the document geometry in absolute coordinates and collect all the issues found */
+	/* (containment, sibling overlaps, zero sizes, edge endpoints & dangling polylines). The */
+	/* tolerance is used for the coordinates comparison; the issues array should be freed   */
+	int cyberiada_lint_document_geometry(CyberiadaDocument* doc, double tolerance,
+										 CyberiadaGeometryIssue** issues, size_t* issues_count);
+	
+	/* Get the absolute rect of the SM node (zero-sized for the point nodes) from the lazily built */
+	/* SM cache; returns CYBERIADA_NOT_FOUND if the node has no geometry. In the local center     */
+	/* coordinates the top-level nodes are placed relative to the document bounding rect center   */
+	int cyberiada_node_absolute_rect(CyberiadaDocument* doc, CyberiadaSM* sm,
+									 const CyberiadaNode* node, CyberiadaRect* rect);
+
+	/* Invalidate the cached absolute geometry after the nodes geometry was changed by the user */
+	/* (the library geometry functions invalidate the cache themselves)                          */
+	int cyberiada_invalidate_sm_absolute_geometry(CyberiadaSM* sm);
+	int cyberiada_invalidate_document_absolute_geometry(CyberiadaDocument* doc);
+
+	/* Build (rebuild) the SM adjacency index: the incoming & outgoing edges of every SM node; */
+	/* the nodes are found by the SM ordinals (built on demand)                               */
+	int cyberiada_sm_build_adjacency(CyberiadaSM* sm);
+
+	/* Get the outgoing/incoming edges of the SM node (in the SM edges order) from the adjacency  */
+	/* index built on the first access; the array belongs to the index and is valid until the    */
+	/* index is invalidated. Returns CYBERIADA_NOT_FOUND if the node does not belong to the SM   */
+	int cyberiada_node_out_edges(CyberiadaSM* sm, const CyberiadaNode* node,
+								 CyberiadaEdge* const** edges, size_t* count);
+	int cyberiada_node_in_edges(CyberiadaSM* sm, const CyberiadaNode* node,
+								CyberiadaEdge* const** edges, size_t* count);
+
+	/* Invalidate the adjacency index after the SM nodes or edges were changed by the user */
+	/* (the SM editor invalidates the index itself)                                       */
+	int cyberiada_invalidate_sm_adjacency(CyberiadaSM* sm);
+	int cyberiada_invalidate_document_adjacency(CyberiadaDocument* doc);
+
+	/* Build (rebuild) the SM hierarchy index: the pre/post-order numbers, the depth & the LCA table; */
+	/* the pre-order numbers are the SM ordinals (built on demand)                                   */
+	int cyberiada_sm_build_hierarchy(CyberiadaSM* sm);
+
+	/* Get the SM node pre-order & post-order numbers and the depth (0 for the top-level nodes)     */
+	/* from the hierarchy index built on the first access; the NULL outputs are skipped. Returns   */
+	/* CYBERIADA_NOT_FOUND if the node does not belong to the SM (the same for the queries below)  */
+	int cyberiada_node_hierarchy_position(CyberiadaSM* sm, const CyberiadaNode* node,
+										  size_t* pre, size_t* post, size_t* depth);
+
+	/* Check if the node is a proper ancestor of another node in O(1) */
+	int cyberiada_node_is_ancestor(CyberiadaSM* sm, const CyberiadaNode* ancestor,
+								   const CyberiadaNode* node, int* result);
+
+	/* Find the lowest common ancestor of two nodes in O(1); the node is the LCA of itself and its */
+	/* descendants, the LCA of the nodes from different top-level trees is NULL                    */
+	int cyberiada_nodes_lca(CyberiadaSM* sm, const CyberiadaNode* node1, const CyberiadaNode* node2,
+							CyberiadaNode** lca);
+
+	/* Invalidate the hierarchy index after the SM nodes were changed by the user */
+	/* (the SM editor invalidates the index itself)                             */
+	int cyberiada_invalidate_sm_hierarchy(CyberiadaSM* sm);
+	int cyberiada_invalidate_document_hierarchy(CyberiadaDocument* doc);
+
+	/* Build (rebuild) the SM ordinals: the nodes are numbered in the pre-order of the node tree, */
+	/* the edges are numbered in the SM edges order; the numbers of the unchanged SM are stable; */
+	/* the adjacency & hierarchy indexes keyed by the old ordinals are dropped                   */
+	int cyberiada_sm_build_ordinals(CyberiadaSM* sm);
+
+	/* Get the ordinal-to-pointer arrays from the ordinals built on the first access; the arrays */
+	/* belong to the SM and are valid until the ordinals are invalidated                        */
+	int cyberiada_sm_ordinal_nodes(CyberiadaSM* sm, CyberiadaNode* const** nodes, size_t* count);
+	int cyberiada_sm_ordinal_edges(CyberiadaSM* sm, CyberiadaEdge* const** edges, size_t* count);
+
+	/* Get the node/edge ordinal; returns CYBERIADA_NOT_FOUND if the element does not belong to the SM */
+	int cyberiada_node_ordinal(CyberiadaSM* sm, const CyberiadaNode* node, size_t* ordinal);
+	int cyberiada_edge_ordinal(CyberiadaSM* sm, const CyberiadaEdge* edge, size_t* ordinal);
+
+	/* Invalidate the ordinals after the SM nodes or edges were changed by the user together with */
+	/* the adjacency & hierarchy indexes (the SM editor invalidates the ordinals itself)          */
+	int cyberiada_invalidate_sm_ordinals(CyberiadaSM* sm);
+	int cyberiada_invalidate_document_ordinals(CyberiadaDocument* doc);
+	
+	/* Create the SM builder to append nodes, edges & actions to the SM in constant time; the builder */
+	/* keeps the list tails, the edge identifiers index and the SM size. The builder tolerates the    */
+	/* appends made outside of it but the SM nodes, edges & actions should not be removed while it's  */
+	/* alive                                                                                          */
+	int cyberiada_new_sm_builder(CyberiadaSM* sm, CyberiadaSMBuilder** builder);
+
+	/* Append the node (with its subtree) to the parent children list or to the SM top-level nodes */
+	/* (parent is NULL); the node parent pointer is updated. On error the node is not linked and   */
+	/* still belongs to the caller                                                                 */
+	int cyberiada_sm_builder_add_node(CyberiadaSMBuilder* builder, CyberiadaNode* parent, CyberiadaNode* node);
+
+	/* Append the edge to the SM edges list; the non-empty edge identifiers should be unique */
+	int cyberiada_sm_builder_add_edge(CyberiadaSMBuilder* builder, CyberiadaEdge* edge);
+
+	/* Append the action to the node or edge action list; on error the action is not linked */
+	int cyberiada_sm_builder_add_action(CyberiadaSMBuilder* builder, CyberiadaAction** actions, CyberiadaAction* action);
+
+	/* Find the SM edge by the identifier and get the last SM edge */
+	CyberiadaEdge* cyberiada_sm_builder_find_edge(CyberiadaSMBuilder* builder, const char* id);
+	CyberiadaEdge* cyberiada_sm_builder_last_edge(CyberiadaSMBuilder* builder);
+
+	/* Get the SM size (all nodes & edges) tracked by the builder */
+	int cyberiada_sm_builder_size(CyberiadaSMBuilder* builder, size_t* nodes, size_t* edges);
+
+	/* Free the builder (the SM is not changed) */
+	int cyberiada_destroy_sm_builder(CyberiadaSMBuilder* builder);
+
+	/* Create the SM editor: index the node & edge identifiers, the list links and the incident */
+	/* edges of the nodes to modify the SM structure at the cost of the affected items only. The */
+	/* SM should not be modified outside of the editor while it's alive                         */
+	int cyberiada_new_sm_editor(CyberiadaSM* sm, CyberiadaSMEditor** editor);
+
+	/* Create the editor of the shared document SM: the document is cloned on the first mutation if */
+	/* it is shared with other handles, the node & edge arguments of the shared SM are moved to the  */
+	/* SM copy. The handle should outlive the editor                                                */
+	int cyberiada_new_shared_sm_editor(CyberiadaSharedDocument* shared, CyberiadaSM* sm, CyberiadaSMEditor** editor);
+
+	/* Get the SM the editor works on (changed by the first mutation of the shared document SM) */
+	CyberiadaSM* cyberiada_sm_editor_sm(CyberiadaSMEditor* editor);
+
+	/* Find the SM node/edge by the identifier */
+	CyberiadaNode* cyberiada_sm_editor_find_node(CyberiadaSMEditor* editor, const char* id);
+	CyberiadaEdge* cyberiada_sm_editor_find_edge(CyberiadaSMEditor* editor, const char* id);
+
+	/* Get the incident (incoming & outgoing) edges of the node; the array belongs to the editor */
+	/* and is valid until the next modification                                                 */
+	int cyberiada_sm_editor_node_edges(CyberiadaSMEditor* editor, CyberiadaNode* node,
+									   CyberiadaEdge* const** edges, size_t* count);
+
+	/* Append the new node (with its subtree) to the parent children or to the SM top-level nodes */
+	/* (parent is NULL); the node identifiers should be unique, the parent becomes composite      */
+	int cyberiada_sm_editor_add_node(CyberiadaSMEditor* editor, CyberiadaNode* parent, CyberiadaNode* node);
+
+	/* Move the node (with its subtree) to the new parent; the edges are kept, the old parent */
+	/* without substates becomes simple state                                                */
+	int cyberiada_sm_editor_move_node(CyberiadaSMEditor* editor, CyberiadaNode* node, CyberiadaNode* new_parent);
+
+	/* Remove & free the node with its subtree and all the edges incident to the subtree nodes */
+	int cyberiada_sm_editor_remove_node(CyberiadaSMEditor* editor, CyberiadaNode* node);
+
+	/* Append the new edge to the SM; the source & target links are resolved by the identifiers */
+	int cyberiada_sm_editor_add_edge(CyberiadaSMEditor* editor, CyberiadaEdge* edge);
+
+	/* Remove & free the edge */
+	int cyberiada_sm_editor_remove_edge(CyberiadaSMEditor* editor, CyberiadaEdge* edge);
+
+	/* Replace the node/edge actions (the old actions are freed) */
+	int cyberiada_sm_editor_set_node_actions(CyberiadaSMEditor* editor, CyberiadaNode* node, CyberiadaAction* actions);
+	int cyberiada_sm_editor_set_edge_action(CyberiadaSMEditor* editor, CyberiadaEdge* edge, CyberiadaAction* action);
+
+	/* Free the editor (the SM is not changed) */
+	int cyberiada_destroy_sm_editor(CyberiadaSMEditor* editor);
+
+	/* Analyze the SM graph: the reachability from the top-level initial pseudostate (skipped if there */
+	/* is no initial pseudostate), the dead nodes and the strongly connected components (livelocks).   */
+	/* The transitions of a state apply to its substates, entering a composite state or a region       */
+	/* enters its initial pseudostates and regions. The SM ordinals are rebuilt                         */
+	int cyberiada_analyze_sm(CyberiadaSM* sm, CyberiadaSMAnalysis** analysis);
+
+	/* Free the SM analysis results */
+	int cyberiada_destroy_sm_analysis(CyberiadaSMAnalysis* analysis);
+
+	/* Flatten the hierarchical SM to the flat transition table of the leaf states. The action        */
+	/* sequences include the exit/entry actions ordered by the document transitionOrder flag and the  */
+	/* initial pseudostates of the entered composite states. The SMs with orthogonal regions (several */
+	/* regions of a state) are not supported; the SM ordinals & hierarchy index are rebuilt            */
+	int cyberiada_flatten_sm(CyberiadaDocument* doc, CyberiadaSM* sm, CyberiadaFlatTable** table);
+
+	/* Free the flat transition table */
+	int cyberiada_destroy_flat_table(CyberiadaFlatTable* table);
 	
     /* Print the SM structure to stdout */
     int cyberiada_print_sm_document(CyberiadaDocument* doc);
@@ -465,7 +984,8 @@ typedef enum {
 	CyberiadaAction* cyberiada_new_action(CyberiadaActionType type, const char* trigger, const char* guard, const char* behavior);
 
 	/* Compare two SM graphs to detect isomorphism and the difference if the graphs are not isomorphic */
-	/* Note: this function ignores comment nodes and edges if the ignore_comments flag is set          */
+	/* Note: this function ignores comment nodes and edges if the ignore_comments flag is set;         */
+	/* the SM ordinals & adjacency indexes are neither used nor built                                  */
 	int cyberiada_check_isomorphism(CyberiadaSM* sm1, CyberiadaSM* sm2, int ignore_comments, int require_initial,
 									int* result_flags, CyberiadaNode** new_initial,
 									size_t* sm_diff_nodes_size, CyberiadaNodePair** sm_diff_nodes, size_t** sm_diff_nodes_flags,
@@ -486,8 +1006,25 @@ typedef enum {
 
 	/* Reconstruct the SM document geometry from scratch */
 	int cyberiada_reconstruct_document_geometry(CyberiadaDocument* doc, int reconstruct_sm);
+
+	/* Reconstruct the geometry of the nodes & edges lacking it and of the dirty nodes (with their edges) */
+	/* keeping the existing coordinates; the dirty composite nodes & the ancestors of the dirty nodes    */
+	/* are extended to fit their children                                                                */
+	int cyberiada_reconstruct_document_geometry_incremental(CyberiadaDocument* doc,
+															CyberiadaNode** dirty_nodes, size_t dirty_nodes_count,
+															int reconstruct_sm);
 	
-	/* Change the SM document geometry format and convert the SMs geometry data */
+	/* Simplify the edge polylines (Ramer-Douglas-Peucker) within the tolerance and quantize all the */
+	/* document coordinates to the grid; zero tolerance/grid disables the corresponding step; the    */
+	/* edge source & target points are the fixed ends of the simplified polylines; the non-zero      */
+	/* rect sizes are quantized to at least one grid step                                            */
+	int cyberiada_simplify_document_geometry(CyberiadaDocument* doc, double tolerance, double grid);
+
+	/* Change the SM document geometry format and convert the SMs geometry data. The fast in-place  */
+	/* conversion w/o the geometry library is used only if the nodes coordinates format changes     */
+	/* between the absolute, left-top & center formats and all the edge formats (edge coordinates,   */
+	/* polyline coordinates & edge geometry) stay the same; a change of any edge format converts the */
+	/* whole document through the geometry library (O(document size) copy)                           */
 	int cyberiada_convert_document_geometry(CyberiadaDocument* doc,
 											CyberiadaGeometryCoordFormat new_node_coord_format,
 											CyberiadaGeometryCoordFormat new_edge_coord_format,
@@ -24,8 +24,15 @@
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#include <stdint.h>
+#ifdef CYBERIADA_HAVE_PTHREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 #include "geometry.h"
+#include "cyb_structs.h"
+#include "cyb_types.h"
 #include "cyb_error.h"
 
 int cyberiada_document_no_geometry(CyberiadaDocument* doc)
@@ -64,7 +71,7 @@ static int cyberiada_clean_nodes_geometry(CyberiadaNode* node)
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_clean_edge_geometry(CyberiadaEdge* edge)
+int cyberiada_clean_edge_geometry(CyberiadaEdge* edge)
 {
 	if (edge->geometry_polyline) {
 		htree_destroy_polyline(edge->geometry_polyline);
@@ -102,6 +109,8 @@ int cyberiada_clean_document_geometry(CyberiadaDocument* doc)
 		return CYBERIADA_BAD_PARAMETER;
 	}
 
+	cyberiada_invalidate_document_absolute_geometry(doc);
+
 	for (sm = doc->state_machines; sm; sm = sm->next) {
 		cyberiada_clean_nodes_geometry(sm->nodes);
 		cyberiada_clean_edges_geometry(sm->edges);
@@ -173,125 +182,182 @@ static int cyberiada_round_document_geometry(CyberiadaDocument* doc)
 	return CYBERIADA_NO_ERROR;
 }
 
-static HTreeNode* cyberiada_node_to_htree(CyberiadaNode* node)
+/* -----------------------------------------------------------------------------
+ * The HTree bridge: the HTree structure is built once (w/o geometry) and then
+ * the document geometry objects are either moved to the HTree and back (the
+ * document is converted in place, no copies) or copied (the document is left
+ * intact, e.g. on export)
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_nodes_to_htree(CyberiadaNode* nodes, HTreeNode* t_parent, HTreeNode** t_nodes,
+									CyberiadaHash* ids)
 {
 	HTNodeType type;
-	HTreeNode *t_node, *t_child, *n;
-	CyberiadaNode *child;
-	
-	if (!node || !(node->id)) {
-		return NULL;
-	}
-	if (node->type == cybNodeSM) {
-		type = htTree;
-	} else if (node->type == cybNodeCompositeState || node->type == cybNodeRegion) {
-		type = htCompositeNode;
-	} else if (node->type & (cybNodeSimpleState | cybNodeChoice | cybNodeComment | cybNodeFormalComment)) {
-		type = htSimpleNode;
-	} else if (node->type & (cybNodeInitial | cybNodeFinal | cybNodeTerminate)) {
-		type = htPoint;
-	} else {
-		ERROR("Cannot convert node to htree, bad type: %d\n", node->type);
-		return NULL;
-	}
-	t_node = htree_new_node(type, node->id);
-	if (node->geometry_point) {
-		t_node->point = htree_copy_point(node->geometry_point);
-	}
-	if (node->geometry_rect) {
-		t_node->rect = htree_copy_rect(node->geometry_rect);
-	}
-	if (node->children) {
-		for (child = node->children; child; child = child->next) {
-			t_child = cyberiada_node_to_htree(child);
-			t_child->parent = t_node;
-			if (t_node->children) {
-				n = t_node->children;
-				while (n->next) n = n->next;
-				n->next = t_child;
-			} else {
-				t_node->children = t_child;
+	HTreeNode *t_node, *last = NULL;
+	CyberiadaNode *node;
+	int res;
+
+	for (node = nodes; node; node = node->next) {
+		if (!(node->id)) {
+			ERROR("Cannot convert node to htree, empty id\n");
+			return CYBERIADA_BAD_PARAMETER;
+		}
+		if (node->type == cybNodeSM) {
+			type = htTree;
+		} else if (node->type == cybNodeCompositeState || node->type == cybNodeRegion) {
+			type = htCompositeNode;
+		} else if (node->type & (cybNodeSimpleState | cybNodeChoice | cybNodeComment | cybNodeFormalComment)) {
+			type = htSimpleNode;
+		} else if (node->type & (cybNodeInitial | cybNodeFinal | cybNodeTerminate)) {
+			type = htPoint;
+		} else {
+			ERROR("Cannot convert node to htree, bad type: %d\n", node->type);
+			return CYBERIADA_BAD_PARAMETER;
+		}
+		t_node = htree_new_node(type, node->id);
+		if (!t_node) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		/* the node is linked to the tree at once to be destroyed with the tree on error */
+		t_node->parent = t_parent;
+		if (last) {
+			last->next = t_node;
+		} else {
+			*t_nodes = t_node;
+		}
+		last = t_node;
+		/* keep the first node with the id as htree_find_node_by_id() does */
+		if (!cyberiada_hash_get(ids, node->id) &&
+			cyberiada_hash_put(ids, node->id, t_node) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		if (node->children) {
+			if ((res = cyberiada_nodes_to_htree(node->children, t_node, &(t_node->children), ids)) != CYBERIADA_NO_ERROR) {
+				return res;
 			}
 		}
 	}
-	return t_node;
-}
-
-static HTreeEdge* cyberiada_edge_to_htree(CyberiadaEdge* edge)
-{
-	HTreeEdge* t_edge;	
-	if (!edge) {
-		return NULL;
-	}
-	t_edge = htree_new_edge(edge->id, edge->source_id, edge->target_id);
-	if (edge->geometry_polyline) {
-		t_edge->polyline = htree_copy_polyline(edge->geometry_polyline);
-	}
-	if (edge->geometry_source_point) {
-		t_edge->source_point = htree_copy_point(edge->geometry_source_point);
-	}
-	if (edge->geometry_target_point) {
-		t_edge->target_point = htree_copy_point(edge->geometry_target_point);
-	}
-	if (edge->geometry_label_point) {
-		t_edge->label_point = htree_copy_point(edge->geometry_label_point);
-	}
-	return t_edge;
+	return CYBERIADA_NO_ERROR;
 }
 
 static HTree* cyberiada_sm_to_htree(CyberiadaSM* sm)
 {
-	CyberiadaNode* node;
 	CyberiadaEdge* edge;
 	HTree* tree;
-	HTreeEdge* t_edge;
+	HTreeEdge *t_edge, *last_edge = NULL;
+	CyberiadaHash ids;
 
 	if (!sm) {
 		return NULL;
 	}
-	
+
 	tree = htree_new_tree();
+	if (!tree) {
+		return NULL;
+	}
+	if (cyberiada_hash_init(&ids, 1, 0) != 0) {
+		htree_destroy_tree(tree);
+		return NULL;
+	}
 	
-	for (node = sm->nodes; node; node = node->next) {
-		HTreeNode* t_node = cyberiada_node_to_htree(node);
-		if (tree->nodes) {
-			HTreeNode* n = tree->nodes;
-			while (n->next) n = n->next;
-			n->next = t_node;
-		} else {
-			tree->nodes = t_node;
-		}
+	if (cyberiada_nodes_to_htree(sm->nodes, NULL, &(tree->nodes), &ids) != CYBERIADA_NO_ERROR) {
+		cyberiada_hash_free(&ids);
+		htree_destroy_tree(tree);
+		return NULL;
 	}
 
 	for (edge = sm->edges; edge; edge = edge->next) {
-		HTreeEdge* t_edge = cyberiada_edge_to_htree(edge);
-		if (tree->edges) {
-			HTreeEdge* e = tree->edges;
-			while (e->next) e = e->next;
-			e->next = t_edge;
-		} else {
-			tree->edges = t_edge;
-		}
-	}
-
-	t_edge = tree->edges;
-	while (t_edge) {
-		HTreeNode* source = htree_find_node_by_id(tree->nodes, t_edge->source_id);
-		HTreeNode* target = htree_find_node_by_id(tree->nodes, t_edge->target_id);
+		HTreeNode* source = (HTreeNode*)cyberiada_hash_get(&ids, edge->source_id);
+		HTreeNode* target = (HTreeNode*)cyberiada_hash_get(&ids, edge->target_id);
 		if (!source || !target) {
-			ERROR("Cannot find htree node by id ('%s', '%s')\n", t_edge->source_id, t_edge->target_id);
+			ERROR("Cannot find htree node by id ('%s', '%s')\n", edge->source_id, edge->target_id);
+			cyberiada_hash_free(&ids);
+			htree_destroy_tree(tree);
+			return NULL;
+		}
+		t_edge = htree_new_edge(edge->id, edge->source_id, edge->target_id);
+		if (!t_edge) {
+			cyberiada_hash_free(&ids);
 			htree_destroy_tree(tree);
 			return NULL;
 		}
 		t_edge->source = source;
 		t_edge->target = target;
-		t_edge = t_edge->next;
+		if (last_edge) {
+			last_edge->next = t_edge;
+		} else {
+			tree->edges = t_edge;
+		}
+		last_edge = t_edge;
 	}
-	
+
+	cyberiada_hash_free(&ids);
 	return tree;
 }
 
-static HTDocument* cyberiada_to_htree_geometry(CyberiadaDocument* cyb_doc)
+/* move (or copy) the geometry object from the document to the htree */
+#define CYBERIADA_GEOMETRY_TO_HTREE(dst, src, copy_func, move_geometry) \
+	if (src) {                                                       \
+		if (move_geometry) {                                         \
+			(dst) = (src);                                           \
+			(src) = NULL;                                            \
+		} else {                                                     \
+			(dst) = copy_func(src);                                  \
+		}                                                            \
+	}
+
+static void cyberiada_nodes_geometry_to_htree(CyberiadaNode* nodes, HTreeNode* tree_nodes,
+											  int move_geometry, int skip_collapsed)
+{
+	CyberiadaNode* node;
+	HTreeNode* t_node;
+
+	for (node = nodes, t_node = tree_nodes;
+		 node && t_node;
+		 node = node->next, t_node = t_node->next) {
+		CYBERIADA_GEOMETRY_TO_HTREE(t_node->point, node->geometry_point, htree_copy_point, move_geometry);
+		CYBERIADA_GEOMETRY_TO_HTREE(t_node->rect, node->geometry_rect, htree_copy_rect, move_geometry);
+		if (node->children && t_node->children && !(skip_collapsed && node->collapsed_flag)) {
+			cyberiada_nodes_geometry_to_htree(node->children, t_node->children, move_geometry, skip_collapsed);
+		}
+	}
+}
+
+/* the node is hidden inside a collapsed node */
+static int cyberiada_node_inside_collapsed(const CyberiadaNode* node)
+{
+	for (node = node ? node->parent : NULL; node; node = node->parent) {
+		if (node->collapsed_flag) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void cyberiada_edges_geometry_to_htree(CyberiadaEdge* edges, HTreeEdge* tree_edges,
+											  int move_geometry, int skip_collapsed)
+{
+	CyberiadaEdge* edge;
+	HTreeEdge* t_edge;
+
+	for (edge = edges, t_edge = tree_edges;
+		 edge && t_edge;
+		 edge = edge->next, t_edge = t_edge->next) {
+		if (skip_collapsed &&
+			(cyberiada_node_inside_collapsed(edge->source) || cyberiada_node_inside_collapsed(edge->target))) {
+			continue;
+		}
+		CYBERIADA_GEOMETRY_TO_HTREE(t_edge->polyline, edge->geometry_polyline, htree_copy_polyline, move_geometry);
+		CYBERIADA_GEOMETRY_TO_HTREE(t_edge->source_point, edge->geometry_source_point, htree_copy_point, move_geometry);
+		CYBERIADA_GEOMETRY_TO_HTREE(t_edge->target_point, edge->geometry_target_point, htree_copy_point, move_geometry);
+		CYBERIADA_GEOMETRY_TO_HTREE(t_edge->label_point, edge->geometry_label_point, htree_copy_point, move_geometry);
+	}
+}
+
+/* build the htree document; if move_geometry is set, the geometry is moved from the document
+   and should be returned back using cyberiada_update_geometry() before the htree is destroyed;
+   if skip_collapsed is set, the geometry inside the collapsed nodes is left in the document */
+static HTDocument* cyberiada_to_htree_geometry(CyberiadaDocument* cyb_doc, int move_geometry, int skip_collapsed)
 {
 	HTDocument* htg_doc;
 	HTree *tree, *prev = NULL; 
@@ -305,12 +371,17 @@ static HTDocument* cyberiada_to_htree_geometry(CyberiadaDocument* cyb_doc)
 								 cyb_doc->edge_coord_format,
 								 cyb_doc->edge_pl_coord_format,
 								 cyb_doc->edge_geom_format);
-	if (cyb_doc->bounding_rect) {
-		htg_doc->bounding_rect = htree_copy_rect(cyb_doc->bounding_rect);
+	if (!htg_doc) {
+		return NULL;
 	}
 	
+	/* the structure first: the document geometry is not touched if it fails */
 	for (sm = cyb_doc->state_machines; sm; sm = sm->next) {
 		tree = cyberiada_sm_to_htree(sm);
+		if (!tree) {
+			htree_destroy_document(htg_doc);
+			return NULL;
+		}
 		if (prev) {
 			prev->next = tree;
 		} else {
@@ -319,10 +390,26 @@ static HTDocument* cyberiada_to_htree_geometry(CyberiadaDocument* cyb_doc)
 		prev = tree;
 	}
 
+	CYBERIADA_GEOMETRY_TO_HTREE(htg_doc->bounding_rect, cyb_doc->bounding_rect, htree_copy_rect, move_geometry);
+	for (sm = cyb_doc->state_machines, tree = htg_doc->trees;
+		 sm && tree;
+		 sm = sm->next, tree = tree->next) {
+		cyberiada_nodes_geometry_to_htree(sm->nodes, tree->nodes, move_geometry, skip_collapsed);
+		cyberiada_edges_geometry_to_htree(sm->edges, tree->edges, move_geometry, skip_collapsed);
+	}
+
 	return htg_doc;
 }
 
-static int cyberiada_update_nodes_geometry(CyberiadaNode* nodes, HTreeNode* tree_nodes)
+/* move the geometry object from the htree to the document */
+#define CYBERIADA_GEOMETRY_FROM_HTREE(dst, src, destroy_func)        \
+	if (dst) {                                                       \
+		destroy_func(dst);                                           \
+	}                                                                \
+	(dst) = (src);                                                   \
+	(src) = NULL;
+
+static int cyberiada_update_nodes_geometry(CyberiadaNode* nodes, HTreeNode* tree_nodes, int skip_collapsed)
 {
 	CyberiadaNode* node;
 	HTreeNode* t_node;
@@ -334,45 +421,10 @@ static int cyberiada_update_nodes_geometry(CyberiadaNode* nodes, HTreeNode* tree
 	for (node = nodes, t_node = tree_nodes;
 		 node && t_node;
 		 node = node->next, t_node = t_node->next) {
-		//DEBUG("update nodes %s -> %s\n", t_node->id, node->id);
-		
-		if (node->id && t_node->id && strcmp(node->id, t_node->id) != 0) {
-			ERROR("Node IDs don't match %s %s\n", node->id, t_node->id);
-			return CYBERIADA_BAD_PARAMETER;
-		}
-
-		if (node->geometry_point && t_node->point) {
-			htree_set_point(node->geometry_point, t_node->point);
-		} else {
-			if (node->geometry_point) {
-				htree_destroy_point(node->geometry_point);
-				node->geometry_point = NULL;
-			}
-			if (t_node->point) {
-				node->geometry_point = htree_copy_point(t_node->point);
-			}
-		}
-
-		if (node->geometry_rect && t_node->rect) {
-			htree_set_rect(node->geometry_rect, t_node->rect);
-		} else {
-			if (node->geometry_rect) {
-				htree_destroy_rect(node->geometry_rect);
-				node->geometry_rect = NULL;
-			}
-			if (t_node->rect) {
-				node->geometry_rect = htree_copy_rect(t_node->rect);
-			}
-		}
-/*		if (node->geometry_rect) {
-			DEBUG("updated node %s rect (%lf; %lf; %lf; %lf)\n",
-				  node->id, node->geometry_rect->x, node->geometry_rect->y, node->geometry_rect->width, node->geometry_rect->height);
-		} else {
-			DEBUG("empty node %s rect\n", node->id);
-		}*/
-		
-		if (node->children && t_node->children) {
-			cyberiada_update_nodes_geometry(node->children, t_node->children);
+		CYBERIADA_GEOMETRY_FROM_HTREE(node->geometry_point, t_node->point, htree_destroy_point);
+		CYBERIADA_GEOMETRY_FROM_HTREE(node->geometry_rect, t_node->rect, htree_destroy_rect);
+		if (node->children && t_node->children && !(skip_collapsed && node->collapsed_flag)) {
+			cyberiada_update_nodes_geometry(node->children, t_node->children, skip_collapsed);
 		}	 
 	}
 	
@@ -384,63 +436,14 @@ static int cyberiada_update_edge_geometry(CyberiadaEdge* edge, HTreeEdge* tree_e
 	if (!edge || !tree_edge) {
 		return CYBERIADA_BAD_PARAMETER;
 	}
-	if (edge->id && tree_edge->id && strcmp(edge->id, tree_edge->id) != 0) {
-		ERROR("Edge IDs don't match %s %s\n", edge->id, tree_edge->id);
-		return CYBERIADA_BAD_PARAMETER;
-	}
-
-	if (edge->geometry_polyline && tree_edge->polyline) {
-		htree_set_polyline(edge->geometry_polyline, tree_edge->polyline);
-	} else {
-		if (edge->geometry_polyline) {
-			htree_destroy_polyline(edge->geometry_polyline);
-			edge->geometry_polyline = NULL;
-		}
-		if (tree_edge->polyline) {
-			edge->geometry_polyline = htree_copy_polyline(tree_edge->polyline);
-		}
-	}
-
-	if (edge->geometry_source_point && tree_edge->source_point) {
-		htree_set_point(edge->geometry_source_point, tree_edge->source_point);
-	} else {
-		if (edge->geometry_source_point) {
-			htree_destroy_point(edge->geometry_source_point);
-			edge->geometry_source_point = NULL;
-		}
-		if (tree_edge->source_point) {
-			edge->geometry_source_point = htree_copy_point(tree_edge->source_point);
-		}
-	}
-
-	if (edge->geometry_target_point && tree_edge->target_point) {
-		htree_set_point(edge->geometry_target_point, tree_edge->target_point);
-	} else {
-		if (edge->geometry_target_point) {
-			htree_destroy_point(edge->geometry_target_point);
-			edge->geometry_target_point = NULL;
-		}
-		if (tree_edge->target_point) {	
-			edge->geometry_target_point = htree_copy_point(tree_edge->target_point);
-		}
-	}
-
-	if (edge->geometry_label_point && tree_edge->label_point) {
-		htree_set_point(edge->geometry_label_point, tree_edge->label_point);
-	} else {
-		if (edge->geometry_label_point) {
-			htree_destroy_point(edge->geometry_label_point);
-			edge->geometry_label_point = NULL;
-		}
-		if (tree_edge->label_point) {
-			edge->geometry_label_point = htree_copy_point(tree_edge->label_point);
-		}
-	}
-	
+	CYBERIADA_GEOMETRY_FROM_HTREE(edge->geometry_polyline, tree_edge->polyline, htree_destroy_polyline);
+	CYBERIADA_GEOMETRY_FROM_HTREE(edge->geometry_source_point, tree_edge->source_point, htree_destroy_point);
+	CYBERIADA_GEOMETRY_FROM_HTREE(edge->geometry_target_point, tree_edge->target_point, htree_destroy_point);
+	CYBERIADA_GEOMETRY_FROM_HTREE(edge->geometry_label_point, tree_edge->label_point, htree_destroy_point);
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_update_sm_geometry(CyberiadaSM* sm, HTree* tree)
+static int cyberiada_update_sm_geometry(CyberiadaSM* sm, HTree* tree, int skip_collapsed)
 {
 	CyberiadaEdge* edge;
 	HTreeEdge* t_edge;
@@ -450,19 +453,26 @@ static int cyberiada_update_sm_geometry(CyberiadaSM* sm, HTree* tree)
 	}
 
 	if (sm->nodes) {
-		cyberiada_update_nodes_geometry(sm->nodes, tree->nodes);	
+		cyberiada_update_nodes_geometry(sm->nodes, tree->nodes, skip_collapsed);	
 	}
 		
 	for (edge = sm->edges, t_edge = tree->edges;
 		 edge && t_edge;
 		 edge = edge->next, t_edge = t_edge->next) {
+		if (skip_collapsed &&
+			(cyberiada_node_inside_collapsed(edge->source) || cyberiada_node_inside_collapsed(edge->target))) {
+			/* the hidden edge geometry was left in the document */
+			continue;
+		}
 		cyberiada_update_edge_geometry(edge, t_edge);
 	}	
 	
 	return CYBERIADA_NO_ERROR;
 }
 
-static int cyberiada_update_geometry(CyberiadaDocument* cyb_doc, HTDocument* htg_doc)
+/* move the htree geometry back to the document w/o changing the document format; skip_collapsed */
+/* should be the same as in cyberiada_to_htree_geometry() to keep the hidden geometry intact      */
+static int cyberiada_return_htree_geometry(CyberiadaDocument* cyb_doc, HTDocument* htg_doc, int skip_collapsed)
 {
 	HTree *tree; 
 	CyberiadaSM* sm;
@@ -471,40 +481,184 @@ static int cyberiada_update_geometry(CyberiadaDocument* cyb_doc, HTDocument* htg
 		return CYBERIADA_BAD_PARAMETER;
 	}
 
+	CYBERIADA_GEOMETRY_FROM_HTREE(cyb_doc->bounding_rect, htg_doc->bounding_rect, htree_destroy_rect);
+	for (sm = cyb_doc->state_machines, tree = htg_doc->trees;
+		 sm && tree;
+		 sm = sm->next, tree = tree->next) {
+
+		cyberiada_update_sm_geometry(sm, tree, skip_collapsed);
+	}
+	
+	return CYBERIADA_NO_ERROR;
+}
+
+/* move the htree geometry (converted or reconstructed) back to the document */
+static int cyberiada_update_geometry(CyberiadaDocument* cyb_doc, HTDocument* htg_doc, int skip_collapsed)
+{
+	if (!cyb_doc || !htg_doc) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
 	cyb_doc->node_coord_format = htg_doc->node_coord_format;
 	cyb_doc->edge_coord_format = htg_doc->edge_coord_format;
 	cyb_doc->edge_geom_format = htg_doc->edge_format;
 
-	if (cyb_doc->bounding_rect && htg_doc->bounding_rect) {
-		htree_set_rect(cyb_doc->bounding_rect, htg_doc->bounding_rect);
-	} else {
-		if (cyb_doc->bounding_rect) {
-			htree_destroy_rect(cyb_doc->bounding_rect);
-			cyb_doc->bounding_rect = NULL;
+	return cyberiada_return_htree_geometry(cyb_doc, htg_doc, skip_collapsed);
+}
+
+/* -----------------------------------------------------------------------------
+ * In-place nodes geometry conversion: when only the node coordinates format
+ * changes, the nodes are converted on the document tree directly without the
+ * HTree round trip. Every level gets the absolute rect of the nearest ancestor
+ * with geometry (the nodes w/o geometry are skipped the same way the absolute
+ * cache does); the edges geometry does not depend on the nodes format.
+ *
+ * The edges are not converted in place: any change of the edge coordinates,
+ * polyline coordinates or edge geometry format (the border points depend on
+ * the nodes shapes) takes the HTree path for the whole document, as well as
+ * the reconstruction.
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_local_node_format(CyberiadaGeometryCoordFormat format)
+{
+	return format == coordAbsolute || format == coordLeftTop || format == coordLocalCenter;
+}
+
+static int cyberiada_can_convert_in_place(CyberiadaDocument* doc,
+										  CyberiadaGeometryCoordFormat new_node_coord_format,
+										  CyberiadaGeometryCoordFormat new_edge_coord_format,
+										  CyberiadaGeometryCoordFormat new_edge_pl_coord_format,
+										  CyberiadaGeometryEdgeFormat new_edge_format)
+{
+	return (cyberiada_local_node_format(doc->node_coord_format) &&
+			cyberiada_local_node_format(new_node_coord_format) &&
+			doc->edge_coord_format == new_edge_coord_format &&
+			doc->edge_pl_coord_format == new_edge_pl_coord_format &&
+			doc->edge_geom_format == new_edge_format);
+}
+
+/* the children origin in the format; parent is the absolute rect of the nearest ancestor
+   with geometry or the absolute bounding rect for the top level (NULL if there is none) */
+static void cyberiada_in_place_origin(CyberiadaGeometryCoordFormat format, const CyberiadaRect* parent,
+									  int top_level, double* x, double* y)
+{
+	*x = *y = 0.0;
+	if (!parent || format == coordAbsolute || (top_level && format == coordLeftTop)) {
+		return;
+	}
+	*x = parent->x;
+	*y = parent->y;
+	if (format == coordLocalCenter) {
+		*x += parent->width / 2.0;
+		*y += parent->height / 2.0;
+	}
+}
+
+static void cyberiada_convert_nodes_in_place(CyberiadaNode* nodes, const CyberiadaRect* parent, int top_level,
+											 CyberiadaGeometryCoordFormat old_format,
+											 CyberiadaGeometryCoordFormat new_format,
+											 int skip_collapsed)
+{
+	CyberiadaNode* node;
+	CyberiadaRect abs;
+	const CyberiadaRect* next_parent;
+	double old_x, old_y, new_x, new_y;
+	int next_top_level;
+
+	cyberiada_in_place_origin(old_format, parent, top_level, &old_x, &old_y);
+	cyberiada_in_place_origin(new_format, parent, top_level, &new_x, &new_y);
+
+	for (node = nodes; node; node = node->next) {
+		next_parent = parent;
+		next_top_level = top_level;
+		if (node->geometry_rect) {
+			abs = *(node->geometry_rect);
+			abs.x += old_x;
+			abs.y += old_y;
+			if (old_format == coordLocalCenter) {
+				abs.x -= abs.width / 2.0;
+				abs.y -= abs.height / 2.0;
+			}
+			node->geometry_rect->x = abs.x - new_x;
+			node->geometry_rect->y = abs.y - new_y;
+			if (new_format == coordLocalCenter) {
+				node->geometry_rect->x += abs.width / 2.0;
+				node->geometry_rect->y += abs.height / 2.0;
+			}
+			next_parent = &abs;
+			next_top_level = 0;
+		} else if (node->geometry_point) {
+			abs.x = node->geometry_point->x + old_x;
+			abs.y = node->geometry_point->y + old_y;
+			abs.width = abs.height = 0.0;
+			node->geometry_point->x = abs.x - new_x;
+			node->geometry_point->y = abs.y - new_y;
+			next_parent = &abs;
+			next_top_level = 0;
 		}
-		if (htg_doc->bounding_rect) {
-			cyb_doc->bounding_rect = htree_copy_rect(htg_doc->bounding_rect);
+		if (node->children && !(skip_collapsed && node->collapsed_flag)) {
+			cyberiada_convert_nodes_in_place(node->children, next_parent, next_top_level,
+											 old_format, new_format, skip_collapsed);
 		}
 	}
-	for (sm = cyb_doc->state_machines, tree = htg_doc->trees;
-		 sm && tree;
-		 sm = sm->next, tree = tree->next) {
+}
 
-		cyberiada_update_sm_geometry(sm, tree);
+static void cyberiada_convert_geometry_in_place(CyberiadaDocument* doc,
+												CyberiadaGeometryCoordFormat new_node_coord_format,
+												int skip_collapsed)
+{
+	CyberiadaSM* sm;
+	CyberiadaRect bounding;
+	const CyberiadaRect* top = NULL;
+
+	if (doc->node_coord_format != new_node_coord_format) {
+		/* the bounding rect uses the node format: (x, y) is its center in the local center format */
+		if (doc->bounding_rect) {
+			bounding = *(doc->bounding_rect);
+			if (doc->node_coord_format == coordLocalCenter) {
+				bounding.x -= bounding.width / 2.0;
+				bounding.y -= bounding.height / 2.0;
+			}
+			top = &bounding;
+		}
+		for (sm = doc->state_machines; sm; sm = sm->next) {
+			cyberiada_convert_nodes_in_place(sm->nodes, top, 1,
+											 doc->node_coord_format, new_node_coord_format,
+											 skip_collapsed);
+		}
+		if (doc->bounding_rect) {
+			doc->bounding_rect->x = bounding.x;
+			doc->bounding_rect->y = bounding.y;
+			if (new_node_coord_format == coordLocalCenter) {
+				doc->bounding_rect->x += bounding.width / 2.0;
+				doc->bounding_rect->y += bounding.height / 2.0;
+			}
+		}
 	}
-	
-	return CYBERIADA_NO_ERROR;
+	doc->node_coord_format = new_node_coord_format;
 }
 
-int cyberiada_convert_document_geometry(CyberiadaDocument* doc,
-										CyberiadaGeometryCoordFormat new_node_coord_format,
-										CyberiadaGeometryCoordFormat new_edge_coord_format,
-										CyberiadaGeometryCoordFormat new_edge_pl_coord_format,
-										CyberiadaGeometryEdgeFormat new_edge_format)
+/* convert the document geometry in place if possible, use the HTree otherwise */
+static int cyberiada_convert_geometry(CyberiadaDocument* doc,
+									  CyberiadaGeometryCoordFormat new_node_coord_format,
+									  CyberiadaGeometryCoordFormat new_edge_coord_format,
+									  CyberiadaGeometryCoordFormat new_edge_pl_coord_format,
+									  CyberiadaGeometryEdgeFormat new_edge_format,
+									  int skip_collapsed)
 {
+	HTDocument* htreegeom;
 	int res;
-	HTDocument* htreegeom = cyberiada_to_htree_geometry(doc);
-	
+
+	if (cyberiada_can_convert_in_place(doc,
+									   new_node_coord_format,
+									   new_edge_coord_format,
+									   new_edge_pl_coord_format,
+									   new_edge_format)) {
+		cyberiada_convert_geometry_in_place(doc, new_node_coord_format, skip_collapsed);
+		return CYBERIADA_NO_ERROR;
+	}
+
+	htreegeom = cyberiada_to_htree_geometry(doc, 1, skip_collapsed);
 	if (!htreegeom) {
 		ERROR("Cannot convert document geometry to htree geometry\n");
 		return CYBERIADA_BAD_PARAMETER;
@@ -516,46 +670,653 @@ int cyberiada_convert_document_geometry(CyberiadaDocument* doc,
 											   new_edge_pl_coord_format,
 											   new_edge_format)) != HTREE_OK) {
 		ERROR("Error while converting document geometry %d\n", res);
+		cyberiada_return_htree_geometry(doc, htreegeom, skip_collapsed);
 		htree_destroy_document(htreegeom);
 		return CYBERIADA_BAD_PARAMETER;
 	}
 
-	cyberiada_update_geometry(doc, htreegeom);
+	cyberiada_update_geometry(doc, htreegeom, skip_collapsed);
 	htree_destroy_document(htreegeom);
-	
 	return CYBERIADA_NO_ERROR;
 }
 
-int cyberiada_import_document_geometry(CyberiadaDocument* doc,
-									   int flags, CyberiadaXMLFormat file_format)
+/* -----------------------------------------------------------------------------
+ * Incremental geometry reconstruction: only the SMs lacking geometry are
+ * passed to the geometry library, the existing coordinates are kept
+ * ----------------------------------------------------------------------------- */
+
+#define CYBERIADA_FIT_PADDING 10.0
+
+static int cyberiada_nodes_lack_geometry(CyberiadaNode* node, int reconstruct_sm)
 {
-	int res, geom_flags;
-	CyberiadaGeometryCoordFormat old_node_coord_format, old_edge_coord_format, old_edge_pl_coord_format;
-	CyberiadaGeometryCoordFormat new_node_coord_format, new_edge_coord_format, new_edge_pl_coord_format;
-	CyberiadaGeometryEdgeFormat old_edge_format, new_edge_format;
-	HTDocument* htreegeom;
-	
-	if (!doc) {
-		ERROR("Cannot import document geometry\n");
-		return CYBERIADA_BAD_PARAMETER;
+	for (; node; node = node->next) {
+		if (!node->geometry_point && !node->geometry_rect &&
+			(node->type != cybNodeSM || reconstruct_sm)) {
+			return 1;
+		}
+		if (node->children && cyberiada_nodes_lack_geometry(node->children, reconstruct_sm)) {
+			return 1;
+		}
 	}
+	return 0;
+}
 
-	if (file_format == cybxmlYED) {
-		old_node_coord_format = coordAbsolute;
-		old_edge_coord_format = coordLocalCenter;
-		old_edge_pl_coord_format = coordAbsolute;		
-		old_edge_format = edgeCenter;
-	} else if (file_format == cybxmlCyberiada10) {
-		old_node_coord_format = coordLeftTop;
-		old_edge_coord_format = coordLeftTop;
-		old_edge_pl_coord_format = coordLeftTop;		
-		old_edge_format = edgeBorder;
+static int cyberiada_sm_lacks_geometry(CyberiadaSM* sm, int reconstruct_sm)
+{
+	CyberiadaEdge* edge;
+	if (cyberiada_nodes_lack_geometry(sm->nodes, reconstruct_sm)) {
+		return 1;
+	}
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if (!edge->geometry_source_point || !edge->geometry_target_point) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* extend the document bounding rect to contain the rect in the document node coordinates format */
+static int cyberiada_merge_bounding_rect(CyberiadaDocument* doc, const CyberiadaRect* rect)
+{
+	CyberiadaRect* r = doc->bounding_rect;
+	double x1, y1, x2, y2, rx1, ry1;
+
+	if (!rect) {
+		return CYBERIADA_NO_ERROR;
+	}
+	if (!r) {
+		doc->bounding_rect = htree_copy_rect(rect);
+		return doc->bounding_rect ? CYBERIADA_NO_ERROR : CYBERIADA_MEMORY_ERROR;
+	}
+
+	x1 = rect->x;
+	y1 = rect->y;
+	rx1 = r->x;
+	ry1 = r->y;
+	if (doc->node_coord_format == coordLocalCenter) {
+		x1 -= rect->width / 2.0;
+		y1 -= rect->height / 2.0;
+		rx1 -= r->width / 2.0;
+		ry1 -= r->height / 2.0;
+	}
+	x2 = x1 + rect->width;
+	y2 = y1 + rect->height;
+	if (rx1 + r->width > x2) x2 = rx1 + r->width;
+	if (ry1 + r->height > y2) y2 = ry1 + r->height;
+	if (rx1 < x1) x1 = rx1;
+	if (ry1 < y1) y1 = ry1;
+
+	r->width = x2 - x1;
+	r->height = y2 - y1;
+	if (doc->node_coord_format == coordLocalCenter) {
+		r->x = x1 + r->width / 2.0;
+		r->y = y1 + r->height / 2.0;
 	} else {
-		ERROR("Bad XML format %d\n", file_format);
-		return CYBERIADA_BAD_PARAMETER;
+		r->x = x1;
+		r->y = y1;
 	}
-	
-	geom_flags = flags & CYBERIADA_FLAG_NODES_GEOMETRY;
+	return CYBERIADA_NO_ERROR;
+}
+
+/* move the reconstructed geometry of the nodes lacking it from the htree, keep the existing geometry */
+static void cyberiada_fill_missing_nodes_geometry(CyberiadaNode* nodes, HTreeNode* tree_nodes)
+{
+	CyberiadaNode* node;
+	HTreeNode* t_node;
+
+	for (node = nodes, t_node = tree_nodes;
+		 node && t_node;
+		 node = node->next, t_node = t_node->next) {
+		if (!node->geometry_point && !node->geometry_rect) {
+			CYBERIADA_GEOMETRY_FROM_HTREE(node->geometry_point, t_node->point, htree_destroy_point);
+			CYBERIADA_GEOMETRY_FROM_HTREE(node->geometry_rect, t_node->rect, htree_destroy_rect);
+		}
+		if (node->children && t_node->children) {
+			cyberiada_fill_missing_nodes_geometry(node->children, t_node->children);
+		}
+	}
+}
+
+/* the edge geometry is a whole, so the edges lacking the end points take all the reconstructed geometry */
+static void cyberiada_fill_missing_edges_geometry(CyberiadaEdge* edges, HTreeEdge* tree_edges)
+{
+	CyberiadaEdge* edge;
+	HTreeEdge* t_edge;
+
+	for (edge = edges, t_edge = tree_edges;
+		 edge && t_edge;
+		 edge = edge->next, t_edge = t_edge->next) {
+		if (!edge->geometry_source_point || !edge->geometry_target_point) {
+			cyberiada_update_edge_geometry(edge, t_edge);
+		}
+	}
+}
+
+/* reconstruct the missing geometry of the single SM in the current document formats; the SM */
+/* is reconstructed by the geometry library on a copy and only the missing geometry objects   */
+/* are taken back, so the existing geometry is kept                                           */
+static int cyberiada_reconstruct_sm_geometry(CyberiadaDocument* doc, CyberiadaSM* sm, int reconstruct_sm)
+{
+	int res;
+	CyberiadaDocument sm_doc;
+	CyberiadaSM* next_sm = sm->next;
+	HTDocument* htreegeom;
+
+	memset(&sm_doc, 0, sizeof(CyberiadaDocument));
+	sm_doc.node_coord_format = doc->node_coord_format;
+	sm_doc.edge_coord_format = doc->edge_coord_format;
+	sm_doc.edge_pl_coord_format = doc->edge_pl_coord_format;
+	sm_doc.edge_geom_format = doc->edge_geom_format;
+	sm_doc.bounding_rect = doc->bounding_rect;
+	sm_doc.state_machines = sm;
+	sm->next = NULL;
+
+	htreegeom = cyberiada_to_htree_geometry(&sm_doc, 0, 0);
+	sm->next = next_sm;
+	if (!htreegeom) {
+		ERROR("Cannot convert SM geometry to htree geometry\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	res = htree_reconstruct_document_geometry(htreegeom, reconstruct_sm);
+	if (res != HTREE_OK) {
+		ERROR("Error while reconstructing htree geometry %d\n", res);
+		htree_destroy_document(htreegeom);
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	if (htreegeom->trees) {
+		cyberiada_fill_missing_nodes_geometry(sm->nodes, htreegeom->trees->nodes);
+		cyberiada_fill_missing_edges_geometry(sm->edges, htreegeom->trees->edges);
+	}
+	/* the document bounding rect grows to contain the reconstructed SM */
+	res = cyberiada_merge_bounding_rect(doc, htreegeom->bounding_rect);
+	htree_destroy_document(htreegeom);
+
+	return res;
+}
+
+static int cyberiada_reconstruct_missing_geometry(CyberiadaDocument* doc, int reconstruct_sm)
+{
+	int res;
+	CyberiadaSM* sm;
+
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		if (cyberiada_sm_lacks_geometry(sm, reconstruct_sm)) {
+			if ((res = cyberiada_reconstruct_sm_geometry(doc, sm, reconstruct_sm)) != CYBERIADA_NO_ERROR) {
+				return res;
+			}
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* extend the node rect to contain its children in the node coordinates format */
+static void cyberiada_fit_node_to_children(CyberiadaNode* node, CyberiadaGeometryCoordFormat format)
+{
+	CyberiadaNode* child;
+	CyberiadaRect* r = node->geometry_rect;
+	double x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0, cx1, cy1, cx2, cy2, dx, dy;
+	int empty = 1;
+
+	for (child = node->children; child; child = child->next) {
+		if (child->geometry_rect) {
+			cx1 = child->geometry_rect->x;
+			cy1 = child->geometry_rect->y;
+			if (format == coordLocalCenter) {
+				cx1 -= child->geometry_rect->width / 2.0;
+				cy1 -= child->geometry_rect->height / 2.0;
+			}
+			cx2 = cx1 + child->geometry_rect->width;
+			cy2 = cy1 + child->geometry_rect->height;
+		} else if (child->geometry_point) {
+			cx1 = cx2 = child->geometry_point->x;
+			cy1 = cy2 = child->geometry_point->y;
+		} else {
+			continue;
+		}
+		if (empty || cx1 < x1) x1 = cx1;
+		if (empty || cy1 < y1) y1 = cy1;
+		if (empty || cx2 > x2) x2 = cx2;
+		if (empty || cy2 > y2) y2 = cy2;
+		empty = 0;
+	}
+	if (empty) {
+		return;
+	}
+	x1 -= CYBERIADA_FIT_PADDING;
+	y1 -= CYBERIADA_FIT_PADDING;
+	x2 += CYBERIADA_FIT_PADDING;
+	y2 += CYBERIADA_FIT_PADDING;
+
+	if (format == coordAbsolute) {
+		if (x1 < r->x) {
+			r->width += r->x - x1;
+			r->x = x1;
+		}
+		if (y1 < r->y) {
+			r->height += r->y - y1;
+			r->y = y1;
+		}
+		if (x2 > r->x + r->width) r->width = x2 - r->x;
+		if (y2 > r->y + r->height) r->height = y2 - r->y;
+	} else if (format == coordLeftTop) {
+		/* move the rect origin and keep the children in place */
+		dx = x1 < 0.0 ? -x1 : 0.0;
+		dy = y1 < 0.0 ? -y1 : 0.0;
+		if (dx > 0.0 || dy > 0.0) {
+			r->x -= dx;
+			r->y -= dy;
+			r->width += dx;
+			r->height += dy;
+			for (child = node->children; child; child = child->next) {
+				if (child->geometry_rect) {
+					child->geometry_rect->x += dx;
+					child->geometry_rect->y += dy;
+				} else if (child->geometry_point) {
+					child->geometry_point->x += dx;
+					child->geometry_point->y += dy;
+				}
+			}
+		}
+		if (x2 + dx > r->width) r->width = x2 + dx;
+		if (y2 + dy > r->height) r->height = y2 + dy;
+	} else if (format == coordLocalCenter) {
+		/* the center stays in place */
+		dx = 2.0 * (-x1 > x2 ? -x1 : x2);
+		dy = 2.0 * (-y1 > y2 ? -y1 : y2);
+		if (dx > r->width) r->width = dx;
+		if (dy > r->height) r->height = dy;
+	}
+}
+
+int cyberiada_reconstruct_document_geometry_incremental(CyberiadaDocument* doc,
+														CyberiadaNode** dirty_nodes, size_t dirty_nodes_count,
+														int reconstruct_sm)
+{
+	int res;
+	size_t i;
+	CyberiadaHash dirty;
+	CyberiadaSM* sm;
+	CyberiadaEdge* edge;
+	CyberiadaNode* node;
+
+	if (!doc || (dirty_nodes_count && !dirty_nodes)) {
+		ERROR("Cannot reconstruct document geometry: bad parameters\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	cyberiada_invalidate_document_absolute_geometry(doc);
+
+	if (doc->node_coord_format == coordNone || !cyberiada_document_has_geometry(doc)) {
+		/* nothing to keep */
+		return cyberiada_reconstruct_document_geometry(doc, reconstruct_sm);
+	}
+
+	if (dirty_nodes_count) {
+		if (cyberiada_hash_init(&dirty, 0, dirty_nodes_count) != 0) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+		for (i = 0; i < dirty_nodes_count; i++) {
+			node = dirty_nodes[i];
+			if (!node) continue;
+			if (node->geometry_point) {
+				htree_destroy_point(node->geometry_point);
+				node->geometry_point = NULL;
+			}
+			if (node->geometry_rect) {
+				htree_destroy_rect(node->geometry_rect);
+				node->geometry_rect = NULL;
+			}
+			if (cyberiada_hash_put(&dirty, node, node) != 0) {
+				cyberiada_hash_free(&dirty);
+				return CYBERIADA_MEMORY_ERROR;
+			}
+		}
+		for (sm = doc->state_machines; sm; sm = sm->next) {
+			for (edge = sm->edges; edge; edge = edge->next) {
+				if (cyberiada_hash_get(&dirty, edge->source) || cyberiada_hash_get(&dirty, edge->target)) {
+					cyberiada_clean_edge_geometry(edge);
+				}
+			}
+		}
+		cyberiada_hash_free(&dirty);
+	}
+
+	if ((res = cyberiada_reconstruct_missing_geometry(doc, reconstruct_sm)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	/* the dirty composite nodes & the ancestors of the dirty nodes grow to contain the new geometry */
+	for (i = 0; i < dirty_nodes_count; i++) {
+		node = dirty_nodes[i];
+		if (node && !node->children) {
+			node = node->parent;
+		}
+		for (; node; node = node->parent) {
+			if (node->geometry_rect) {
+				cyberiada_fit_node_to_children(node, doc->node_coord_format);
+			}
+		}
+	}
+
+	return CYBERIADA_NO_ERROR;
+}
+
+int cyberiada_convert_document_geometry(CyberiadaDocument* doc,
+										CyberiadaGeometryCoordFormat new_node_coord_format,
+										CyberiadaGeometryCoordFormat new_edge_coord_format,
+										CyberiadaGeometryCoordFormat new_edge_pl_coord_format,
+										CyberiadaGeometryEdgeFormat new_edge_format)
+{
+	cyberiada_invalidate_document_absolute_geometry(doc);
+
+	return cyberiada_convert_geometry(doc,
+									  new_node_coord_format,
+									  new_edge_coord_format,
+									  new_edge_pl_coord_format,
+									  new_edge_format,
+									  0);
+}
+
+/* -----------------------------------------------------------------------------
+ * Parallel geometry import: the SMs geometry is independent, so every SM is
+ * reconstructed and converted as a separate single-SM document by the worker
+ * threads. The missing geometry is reconstructed first, every worker uses its
+ * own copy of the document bounding rect and merges the result back; then the
+ * SMs are converted with the merged rect the same way the sequential import
+ * does. The document bounding rect is converted by the caller afterwards
+ * ----------------------------------------------------------------------------- */
+
+#define CYBERIADA_PARALLEL_MAX_WORKERS 64
+
+typedef struct {
+	CyberiadaDocument*           doc;                       /* the document in the source formats */
+	int                          flags;
+	CyberiadaGeometryCoordFormat node_coord_format;
+	CyberiadaGeometryCoordFormat edge_coord_format;
+	CyberiadaGeometryCoordFormat edge_pl_coord_format;
+	CyberiadaGeometryEdgeFormat  edge_format;
+	CyberiadaSM**                sms;                       /* the detached SMs */
+	CyberiadaRect**              bounding_rects;            /* the SMs bounding rects of the reconstruction pass */
+	size_t                       sms_count;
+	size_t                       next_sm;
+	int                          reconstruct;               /* the reconstruction pass */
+	int                          res;
+#ifdef CYBERIADA_HAVE_PTHREADS
+	pthread_mutex_t              lock;
+#endif
+} CyberiadaParallelImport;
+
+static void cyberiada_import_task_lock(CyberiadaParallelImport* task)
+{
+#ifdef CYBERIADA_HAVE_PTHREADS
+	pthread_mutex_lock(&(task->lock));
+#else
+	(void)task;
+#endif
+}
+
+static void cyberiada_import_task_unlock(CyberiadaParallelImport* task)
+{
+#ifdef CYBERIADA_HAVE_PTHREADS
+	pthread_mutex_unlock(&(task->lock));
+#else
+	(void)task;
+#endif
+}
+
+static int cyberiada_import_sm_document(CyberiadaParallelImport* task, CyberiadaSM* sm, CyberiadaDocument* sm_doc)
+{
+	memset(sm_doc, 0, sizeof(CyberiadaDocument));
+	sm_doc->node_coord_format = task->doc->node_coord_format;
+	sm_doc->edge_coord_format = task->doc->edge_coord_format;
+	sm_doc->edge_pl_coord_format = task->doc->edge_pl_coord_format;
+	sm_doc->edge_geom_format = task->doc->edge_geom_format;
+	sm_doc->state_machines = sm;
+	if (task->doc->bounding_rect) {
+		sm_doc->bounding_rect = htree_copy_rect(task->doc->bounding_rect);
+		if (!sm_doc->bounding_rect) {
+			return CYBERIADA_MEMORY_ERROR;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+/* the SM is reconstructed against the document bounding rect taken before the pass (the rect */
+/* is read-only for the workers); the grown SM bounding rect is kept for the ordered merge     */
+static int cyberiada_reconstruct_sm_geometry_parallel(CyberiadaParallelImport* task, size_t index)
+{
+	int res, reconstruct_sm = task->flags & CYBERIADA_FLAG_RECONSTRUCT_SM_GEOMETRY;
+	CyberiadaSM* sm = task->sms[index];
+	CyberiadaDocument sm_doc;
+
+	if (!cyberiada_sm_lacks_geometry(sm, reconstruct_sm)) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	if ((res = cyberiada_import_sm_document(task, sm, &sm_doc)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	res = cyberiada_reconstruct_sm_geometry(&sm_doc, sm, reconstruct_sm);
+	if (res == CYBERIADA_NO_ERROR) {
+		task->bounding_rects[index] = sm_doc.bounding_rect;
+	} else if (sm_doc.bounding_rect) {
+		htree_destroy_rect(sm_doc.bounding_rect);
+	}
+	return res;
+}
+
+/* merge the SMs bounding rects into the document bounding rect in the SMs order */
+static int cyberiada_merge_sms_bounding_rects(CyberiadaParallelImport* task)
+{
+	size_t i;
+	int res = CYBERIADA_NO_ERROR;
+
+	for (i = 0; i < task->sms_count; i++) {
+		if (task->bounding_rects[i]) {
+			if (res == CYBERIADA_NO_ERROR) {
+				res = cyberiada_merge_bounding_rect(task->doc, task->bounding_rects[i]);
+			}
+			htree_destroy_rect(task->bounding_rects[i]);
+			task->bounding_rects[i] = NULL;
+		}
+	}
+	return res;
+}
+
+static int cyberiada_convert_sm_geometry_parallel(CyberiadaParallelImport* task, CyberiadaSM* sm)
+{
+	int res, skip_collapsed = task->flags & CYBERIADA_FLAG_COLLAPSED_GEOMETRY;
+	CyberiadaDocument sm_doc;
+
+	/* the document bounding rect is not changed during the conversion pass */
+	if ((res = cyberiada_import_sm_document(task, sm, &sm_doc)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
+	res = cyberiada_convert_geometry(&sm_doc,
+									 task->node_coord_format,
+									 task->edge_coord_format,
+									 task->edge_pl_coord_format,
+									 task->edge_format,
+									 skip_collapsed);
+
+	/* the document bounding rect is converted by the caller */
+	if (sm_doc.bounding_rect) {
+		htree_destroy_rect(sm_doc.bounding_rect);
+	}
+	return res;
+}
+
+static void* cyberiada_import_geometry_worker(void* arg)
+{
+	CyberiadaParallelImport* task = (CyberiadaParallelImport*)arg;
+	size_t i;
+	int res;
+
+	for (;;) {
+		cyberiada_import_task_lock(task);
+		i = task->next_sm++;
+		cyberiada_import_task_unlock(task);
+		if (i >= task->sms_count) {
+			break;
+		}
+		if (task->reconstruct) {
+			res = cyberiada_reconstruct_sm_geometry_parallel(task, i);
+		} else {
+			res = cyberiada_convert_sm_geometry_parallel(task, task->sms[i]);
+		}
+		if (res != CYBERIADA_NO_ERROR) {
+			cyberiada_import_task_lock(task);
+			if (task->res == CYBERIADA_NO_ERROR) {
+				task->res = res;
+			}
+			cyberiada_import_task_unlock(task);
+		}
+	}
+	return NULL;
+}
+
+/* run the single import pass over all SMs */
+static int cyberiada_run_import_workers(CyberiadaParallelImport* task)
+{
+#ifdef CYBERIADA_HAVE_PTHREADS
+	pthread_t workers[CYBERIADA_PARALLEL_MAX_WORKERS];
+	size_t i, workers_count = 0, max_workers;
+	long cpus;
+#endif
+
+	task->next_sm = 0;
+
+#ifdef CYBERIADA_HAVE_PTHREADS
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	max_workers = cpus > 1 ? (size_t)cpus : 1;
+	if (max_workers > task->sms_count) max_workers = task->sms_count;
+	if (max_workers > CYBERIADA_PARALLEL_MAX_WORKERS) max_workers = CYBERIADA_PARALLEL_MAX_WORKERS;
+	/* the calling thread is a worker too */
+	while (workers_count + 1 < max_workers) {
+		if (pthread_create(workers + workers_count, NULL, cyberiada_import_geometry_worker, task) != 0) {
+			break;
+		}
+		workers_count++;
+	}
+#endif
+
+	cyberiada_import_geometry_worker(task);
+
+#ifdef CYBERIADA_HAVE_PTHREADS
+	for (i = 0; i < workers_count; i++) {
+		pthread_join(workers[i], NULL);
+	}
+#endif
+
+	return task->res;
+}
+
+static int cyberiada_import_sms_geometry_parallel(CyberiadaDocument* doc, int flags,
+												  CyberiadaGeometryCoordFormat node_coord_format,
+												  CyberiadaGeometryCoordFormat edge_coord_format,
+												  CyberiadaGeometryCoordFormat edge_pl_coord_format,
+												  CyberiadaGeometryEdgeFormat edge_format)
+{
+	CyberiadaParallelImport task;
+	CyberiadaSM* sm;
+	size_t i;
+	int res;
+
+	memset(&task, 0, sizeof(CyberiadaParallelImport));
+	task.doc = doc;
+	task.flags = flags;
+	task.node_coord_format = node_coord_format;
+	task.edge_coord_format = edge_coord_format;
+	task.edge_pl_coord_format = edge_pl_coord_format;
+	task.edge_format = edge_format;
+	task.res = CYBERIADA_NO_ERROR;
+
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		task.sms_count++;
+	}
+	task.sms = (CyberiadaSM**)malloc(sizeof(CyberiadaSM*) * task.sms_count);
+	if (!task.sms) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	/* detach the SMs so that every worker sees a single-SM list */
+	for (i = 0, sm = doc->state_machines; sm; sm = sm->next, i++) {
+		task.sms[i] = sm;
+	}
+	for (i = 0; i < task.sms_count; i++) {
+		task.sms[i]->next = NULL;
+	}
+
+#ifdef CYBERIADA_HAVE_PTHREADS
+	pthread_mutex_init(&(task.lock), NULL);
+#endif
+
+	if (flags & (CYBERIADA_FLAG_RECONSTRUCT_GEOMETRY | CYBERIADA_FLAG_RECONSTRUCT_SM_GEOMETRY)) {
+		task.bounding_rects = (CyberiadaRect**)calloc(task.sms_count, sizeof(CyberiadaRect*));
+		if (!task.bounding_rects) {
+			task.res = CYBERIADA_MEMORY_ERROR;
+		} else {
+			task.reconstruct = 1;
+			cyberiada_run_import_workers(&task);
+			task.reconstruct = 0;
+			res = cyberiada_merge_sms_bounding_rects(&task);
+			if (task.res == CYBERIADA_NO_ERROR) {
+				task.res = res;
+			}
+			free(task.bounding_rects);
+			task.bounding_rects = NULL;
+		}
+	}
+	if (task.res == CYBERIADA_NO_ERROR) {
+		cyberiada_run_import_workers(&task);
+	}
+
+#ifdef CYBERIADA_HAVE_PTHREADS
+	pthread_mutex_destroy(&(task.lock));
+#endif
+
+	for (i = 0; i + 1 < task.sms_count; i++) {
+		task.sms[i]->next = task.sms[i + 1];
+	}
+	free(task.sms);
+
+	return task.res;
+}
+
+int cyberiada_import_document_geometry(CyberiadaDocument* doc,
+									   int flags, CyberiadaXMLFormat file_format)
+{
+	int res, geom_flags;
+	CyberiadaGeometryCoordFormat old_node_coord_format, old_edge_coord_format, old_edge_pl_coord_format;
+	CyberiadaGeometryCoordFormat new_node_coord_format, new_edge_coord_format, new_edge_pl_coord_format;
+	CyberiadaGeometryEdgeFormat old_edge_format, new_edge_format;
+	CyberiadaSM* sms;
+	
+	if (!doc) {
+		ERROR("Cannot import document geometry\n");
+		return CYBERIADA_BAD_PARAMETER;
+	}
+
+	cyberiada_invalidate_document_absolute_geometry(doc);
+
+	if (file_format == cybxmlYED) {
+		old_node_coord_format = coordAbsolute;
+		old_edge_coord_format = coordLocalCenter;
+		old_edge_pl_coord_format = coordAbsolute;		
+		old_edge_format = edgeCenter;
+	} else if (file_format == cybxmlCyberiada10) {
+		old_node_coord_format = coordLeftTop;
+		old_edge_coord_format = coordLeftTop;
+		old_edge_pl_coord_format = coordLeftTop;		
+		old_edge_format = edgeBorder;
+	} else {
+		ERROR("Bad XML format %d\n", file_format);
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	
+	geom_flags = flags & CYBERIADA_FLAG_NODES_GEOMETRY;
 	if (geom_flags) {
 		if (geom_flags == CYBERIADA_FLAG_NODES_ABSOLUTE_GEOMETRY) {
 			new_node_coord_format = coordAbsolute;
@@ -623,73 +1384,545 @@ int cyberiada_import_document_geometry(CyberiadaDocument* doc,
 	doc->edge_coord_format = old_edge_coord_format;
 	doc->edge_pl_coord_format = old_edge_pl_coord_format;
 	doc->edge_geom_format = old_edge_format;
+
+	sms = doc->state_machines;
+	if ((flags & CYBERIADA_FLAG_PARALLEL_GEOMETRY) && sms && sms->next) {
+		if ((res = cyberiada_import_sms_geometry_parallel(doc, flags,
+														  new_node_coord_format,
+														  new_edge_coord_format,
+														  new_edge_pl_coord_format,
+														  new_edge_format)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+		/* the SMs are converted, only the bounding rect & the formats are left */
+		doc->state_machines = NULL;
+	} else if (flags & (CYBERIADA_FLAG_RECONSTRUCT_GEOMETRY | CYBERIADA_FLAG_RECONSTRUCT_SM_GEOMETRY)) {
+		if ((res = cyberiada_reconstruct_missing_geometry(doc,
+														  flags & CYBERIADA_FLAG_RECONSTRUCT_SM_GEOMETRY)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+
+	res = cyberiada_convert_geometry(doc,
+									 new_node_coord_format,
+									 new_edge_coord_format,
+									 new_edge_pl_coord_format,
+									 new_edge_format,
+									 flags & CYBERIADA_FLAG_COLLAPSED_GEOMETRY);
+	doc->state_machines = sms;
+	if (res != CYBERIADA_NO_ERROR) {
+		return res;
+	}
 	
-	htreegeom = cyberiada_to_htree_geometry(doc);
+	if (flags & CYBERIADA_FLAG_ROUND_GEOMETRY) {
+		cyberiada_round_document_geometry(doc);
+	}
 	
-	if (!htreegeom) {
-		ERROR("Cannot convert document geometry to htree geometry\n");
+	return CYBERIADA_NO_ERROR;
+}
+
+static int cyberiada_export_geometry_formats(CyberiadaXMLFormat file_format,
+											 CyberiadaGeometryCoordFormat* to_node_coord_format,
+											 CyberiadaGeometryCoordFormat* to_edge_coord_format,
+											 CyberiadaGeometryCoordFormat* to_edge_pl_coord_format,
+											 CyberiadaGeometryEdgeFormat* to_edge_format)
+{
+	if (file_format == cybxmlYED) {
+		*to_node_coord_format = coordAbsolute;
+		*to_edge_coord_format = coordLocalCenter;
+		*to_edge_pl_coord_format = coordAbsolute;
+		*to_edge_format = edgeCenter;
+	} else if (file_format == cybxmlCyberiada10) {
+		*to_node_coord_format = *to_edge_coord_format = *to_edge_pl_coord_format = coordLeftTop;
+		*to_edge_format = edgeBorder;
+	} else {
+		ERROR("Bad XML format %d\n", file_format);
 		return CYBERIADA_BAD_PARAMETER;
 	}
-	
-	if (flags & (CYBERIADA_FLAG_RECONSTRUCT_GEOMETRY | CYBERIADA_FLAG_RECONSTRUCT_SM_GEOMETRY)) {
-		if ((res = htree_reconstruct_document_geometry(htreegeom,
-													   flags & CYBERIADA_FLAG_RECONSTRUCT_SM_GEOMETRY)) != HTREE_OK) {
-			ERROR("Error while reconstructing htree geometry %d\n", res);
-			htree_destroy_document(htreegeom);
-			return CYBERIADA_BAD_PARAMETER;
+	return CYBERIADA_NO_ERROR;
+}
+
+/* -----------------------------------------------------------------------------
+ * The geometry table: converted geometry of the document nodes & edges stored
+ * aside of the document itself (the document is not modified)
+ * ----------------------------------------------------------------------------- */
+
+static int cyberiada_geometry_table_key_cmp(uintptr_t a, uintptr_t b)
+{
+	if (a < b) {
+		return -1;
+	} else if (a > b) {
+		return 1;
+	} else {
+		return 0;
+	}
+}
+
+static int cyberiada_node_geometry_cmp(const void* a, const void* b)
+{
+	return cyberiada_geometry_table_key_cmp((uintptr_t)((const CyberiadaNodeGeometry*)a)->node,
+											(uintptr_t)((const CyberiadaNodeGeometry*)b)->node);
+}
+
+static int cyberiada_edge_geometry_cmp(const void* a, const void* b)
+{
+	return cyberiada_geometry_table_key_cmp((uintptr_t)((const CyberiadaEdgeGeometry*)a)->edge,
+											(uintptr_t)((const CyberiadaEdgeGeometry*)b)->edge);
+}
+
+static void cyberiada_geometry_table_take_nodes(CyberiadaGeometryTable* table,
+												CyberiadaNode* nodes, HTreeNode* tree_nodes)
+{
+	CyberiadaNode* node;
+	HTreeNode* t_node;
+	CyberiadaNodeGeometry* entry;
+
+	for (node = nodes, t_node = tree_nodes;
+		 node && t_node;
+		 node = node->next, t_node = t_node->next) {
+		if (t_node->point || t_node->rect) {
+			entry = table->nodes + table->nodes_count++;
+			entry->node = node;
+			/* the converted geometry is moved from the htree */
+			entry->point = t_node->point;
+			entry->rect = t_node->rect;
+			t_node->point = NULL;
+			t_node->rect = NULL;
+		}
+		if (node->children && t_node->children) {
+			cyberiada_geometry_table_take_nodes(table, node->children, t_node->children);
 		}
 	}
+}
 
-	if ((res = htree_convert_document_geometry(htreegeom,
-											   new_node_coord_format,
-											   new_edge_coord_format,
-											   new_edge_pl_coord_format,
-											   new_edge_format)) != HTREE_OK) {
-		ERROR("Error while converting document geometry %d\n", res);
-		htree_destroy_document(htreegeom);
-		return CYBERIADA_BAD_PARAMETER;
+static void cyberiada_geometry_table_take_edges(CyberiadaGeometryTable* table,
+												CyberiadaEdge* edges, HTreeEdge* tree_edges)
+{
+	CyberiadaEdge* edge;
+	HTreeEdge* t_edge;
+	CyberiadaEdgeGeometry* entry;
+
+	for (edge = edges, t_edge = tree_edges;
+		 edge && t_edge;
+		 edge = edge->next, t_edge = t_edge->next) {
+		if (t_edge->polyline || t_edge->source_point || t_edge->target_point || t_edge->label_point) {
+			entry = table->edges + table->edges_count++;
+			entry->edge = edge;
+			entry->polyline = t_edge->polyline;
+			entry->source_point = t_edge->source_point;
+			entry->target_point = t_edge->target_point;
+			entry->label_point = t_edge->label_point;
+			t_edge->polyline = NULL;
+			t_edge->source_point = NULL;
+			t_edge->target_point = NULL;
+			t_edge->label_point = NULL;
+		}
 	}
+}
 
-	cyberiada_update_geometry(doc, htreegeom);
-	htree_destroy_document(htreegeom);
+static CyberiadaGeometryTable* cyberiada_new_geometry_table(CyberiadaDocument* doc)
+{
+	CyberiadaGeometryTable* table;
+	CyberiadaSM* sm;
+	CyberiadaEdge* edge;
+	size_t nodes_count = 0, edges_count = 0;
 	
-	if (flags & CYBERIADA_FLAG_ROUND_GEOMETRY) {
-		cyberiada_round_document_geometry(doc);
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		nodes_count += cyberiada_count_nodes(sm->nodes);
+		for (edge = sm->edges; edge; edge = edge->next) {
+			edges_count++;
+		}
 	}
-	
+
+	table = (CyberiadaGeometryTable*)malloc(sizeof(CyberiadaGeometryTable));
+	if (!table) {
+		return NULL;
+	}
+	memset(table, 0, sizeof(CyberiadaGeometryTable));
+	if (nodes_count) {
+		table->nodes = (CyberiadaNodeGeometry*)malloc(sizeof(CyberiadaNodeGeometry) * nodes_count);
+	}
+	if (edges_count) {
+		table->edges = (CyberiadaEdgeGeometry*)malloc(sizeof(CyberiadaEdgeGeometry) * edges_count);
+	}
+	if ((nodes_count && !table->nodes) || (edges_count && !table->edges)) {
+		cyberiada_destroy_geometry_table(table);
+		return NULL;
+	}
+	return table;
+}
+
+static void cyberiada_round_geometry_table(CyberiadaGeometryTable* table)
+{
+	size_t i;
+	CyberiadaPolyline* pl;
+
+	if (table->bounding_rect) {
+		htree_round_rect(table->bounding_rect, 0);
+	}
+	for (i = 0; i < table->nodes_count; i++) {
+		/* the same nodes as cyberiada_round_node_geometry() does */
+		if (table->nodes[i].node->children) {
+			if (table->nodes[i].point) {
+				htree_round_point(table->nodes[i].point, 0);
+			}
+			if (table->nodes[i].rect) {
+				htree_round_rect(table->nodes[i].rect, 0);
+			}
+		}
+	}
+	for (i = 0; i < table->edges_count; i++) {
+		if (table->edges[i].source_point) {
+			htree_round_point(table->edges[i].source_point, 0);
+		}
+		if (table->edges[i].target_point) {
+			htree_round_point(table->edges[i].target_point, 0);
+		}
+		if (table->edges[i].label_point) {
+			htree_round_point(table->edges[i].label_point, 0);
+		}
+		for (pl = table->edges[i].polyline; pl; pl = pl->next) {
+			htree_round_point(&(pl->point), 0);
+		}
+	}
+}
+
+/* -----------------------------------------------------------------------------
+ * Geometry simplification: Ramer-Douglas-Peucker polyline simplification and
+ * coordinates quantization to the grid
+ * ----------------------------------------------------------------------------- */
+
+static double cyberiada_segment_distance(const CyberiadaPoint* p, const CyberiadaPoint* a, const CyberiadaPoint* b)
+{
+	double dx = b->x - a->x, dy = b->y - a->y, len2 = dx * dx + dy * dy, t;
+	if (len2 == 0.0) {
+		return hypot(p->x - a->x, p->y - a->y);
+	}
+	t = ((p->x - a->x) * dx + (p->y - a->y) * dy) / len2;
+	if (t < 0.0) t = 0.0;
+	if (t > 1.0) t = 1.0;
+	return hypot(p->x - (a->x + t * dx), p->y - (a->y + t * dy));
+}
+
+/* the source & target anchors (if any) are the fixed ends of the simplified line, the polyline
+   points are all removable; the anchors should be in the polyline coordinates frame */
+static int cyberiada_simplify_polyline(CyberiadaPolyline** polyline,
+									   const CyberiadaPoint* source, const CyberiadaPoint* target,
+									   double tolerance)
+{
+	CyberiadaPolyline *pl, *prev, *next;
+	const CyberiadaPoint** points;
+	char* keep;
+	size_t* stack;
+	size_t count = 0, stack_size = 0, first, last, i, max_i, offset;
+	double d, max_d;
+
+	offset = source ? 1 : 0;
+	for (pl = *polyline; pl; pl = pl->next) {
+		count++;
+	}
+	if (!count) {
+		return CYBERIADA_NO_ERROR;
+	}
+	count += offset + (target ? 1 : 0);
+	if (count < 3) {
+		return CYBERIADA_NO_ERROR;
+	}
+
+	points = (const CyberiadaPoint**)malloc(sizeof(CyberiadaPoint*) * count);
+	keep = (char*)calloc(count, 1);
+	stack = (size_t*)malloc(sizeof(size_t) * 2 * count);
+	if (!points || !keep || !stack) {
+		if (points) free(points);
+		if (keep) free(keep);
+		if (stack) free(stack);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (source) {
+		points[0] = source;
+	}
+	for (i = offset, pl = *polyline; pl; pl = pl->next, i++) {
+		points[i] = &(pl->point);
+	}
+	if (target) {
+		points[count - 1] = target;
+	}
+
+	keep[0] = keep[count - 1] = 1;
+	stack[stack_size++] = 0;
+	stack[stack_size++] = count - 1;
+	while (stack_size > 0) {
+		last = stack[--stack_size];
+		first = stack[--stack_size];
+		max_d = 0.0;
+		max_i = first;
+		for (i = first + 1; i < last; i++) {
+			d = cyberiada_segment_distance(points[i], points[first], points[last]);
+			if (d > max_d) {
+				max_d = d;
+				max_i = i;
+			}
+		}
+		if (max_d > tolerance) {
+			keep[max_i] = 1;
+			stack[stack_size++] = first;
+			stack[stack_size++] = max_i;
+			stack[stack_size++] = max_i;
+			stack[stack_size++] = last;
+		}
+	}
+
+	for (i = offset, prev = NULL, pl = *polyline; pl; pl = next, i++) {
+		next = pl->next;
+		if (keep[i]) {
+			prev = pl;
+		} else {
+			if (prev) {
+				prev->next = next;
+			} else {
+				*polyline = next;
+			}
+			pl->next = NULL;
+			htree_destroy_polyline(pl);
+		}
+	}
+
+	free(points);
+	free(keep);
+	free(stack);
 	return CYBERIADA_NO_ERROR;
 }
 
-int cyberiada_export_document_geometry(CyberiadaDocument* doc,
-									   int flags, CyberiadaXMLFormat file_format)
+static double cyberiada_quantize(double v, double grid)
+{
+	return round(v / grid) * grid;
+}
+
+/* the positive sizes are kept at least one grid step, so the small rects do not collapse */
+static double cyberiada_quantize_size(double v, double grid)
+{
+	double q = cyberiada_quantize(v, grid);
+	if (v > 0.0 && q < grid) {
+		q = grid;
+	}
+	return q;
+}
+
+static void cyberiada_quantize_point(CyberiadaPoint* p, double grid)
+{
+	if (p && grid > 0.0) {
+		p->x = cyberiada_quantize(p->x, grid);
+		p->y = cyberiada_quantize(p->y, grid);
+	}
+}
+
+static void cyberiada_quantize_rect(CyberiadaRect* r, double grid)
+{
+	if (r && grid > 0.0) {
+		r->x = cyberiada_quantize(r->x, grid);
+		r->y = cyberiada_quantize(r->y, grid);
+		r->width = cyberiada_quantize_size(r->width, grid);
+		r->height = cyberiada_quantize_size(r->height, grid);
+	}
+}
+
+/* the edge source & target points in the polyline coordinates frame; the polyline local frames
+   differ from the absolute one by the offset only, so it is taken from the first polyline point */
+static void cyberiada_edge_anchors(const CyberiadaEdgeGeometry* abs_geometry, const CyberiadaPolyline* polyline,
+								   CyberiadaPoint* source, CyberiadaPoint* target,
+								   const CyberiadaPoint** source_anchor, const CyberiadaPoint** target_anchor)
+{
+	double dx, dy;
+
+	*source_anchor = *target_anchor = NULL;
+	if (!abs_geometry || !abs_geometry->polyline || !polyline) {
+		return;
+	}
+	dx = polyline->point.x - abs_geometry->polyline->point.x;
+	dy = polyline->point.y - abs_geometry->polyline->point.y;
+	if (abs_geometry->source_point) {
+		source->x = abs_geometry->source_point->x + dx;
+		source->y = abs_geometry->source_point->y + dy;
+		*source_anchor = source;
+	}
+	if (abs_geometry->target_point) {
+		target->x = abs_geometry->target_point->x + dx;
+		target->y = abs_geometry->target_point->y + dy;
+		*target_anchor = target;
+	}
+}
+
+/* abs_geometry is the edge geometry with the absolute source/target points & polyline */
+static int cyberiada_simplify_edge(CyberiadaPolyline** polyline,
+								   CyberiadaPoint* source_point, CyberiadaPoint* target_point,
+								   CyberiadaPoint* label_point, const CyberiadaEdgeGeometry* abs_geometry,
+								   double tolerance, double grid)
 {
+	CyberiadaPolyline* pl;
+	CyberiadaPoint source, target;
+	const CyberiadaPoint *source_anchor, *target_anchor;
 	int res;
-	CyberiadaGeometryCoordFormat to_node_coord_format, to_edge_coord_format, to_edge_pl_coord_format;
-	CyberiadaGeometryEdgeFormat to_edge_format;
-	HTDocument* htreegeom;
-	
-	if (!doc) {
-		ERROR("Cannot export document geometry\n");
+	if (tolerance > 0.0) {
+		cyberiada_edge_anchors(abs_geometry, *polyline, &source, &target, &source_anchor, &target_anchor);
+		if ((res = cyberiada_simplify_polyline(polyline, source_anchor, target_anchor,
+											   tolerance)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	for (pl = *polyline; pl; pl = pl->next) {
+		cyberiada_quantize_point(&(pl->point), grid);
+	}
+	cyberiada_quantize_point(source_point, grid);
+	cyberiada_quantize_point(target_point, grid);
+	cyberiada_quantize_point(label_point, grid);
+	return CYBERIADA_NO_ERROR;
+}
+
+static void cyberiada_quantize_nodes(CyberiadaNode* node, double grid)
+{
+	for (; node; node = node->next) {
+		cyberiada_quantize_point(node->geometry_point, grid);
+		cyberiada_quantize_rect(node->geometry_rect, grid);
+		cyberiada_quantize_nodes(node->children, grid);
+	}
+}
+
+static CyberiadaGeometryTable* cyberiada_new_converted_geometry_table(CyberiadaDocument* doc,
+																	   int flags,
+																	   CyberiadaGeometryCoordFormat to_node_coord_format,
+																	   CyberiadaGeometryCoordFormat to_edge_coord_format,
+																	   CyberiadaGeometryCoordFormat to_edge_pl_coord_format,
+																	   CyberiadaGeometryEdgeFormat to_edge_format,
+																	   double tolerance, double grid);
+
+int cyberiada_simplify_document_geometry(CyberiadaDocument* doc, double tolerance, double grid)
+{
+	CyberiadaSM* sm;
+	CyberiadaEdge* edge;
+	CyberiadaGeometryTable* abs_table = NULL;
+	CyberiadaEdgeGeometry own;
+	const CyberiadaEdgeGeometry* abs_geometry;
+	int absolute, res = CYBERIADA_NO_ERROR;
+
+	if (!doc || tolerance < 0.0 || grid < 0.0) {
+		ERROR("Cannot simplify document geometry: bad parameters\n");
 		return CYBERIADA_BAD_PARAMETER;
 	}
+
+	absolute = doc->edge_coord_format == coordAbsolute && doc->edge_pl_coord_format == coordAbsolute;
+	if (tolerance > 0.0 && !absolute) {
+		/* the edge ends anchors are taken from the absolute geometry */
+		for (sm = doc->state_machines; sm && !abs_table; sm = sm->next) {
+			for (edge = sm->edges; edge; edge = edge->next) {
+				if (edge->geometry_polyline) {
+					abs_table = cyberiada_new_converted_geometry_table(doc, 0,
+																	   doc->node_coord_format,
+																	   coordAbsolute,
+																	   coordAbsolute,
+																	   doc->edge_geom_format,
+																	   0.0, 0.0);
+					if (!abs_table) {
+						ERROR("Cannot convert document geometry to absolute coordinates\n");
+						return CYBERIADA_BAD_PARAMETER;
+					}
+					break;
+				}
+			}
+		}
+	}
+
+	cyberiada_invalidate_document_absolute_geometry(doc);
+
+	cyberiada_quantize_rect(doc->bounding_rect, grid);
+	for (sm = doc->state_machines; sm && res == CYBERIADA_NO_ERROR; sm = sm->next) {
+		cyberiada_quantize_nodes(sm->nodes, grid);
+		for (edge = sm->edges; edge; edge = edge->next) {
+			if (absolute) {
+				own.polyline = edge->geometry_polyline;
+				own.source_point = edge->geometry_source_point;
+				own.target_point = edge->geometry_target_point;
+				abs_geometry = &own;
+			} else {
+				abs_geometry = cyberiada_geometry_table_edge(abs_table, edge);
+			}
+			if ((res = cyberiada_simplify_edge(&(edge->geometry_polyline),
+											   edge->geometry_source_point,
+											   edge->geometry_target_point,
+											   edge->geometry_label_point,
+											   abs_geometry,
+											   tolerance, grid)) != CYBERIADA_NO_ERROR) {
+				break;
+			}
+		}
+	}
+
+	if (abs_table) {
+		cyberiada_destroy_geometry_table(abs_table);
+	}
+	return res;
+}
+
+/* abs_table is the table geometry with the absolute edges coordinates (NULL if the table is absolute) */
+static int cyberiada_simplify_geometry_table(CyberiadaGeometryTable* table, const CyberiadaGeometryTable* abs_table,
+											 double tolerance, double grid)
+{
+	size_t i;
+	int res;
+
+	cyberiada_quantize_rect(table->bounding_rect, grid);
+	for (i = 0; i < table->nodes_count; i++) {
+		cyberiada_quantize_point(table->nodes[i].point, grid);
+		cyberiada_quantize_rect(table->nodes[i].rect, grid);
+	}
+	for (i = 0; i < table->edges_count; i++) {
+		if ((res = cyberiada_simplify_edge(&(table->edges[i].polyline),
+										   table->edges[i].source_point,
+										   table->edges[i].target_point,
+										   table->edges[i].label_point,
+										   abs_table ?
+										   cyberiada_geometry_table_edge(abs_table, table->edges[i].edge) :
+										   table->edges + i,
+										   tolerance, grid)) != CYBERIADA_NO_ERROR) {
+			return res;
+		}
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static CyberiadaGeometryTable* cyberiada_new_converted_geometry_table(CyberiadaDocument* doc,
+																	   int flags,
+																	   CyberiadaGeometryCoordFormat to_node_coord_format,
+																	   CyberiadaGeometryCoordFormat to_edge_coord_format,
+																	   CyberiadaGeometryCoordFormat to_edge_pl_coord_format,
+																	   CyberiadaGeometryEdgeFormat to_edge_format,
+																	   double tolerance, double grid)
+{
+	int res;
+	CyberiadaGeometryTable *table, *abs_table = NULL;
+	HTDocument* htreegeom;
+	HTree* tree;
+	CyberiadaSM* sm;
 	
-	if (file_format == cybxmlYED) {
-		to_node_coord_format = coordAbsolute;
-		to_edge_coord_format = coordLocalCenter;
-		to_edge_pl_coord_format = coordAbsolute;
-		to_edge_format = edgeCenter;
-	} else if (file_format == cybxmlCyberiada10) {
-		to_node_coord_format = to_edge_coord_format = to_edge_pl_coord_format = coordLeftTop;
-		to_edge_format = edgeBorder;
-	} else {
-		ERROR("Bad XML format %d\n", file_format);
-		return CYBERIADA_BAD_PARAMETER;
+	table = cyberiada_new_geometry_table(doc);
+	if (!table) {
+		ERROR("Cannot allocate geometry table\n");
+		return NULL;
 	}
+	table->node_coord_format = to_node_coord_format;
+	table->edge_coord_format = to_edge_coord_format;
+	table->edge_pl_coord_format = to_edge_pl_coord_format;
+	table->edge_geom_format = to_edge_format;
 
-	htreegeom = cyberiada_to_htree_geometry(doc);
+	if (flags & CYBERIADA_FLAG_SKIP_GEOMETRY) {
+		/* the empty table */
+		return table;
+	}
+	
+	htreegeom = cyberiada_to_htree_geometry(doc, 0, flags & CYBERIADA_FLAG_COLLAPSED_GEOMETRY);
 	if (!htreegeom) {
 		ERROR("Cannot convert document geometry to htree geometry\n");
-		return CYBERIADA_BAD_PARAMETER;
+		cyberiada_destroy_geometry_table(table);
+		return NULL;
 	}
 
 	if ((res = htree_convert_document_geometry(htreegeom,
@@ -699,19 +1932,168 @@ int cyberiada_export_document_geometry(CyberiadaDocument* doc,
 											   to_edge_format)) != HTREE_OK) {
 		ERROR("Error while converting document geometry %d\n", res);
 		htree_destroy_document(htreegeom);
-		return CYBERIADA_BAD_PARAMETER;
+		cyberiada_destroy_geometry_table(table);
+		return NULL;
 	}
 
-	cyberiada_update_geometry(doc, htreegeom);
+	table->bounding_rect = htreegeom->bounding_rect;
+	htreegeom->bounding_rect = NULL;
+	for (sm = doc->state_machines, tree = htreegeom->trees;
+		 sm && tree;
+		 sm = sm->next, tree = tree->next) {
+		cyberiada_geometry_table_take_nodes(table, sm->nodes, tree->nodes);
+		cyberiada_geometry_table_take_edges(table, sm->edges, tree->edges);
+	}
 	htree_destroy_document(htreegeom);
+
+	if (table->nodes_count > 1) {
+		qsort(table->nodes, table->nodes_count, sizeof(CyberiadaNodeGeometry), cyberiada_node_geometry_cmp);
+	}
+	if (table->edges_count > 1) {
+		qsort(table->edges, table->edges_count, sizeof(CyberiadaEdgeGeometry), cyberiada_edge_geometry_cmp);
+	}
 	
 	if (flags & CYBERIADA_FLAG_ROUND_GEOMETRY) {
-		cyberiada_round_document_geometry(doc);
+		cyberiada_round_geometry_table(table);
+	}
+
+	if (flags & CYBERIADA_FLAG_SIMPLIFY_GEOMETRY) {
+		if (tolerance > 0.0 && table->edges_count &&
+			(to_edge_coord_format != coordAbsolute || to_edge_pl_coord_format != coordAbsolute)) {
+			/* the edge ends anchors are taken from the absolute geometry */
+			abs_table = cyberiada_new_converted_geometry_table(doc, flags & CYBERIADA_FLAG_COLLAPSED_GEOMETRY,
+															   to_node_coord_format,
+															   coordAbsolute,
+															   coordAbsolute,
+															   to_edge_format,
+															   0.0, 0.0);
+			if (!abs_table) {
+				ERROR("Cannot convert document geometry to absolute coordinates\n");
+				cyberiada_destroy_geometry_table(table);
+				return NULL;
+			}
+		}
+		res = cyberiada_simplify_geometry_table(table, abs_table, tolerance, grid);
+		if (abs_table) {
+			cyberiada_destroy_geometry_table(abs_table);
+		}
+		if (res != CYBERIADA_NO_ERROR) {
+			ERROR("Cannot simplify geometry table\n");
+			cyberiada_destroy_geometry_table(table);
+			return NULL;
+		}
 	}
 	
-	return CYBERIADA_NO_ERROR;
+	return table;
+}
+
+CyberiadaGeometryTable* cyberiada_new_export_geometry_table(CyberiadaDocument* doc,
+															int flags, CyberiadaXMLFormat file_format,
+															double tolerance, double grid)
+{
+	CyberiadaGeometryCoordFormat to_node_coord_format, to_edge_coord_format, to_edge_pl_coord_format;
+	CyberiadaGeometryEdgeFormat to_edge_format;
+	
+	if (!doc) {
+		ERROR("Cannot export document geometry\n");
+		return NULL;
+	}
+
+	if (cyberiada_export_geometry_formats(file_format,
+										  &to_node_coord_format,
+										  &to_edge_coord_format,
+										  &to_edge_pl_coord_format,
+										  &to_edge_format) != CYBERIADA_NO_ERROR) {
+		return NULL;
+	}
+
+	return cyberiada_new_converted_geometry_table(doc, flags,
+												  to_node_coord_format,
+												  to_edge_coord_format,
+												  to_edge_pl_coord_format,
+												  to_edge_format,
+												  tolerance, grid);
+}
+
+CyberiadaGeometryTable* cyberiada_new_absolute_geometry_table(CyberiadaDocument* doc)
+{
+	if (!doc) {
+		ERROR("Cannot convert document geometry\n");
+		return NULL;
+	}
+
+	return cyberiada_new_converted_geometry_table(doc, 0,
+												  coordAbsolute,
+												  coordAbsolute,
+												  coordAbsolute,
+												  edgeBorder,
+												  0.0, 0.0);
 }
 
+const CyberiadaNodeGeometry* cyberiada_geometry_table_node(const CyberiadaGeometryTable* table,
+														   const CyberiadaNode* node)
+{
+	CyberiadaNodeGeometry key;
+	if (!table || !node || !table->nodes_count) {
+		return NULL;
+	}
+	key.node = node;
+	return (const CyberiadaNodeGeometry*)bsearch(&key, table->nodes, table->nodes_count,
+												 sizeof(CyberiadaNodeGeometry), cyberiada_node_geometry_cmp);
+}
+
+const CyberiadaEdgeGeometry* cyberiada_geometry_table_edge(const CyberiadaGeometryTable* table,
+														   const CyberiadaEdge* edge)
+{
+	CyberiadaEdgeGeometry key;
+	if (!table || !edge || !table->edges_count) {
+		return NULL;
+	}
+	key.edge = edge;
+	return (const CyberiadaEdgeGeometry*)bsearch(&key, table->edges, table->edges_count,
+												 sizeof(CyberiadaEdgeGeometry), cyberiada_edge_geometry_cmp);
+}
+
+int cyberiada_destroy_geometry_table(CyberiadaGeometryTable* table)
+{
+	size_t i;
+	if (!table) {
+		return CYBERIADA_BAD_PARAMETER;
+	}
+	for (i = 0; i < table->nodes_count; i++) {
+		if (table->nodes[i].point) {
+			htree_destroy_point(table->nodes[i].point);
+		}
+		if (table->nodes[i].rect) {
+			htree_destroy_rect(table->nodes[i].rect);
+		}
+	}
+	for (i = 0; i < table->edges_count; i++) {
+		if (table->edges[i].polyline) {
+			htree_destroy_polyline(table->edges[i].polyline);
+		}
+		if (table->edges[i].source_point) {
+			htree_destroy_point(table->edges[i].source_point);
+		}
+		if (table->edges[i].target_point) {
+			htree_destroy_point(table->edges[i].target_point);
+		}
+		if (table->edges[i].label_point) {
+			htree_destroy_point(table->edges[i].label_point);
+		}
+	}
+	if (table->bounding_rect) {
+		htree_destroy_rect(table->bounding_rect);
+	}
+	if (table->nodes) {
+		free(table->nodes);
+	}
+	if (table->edges) {
+		free(table->edges);
+	}
+	free(table);
+	return CYBERIADA_NO_ERROR;
+}
 
 int cyberiada_reconstruct_document_geometry(CyberiadaDocument* doc, int reconstruct_sm)
 {
@@ -720,7 +2102,7 @@ int cyberiada_reconstruct_document_geometry(CyberiadaDocument* doc, int reconstr
 
 	cyberiada_clean_document_geometry(doc);
 	
-	htreegeom = cyberiada_to_htree_geometry(doc);
+	htreegeom = cyberiada_to_htree_geometry(doc, 1, 0);
 	if (!htreegeom) {
 		ERROR("Cannot convert document geometry to htree geometry\n");
 		return CYBERIADA_BAD_PARAMETER;
@@ -728,11 +2110,12 @@ int cyberiada_reconstruct_document_geometry(CyberiadaDocument* doc, int reconstr
 
 	if ((res = htree_reconstruct_document_geometry(htreegeom, reconstruct_sm)) != HTREE_OK) {
 		ERROR("Error while reconstructing htree geometry %d\n", res);
+		cyberiada_return_htree_geometry(doc, htreegeom, 0);
 		htree_destroy_document(htreegeom);
 		return CYBERIADA_BAD_PARAMETER;
 	}
 
-	cyberiada_update_geometry(doc, htreegeom);
+	cyberiada_update_geometry(doc, htreegeom, 0);
 	htree_destroy_document(htreegeom);
 	
 	return CYBERIADA_NO_ERROR;
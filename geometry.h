@@ -42,7 +42,12 @@ extern "C" {
 	
 	int                cyberiada_document_no_geometry(CyberiadaDocument* doc);
 	int                cyberiada_clean_document_geometry(CyberiadaDocument* doc);
+	int                cyberiada_clean_edge_geometry(CyberiadaEdge* edge);
 	int                cyberiada_reconstruct_document_geometry(CyberiadaDocument* doc, int reconstruct_sm);
+	int                cyberiada_reconstruct_document_geometry_incremental(CyberiadaDocument* doc,
+																		   CyberiadaNode** dirty_nodes,
+																		   size_t dirty_nodes_count,
+																		   int reconstruct_sm);
 	int                cyberiada_convert_document_geometry(CyberiadaDocument* doc,
 														   CyberiadaGeometryCoordFormat new_node_coord_format,
 														   CyberiadaGeometryCoordFormat new_edge_coord_format,
@@ -50,10 +55,49 @@ extern "C" {
 														   CyberiadaGeometryEdgeFormat new_edge_format);
 	int                cyberiada_import_document_geometry(CyberiadaDocument* doc,
 														  int flags, CyberiadaXMLFormat file_format);
-	int                cyberiada_export_document_geometry(CyberiadaDocument* doc,
-														  int flags, CyberiadaXMLFormat file_format);
 	int                cyberiada_document_has_geometry(CyberiadaDocument* doc);
 	int                cyberiada_check_nodes_geometry(CyberiadaNode* nodes);
+
+/* -----------------------------------------------------------------------------
+ * The geometry table: the document geometry converted to the target format &
+ * stored aside of the document; the table lookups use the node/edge pointers
+ * ----------------------------------------------------------------------------- */
+
+	typedef struct {
+		const CyberiadaNode*         node;
+		CyberiadaPoint*              point;
+		CyberiadaRect*               rect;
+	} CyberiadaNodeGeometry;
+
+	typedef struct {
+		const CyberiadaEdge*         edge;
+		CyberiadaPolyline*           polyline;
+		CyberiadaPoint*              source_point;
+		CyberiadaPoint*              target_point;
+		CyberiadaPoint*              label_point;
+	} CyberiadaEdgeGeometry;
+
+	typedef struct {
+		CyberiadaGeometryCoordFormat node_coord_format;
+		CyberiadaGeometryCoordFormat edge_coord_format;
+		CyberiadaGeometryCoordFormat edge_pl_coord_format;
+		CyberiadaGeometryEdgeFormat  edge_geom_format;
+		CyberiadaRect*               bounding_rect;
+		CyberiadaNodeGeometry*       nodes;             /* sorted by the node pointer */
+		size_t                       nodes_count;
+		CyberiadaEdgeGeometry*       edges;             /* sorted by the edge pointer */
+		size_t                       edges_count;
+	} CyberiadaGeometryTable;
+
+	CyberiadaGeometryTable*      cyberiada_new_export_geometry_table(CyberiadaDocument* doc,
+																	 int flags, CyberiadaXMLFormat file_format,
+																	 double tolerance, double grid);
+	CyberiadaGeometryTable*      cyberiada_new_absolute_geometry_table(CyberiadaDocument* doc);
+	const CyberiadaNodeGeometry* cyberiada_geometry_table_node(const CyberiadaGeometryTable* table,
+															   const CyberiadaNode* node);
+	const CyberiadaEdgeGeometry* cyberiada_geometry_table_edge(const CyberiadaGeometryTable* table,
+															   const CyberiadaEdge* edge);
+	int                          cyberiada_destroy_geometry_table(CyberiadaGeometryTable* table);
 	
 #ifdef __cplusplus
 }
@@ -21,11 +21,13 @@
  * ----------------------------------------------------------------------------- */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "cyberiadaml.h"
 #include "cyb_structs.h"
 #include "cyb_error.h"
+#include "cyb_graph.h"
 
 #ifdef __DEBUG__
 /* Uncomment this if you need additional debug */
@@ -100,103 +102,79 @@ int cyberiada_sm_size(CyberiadaSM* sm, size_t* v, size_t* e, int ignore_comments
 }
 
 /*-----------------------------------------------------------------------------
- Find the initial pseudostate of a SM 
+ The representation of a SM node in the isomorphism check algorithm
+ ------------------------------------------------------------------------------*/
+
+typedef struct {
+	CyberiadaNode* node;       /* the node itself */
+	int            degree_out; /* the node outdegree */
+	int            degree_in;  /* the node indegree */
+	int            found;      /* the found flag - if the node was found in the comparing graph */
+} Vertex;
+
+/*-----------------------------------------------------------------------------
+ Build the private vertex index of a SM: the node -> vertex index + 1 hash
+ (the SM ordinals & adjacency indexes are not used, so the check leaves the
+ compared SMs untouched)
  ------------------------------------------------------------------------------*/
 
-static int cyberiada_get_initial_pseudostate(CyberiadaSM* sm,
-											 CyberiadaNode** initial_node,
-											 CyberiadaEdge** initial_edge,
-											 int check)
+static int cyberiada_vertex_index_init(CyberiadaHash* index, Vertex* v_array, size_t v_size)
 {
-	CyberiadaNode* n;
-	CyberiadaEdge* e;
-	CyberiadaNode* init_n = NULL;
-	size_t initial = 0;
-	int found;
+	size_t i;
 
-	if (!sm || !sm->nodes) {
-		return CYBERIADA_BAD_PARAMETER;
-	}
-	
-	for (n = sm->nodes->children; n; n = n->next) {
-		if (n->type == cybNodeInitial) {
-			initial++;
-			init_n = n;
-			if (initial_node) {
-				*initial_node = n;
-			}
-		}
+	if (cyberiada_hash_init(index, 0, v_size) != 0) {
+		return CYBERIADA_MEMORY_ERROR;
 	}
-
-	if (check) {
-		if (initial != 1) {
-			ERROR("To check graph isomorhpism the SM %s should have one single initial pseudostate on the top level\n",
-				  sm->nodes->id);
-			return CYBERIADA_FORMAT_ERROR;
-		}
-		
-		found = 0;
-		for (e = sm->edges; e; e = e->next) {
-			if (e->source && e->source == init_n) {
-				found = 1;
-				if (initial_edge) {
-					*initial_edge = e;
-				}
-			}
-		}
-		if (!found) {
-			ERROR("The SM %s has no edge form the top level initial pseudostate\n",
-				  sm->nodes->id);
-			return CYBERIADA_FORMAT_ERROR;
+	for (i = 0; i < v_size; i++) {
+		if (cyberiada_hash_put(index, v_array[i].node, (void*)(uintptr_t)(i + 1)) != 0) {
+			cyberiada_hash_free(index);
+			return CYBERIADA_MEMORY_ERROR;
 		}
 	}
-		
 	return CYBERIADA_NO_ERROR;
 }
 
-/*-----------------------------------------------------------------------------
- The representation of a SM node in the isomorphism check algorithm
- ------------------------------------------------------------------------------*/
-
-typedef struct {
-	CyberiadaNode* node;       /* the node itself */
-	int            degree_out; /* the node outdegree */
-	int            degree_in;  /* the node indegree */
-	int            found;      /* the found flag - if the node was found in the comparing graph */
-} Vertex;
+static size_t cyberiada_find_vertex(CyberiadaHash* index, size_t v_size, CyberiadaNode* node)
+{
+	size_t i;
+	if (!node) {
+		return v_size;
+	}
+	i = (size_t)(uintptr_t)cyberiada_hash_get(index, node);
+	return i ? i - 1 : v_size;
+}
 
 /*-----------------------------------------------------------------------------
- Calculate degrees of SM graph nodes 
+ Calculate degrees of SM graph nodes by a single pass over the SM edges 
  ------------------------------------------------------------------------------*/
 
-static int cyberiada_node_degrees(CyberiadaSM* sm, CyberiadaNode* node, int* degree_in, int* degree_out)
+static int cyberiada_vertex_degrees(CyberiadaSM* sm, Vertex* v_array, size_t v_size)
 {
+	CyberiadaHash index;
 	CyberiadaEdge* e;
-	int d_in = 0, d_out = 0;
+	size_t i;
+	int res;
 
-	if (!sm || !node || !degree_in || !degree_out) {
+	if (!sm || !v_array) {
 		return CYBERIADA_BAD_PARAMETER;
 	}
-	
-	for (e = sm->edges; e; e = e->next) {
-		if (e->source == node) {
-			d_out++;
-		}
+
+	for (i = 0; i < v_size; i++) {
+		v_array[i].degree_in = v_array[i].degree_out = 0;
 	}
 
+	if ((res = cyberiada_vertex_index_init(&index, v_array, v_size)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
 	for (e = sm->edges; e; e = e->next) {
-		if (e->target == node) {
-			d_in++;
+		if ((i = cyberiada_find_vertex(&index, v_size, e->source)) < v_size) {
+			v_array[i].degree_out++;
+		}
+		if ((i = cyberiada_find_vertex(&index, v_size, e->target)) < v_size) {
+			v_array[i].degree_in++;
 		}
 	}
-	
-	if (degree_in) {
-		*degree_in = d_in;
-	}
-
-	if (degree_out) {
-		*degree_out = d_out;
-	}
+	cyberiada_hash_free(&index);
 
 	return CYBERIADA_NO_ERROR;
 }
@@ -226,7 +204,6 @@ static int cyberiada_enumerate_vertexes(CyberiadaSM* sm, CyberiadaNode* nodes, V
 	}
 
 	for (n = nodes; n; n = n->next) {
-		int d_in, d_out;
 		Vertex* cur_vertex;
 
 		/* check if we consider comment nodes during isomorphism check */
@@ -236,18 +213,10 @@ static int cyberiada_enumerate_vertexes(CyberiadaSM* sm, CyberiadaNode* nodes, V
 		if (!ignore_regions || n->type != cybNodeRegion) {
 			cur_vertex = v_array + (*cur_index)++;
 			cur_vertex->node = n;
-			if ((res = cyberiada_node_degrees(sm, n, &d_in, &d_out)) != CYBERIADA_NO_ERROR) {
-				return res;
-			}
-			cur_vertex->degree_in = d_in;
-			cur_vertex->degree_out = d_out;
+			cur_vertex->degree_in = cur_vertex->degree_out = 0;
 			cur_vertex->found = 0;
 		}
 
-#ifdef EXTRA_DEBUG
-		DEBUG("%lu: %s +%lu -%lu\n", *cur_index, n->id, d_in, d_out);
-#endif
-
 		if (n->children) {
 			if ((res = cyberiada_enumerate_vertexes(sm, n->children, v_array, v_size, cur_index,
 													ignore_comments, ignore_regions)) != CYBERIADA_NO_ERROR) {
@@ -255,6 +224,11 @@ static int cyberiada_enumerate_vertexes(CyberiadaSM* sm, CyberiadaNode* nodes, V
 			}
 		}
 	}
+
+	/* the degrees are calculated once the whole vertex array is filled */
+	if (cur_index == &index) {
+		return cyberiada_vertex_degrees(sm, v_array, *cur_index);
+	}
 	
 	return CYBERIADA_NO_ERROR;
 }
@@ -384,9 +358,18 @@ static int calculate_sm_proximity_matrix_edges(char** M, char** ProxiM,
 											   CyberiadaSM* sm1, CyberiadaSM* sm2,
 											   Vertex* v1, Vertex* v2, size_t n1, size_t n2)
 {
-	size_t i, j, k;
+	size_t i, j;
+	CyberiadaHash vi1, vi2;
 	int** EP;
 
+	if (cyberiada_vertex_index_init(&vi1, v1, n1) != CYBERIADA_NO_ERROR) {
+		return CYBERIADA_MEMORY_ERROR;
+	}
+	if (cyberiada_vertex_index_init(&vi2, v2, n2) != CYBERIADA_NO_ERROR) {
+		cyberiada_hash_free(&vi1);
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
 	EP = (int**)malloc(sizeof(int*) * n1);
 	for (i = 0; i < n1; i++) {
 		EP[i] = (int*)malloc(sizeof(int) * n2);
@@ -404,25 +387,16 @@ static int calculate_sm_proximity_matrix_edges(char** M, char** ProxiM,
 					for (e1 = sm1->edges; e1; e1 = e1->next) {
 						for (e2 = sm2->edges; e2; e2 = e2->next) {
 							if (e1->source == node1 && e2->source == node2) {
-								size_t n = n1, m = n2;
-								for (k = 0; k < n1; k++) {
-									if (v1[k].node == e1->target) {
-										n = k;
-										break;
-									}
-								}
-								for (k = 0; k < n2; k++) {
-									if (v2[k].node == e2->target) {
-										m = k;
-										break;
-									}
-								}
+								size_t n = cyberiada_find_vertex(&vi1, n1, e1->target);
+								size_t m = cyberiada_find_vertex(&vi2, n2, e2->target);
 								if (n == n1 || m == n2) {
 									ERROR("Error while reconstruction edge source proximity\n");
 									for (i = 0; i < n1; i++) {
 										free(EP[i]);
 									}
 									free(EP);
+									cyberiada_hash_free(&vi1);
+									cyberiada_hash_free(&vi2);
 									return CYBERIADA_BAD_PARAMETER;
 								}
 								if (ProxiM[n][m] > 0) {
@@ -434,25 +408,16 @@ static int calculate_sm_proximity_matrix_edges(char** M, char** ProxiM,
 								break;
 							}
 							if (e1->target == node1 && e2->target == node2) {
-								size_t n = n1, m = n2;
-								for (k = 0; k < n1; k++) {
-									if (v1[k].node == e1->source) {
-										n = k;
-										break;
-									}
-								}
-								for (k = 0; k < n2; k++) {
-									if (v2[k].node == e2->source) {
-										m = k;
-										break;
-									}
-								}
+								size_t n = cyberiada_find_vertex(&vi1, n1, e1->source);
+								size_t m = cyberiada_find_vertex(&vi2, n2, e2->source);
 								if (n == n1 || m == n2) {
 									ERROR("Error while reconstruction edge target proximity\n");
 									for (i = 0; i < n1; i++) {
 										free(EP[i]);
 									}
 									free(EP);
+									cyberiada_hash_free(&vi1);
+									cyberiada_hash_free(&vi2);
 									return CYBERIADA_BAD_PARAMETER;
 								}
 								if (ProxiM[n][m] > 0) {
@@ -489,6 +454,8 @@ static int calculate_sm_proximity_matrix_edges(char** M, char** ProxiM,
 		free(EP[i]);
 	}
 	free(EP);
+	cyberiada_hash_free(&vi1);
+	cyberiada_hash_free(&vi2);
 	
 	return CYBERIADA_NO_ERROR;
 }
@@ -969,6 +936,7 @@ int cyberiada_check_isomorphism(CyberiadaSM* sm1, CyberiadaSM* sm2, int ignore_c
 	size_t i, j, sm1_vertexes = 0, sm1_edges = 0, sm2_vertexes = 0, sm2_edges = 0;
 	char** perm_matrix = NULL;
 	Vertex *vertexes1 = NULL, *vertexes2 = NULL;
+	CyberiadaHash vertexes1_index;
 	CyberiadaNode *sm1_initial_ps = NULL, *sm2_initial_ps = NULL;
 	CyberiadaEdge *sm1_initial_edge = NULL, *sm2_initial_edge = NULL, *e1, *e2;
 	CyberiadaList* found_edges = NULL;
@@ -977,12 +945,19 @@ int cyberiada_check_isomorphism(CyberiadaSM* sm1, CyberiadaSM* sm2, int ignore_c
 		return CYBERIADA_BAD_PARAMETER;
 	}
 
+	/* the actions are compared, so decode the lazy ones; the node degrees & vertex indexes are */
+	/* private to the check, the SM ordinals & adjacency indexes are neither used nor built     */
+	if ((res = cyberiada_decode_sm_actions(sm1)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_decode_sm_actions(sm2)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+
 	/* check if thw both statemachines have initial nodes on the top level */
-	res = cyberiada_get_initial_pseudostate(sm1, &sm1_initial_ps, &sm1_initial_edge, require_initial);
+	res = cyberiada_graph_get_initial_pseudostate(sm1, &sm1_initial_ps, &sm1_initial_edge, require_initial);
 	if (res != CYBERIADA_NO_ERROR) {
 		return res;
 	}
-	res = cyberiada_get_initial_pseudostate(sm2, &sm2_initial_ps, &sm2_initial_edge, require_initial);
+	res = cyberiada_graph_get_initial_pseudostate(sm2, &sm2_initial_ps, &sm2_initial_edge, require_initial);
 	if (res != CYBERIADA_NO_ERROR) {
 		return res;
 	}
@@ -1115,30 +1090,34 @@ int cyberiada_check_isomorphism(CyberiadaSM* sm1, CyberiadaSM* sm2, int ignore_c
 		return CYBERIADA_ASSERT;
 	}
 
+	if (cyberiada_vertex_index_init(&vertexes1_index, vertexes1, sm1_vertexes) != CYBERIADA_NO_ERROR) {
+		ERROR("Cannot build the vertex index table\n");
+		return CYBERIADA_MEMORY_ERROR;
+	}
+
 	for (e1 = sm1->edges; e1; e1 = e1->next) {
 		CyberiadaNode *sm2_source = NULL, *sm2_target = NULL;
 		int found = 0;
 
 		if (ignore_comments && (e1->type == cybEdgeComment)) continue;
 		
-		for (i = 0; i < sm1_vertexes; i++) {
-			if (e1->source == vertexes1[i].node) {
-				for (j = 0; j < sm2_vertexes; j++) {
-					if (perm_matrix[i][j]) {
-						sm2_source = vertexes2[j].node;
-						break;
-					}
+		i = cyberiada_find_vertex(&vertexes1_index, sm1_vertexes, e1->source);
+		if (i < sm1_vertexes) {
+			for (j = 0; j < sm2_vertexes; j++) {
+				if (perm_matrix[i][j]) {
+					sm2_source = vertexes2[j].node;
+					break;
 				}
 			}
-			if (e1->target == vertexes1[i].node) {
-				for (j = 0; j < sm2_vertexes; j++) {
-					if (perm_matrix[i][j]) {
-						sm2_target = vertexes2[j].node;
-						break;
-					}
-				}			
+		}
+		i = cyberiada_find_vertex(&vertexes1_index, sm1_vertexes, e1->target);
+		if (i < sm1_vertexes) {
+			for (j = 0; j < sm2_vertexes; j++) {
+				if (perm_matrix[i][j]) {
+					sm2_target = vertexes2[j].node;
+					break;
+				}
 			}
-			if (sm2_source && sm2_target) break;
 		}
 		if (!sm2_source || !sm2_target) {
 			/* the edge found not available in the second graph */
@@ -1221,6 +1200,7 @@ int cyberiada_check_isomorphism(CyberiadaSM* sm1, CyberiadaSM* sm2, int ignore_c
 	}
 
 	cyberiada_list_free(&found_edges);
+	cyberiada_hash_free(&vertexes1_index);
 	if (perm_matrix) {
 		for (i = 0; i < sm1_vertexes; i++) {
 			free(perm_matrix[i]);
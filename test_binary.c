@@ -0,0 +1,165 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The binary format round trip testing program
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ * ----------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "cyberiadaml.h"
+
+/* the number of the nodes & edges keeping the lazy actions text */
+static size_t count_raw_nodes(const CyberiadaNode* nodes)
+{
+	size_t count = 0;
+	for (; nodes; nodes = nodes->next) {
+		if (nodes->raw_actions) count++;
+		count += count_raw_nodes(nodes->children);
+	}
+	return count;
+}
+
+static size_t count_raw_actions(const CyberiadaDocument* doc)
+{
+	const CyberiadaSM* sm;
+	const CyberiadaEdge* edge;
+	size_t count = 0;
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		count += count_raw_nodes(sm->nodes);
+		for (edge = sm->edges; edge; edge = edge->next) {
+			if (edge->raw_action) count++;
+		}
+	}
+	return count;
+}
+
+/* the document read from the file, decoded from its binary encoding & re-encoded is identical */
+static int test_binary_round_trip(const char* filename)
+{
+	CyberiadaDocument orig, copy;
+	CyberiadaSM *orig_sm, *copy_sm;
+	char *buffer = NULL, *copy_buffer = NULL;
+	size_t buffer_size = 0, copy_buffer_size = 0;
+	int res, flags, errors = 0;
+
+	cyberiada_init_sm_document(&orig);
+	cyberiada_init_sm_document(&copy);
+
+	if ((res = cyberiada_read_sm_document(&orig, filename, cybxmlUnknown, CYBERIADA_FLAG_NO)) != CYBERIADA_NO_ERROR) {
+		printf("Document %s reading error %d\n", filename, res);
+		cyberiada_cleanup_sm_document(&orig);
+		return 1;
+	}
+
+	if ((res = cyberiada_encode_sm_document_binary(&orig, &buffer, &buffer_size)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_decode_sm_document_binary(&copy, buffer, buffer_size)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_encode_sm_document_binary(&copy, &copy_buffer, &copy_buffer_size)) != CYBERIADA_NO_ERROR) {
+		printf("Binary encoding/decoding error %d\n", res);
+		errors++;
+	} else {
+		for (orig_sm = orig.state_machines, copy_sm = copy.state_machines;
+			 orig_sm && copy_sm;
+			 orig_sm = orig_sm->next, copy_sm = copy_sm->next) {
+			flags = 0;
+			res = cyberiada_check_isomorphism(orig_sm, copy_sm, 0, 0, &flags, NULL,
+											  NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+											  NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+			if (res != CYBERIADA_NO_ERROR || flags != CYBERIADA_ISOMORPH_FLAG_IDENTICAL) {
+				printf("SM %s is not identical after the round trip (res %d, flags 0x%x)\n",
+					   orig_sm->nodes->id, res, flags);
+				errors++;
+			}
+		}
+		if (orig_sm || copy_sm) {
+			printf("Different number of SMs\n");
+			errors++;
+		}
+		if (buffer_size != copy_buffer_size || memcmp(buffer, copy_buffer, buffer_size) != 0) {
+			printf("The re-encoded document differs\n");
+			errors++;
+		}
+	}
+
+	if (buffer) free(buffer);
+	if (copy_buffer) free(copy_buffer);
+	cyberiada_cleanup_sm_document(&copy);
+	cyberiada_cleanup_sm_document(&orig);
+
+	printf("Binary round trip %s: %s\n", filename, errors ? "FAILED" : "OK");
+	return errors;
+}
+
+/* the binary encoder leaves the lazy actions of the document as is & encodes them as the decoded ones */
+static int test_binary_lazy_actions(const char* filename)
+{
+	CyberiadaDocument lazy, eager;
+	char *lazy_buffer = NULL, *eager_buffer = NULL;
+	size_t lazy_buffer_size = 0, eager_buffer_size = 0, raw_count;
+	int res, errors = 0;
+
+	cyberiada_init_sm_document(&lazy);
+	cyberiada_init_sm_document(&eager);
+
+	if ((res = cyberiada_read_sm_document(&lazy, filename, cybxmlUnknown, CYBERIADA_FLAG_LAZY_ACTIONS)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_read_sm_document(&eager, filename, cybxmlUnknown, CYBERIADA_FLAG_NO)) != CYBERIADA_NO_ERROR) {
+		printf("Document %s reading error %d\n", filename, res);
+		cyberiada_cleanup_sm_document(&lazy);
+		cyberiada_cleanup_sm_document(&eager);
+		return 1;
+	}
+
+	raw_count = count_raw_actions(&lazy);
+	if ((res = cyberiada_encode_sm_document_binary(&lazy, &lazy_buffer, &lazy_buffer_size)) != CYBERIADA_NO_ERROR ||
+		(res = cyberiada_encode_sm_document_binary(&eager, &eager_buffer, &eager_buffer_size)) != CYBERIADA_NO_ERROR) {
+		printf("Binary encoding error %d\n", res);
+		errors++;
+	} else {
+		if (count_raw_actions(&lazy) != raw_count) {
+			printf("The lazy actions were changed by the encoder\n");
+			errors++;
+		}
+		if (lazy_buffer_size != eager_buffer_size || memcmp(lazy_buffer, eager_buffer, lazy_buffer_size) != 0) {
+			printf("The lazy actions document is encoded differently\n");
+			errors++;
+		}
+	}
+
+	if (lazy_buffer) free(lazy_buffer);
+	if (eager_buffer) free(eager_buffer);
+	cyberiada_cleanup_sm_document(&eager);
+	cyberiada_cleanup_sm_document(&lazy);
+
+	printf("Binary lazy actions %s: %s\n", filename, errors ? "FAILED" : "OK");
+	return errors;
+}
+
+int main(int argc, char** argv)
+{
+	int i, errors = 0;
+
+	if (argc < 2) {
+		printf("Usage: %s <graphml-file>...\n", argv[0]);
+		return 1;
+	}
+	for (i = 1; i < argc; i++) {
+		errors += test_binary_round_trip(argv[i]);
+		errors += test_binary_lazy_actions(argv[i]);
+	}
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,342 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The lazy & selective decoding testing program
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ * ----------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "cyberiadaml.h"
+
+/* the document with the actions of all kinds, the comment nodes & the comment edge */
+static const char* test_document =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+	"  <data key=\"gFormat\">Cyberiada-GraphML-1.0</data>\n"
+	"  <key id=\"gFormat\" for=\"graphml\" attr.name=\"format\" attr.type=\"string\"/>\n"
+	"  <key id=\"dName\" for=\"graph\" attr.name=\"name\" attr.type=\"string\"/>\n"
+	"  <key id=\"dName\" for=\"node\" attr.name=\"name\" attr.type=\"string\"/>\n"
+	"  <key id=\"dStateMachine\" for=\"graph\" attr.name=\"stateMachine\" attr.type=\"string\"/>\n"
+	"  <key id=\"dNote\" for=\"node\" attr.name=\"note\" attr.type=\"string\"/>\n"
+	"  <key id=\"dVertex\" for=\"node\" attr.name=\"vertex\" attr.type=\"string\"/>\n"
+	"  <key id=\"dPivot\" for=\"edge\" attr.name=\"pivot\" attr.type=\"string\"/>\n"
+	"  <key id=\"dData\" for=\"node\" attr.name=\"data\" attr.type=\"string\"/>\n"
+	"  <key id=\"dData\" for=\"edge\" attr.name=\"data\" attr.type=\"string\"/>\n"
+	"  <graph id=\"G\" edgedefault=\"directed\">\n"
+	"    <data key=\"dStateMachine\"/>\n"
+	"    <data key=\"dName\">machine</data>\n"
+	"    <node id=\"nMeta\">\n"
+	"      <data key=\"dNote\">formal</data>\n"
+	"      <data key=\"dName\">CGML_META</data>\n"
+	"      <data key=\"dData\">standardVersion/ 1.0\n\n</data>\n"
+	"    </node>\n"
+	"    <node id=\"init\">\n"
+	"      <data key=\"dVertex\">initial</data>\n"
+	"    </node>\n"
+	"    <node id=\"A\">\n"
+	"      <data key=\"dName\">A</data>\n"
+	"      <data key=\"dData\">entry/\nenterA()\n\nexit/\nexitA()\n</data>\n"
+	"      <graph id=\"A:\" edgedefault=\"directed\">\n"
+	"        <node id=\"A::init\">\n"
+	"          <data key=\"dVertex\">initial</data>\n"
+	"        </node>\n"
+	"        <node id=\"A::A1\">\n"
+	"          <data key=\"dName\">A1</data>\n"
+	"          <data key=\"dData\">entry/\nenterA1()\n</data>\n"
+	"        </node>\n"
+	"        <node id=\"A::A2\">\n"
+	"          <data key=\"dName\">A2</data>\n"
+	"        </node>\n"
+	"      </graph>\n"
+	"    </node>\n"
+	"    <node id=\"B\">\n"
+	"      <data key=\"dName\">B</data>\n"
+	"    </node>\n"
+	"    <node id=\"C\">\n"
+	"      <data key=\"dName\">C</data>\n"
+	"    </node>\n"
+	"    <node id=\"note\">\n"
+	"      <data key=\"dNote\">informal</data>\n"
+	"      <data key=\"dData\">a comment</data>\n"
+	"    </node>\n"
+	"    <edge id=\"e0\" source=\"init\" target=\"A\"/>\n"
+	"    <edge id=\"e1\" source=\"A::init\" target=\"A::A1\"/>\n"
+	"    <edge id=\"e2\" source=\"A::A1\" target=\"A::A2\">\n"
+	"      <data key=\"dData\">ev1/ go()</data>\n"
+	"    </edge>\n"
+	"    <edge id=\"e3\" source=\"A::A2\" target=\"A::A1\">\n"
+	"      <data key=\"dData\">ev2/</data>\n"
+	"    </edge>\n"
+	"    <edge id=\"e4\" source=\"A\" target=\"B\">\n"
+	"      <data key=\"dData\">ev3/ leave()</data>\n"
+	"    </edge>\n"
+	"    <edge id=\"e5\" source=\"C\" target=\"B\">\n"
+	"      <data key=\"dData\">ev4/</data>\n"
+	"    </edge>\n"
+	"    <edge id=\"e6\" source=\"note\" target=\"A\">\n"
+	"      <data key=\"dPivot\"/>\n"
+	"    </edge>\n"
+	"  </graph>\n"
+	"</graphml>\n";
+
+static int decode_document(CyberiadaDocument* doc, int flags)
+{
+	int res;
+	cyberiada_init_sm_document(doc);
+	res = cyberiada_decode_sm_document(doc, test_document, strlen(test_document), cybxmlCyberiada10, flags);
+	if (res != CYBERIADA_NO_ERROR) {
+		printf("Document decoding error %d (flags 0x%x)\n", res, flags);
+		cyberiada_cleanup_sm_document(doc);
+	}
+	return res;
+}
+
+static int decode_document_with_skip(CyberiadaDocument* doc, CyberiadaDecodeOptions* options, int skip)
+{
+	int res;
+	memset(options, 0, sizeof(CyberiadaDecodeOptions));
+	options->skip = skip;
+	cyberiada_init_sm_document(doc);
+	res = cyberiada_decode_sm_document_with_options(doc, test_document, strlen(test_document),
+													cybxmlCyberiada10, options);
+	if (res != CYBERIADA_NO_ERROR) {
+		printf("Document decoding error %d (skip 0x%x)\n", res, skip);
+		cyberiada_cleanup_sm_document(doc);
+	}
+	return res;
+}
+
+static int same_string(const char* a, const char* b)
+{
+	return (!a || !*a) ? (!b || !*b) : (b && strcmp(a, b) == 0);
+}
+
+static int same_actions(const CyberiadaAction* a, const CyberiadaAction* b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (a->type != b->type || !same_string(a->trigger, b->trigger) ||
+			!same_string(a->guard, b->guard) || !same_string(a->behavior, b->behavior)) {
+			return 0;
+		}
+	}
+	return !a && !b;
+}
+
+/* the number of the nodes & edges keeping the lazy actions text */
+static size_t count_raw_nodes(const CyberiadaNode* nodes)
+{
+	size_t count = 0;
+	for (; nodes; nodes = nodes->next) {
+		if (nodes->raw_actions) count++;
+		count += count_raw_nodes(nodes->children);
+	}
+	return count;
+}
+
+static size_t count_raw_actions(const CyberiadaDocument* doc)
+{
+	const CyberiadaSM* sm;
+	const CyberiadaEdge* edge;
+	size_t count = 0;
+	for (sm = doc->state_machines; sm; sm = sm->next) {
+		count += count_raw_nodes(sm->nodes);
+		for (edge = sm->edges; edge; edge = edge->next) {
+			if (edge->raw_action) count++;
+		}
+	}
+	return count;
+}
+
+/* the lazy nodes actions are decoded on the first access the same way as the eager ones */
+static int check_lazy_nodes(CyberiadaNode* lazy, CyberiadaNode* eager)
+{
+	CyberiadaAction* actions;
+	int errors = 0;
+	for (; lazy && eager; lazy = lazy->next, eager = eager->next) {
+		if (eager->actions && (lazy->actions || !lazy->raw_actions)) {
+			printf("Node %s actions were decoded eagerly\n", lazy->id);
+			errors++;
+		}
+		if (cyberiada_node_get_actions(lazy, &actions) != CYBERIADA_NO_ERROR ||
+			!same_actions(actions, eager->actions) || lazy->raw_actions) {
+			printf("Node %s lazy actions differ\n", lazy->id);
+			errors++;
+		}
+		errors += check_lazy_nodes(lazy->children, eager->children);
+	}
+	return errors;
+}
+
+static int test_lazy_actions(void)
+{
+	CyberiadaDocument lazy, eager;
+	CyberiadaEdge *lazy_edge, *eager_edge;
+	CyberiadaAction* action;
+	char *lazy_buffer = NULL, *eager_buffer = NULL;
+	size_t lazy_buffer_size = 0, eager_buffer_size = 0, raw_count;
+	int errors = 0;
+
+	if (decode_document(&eager, CYBERIADA_FLAG_NO) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+	if (decode_document(&lazy, CYBERIADA_FLAG_LAZY_ACTIONS) != CYBERIADA_NO_ERROR) {
+		cyberiada_cleanup_sm_document(&eager);
+		return 1;
+	}
+
+	/* the exporters leave the actions text as is */
+	raw_count = count_raw_actions(&lazy);
+	if (raw_count == 0) {
+		printf("No lazy actions were kept\n");
+		errors++;
+	}
+	if (cyberiada_encode_sm_document(&lazy, &lazy_buffer, &lazy_buffer_size,
+									 cybxmlCyberiada10, CYBERIADA_FLAG_NO) != CYBERIADA_NO_ERROR ||
+		cyberiada_encode_sm_document(&eager, &eager_buffer, &eager_buffer_size,
+									 cybxmlCyberiada10, CYBERIADA_FLAG_NO) != CYBERIADA_NO_ERROR) {
+		printf("Document encoding error\n");
+		errors++;
+	} else if (lazy_buffer_size != eager_buffer_size ||
+			   memcmp(lazy_buffer, eager_buffer, lazy_buffer_size) != 0) {
+		printf("The lazy actions document is encoded differently\n");
+		errors++;
+	}
+	if (count_raw_actions(&lazy) != raw_count) {
+		printf("The lazy actions were changed by the encoder\n");
+		errors++;
+	}
+
+	/* the first access decodes the actions */
+	errors += check_lazy_nodes(lazy.state_machines->nodes, eager.state_machines->nodes);
+	for (lazy_edge = lazy.state_machines->edges, eager_edge = eager.state_machines->edges;
+		 lazy_edge && eager_edge;
+		 lazy_edge = lazy_edge->next, eager_edge = eager_edge->next) {
+		if (cyberiada_edge_get_action(lazy_edge, &action) != CYBERIADA_NO_ERROR ||
+			!same_actions(action, eager_edge->action) || lazy_edge->raw_action) {
+			printf("Edge %s lazy action differs\n", lazy_edge->id);
+			errors++;
+		}
+	}
+	if (count_raw_actions(&lazy) != 0) {
+		printf("The lazy actions were not decoded\n");
+		errors++;
+	}
+
+	if (lazy_buffer) free(lazy_buffer);
+	if (eager_buffer) free(eager_buffer);
+	cyberiada_cleanup_sm_document(&lazy);
+	cyberiada_cleanup_sm_document(&eager);
+
+	/* all the actions are decoded at once */
+	if (decode_document(&lazy, CYBERIADA_FLAG_LAZY_ACTIONS) != CYBERIADA_NO_ERROR) {
+		return errors + 1;
+	}
+	if (cyberiada_decode_document_actions(&lazy) != CYBERIADA_NO_ERROR || count_raw_actions(&lazy) != 0) {
+		printf("The document actions were not decoded\n");
+		errors++;
+	}
+	cyberiada_cleanup_sm_document(&lazy);
+
+	printf("Lazy actions decoding: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+static size_t count_actions(const CyberiadaNode* nodes)
+{
+	size_t count = 0;
+	for (; nodes; nodes = nodes->next) {
+		if (nodes->actions || nodes->raw_actions) count++;
+		count += count_actions(nodes->children);
+	}
+	return count;
+}
+
+static int test_skip_categories(void)
+{
+	CyberiadaDocument doc;
+	CyberiadaDecodeOptions options;
+	CyberiadaNode* nodes;
+	CyberiadaEdge* edge;
+	size_t edges;
+	int errors = 0;
+
+	/* the comment node is skipped with its subject edge */
+	if (decode_document_with_skip(&doc, &options, CYBERIADA_DECODE_SKIP_COMMENTS) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+	nodes = doc.state_machines->nodes;
+	for (edges = 0, edge = doc.state_machines->edges; edge; edge = edge->next, edges++);
+	if (cyberiada_graph_find_node_by_id(nodes, "note") || !cyberiada_graph_find_node_by_id(nodes, "nMeta") ||
+		edges != 6 || options.skipped_nodes != 1 || options.skipped_edges != 1) {
+		printf("Wrong SM w/o the comments\n");
+		errors++;
+	}
+	cyberiada_cleanup_sm_document(&doc);
+
+	/* the comment node is kept without the subject edge */
+	if (decode_document_with_skip(&doc, &options, CYBERIADA_DECODE_SKIP_COMMENT_EDGES) != CYBERIADA_NO_ERROR) {
+		return errors + 1;
+	}
+	for (edges = 0, edge = doc.state_machines->edges; edge; edge = edge->next) {
+		if (edge->type == cybEdgeComment) edges++;
+	}
+	if (!cyberiada_graph_find_node_by_id(doc.state_machines->nodes, "note") || edges != 0 ||
+		options.skipped_nodes != 0 || options.skipped_edges != 1) {
+		printf("Wrong SM w/o the comment edges\n");
+		errors++;
+	}
+	cyberiada_cleanup_sm_document(&doc);
+
+	/* the actions are not decoded, the structure is complete */
+	if (decode_document_with_skip(&doc, &options, CYBERIADA_DECODE_SKIP_ACTIONS) != CYBERIADA_NO_ERROR) {
+		return errors + 1;
+	}
+	for (edges = 0, edge = doc.state_machines->edges; edge; edge = edge->next, edges++) {
+		if (edge->action || edge->raw_action) {
+			printf("Edge %s action was decoded\n", edge->id);
+			errors++;
+		}
+	}
+	if (count_actions(doc.state_machines->nodes) != 0 || edges != 7) {
+		printf("Wrong SM w/o the actions\n");
+		errors++;
+	}
+	cyberiada_cleanup_sm_document(&doc);
+
+	/* the meta node is skipped (the default meta information is used) */
+	if (decode_document_with_skip(&doc, &options, CYBERIADA_DECODE_SKIP_META) != CYBERIADA_NO_ERROR) {
+		return errors + 1;
+	}
+	if (!doc.meta_info || options.skipped_nodes != 1 || options.skipped_edges != 0) {
+		printf("Wrong SM w/o the meta node\n");
+		errors++;
+	}
+	cyberiada_cleanup_sm_document(&doc);
+
+	printf("Skipped categories decoding: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+int main(void)
+{
+	int errors = 0;
+	errors += test_lazy_actions();
+	errors += test_skip_categories();
+	return errors ? 1 : 0;
+}
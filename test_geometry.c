@@ -0,0 +1,557 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The geometry import & decoding testing program
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ * ----------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "cyberiadaml.h"
+#include "geometry.h"
+
+#define MAX_ID_LENGTH 256
+
+#define TEST_DOCUMENT_HEADER \
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" \
+	"<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n" \
+	"  <data key=\"gFormat\">Cyberiada-GraphML-1.0</data>\n" \
+	"  <key id=\"gFormat\" for=\"graphml\" attr.name=\"format\" attr.type=\"string\"/>\n" \
+	"  <key id=\"dName\" for=\"graph\" attr.name=\"name\" attr.type=\"string\"/>\n" \
+	"  <key id=\"dName\" for=\"node\" attr.name=\"name\" attr.type=\"string\"/>\n" \
+	"  <key id=\"dStateMachine\" for=\"graph\" attr.name=\"stateMachine\" attr.type=\"string\"/>\n" \
+	"  <key id=\"dGeometry\" for=\"graph\" attr.name=\"geometry\"/>\n" \
+	"  <key id=\"dGeometry\" for=\"node\" attr.name=\"geometry\"/>\n" \
+	"  <key id=\"dGeometry\" for=\"edge\" attr.name=\"geometry\"/>\n" \
+	"  <key id=\"dSourcePoint\" for=\"edge\" attr.name=\"sourcePoint\"/>\n" \
+	"  <key id=\"dTargetPoint\" for=\"edge\" attr.name=\"targetPoint\"/>\n" \
+	"  <key id=\"dNote\" for=\"node\" attr.name=\"note\" attr.type=\"string\"/>\n" \
+	"  <key id=\"dData\" for=\"node\" attr.name=\"data\" attr.type=\"string\"/>\n" \
+	"  <key id=\"dData\" for=\"edge\" attr.name=\"data\" attr.type=\"string\"/>\n"
+
+#define TEST_DOCUMENT_FOOTER \
+	"</graphml>\n"
+
+/* the single-SM documents joined into the multi-SM document by decode_multi_sm_document() */
+static const char* test_documents[] = {
+	TEST_DOCUMENT_HEADER
+	"  <graph id=\"G\" edgedefault=\"directed\">\n"
+	"    <data key=\"dStateMachine\"/>\n"
+	"    <data key=\"dName\">first</data>\n"
+	"    <node id=\"nMeta\">\n"
+	"      <data key=\"dNote\">formal</data>\n"
+	"      <data key=\"dName\">CGML_META</data>\n"
+	"      <data key=\"dData\">standardVersion/ 1.0\n\n</data>\n"
+	"    </node>\n"
+	"    <node id=\"n0\">\n"
+	"      <data key=\"dName\">outer</data>\n"
+	"      <data key=\"dGeometry\"><rect x=\"100\" y=\"100\" width=\"400\" height=\"300\"/></data>\n"
+	"      <graph id=\"n0:\" edgedefault=\"directed\">\n"
+	"        <node id=\"n0::n0\">\n"
+	"          <data key=\"dName\">collapsed</data>\n"
+	"          <data key=\"dGeometry\"><rect x=\"20\" y=\"40\" width=\"300\" height=\"200\"/></data>\n"
+	"          <graph id=\"n0::n0:\" edgedefault=\"directed\">\n"
+	"            <node id=\"n0::n0::n0\">\n"
+	"              <data key=\"dName\">hidden1</data>\n"
+	"              <data key=\"dGeometry\"><rect x=\"10\" y=\"30\" width=\"100\" height=\"50\"/></data>\n"
+	"            </node>\n"
+	"            <node id=\"n0::n0::n1\">\n"
+	"              <data key=\"dName\">hidden2</data>\n"
+	"              <data key=\"dGeometry\"><rect x=\"150\" y=\"120\" width=\"100\" height=\"50\"/></data>\n"
+	"            </node>\n"
+	"          </graph>\n"
+	"        </node>\n"
+	"        <node id=\"n0::n1\">\n"
+	"          <data key=\"dName\">visible</data>\n"
+	"          <data key=\"dGeometry\"><rect x=\"20\" y=\"250\" width=\"100\" height=\"40\"/></data>\n"
+	"        </node>\n"
+	"      </graph>\n"
+	"    </node>\n"
+	"    <edge id=\"n0::n0::e0\" source=\"n0::n0::n0\" target=\"n0::n0::n1\">\n"
+	"      <data key=\"dData\">go/</data>\n"
+	"      <data key=\"dSourcePoint\"><point x=\"50\" y=\"25\"/></data>\n"
+	"      <data key=\"dTargetPoint\"><point x=\"0\" y=\"25\"/></data>\n"
+	"    </edge>\n"
+	"    <edge id=\"e0\" source=\"n0::n0\" target=\"n0::n1\">\n"
+	"      <data key=\"dData\">next/</data>\n"
+	"      <data key=\"dSourcePoint\"><point x=\"150\" y=\"100\"/></data>\n"
+	"      <data key=\"dTargetPoint\"><point x=\"50\" y=\"0\"/></data>\n"
+	"    </edge>\n"
+	"  </graph>\n"
+	TEST_DOCUMENT_FOOTER,
+	TEST_DOCUMENT_HEADER
+	"  <graph id=\"G2\" edgedefault=\"directed\">\n"
+	"    <data key=\"dStateMachine\"/>\n"
+	"    <data key=\"dName\">second</data>\n"
+	"    <node id=\"nMeta\">\n"
+	"      <data key=\"dNote\">formal</data>\n"
+	"      <data key=\"dName\">CGML_META</data>\n"
+	"      <data key=\"dData\">standardVersion/ 1.0\n\n</data>\n"
+	"    </node>\n"
+	"    <node id=\"m0\">\n"
+	"      <data key=\"dName\">placed</data>\n"
+	"      <data key=\"dGeometry\"><rect x=\"0\" y=\"0\" width=\"200\" height=\"100\"/></data>\n"
+	"    </node>\n"
+	"    <node id=\"m1\">\n"
+	"      <data key=\"dName\">unplaced</data>\n"
+	"      <graph id=\"m1:\" edgedefault=\"directed\">\n"
+	"        <node id=\"m1::m0\">\n"
+	"          <data key=\"dName\">child</data>\n"
+	"        </node>\n"
+	"      </graph>\n"
+	"    </node>\n"
+	"    <edge id=\"f0\" source=\"m0\" target=\"m1\">\n"
+	"      <data key=\"dData\">go/</data>\n"
+	"    </edge>\n"
+	"  </graph>\n"
+	TEST_DOCUMENT_FOOTER,
+	TEST_DOCUMENT_HEADER
+	"  <graph id=\"G3\" edgedefault=\"directed\">\n"
+	"    <data key=\"dStateMachine\"/>\n"
+	"    <data key=\"dName\">third</data>\n"
+	"    <node id=\"nMeta\">\n"
+	"      <data key=\"dNote\">formal</data>\n"
+	"      <data key=\"dName\">CGML_META</data>\n"
+	"      <data key=\"dData\">standardVersion/ 1.0\n\n</data>\n"
+	"    </node>\n"
+	"    <node id=\"k0\">\n"
+	"      <data key=\"dName\">unplaced</data>\n"
+	"    </node>\n"
+	"    <node id=\"k1\">\n"
+	"      <data key=\"dName\">placed</data>\n"
+	"      <data key=\"dGeometry\"><rect x=\"300\" y=\"20\" width=\"120\" height=\"60\"/></data>\n"
+	"    </node>\n"
+	"  </graph>\n"
+	TEST_DOCUMENT_FOOTER
+};
+
+#define TEST_DOCUMENTS_COUNT (sizeof(test_documents) / sizeof(test_documents[0]))
+
+static int decode_document(CyberiadaDocument* doc, size_t index, int flags)
+{
+	int res;
+	cyberiada_init_sm_document(doc);
+	res = cyberiada_decode_sm_document(doc, test_documents[index], strlen(test_documents[index]),
+									   cybxmlCyberiada10, flags);
+	if (res != CYBERIADA_NO_ERROR) {
+		printf("Document %lu decoding error %d (flags 0x%x)\n", index, res, flags);
+		cyberiada_cleanup_sm_document(doc);
+	}
+	return res;
+}
+
+/* decode all the test documents w/o geometry conversion and join the SMs into the single document */
+static int decode_multi_sm_document(CyberiadaDocument* doc)
+{
+	CyberiadaDocument sm_doc;
+	CyberiadaSM* tail;
+	size_t i;
+	int res;
+
+	if ((res = decode_document(doc, 0, CYBERIADA_FLAG_NO)) != CYBERIADA_NO_ERROR) {
+		return res;
+	}
+	for (tail = doc->state_machines; tail->next; tail = tail->next);
+	for (i = 1; i < TEST_DOCUMENTS_COUNT; i++) {
+		if ((res = decode_document(&sm_doc, i, CYBERIADA_FLAG_NO)) != CYBERIADA_NO_ERROR) {
+			cyberiada_cleanup_sm_document(doc);
+			return res;
+		}
+		tail->next = sm_doc.state_machines;
+		sm_doc.state_machines = NULL;
+		cyberiada_cleanup_sm_document(&sm_doc);
+		for (; tail->next; tail = tail->next);
+	}
+	return CYBERIADA_NO_ERROR;
+}
+
+static int same_rect(const CyberiadaRect* a, const CyberiadaRect* b)
+{
+	return a && b && a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height;
+}
+
+static int same_point(const CyberiadaPoint* a, const CyberiadaPoint* b)
+{
+	return a && b && a->x == b->x && a->y == b->y;
+}
+
+static int same_optional_rect(const CyberiadaRect* a, const CyberiadaRect* b)
+{
+	return (!a && !b) || same_rect(a, b);
+}
+
+static int same_optional_point(const CyberiadaPoint* a, const CyberiadaPoint* b)
+{
+	return (!a && !b) || same_point(a, b);
+}
+
+static int same_nodes_geometry(const CyberiadaNode* a, const CyberiadaNode* b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (strcmp(a->id, b->id) != 0 ||
+			!same_optional_rect(a->geometry_rect, b->geometry_rect) ||
+			!same_optional_point(a->geometry_point, b->geometry_point) ||
+			!same_nodes_geometry(a->children, b->children)) {
+			printf("Node %s geometry differs\n", a->id);
+			return 0;
+		}
+	}
+	return !a && !b;
+}
+
+static int same_edges_geometry(const CyberiadaEdge* a, const CyberiadaEdge* b)
+{
+	const CyberiadaPolyline *pa, *pb;
+	for (; a && b; a = a->next, b = b->next) {
+		for (pa = a->geometry_polyline, pb = b->geometry_polyline;
+			 pa && pb && same_point(&(pa->point), &(pb->point));
+			 pa = pa->next, pb = pb->next);
+		if (strcmp(a->id, b->id) != 0 || pa || pb ||
+			!same_optional_point(a->geometry_source_point, b->geometry_source_point) ||
+			!same_optional_point(a->geometry_target_point, b->geometry_target_point) ||
+			!same_optional_point(a->geometry_label_point, b->geometry_label_point)) {
+			printf("Edge %s geometry differs\n", a->id);
+			return 0;
+		}
+	}
+	return !a && !b;
+}
+
+/* the geometry inside a collapsed node is left intact on import with CYBERIADA_FLAG_COLLAPSED_GEOMETRY */
+static int test_collapsed_import(void)
+{
+	CyberiadaDocument orig, doc;
+	CyberiadaNode *orig_node, *node;
+	CyberiadaEdge *orig_edge, *edge;
+	const char* hidden[] = {"n0::n0::n0", "n0::n0::n1"};
+	size_t i;
+	int errors = 0;
+
+	if (decode_document(&orig, 0, CYBERIADA_FLAG_NO) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+	if (decode_document(&doc, 0, CYBERIADA_FLAG_NO) != CYBERIADA_NO_ERROR) {
+		cyberiada_cleanup_sm_document(&orig);
+		return 1;
+	}
+
+	node = cyberiada_graph_find_node_by_id(doc.state_machines->nodes, "n0::n0");
+	if (!node) {
+		printf("Collapsed node not found\n");
+		cyberiada_cleanup_sm_document(&doc);
+		cyberiada_cleanup_sm_document(&orig);
+		return 1;
+	}
+	node->collapsed_flag = 1;
+
+	if (cyberiada_import_document_geometry(&doc,
+										   CYBERIADA_FLAG_COLLAPSED_GEOMETRY |
+										   CYBERIADA_FLAG_NODES_ABSOLUTE_GEOMETRY |
+										   CYBERIADA_FLAG_EDGES_ABSOLUTE_GEOMETRY |
+										   CYBERIADA_FLAG_EDGES_PL_ABSOLUTE_GEOMETRY |
+										   CYBERIADA_FLAG_CENTER_EDGE_GEOMETRY,
+										   cybxmlCyberiada10) != CYBERIADA_NO_ERROR) {
+		printf("Geometry import error\n");
+		errors++;
+	}
+
+	for (i = 0; i < sizeof(hidden) / sizeof(hidden[0]); i++) {
+		orig_node = cyberiada_graph_find_node_by_id(orig.state_machines->nodes, hidden[i]);
+		node = cyberiada_graph_find_node_by_id(doc.state_machines->nodes, hidden[i]);
+		if (!node || !orig_node || !same_rect(node->geometry_rect, orig_node->geometry_rect)) {
+			printf("Hidden node %s geometry was lost on import\n", hidden[i]);
+			errors++;
+		}
+	}
+
+	for (orig_edge = orig.state_machines->edges, edge = doc.state_machines->edges;
+		 orig_edge && edge;
+		 orig_edge = orig_edge->next, edge = edge->next) {
+		if (strcmp(edge->id, "n0::n0::e0") == 0 &&
+			(!same_point(edge->geometry_source_point, orig_edge->geometry_source_point) ||
+			 !same_point(edge->geometry_target_point, orig_edge->geometry_target_point))) {
+			printf("Hidden edge %s geometry was lost on import\n", edge->id);
+			errors++;
+		}
+	}
+
+	node = cyberiada_graph_find_node_by_id(doc.state_machines->nodes, "n0::n0");
+	if (!node || !node->geometry_rect) {
+		printf("Collapsed node geometry was lost on import\n");
+		errors++;
+	}
+
+	cyberiada_cleanup_sm_document(&doc);
+	cyberiada_cleanup_sm_document(&orig);
+
+	printf("Collapsed geometry import: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+/* the parallel import reconstructs & converts the multi-SM document the same way as the sequential one */
+static int test_parallel_import(void)
+{
+	CyberiadaDocument seq, par;
+	CyberiadaSM *seq_sm, *par_sm;
+	int flags = (CYBERIADA_FLAG_NODES_ABSOLUTE_GEOMETRY |
+				 CYBERIADA_FLAG_EDGES_ABSOLUTE_GEOMETRY |
+				 CYBERIADA_FLAG_EDGES_PL_ABSOLUTE_GEOMETRY |
+				 CYBERIADA_FLAG_CENTER_EDGE_GEOMETRY |
+				 CYBERIADA_FLAG_RECONSTRUCT_GEOMETRY);
+	int errors = 0;
+
+	if (decode_multi_sm_document(&seq) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+	if (decode_multi_sm_document(&par) != CYBERIADA_NO_ERROR) {
+		cyberiada_cleanup_sm_document(&seq);
+		return 1;
+	}
+
+	if (cyberiada_import_document_geometry(&seq, flags, cybxmlCyberiada10) != CYBERIADA_NO_ERROR ||
+		cyberiada_import_document_geometry(&par, flags | CYBERIADA_FLAG_PARALLEL_GEOMETRY,
+										   cybxmlCyberiada10) != CYBERIADA_NO_ERROR) {
+		printf("Geometry import error\n");
+		errors++;
+	}
+
+	if (!same_optional_rect(seq.bounding_rect, par.bounding_rect)) {
+		printf("Document bounding rect differs\n");
+		errors++;
+	}
+	for (seq_sm = seq.state_machines, par_sm = par.state_machines;
+		 seq_sm && par_sm;
+		 seq_sm = seq_sm->next, par_sm = par_sm->next) {
+		if (!same_nodes_geometry(seq_sm->nodes, par_sm->nodes) ||
+			!same_edges_geometry(seq_sm->edges, par_sm->edges)) {
+			errors++;
+		}
+	}
+	if (seq_sm || par_sm) {
+		printf("Different number of SMs\n");
+		errors++;
+	}
+
+	cyberiada_cleanup_sm_document(&par);
+	cyberiada_cleanup_sm_document(&seq);
+
+	printf("Parallel geometry import: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+/* the exported node element has the geometry data (the XML text is checked since the Cyberiada */
+/* decoder does not accept the collapsed flag before the nested graph of the node)                */
+static int node_has_exported_geometry(const char* buffer, const char* id)
+{
+	char element[MAX_ID_LENGTH];
+	const char *start, *end, *geometry;
+
+	snprintf(element, sizeof(element), "<node id=\"%s\">", id);
+	start = strstr(buffer, element);
+	if (!start) {
+		return -1;
+	}
+	start += strlen(element);
+	end = strstr(start, "<node ");
+	if (!end) end = strstr(start, "</node>");
+	geometry = strstr(start, "<data key=\"dGeometry\">");
+	return geometry && (!end || geometry < end);
+}
+
+/* the collapsed node rect is exported while the geometry inside it is not */
+static int test_collapsed_export(void)
+{
+	CyberiadaDocument doc;
+	CyberiadaNode* node;
+	const char* hidden[] = {"n0::n0::n0", "n0::n0::n1"};
+	char* buffer = NULL;
+	size_t buffer_size = 0, i;
+	int errors = 0;
+
+	if (decode_document(&doc, 0, CYBERIADA_FLAG_NO) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+	node = cyberiada_graph_find_node_by_id(doc.state_machines->nodes, "n0::n0");
+	if (node) {
+		node->collapsed_flag = 1;
+	}
+
+	if (cyberiada_encode_sm_document(&doc, &buffer, &buffer_size, cybxmlCyberiada10,
+									 CYBERIADA_FLAG_COLLAPSED_GEOMETRY) != CYBERIADA_NO_ERROR) {
+		printf("Document encoding error\n");
+		cyberiada_cleanup_sm_document(&doc);
+		return 1;
+	}
+	for (i = 0; i < sizeof(hidden) / sizeof(hidden[0]); i++) {
+		if (node_has_exported_geometry(buffer, hidden[i]) != 0) {
+			printf("Hidden node %s geometry was exported\n", hidden[i]);
+			errors++;
+		}
+	}
+	if (node_has_exported_geometry(buffer, "n0::n0") != 1 ||
+		node_has_exported_geometry(buffer, "n0::n1") != 1) {
+		printf("Collapsed or visible node geometry was not exported\n");
+		errors++;
+	}
+
+	free(buffer);
+	cyberiada_cleanup_sm_document(&doc);
+
+	printf("Collapsed geometry export: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+/* the cached absolute rects follow the geometry changes (the user ones after the invalidation) */
+static int test_absolute_cache(void)
+{
+	CyberiadaDocument doc;
+	CyberiadaSM* sm;
+	CyberiadaNode *parent, *node;
+	CyberiadaRect rect, moved;
+	int errors = 0;
+
+	if (decode_document(&doc, 0, CYBERIADA_FLAG_NO) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+	sm = doc.state_machines;
+	parent = cyberiada_graph_find_node_by_id(sm->nodes, "n0");
+	node = cyberiada_graph_find_node_by_id(sm->nodes, "n0::n0::n0");
+
+	if (!parent || !node ||
+		cyberiada_node_absolute_rect(&doc, sm, node, &rect) != CYBERIADA_NO_ERROR) {
+		printf("Cannot get the node absolute rect\n");
+		cyberiada_cleanup_sm_document(&doc);
+		return 1;
+	}
+
+	/* the nested nodes move with the parent */
+	parent->geometry_rect->x += 50.0;
+	cyberiada_invalidate_sm_absolute_geometry(sm);
+	if (cyberiada_node_absolute_rect(&doc, sm, node, &moved) != CYBERIADA_NO_ERROR ||
+		moved.x != rect.x + 50.0 || moved.y != rect.y ||
+		moved.width != rect.width || moved.height != rect.height) {
+		printf("The absolute rect does not follow the parent move\n");
+		errors++;
+	}
+
+	/* the library geometry functions invalidate the cache themselves */
+	if (cyberiada_convert_document_geometry(&doc, coordAbsolute, coordAbsolute, coordAbsolute,
+											edgeCenter) != CYBERIADA_NO_ERROR) {
+		printf("Geometry conversion error\n");
+		errors++;
+	} else if (cyberiada_node_absolute_rect(&doc, sm, node, &rect) != CYBERIADA_NO_ERROR ||
+			   !same_rect(&rect, node->geometry_rect)) {
+		printf("The absolute rect differs from the node geometry in the absolute coordinates\n");
+		errors++;
+	}
+
+	cyberiada_cleanup_sm_document(&doc);
+
+	printf("Absolute geometry cache: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+static int decode_clipped_document(CyberiadaDocument* doc, CyberiadaDecodeOptions* options,
+								   double x, double y, double width, double height)
+{
+	CyberiadaRect viewport;
+	int res;
+
+	viewport.x = x;
+	viewport.y = y;
+	viewport.width = width;
+	viewport.height = height;
+	memset(options, 0, sizeof(CyberiadaDecodeOptions));
+	options->viewport = &viewport;
+	cyberiada_init_sm_document(doc);
+	res = cyberiada_decode_sm_document_with_options(doc, test_documents[0], strlen(test_documents[0]),
+													cybxmlCyberiada10, options);
+	options->viewport = NULL;
+	if (res != CYBERIADA_NO_ERROR) {
+		printf("Clipped document decoding error %d\n", res);
+		cyberiada_cleanup_sm_document(doc);
+	}
+	return res;
+}
+
+/* the geometry outside the viewport is skipped, the SM structure is complete */
+static int test_clipped_decoding(void)
+{
+	CyberiadaDocument doc;
+	CyberiadaDecodeOptions options;
+	CyberiadaNode* node;
+	CyberiadaEdge* edge;
+	const char* visible[] = {"n0", "n0::n0", "n0::n0::n0"};
+	const char* clipped[] = {"n0::n0::n1", "n0::n1"};
+	size_t i;
+	int errors = 0;
+
+	/* the viewport covers the top-left part of the outer node */
+	if (decode_clipped_document(&doc, &options, 0.0, 0.0, 250.0, 250.0) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+	for (i = 0; i < sizeof(visible) / sizeof(visible[0]); i++) {
+		node = cyberiada_graph_find_node_by_id(doc.state_machines->nodes, visible[i]);
+		if (!node || !node->geometry_rect) {
+			printf("Visible node %s geometry was clipped\n", visible[i]);
+			errors++;
+		}
+	}
+	for (i = 0; i < sizeof(clipped) / sizeof(clipped[0]); i++) {
+		node = cyberiada_graph_find_node_by_id(doc.state_machines->nodes, clipped[i]);
+		if (!node || node->geometry_rect) {
+			printf("Node %s outside the viewport is missing or has geometry\n", clipped[i]);
+			errors++;
+		}
+	}
+	if (options.clipped_nodes != 2 || options.clipped_edges != 0) {
+		printf("Wrong clipping counters %lu/%lu\n", options.clipped_nodes, options.clipped_edges);
+		errors++;
+	}
+	cyberiada_cleanup_sm_document(&doc);
+
+	/* the viewport misses the document: the descendants & the edges geometry is clipped too */
+	if (decode_clipped_document(&doc, &options, 600.0, 600.0, 100.0, 100.0) != CYBERIADA_NO_ERROR) {
+		return errors + 1;
+	}
+	for (edge = doc.state_machines->edges, i = 0; edge; edge = edge->next, i++) {
+		if (edge->geometry_source_point || edge->geometry_target_point) {
+			printf("Edge %s geometry outside the viewport was kept\n", edge->id);
+			errors++;
+		}
+	}
+	if (i != 2 || options.clipped_nodes != 5 || options.clipped_edges != 2) {
+		printf("Wrong clipped SM structure or counters %lu/%lu\n", options.clipped_nodes, options.clipped_edges);
+		errors++;
+	}
+	cyberiada_cleanup_sm_document(&doc);
+
+	printf("Clipped geometry decoding: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+int main(void)
+{
+	int errors = 0;
+	errors += test_collapsed_import();
+	errors += test_collapsed_export();
+	errors += test_parallel_import();
+	errors += test_absolute_cache();
+	errors += test_clipped_decoding();
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,613 @@
+/* -----------------------------------------------------------------------------
+ * The Cyberiada GraphML library implemention
+ *
+ * The SM graph indexes, analysis & editing testing program
+ *
+ * Copyright (C) 2025 Alexey Fedoseev <aleksey@fedoseev.net>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see https://www.gnu.org/licenses/
+ * ----------------------------------------------------------------------------- */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "cyberiadaml.h"
+#include "cyb_types.h"
+
+/* init -> A (A::init -> A::A1 <-> A::A2) -> B <- C; C is unreachable, B is dead */
+static const char* test_document =
+	"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	"<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+	"  <data key=\"gFormat\">Cyberiada-GraphML-1.0</data>\n"
+	"  <key id=\"gFormat\" for=\"graphml\" attr.name=\"format\" attr.type=\"string\"/>\n"
+	"  <key id=\"dName\" for=\"graph\" attr.name=\"name\" attr.type=\"string\"/>\n"
+	"  <key id=\"dName\" for=\"node\" attr.name=\"name\" attr.type=\"string\"/>\n"
+	"  <key id=\"dStateMachine\" for=\"graph\" attr.name=\"stateMachine\" attr.type=\"string\"/>\n"
+	"  <key id=\"dNote\" for=\"node\" attr.name=\"note\" attr.type=\"string\"/>\n"
+	"  <key id=\"dVertex\" for=\"node\" attr.name=\"vertex\" attr.type=\"string\"/>\n"
+	"  <key id=\"dPivot\" for=\"edge\" attr.name=\"pivot\" attr.type=\"string\"/>\n"
+	"  <key id=\"dData\" for=\"node\" attr.name=\"data\" attr.type=\"string\"/>\n"
+	"  <key id=\"dData\" for=\"edge\" attr.name=\"data\" attr.type=\"string\"/>\n"
+	"  <graph id=\"G\" edgedefault=\"directed\">\n"
+	"    <data key=\"dStateMachine\"/>\n"
+	"    <data key=\"dName\">machine</data>\n"
+	"    <node id=\"nMeta\">\n"
+	"      <data key=\"dNote\">formal</data>\n"
+	"      <data key=\"dName\">CGML_META</data>\n"
+	"      <data key=\"dData\">standardVersion/ 1.0\n\n</data>\n"
+	"    </node>\n"
+	"    <node id=\"init\">\n"
+	"      <data key=\"dVertex\">initial</data>\n"
+	"    </node>\n"
+	"    <node id=\"A\">\n"
+	"      <data key=\"dName\">A</data>\n"
+	"      <data key=\"dData\">entry/\nenterA()\n\nexit/\nexitA()\n</data>\n"
+	"      <graph id=\"A:\" edgedefault=\"directed\">\n"
+	"        <node id=\"A::init\">\n"
+	"          <data key=\"dVertex\">initial</data>\n"
+	"        </node>\n"
+	"        <node id=\"A::A1\">\n"
+	"          <data key=\"dName\">A1</data>\n"
+	"          <data key=\"dData\">entry/\nenterA1()\n</data>\n"
+	"        </node>\n"
+	"        <node id=\"A::A2\">\n"
+	"          <data key=\"dName\">A2</data>\n"
+	"        </node>\n"
+	"      </graph>\n"
+	"    </node>\n"
+	"    <node id=\"B\">\n"
+	"      <data key=\"dName\">B</data>\n"
+	"    </node>\n"
+	"    <node id=\"C\">\n"
+	"      <data key=\"dName\">C</data>\n"
+	"    </node>\n"
+	"    <node id=\"note\">\n"
+	"      <data key=\"dNote\">informal</data>\n"
+	"      <data key=\"dData\">a comment</data>\n"
+	"    </node>\n"
+	"    <edge id=\"e0\" source=\"init\" target=\"A\"/>\n"
+	"    <edge id=\"e1\" source=\"A::init\" target=\"A::A1\"/>\n"
+	"    <edge id=\"e2\" source=\"A::A1\" target=\"A::A2\">\n"
+	"      <data key=\"dData\">ev1/ go()</data>\n"
+	"    </edge>\n"
+	"    <edge id=\"e3\" source=\"A::A2\" target=\"A::A1\">\n"
+	"      <data key=\"dData\">ev2/</data>\n"
+	"    </edge>\n"
+	"    <edge id=\"e4\" source=\"A\" target=\"B\">\n"
+	"      <data key=\"dData\">ev3/ leave()</data>\n"
+	"    </edge>\n"
+	"    <edge id=\"e5\" source=\"C\" target=\"B\">\n"
+	"      <data key=\"dData\">ev4/</data>\n"
+	"    </edge>\n"
+	"    <edge id=\"e6\" source=\"note\" target=\"A\">\n"
+	"      <data key=\"dPivot\"/>\n"
+	"    </edge>\n"
+	"  </graph>\n"
+	"</graphml>\n";
+
+static int decode_document(CyberiadaDocument* doc)
+{
+	int res;
+	cyberiada_init_sm_document(doc);
+	res = cyberiada_decode_sm_document(doc, test_document, strlen(test_document),
+									   cybxmlCyberiada10, CYBERIADA_FLAG_NO);
+	if (res != CYBERIADA_NO_ERROR) {
+		printf("Document decoding error %d\n", res);
+		cyberiada_cleanup_sm_document(doc);
+	}
+	return res;
+}
+
+static CyberiadaNode* find_node(CyberiadaSM* sm, const char* id)
+{
+	return cyberiada_graph_find_node_by_id(sm->nodes, id);
+}
+
+static CyberiadaEdge* find_edge(CyberiadaSM* sm, const char* id)
+{
+	CyberiadaEdge* edge;
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if (strcmp(edge->id, id) == 0) {
+			return edge;
+		}
+	}
+	return NULL;
+}
+
+/* -----------------------------------------------------------------------------
+ * The SM indexes (ordinals, adjacency & hierarchy) are compared with the
+ * straightforward walks over the current SM lists, so the stale indexes left
+ * after the SM modifications are detected
+ * ----------------------------------------------------------------------------- */
+
+static size_t count_nodes(const CyberiadaNode* node)
+{
+	size_t count = 0;
+	for (; node; node = node->next) {
+		count += 1 + count_nodes(node->children);
+	}
+	return count;
+}
+
+static void collect_nodes(CyberiadaNode* node, CyberiadaNode** nodes, size_t* count)
+{
+	for (; node; node = node->next) {
+		nodes[(*count)++] = node;
+		collect_nodes(node->children, nodes, count);
+	}
+}
+
+static size_t node_depth(const CyberiadaNode* node)
+{
+	size_t depth = 0;
+	for (node = node->parent; node; node = node->parent) {
+		depth++;
+	}
+	return depth;
+}
+
+static int node_is_ancestor(const CyberiadaNode* ancestor, const CyberiadaNode* node)
+{
+	for (node = node->parent; node; node = node->parent) {
+		if (node == ancestor) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static const CyberiadaNode* nodes_lca(const CyberiadaNode* node1, const CyberiadaNode* node2)
+{
+	for (; node1; node1 = node1->parent) {
+		if (node1 == node2 || node_is_ancestor(node1, node2)) {
+			return node1;
+		}
+	}
+	return NULL;
+}
+
+static int check_node_edges(CyberiadaSM* sm, CyberiadaNode* node, int out)
+{
+	CyberiadaEdge* const* edges;
+	CyberiadaEdge* edge;
+	size_t count, i = 0;
+	int res;
+
+	res = (out ?
+		   cyberiada_node_out_edges(sm, node, &edges, &count) :
+		   cyberiada_node_in_edges(sm, node, &edges, &count));
+	if (res != CYBERIADA_NO_ERROR) {
+		printf("Node %s %s edges error %d\n", node->id, out ? "outgoing" : "incoming", res);
+		return 1;
+	}
+	for (edge = sm->edges; edge; edge = edge->next) {
+		if ((out ? edge->source : edge->target) != node) continue;
+		if (i >= count || edges[i] != edge) {
+			printf("Node %s %s edges differ from the SM edges\n", node->id, out ? "outgoing" : "incoming");
+			return 1;
+		}
+		i++;
+	}
+	if (i != count) {
+		printf("Node %s has %lu %s edges instead of %lu\n", node->id, count, out ? "outgoing" : "incoming", i);
+		return 1;
+	}
+	return 0;
+}
+
+static int check_sm_indexes(CyberiadaSM* sm, const char* stage)
+{
+	CyberiadaNode** nodes;
+	CyberiadaNode* const* ordinal_nodes;
+	CyberiadaEdge* const* ordinal_edges;
+	CyberiadaNode* lca;
+	CyberiadaEdge* edge;
+	size_t nodes_count = 0, count, ordinal, pre, depth, i, j;
+	int errors = 0, result;
+
+	nodes = (CyberiadaNode**)malloc(sizeof(CyberiadaNode*) * (count_nodes(sm->nodes) + 1));
+	collect_nodes(sm->nodes, nodes, &nodes_count);
+
+	/* the ordinals */
+	if (cyberiada_sm_ordinal_nodes(sm, &ordinal_nodes, &count) != CYBERIADA_NO_ERROR || count != nodes_count) {
+		printf("Wrong number of the node ordinals\n");
+		errors++;
+	} else {
+		for (i = 0; i < nodes_count; i++) {
+			if (ordinal_nodes[i] != nodes[i] ||
+				cyberiada_node_ordinal(sm, nodes[i], &ordinal) != CYBERIADA_NO_ERROR || ordinal != i) {
+				printf("Wrong node %s ordinal\n", nodes[i]->id);
+				errors++;
+			}
+		}
+	}
+	if (cyberiada_sm_ordinal_edges(sm, &ordinal_edges, &count) != CYBERIADA_NO_ERROR) {
+		printf("Cannot get the edge ordinals\n");
+		errors++;
+	} else {
+		for (edge = sm->edges, i = 0; edge; edge = edge->next, i++) {
+			if (i >= count || ordinal_edges[i] != edge ||
+				cyberiada_edge_ordinal(sm, edge, &ordinal) != CYBERIADA_NO_ERROR || ordinal != i) {
+				printf("Wrong edge %s ordinal\n", edge->id);
+				errors++;
+			}
+		}
+		if (i != count) {
+			printf("Wrong number of the edge ordinals\n");
+			errors++;
+		}
+	}
+
+	for (i = 0; i < nodes_count; i++) {
+		/* the adjacency */
+		errors += check_node_edges(sm, nodes[i], 1);
+		errors += check_node_edges(sm, nodes[i], 0);
+		/* the hierarchy */
+		if (cyberiada_node_hierarchy_position(sm, nodes[i], &pre, NULL, &depth) != CYBERIADA_NO_ERROR ||
+			pre != i || depth != node_depth(nodes[i])) {
+			printf("Wrong node %s hierarchy position\n", nodes[i]->id);
+			errors++;
+		}
+		for (j = 0; j < nodes_count; j++) {
+			if (cyberiada_node_is_ancestor(sm, nodes[i], nodes[j], &result) != CYBERIADA_NO_ERROR ||
+				result != node_is_ancestor(nodes[i], nodes[j])) {
+				printf("Wrong ancestor check of the nodes %s & %s\n", nodes[i]->id, nodes[j]->id);
+				errors++;
+			}
+			if (cyberiada_nodes_lca(sm, nodes[i], nodes[j], &lca) != CYBERIADA_NO_ERROR ||
+				lca != nodes_lca(nodes[i], nodes[j])) {
+				printf("Wrong LCA of the nodes %s & %s\n", nodes[i]->id, nodes[j]->id);
+				errors++;
+			}
+		}
+	}
+
+	free(nodes);
+	if (errors) {
+		printf("The SM indexes are wrong %s\n", stage);
+	}
+	return errors;
+}
+
+/* the indexes follow the SM changes made by the editor & by the user (with the invalidation) */
+static int test_indexes(void)
+{
+	CyberiadaDocument doc;
+	CyberiadaSMEditor* editor = NULL;
+	CyberiadaSM* sm;
+	CyberiadaNode *node, *region;
+	CyberiadaEdge *edge, *prev;
+	CyberiadaEdge* const* edges;
+	size_t count;
+	int errors = 0;
+
+	if (decode_document(&doc) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+	sm = doc.state_machines;
+
+	errors += check_sm_indexes(sm, "after decoding");
+
+	if (cyberiada_new_sm_editor(sm, &editor) != CYBERIADA_NO_ERROR) {
+		printf("Cannot create the SM editor\n");
+		cyberiada_cleanup_sm_document(&doc);
+		return errors + 1;
+	}
+	region = find_node(sm, "A:");
+
+	node = cyberiada_new_node("A::A3");
+	if (cyberiada_sm_editor_add_node(editor, region, node) != CYBERIADA_NO_ERROR) {
+		printf("Cannot add the node\n");
+		cyberiada_destroy_node(node);
+		errors++;
+	}
+	errors += check_sm_indexes(sm, "after adding the node");
+
+	edge = cyberiada_new_edge("e7", "B", "A::A3", 0);
+	if (cyberiada_sm_editor_add_edge(editor, edge) != CYBERIADA_NO_ERROR) {
+		printf("Cannot add the edge\n");
+		cyberiada_destroy_edge(edge);
+		errors++;
+	}
+	errors += check_sm_indexes(sm, "after adding the edge");
+
+	if (cyberiada_sm_editor_move_node(editor, find_node(sm, "C"), region) != CYBERIADA_NO_ERROR) {
+		printf("Cannot move the node\n");
+		errors++;
+	}
+	errors += check_sm_indexes(sm, "after moving the node");
+
+	if (cyberiada_sm_editor_remove_edge(editor, find_edge(sm, "e5")) != CYBERIADA_NO_ERROR) {
+		printf("Cannot remove the edge\n");
+		errors++;
+	}
+	errors += check_sm_indexes(sm, "after removing the edge");
+
+	/* the incident edges of the removed subtree are removed too */
+	if (cyberiada_sm_editor_remove_node(editor, find_node(sm, "A::A2")) != CYBERIADA_NO_ERROR) {
+		printf("Cannot remove the node\n");
+		errors++;
+	}
+	if (find_node(sm, "A::A2") || find_edge(sm, "e2") || find_edge(sm, "e3") ||
+		cyberiada_sm_editor_find_node(editor, "A::A2") || cyberiada_sm_editor_find_edge(editor, "e2")) {
+		printf("The removed node or its edges are still in the SM\n");
+		errors++;
+	}
+	errors += check_sm_indexes(sm, "after removing the node");
+
+	if (cyberiada_sm_editor_node_edges(editor, find_node(sm, "B"), &edges, &count) != CYBERIADA_NO_ERROR ||
+		count != 2) {
+		printf("Wrong number of the node B incident edges\n");
+		errors++;
+	}
+	cyberiada_destroy_sm_editor(editor);
+
+	/* the user modification with the explicit invalidation */
+	for (prev = NULL, edge = sm->edges; edge && strcmp(edge->id, "e4") != 0; prev = edge, edge = edge->next);
+	if (edge) {
+		if (prev) {
+			prev->next = edge->next;
+		} else {
+			sm->edges = edge->next;
+		}
+		edge->next = NULL;
+		cyberiada_destroy_edge(edge);
+	}
+	cyberiada_invalidate_sm_ordinals(sm);
+	errors += check_sm_indexes(sm, "after the user modification");
+
+	cyberiada_cleanup_sm_document(&doc);
+
+	printf("SM indexes: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+/* the node arrays are compared with the expected identifiers in any order */
+static int same_node_ids(CyberiadaNode** nodes, size_t count, const char** ids, size_t ids_count)
+{
+	size_t i, j;
+	if (count != ids_count) {
+		return 0;
+	}
+	for (i = 0; i < ids_count; i++) {
+		for (j = 0; j < count && strcmp(nodes[j]->id, ids[i]) != 0; j++);
+		if (j == count) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int test_analysis(void)
+{
+	CyberiadaDocument doc;
+	CyberiadaSMAnalysis* analysis = NULL;
+	const char* unreachable[] = {"C"};
+	const char* dead[] = {"B"};
+	const char* scc[] = {"A::A1", "A::A2"};
+	int errors = 0;
+
+	if (decode_document(&doc) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+
+	if (cyberiada_analyze_sm(doc.state_machines, &analysis) != CYBERIADA_NO_ERROR) {
+		printf("SM analysis error\n");
+		cyberiada_cleanup_sm_document(&doc);
+		return 1;
+	}
+	if (!analysis->initial || strcmp(analysis->initial->id, "init") != 0) {
+		printf("Wrong initial pseudostate\n");
+		errors++;
+	}
+	if (!same_node_ids(analysis->unreachable, analysis->unreachable_count, unreachable, 1) ||
+		analysis->unreachable_composites_count != 0) {
+		printf("Wrong unreachable nodes\n");
+		errors++;
+	}
+	if (!same_node_ids(analysis->dead, analysis->dead_count, dead, 1)) {
+		printf("Wrong dead nodes\n");
+		errors++;
+	}
+	if (analysis->scc_count != 1 ||
+		!same_node_ids(analysis->scc_nodes + analysis->scc_offsets[0],
+					   analysis->scc_offsets[1] - analysis->scc_offsets[0], scc, 2)) {
+		printf("Wrong strongly connected components\n");
+		errors++;
+	}
+
+	cyberiada_destroy_sm_analysis(analysis);
+	cyberiada_cleanup_sm_document(&doc);
+
+	printf("SM analysis: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+static int same_actions(const CyberiadaFlatTable* table, size_t offset, size_t count,
+						const char** actions, size_t actions_count)
+{
+	size_t i;
+	if (count != actions_count) {
+		return 0;
+	}
+	for (i = 0; i < count; i++) {
+		if (strcmp(table->actions[offset + i], actions[i]) != 0) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int test_flatten(void)
+{
+	CyberiadaDocument doc;
+	CyberiadaFlatTable* table = NULL;
+	const CyberiadaFlatTransition* row;
+	const char* initial_actions[] = {"enterA()", "enterA1()"};
+	const char* leave_actions[] = {"leave()", "exitA()"};
+	const char* states[] = {"A::A1", "A::A2", "B", "C"};
+	size_t i, rows = 0;
+	int errors = 0;
+
+	if (decode_document(&doc) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+
+	if (cyberiada_flatten_sm(&doc, doc.state_machines, &table) != CYBERIADA_NO_ERROR) {
+		printf("SM flattening error\n");
+		cyberiada_cleanup_sm_document(&doc);
+		return 1;
+	}
+	if (!same_node_ids(table->states, table->states_count, states, 4)) {
+		printf("Wrong flat states\n");
+		errors++;
+	} else {
+		if (table->initial_state == CYBERIADA_FLAT_NO_STATE ||
+			strcmp(table->states[table->initial_state]->id, "A::A1") != 0 ||
+			!same_actions(table, table->initial_actions_offset, table->initial_actions_count, initial_actions, 2)) {
+			printf("Wrong flat initial state\n");
+			errors++;
+		}
+		/* the transitions of the composite state apply to the substates */
+		for (i = 0; i < table->transitions_count; i++) {
+			row = table->transitions + i;
+			if (strcmp(table->events[row->event], "ev3") != 0) continue;
+			rows++;
+			if (strcmp(row->target_node->id, "B") != 0 ||
+				!same_actions(table, row->actions_offset, row->actions_count, leave_actions, 2)) {
+				printf("Wrong flat transition of the state %s\n", table->states[row->state]->id);
+				errors++;
+			}
+		}
+		if (rows != 2) {
+			printf("Wrong number of the inherited flat transitions\n");
+			errors++;
+		}
+	}
+
+	cyberiada_destroy_flat_table(table);
+	cyberiada_cleanup_sm_document(&doc);
+
+	printf("SM flattening: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+/* the write access & the shared editor do not change the document seen by the other handles */
+static int test_shared_document(void)
+{
+	CyberiadaDocument* doc = cyberiada_new_sm_document();
+	CyberiadaSharedDocument *shared = NULL, *copy = NULL;
+	CyberiadaSMEditor* editor = NULL;
+	CyberiadaDocument* write_doc = NULL;
+	CyberiadaSM* sm;
+	size_t refs = 0;
+	int errors = 0;
+
+	if (decode_document(doc) != CYBERIADA_NO_ERROR) {
+		free(doc);
+		return 1;
+	}
+	if (cyberiada_new_shared_document(doc, &shared) != CYBERIADA_NO_ERROR ||
+		cyberiada_shared_document_copy(shared, &copy) != CYBERIADA_NO_ERROR) {
+		printf("Cannot create the shared document\n");
+		if (shared) cyberiada_destroy_shared_document(shared);
+		else cyberiada_destroy_sm_document(doc);
+		return 1;
+	}
+
+	if (cyberiada_shared_document_read(copy) != doc ||
+		cyberiada_shared_document_refs(shared, &refs) != CYBERIADA_NO_ERROR || refs != 2) {
+		printf("The shared document copy does not share the document\n");
+		errors++;
+	}
+
+	sm = cyberiada_shared_document_read(copy)->state_machines;
+	if (cyberiada_new_shared_sm_editor(copy, sm, &editor) != CYBERIADA_NO_ERROR) {
+		printf("Cannot create the shared SM editor\n");
+		errors++;
+	} else {
+		if (cyberiada_sm_editor_remove_node(editor, cyberiada_sm_editor_find_node(editor, "C")) != CYBERIADA_NO_ERROR) {
+			printf("Cannot remove the node\n");
+			errors++;
+		}
+		sm = cyberiada_sm_editor_sm(editor);
+		if (sm == doc->state_machines || find_node(sm, "C") || !find_node(doc->state_machines, "C")) {
+			printf("The shared SM editor changed the shared document\n");
+			errors++;
+		}
+		errors += check_sm_indexes(sm, "after the shared document editing");
+		cyberiada_destroy_sm_editor(editor);
+	}
+
+	if (cyberiada_shared_document_refs(shared, &refs) != CYBERIADA_NO_ERROR || refs != 1 ||
+		cyberiada_shared_document_write(shared, &write_doc) != CYBERIADA_NO_ERROR || write_doc != doc) {
+		printf("The unshared document was copied on write\n");
+		errors++;
+	}
+
+	cyberiada_destroy_shared_document(copy);
+	cyberiada_destroy_shared_document(shared);
+
+	printf("Shared document: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+/* the isomorphism check leaves the SM indexes as is */
+static int test_isomorphism_indexes(void)
+{
+	CyberiadaDocument doc1, doc2;
+	CyberiadaSM *sm1, *sm2;
+	int flags = 0, errors = 0;
+
+	if (decode_document(&doc1) != CYBERIADA_NO_ERROR) {
+		return 1;
+	}
+	if (decode_document(&doc2) != CYBERIADA_NO_ERROR) {
+		cyberiada_cleanup_sm_document(&doc1);
+		return 1;
+	}
+	sm1 = doc1.state_machines;
+	sm2 = doc2.state_machines;
+
+	errors += check_sm_indexes(sm1, "before the isomorphism check");
+	if (cyberiada_check_isomorphism(sm1, sm2, 0, 0, &flags, NULL,
+									NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+									NULL, NULL, NULL, NULL, NULL, NULL, NULL) != CYBERIADA_NO_ERROR ||
+		flags != CYBERIADA_ISOMORPH_FLAG_IDENTICAL) {
+		printf("The same SMs are not identical (flags 0x%x)\n", flags);
+		errors++;
+	}
+	if (sm2->ordinals || sm2->adjacency || sm2->hierarchy) {
+		printf("The isomorphism check built the SM indexes\n");
+		errors++;
+	}
+	errors += check_sm_indexes(sm1, "after the isomorphism check");
+
+	cyberiada_cleanup_sm_document(&doc2);
+	cyberiada_cleanup_sm_document(&doc1);
+
+	printf("Isomorphism check indexes: %s\n", errors ? "FAILED" : "OK");
+	return errors;
+}
+
+int main(void)
+{
+	int errors = 0;
+	errors += test_indexes();
+	errors += test_analysis();
+	errors += test_flatten();
+	errors += test_shared_document();
+	errors += test_isomorphism_indexes();
+	return errors ? 1 : 0;
+}